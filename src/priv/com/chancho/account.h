@@ -34,7 +34,9 @@ namespace chancho {
 
 class Account {
     friend class Book;
+    friend class Forecast;
     friend class Stats;
+    friend class Snapshot;
 
  public:
     Account() = default;
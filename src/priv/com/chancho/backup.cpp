@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <glog/logging.h>
+#include <sqlite3.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QThread>
+
+#include "backup.h"
+#include "book.h"
+#include "updater.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+    const QString BACKUPS_DIR = "backups";
+    const QString BACKUP_NAME = "chancho-%1.db";
+    const QString BACKUP_DATE_FORMAT = "yyyyMMdd-hhmmsszzz";
+    const QString BACKUP_FILTER = "chancho-*.db";
+    const QString PARTIAL_SUFFIX = ".part";
+    // the archives of the book are copied next to the backup, the name does not match the filter of the backups
+    const QString BACKUP_ARCHIVE_NAME = "%1-archive-%2";
+    const QString BACKUP_ARCHIVE_FILTER = "%1-archive-*";
+    const char* QUICK_CHECK = "PRAGMA quick_check";
+    const char* SELECT_TABLE = "SELECT name FROM sqlite_master WHERE type='table' AND name=?1 COLLATE NOCASE";
+    // the books made before the archives do not have the table and have no archived years
+    const char* SELECT_ARCHIVED_YEARS = "SELECT year, transactions FROM ArchivedYears";
+    const char* COUNT_TRANSACTIONS = "SELECT COUNT(*) FROM Transactions";
+    // times a step is retried when the book holds a lock
+    const int BUSY_RETRIES = 100;
+}
+
+Backup::Backup(int maxBackups)
+    : _maxBackups(maxBackups) {
+}
+
+QString
+Backup::backupsPath() {
+    QFileInfo dbInfo(Book::databasePath());
+    QDir dir(dbInfo.absolutePath());
+    if (!dir.exists(BACKUPS_DIR)) {
+        auto wasMade = dir.mkpath(BACKUPS_DIR);
+        if (!wasMade)
+            LOG(ERROR) << "Could not create backups dir in " << dir.absolutePath().toStdString();
+    }
+    return dir.absoluteFilePath(BACKUPS_DIR);
+}
+
+QStringList
+Backup::backups() {
+    QStringList result;
+    QDir dir(backupsPath());
+    // the date is part of the name, sorting by name gives the backups in creation order
+    foreach(const QString& name, dir.entryList(QStringList() << BACKUP_FILTER, QDir::Files, QDir::Name | QDir::Reversed)) {
+        result.append(dir.absoluteFilePath(name));
+    }
+    return result;
+}
+
+bool
+Backup::isDue(int days, QDateTime now) {
+    auto stored = backups();
+    if (stored.isEmpty()) {
+        return true;
+    }
+    auto newest = QFileInfo(stored.first()).lastModified();
+    return newest.addDays(days) <= now;
+}
+
+QString
+Backup::backup(BackupProgress progress, int pagesPerStep) {
+    _lastError = QString::null;
+    if (pagesPerStep <= 0) {
+        pagesPerStep = BACKUP_PAGES_PER_STEP;
+    }
+
+    QDir dir(backupsPath());
+    auto path = dir.absoluteFilePath(BACKUP_NAME.arg(QDateTime::currentDateTime().toString(BACKUP_DATE_FORMAT)));
+
+    // the copy is written to a partial file so that an interrupted backup is never listed
+    auto partial = path + PARTIAL_SUFFIX;
+    QFile::remove(partial);
+    if (!copy(Book::databasePath(), partial, progress, pagesPerStep)) {
+        QFile::remove(partial);
+        return QString();
+    }
+
+    // the archives are copied after the book so that they are checked against its archived years, a transaction
+    // of an archived year that was changed meanwhile leaves the archive with a different number of transactions
+    QStringList archives;
+    auto archived = archivedYears(partial);
+    foreach(int year, archived.keys()) {
+        auto archivePartial = BACKUP_ARCHIVE_NAME.arg(path, QString::number(year)) + PARTIAL_SUFFIX;
+        archives.append(archivePartial);
+        QFile::remove(archivePartial);
+        if (!copy(Book::archivePath(year), archivePartial, BackupProgress(), pagesPerStep)) {
+            break;
+        }
+        if (!isValidArchive(archivePartial, archived[year])) {
+            _lastError = QString("The archive of %1 changed while it was copied.").arg(year);
+            LOG(ERROR) << _lastError.toStdString();
+            break;
+        }
+    }
+
+    if (isError()) {
+        QFile::remove(partial);
+        foreach(const QString& archivePartial, archives) {
+            QFile::remove(archivePartial);
+        }
+        return QString();
+    }
+
+    // the book is moved the last so that it is not listed without its archives
+    foreach(const QString& archivePartial, archives) {
+        auto archivePath = archivePartial.left(archivePartial.length() - PARTIAL_SUFFIX.length());
+        QFile::remove(archivePath);
+        if (!QFile::rename(archivePartial, archivePath)) {
+            _lastError = "Could not move the archive to " + archivePath;
+            LOG(ERROR) << _lastError.toStdString();
+            break;
+        }
+    }
+
+    QFile::remove(path);
+    if (!isError() && !QFile::rename(partial, path)) {
+        _lastError = "Could not move the backup to " + path;
+        LOG(ERROR) << _lastError.toStdString();
+    }
+
+    if (isError()) {
+        QFile::remove(partial);
+        removeArchives(path);
+        foreach(const QString& archivePartial, archives) {
+            QFile::remove(archivePartial);
+        }
+        return QString();
+    }
+
+    rotate();
+    return path;
+}
+
+bool
+Backup::restore(QString path) {
+    _lastError = QString::null;
+    if (!isValidBook(path)) {
+        return false;
+    }
+
+    // the archived years of the backup must have their archives, otherwise the book would miss their transactions
+    auto archived = archivedYears(path);
+    foreach(int year, archived.keys()) {
+        if (!isValidArchive(BACKUP_ARCHIVE_NAME.arg(path, QString::number(year)), archived[year])) {
+            _lastError = QString("The backup %1 does not have a valid archive of %2.").arg(path).arg(year);
+            LOG(ERROR) << _lastError.toStdString();
+            return false;
+        }
+    }
+    auto current = archivedYears(Book::databasePath());
+
+    // the pages of the backup replace those of the database, there is no need to wait for the book between steps
+    if (!copy(path, Book::databasePath(), BackupProgress(), -1)) {
+        return false;
+    }
+
+    foreach(int year, archived.keys()) {
+        auto archivePath = BACKUP_ARCHIVE_NAME.arg(path, QString::number(year));
+        if (!copy(archivePath, Book::archivePath(year), BackupProgress(), -1)) {
+            return false;
+        }
+    }
+
+    // the archives of the years that were not archived when the backup was made would be merged with the year
+    // when it is archived again
+    foreach(int year, current.keys()) {
+        if (!archived.contains(year)) {
+            QFile::remove(Book::archivePath(year));
+        }
+    }
+
+    // backups made by older versions are upgraded and migrated as any other database
+    Book::prepareDatabase();
+    Updater updater;
+    if (updater.needsUpgrade() || (updater.needsMigration() && !updater.migrate())) {
+        _lastError = "The restored database could not be upgraded.";
+        LOG(ERROR) << _lastError.toStdString();
+        return false;
+    }
+    return true;
+}
+
+bool
+Backup::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+Backup::lastError() {
+    return _lastError;
+}
+
+bool
+Backup::copy(QString source, QString destination, BackupProgress progress, int pagesPerStep) {
+    sqlite3* sourceDb = nullptr;
+    sqlite3* destinationDb = nullptr;
+
+    auto result = sqlite3_open_v2(source.toUtf8().constData(), &sourceDb, SQLITE_OPEN_READONLY, nullptr);
+    if (result == SQLITE_OK) {
+        result = sqlite3_open_v2(destination.toUtf8().constData(), &destinationDb,
+                SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+    }
+
+    if (result != SQLITE_OK) {
+        _lastError = QString("Could not open the databases to copy: %1").arg(sqlite3_errstr(result));
+        LOG(ERROR) << _lastError.toStdString();
+        sqlite3_close(sourceDb);
+        sqlite3_close(destinationDb);
+        return false;
+    }
+
+    auto backup = sqlite3_backup_init(destinationDb, "main", sourceDb, "main");
+    if (backup == nullptr) {
+        _lastError = QString("Could not start the copy: %1").arg(sqlite3_errmsg(destinationDb));
+        LOG(ERROR) << _lastError.toStdString();
+        sqlite3_close(sourceDb);
+        sqlite3_close(destinationDb);
+        return false;
+    }
+
+    // the source is only locked while a step runs, if the book writes in between the copy is restarted by sqlite
+    auto retries = 0;
+    do {
+        result = sqlite3_backup_step(backup, pagesPerStep);
+        if (result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+            retries++;
+        } else {
+            retries = 0;
+        }
+
+        if (progress && result != SQLITE_BUSY && result != SQLITE_LOCKED) {
+            auto total = sqlite3_backup_pagecount(backup);
+            progress(total - sqlite3_backup_remaining(backup), total);
+        }
+
+        if (result == SQLITE_OK || result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+            QThread::msleep(BACKUP_STEP_PAUSE);
+        }
+    } while ((result == SQLITE_OK || result == SQLITE_BUSY || result == SQLITE_LOCKED) && retries < BUSY_RETRIES);
+
+    sqlite3_backup_finish(backup);
+    auto success = result == SQLITE_DONE;
+    if (!success) {
+        _lastError = QString("Could not copy the database: %1").arg(sqlite3_errstr(result));
+        LOG(ERROR) << _lastError.toStdString();
+    }
+
+    sqlite3_close(sourceDb);
+    sqlite3_close(destinationDb);
+    return success;
+}
+
+bool
+Backup::isValidBook(QString path) {
+    if (!QFile::exists(path)) {
+        _lastError = "The backup " + path + " does not exist.";
+        LOG(ERROR) << _lastError.toStdString();
+        return false;
+    }
+
+    sqlite3* db = nullptr;
+    auto result = sqlite3_open_v2(path.toUtf8().constData(), &db, SQLITE_OPEN_READONLY, nullptr);
+    if (result != SQLITE_OK) {
+        _lastError = QString("Could not open the backup: %1").arg(sqlite3_errstr(result));
+        LOG(ERROR) << _lastError.toStdString();
+        sqlite3_close(db);
+        return false;
+    }
+
+    // the file must be a sane sqlite database with the tables of a book
+    auto valid = false;
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(db, QUICK_CHECK, -1, &statement, nullptr) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW) {
+        auto check = reinterpret_cast<const char*>(sqlite3_column_text(statement, 0));
+        valid = check != nullptr && QString::fromUtf8(check) == "ok";
+    }
+    sqlite3_finalize(statement);
+
+    if (valid && sqlite3_prepare_v2(db, SELECT_TABLE, -1, &statement, nullptr) == SQLITE_OK) {
+        foreach(const QString& table, QStringList() << "Accounts" << "Categories" << "Transactions") {
+            auto name = table.toUtf8();
+            sqlite3_reset(statement);
+            sqlite3_bind_text(statement, 1, name.constData(), -1, SQLITE_TRANSIENT);
+            valid &= sqlite3_step(statement) == SQLITE_ROW;
+        }
+    } else {
+        valid = false;
+    }
+    sqlite3_finalize(statement);
+    sqlite3_close(db);
+
+    if (!valid) {
+        _lastError = "The file " + path + " is not a valid backup.";
+        LOG(ERROR) << _lastError.toStdString();
+    }
+    return valid;
+}
+
+QMap<int, int>
+Backup::archivedYears(QString path) {
+    QMap<int, int> years;
+    sqlite3* db = nullptr;
+    auto result = sqlite3_open_v2(path.toUtf8().constData(), &db, SQLITE_OPEN_READONLY, nullptr);
+
+    sqlite3_stmt* statement = nullptr;
+    if (result == SQLITE_OK && sqlite3_prepare_v2(db, SELECT_ARCHIVED_YEARS, -1, &statement, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            years[sqlite3_column_int(statement, 0)] = sqlite3_column_int(statement, 1);
+        }
+    }
+    sqlite3_finalize(statement);
+    sqlite3_close(db);
+    return years;
+}
+
+bool
+Backup::isValidArchive(QString path, int transactions) {
+    if (!QFile::exists(path)) {
+        return false;
+    }
+
+    sqlite3* db = nullptr;
+    auto result = sqlite3_open_v2(path.toUtf8().constData(), &db, SQLITE_OPEN_READONLY, nullptr);
+
+    // the archive has as many transactions as the book says that it has
+    auto valid = false;
+    sqlite3_stmt* statement = nullptr;
+    if (result == SQLITE_OK && sqlite3_prepare_v2(db, COUNT_TRANSACTIONS, -1, &statement, nullptr) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW) {
+        valid = sqlite3_column_int(statement, 0) == transactions;
+    }
+    sqlite3_finalize(statement);
+    sqlite3_close(db);
+    return valid;
+}
+
+void
+Backup::removeArchives(QString path) {
+    QFileInfo info(path);
+    auto filter = BACKUP_ARCHIVE_FILTER.arg(info.fileName());
+    foreach(const QString& name, info.dir().entryList(QStringList() << filter, QDir::Files)) {
+        QFile::remove(info.dir().absoluteFilePath(name));
+    }
+}
+
+void
+Backup::rotate() {
+    auto stored = backups();
+    for (int index = _maxBackups; index < stored.count(); index++) {
+        LOG(INFO) << "Removing old backup " << stored.at(index).toStdString();
+        QFile::remove(stored.at(index));
+        removeArchives(stored.at(index));
+    }
+}
+
+}
+
+}
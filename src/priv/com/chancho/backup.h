@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+namespace com {
+
+namespace chancho {
+
+/*!
+   \class Backup
+   \brief The Backup class copies the database while the application keeps using it.
+
+   The copy is done with the SQLite online backup API a few pages at a time, the database is only locked while a
+   step is copying and the book can read and write between steps. The archives of the book are copied next to each
+   backup. The backups are rotated so that only the last ones are kept.
+   \since 0.2
+*/
+class Backup {
+
+ public:
+    // copied pages and total pages of the database
+    typedef std::function<void(int, int)> BackupProgress;
+
+    // pages copied while the database is locked
+    static const int BACKUP_PAGES_PER_STEP = 64;
+
+    // time given to the other connections between steps
+    static const int BACKUP_STEP_PAUSE = 10;
+
+    // number of backups kept by the rotation
+    static const int BACKUP_MAX_FILES = 5;
+
+    /*!
+        \fn Backup(int maxBackups=BACKUP_MAX_FILES);
+
+        Creates a backup service that keeps the last \a maxBackups files.
+    */
+    explicit Backup(int maxBackups=BACKUP_MAX_FILES);
+    virtual ~Backup() = default;
+
+    /*!
+        \fn static QString backupsPath();
+
+        Returns the directory where the backups are stored, next to the database.
+    */
+    static QString backupsPath();
+
+    /*!
+        \fn virtual QStringList backups();
+
+        Returns the paths of the stored backups, the newest first.
+    */
+    virtual QStringList backups();
+
+    /*!
+        \fn virtual bool isDue(int days, QDateTime now=QDateTime::currentDateTime());
+
+        Returns if the newest backup is older than the given number of \a days or there is none.
+    */
+    virtual bool isDue(int days, QDateTime now=QDateTime::currentDateTime());
+
+    /*!
+        \fn virtual QString backup(BackupProgress progress=BackupProgress(), int pagesPerStep=BACKUP_PAGES_PER_STEP);
+
+        Copies the database and its archives to a new backup file \a pagesPerStep pages at a time and removes the
+        oldest backups. The \a progress is called after each step of the database. Returns the path of the new
+        backup, an empty string on error.
+    */
+    virtual QString backup(BackupProgress progress=BackupProgress(), int pagesPerStep=BACKUP_PAGES_PER_STEP);
+
+    /*!
+        \fn virtual bool restore(QString path);
+
+        Replaces the database and its archives with the backup in \a path. The backup is refused when an archived
+        year does not have its archive. The schema of the restored database is upgraded by the Updater when it was
+        made by an older version.
+    */
+    virtual bool restore(QString path);
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error in the last operation.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error that happened.
+    */
+    virtual QString lastError();
+
+ protected:
+    bool copy(QString source, QString destination, BackupProgress progress, int pagesPerStep);
+    bool isValidBook(QString path);
+    QMap<int, int> archivedYears(QString path);
+    bool isValidArchive(QString path, int transactions);
+    void removeArchives(QString path);
+    void rotate();
+
+ private:
+    int _maxBackups;
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<Backup> BackupPtr;
+
+}
+
+}
@@ -20,9 +20,16 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include <glog/logging.h>
 
+#include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QSqlRecord>
@@ -35,6 +42,7 @@
 #include "stats.h"
 #include "book.h"
 #include "updater.h"
+#include "version.h"
 
 namespace com {
 
@@ -60,8 +68,11 @@ const QString Book::CATEGORIES_TABLE = "CREATE TABLE IF NOT EXISTS Categories("\
     "type INT,"\
     "color VARCHAR(7),"\
     "FOREIGN KEY(parent) REFERENCES Categories(uuid))";
+// the id is the key of the search index, autoincrement keeps it stable across a vacuum and does not reuse the id of a
+// removed transaction
 const QString Book::TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS Transactions("\
-    "uuid VARCHAR(40) PRIMARY KEY, "\
+    "id INTEGER PRIMARY KEY AUTOINCREMENT, "\
+    "uuid VARCHAR(40) NOT NULL UNIQUE, "\
     "amount TEXT,"\
     "account VARCHAR(40) NOT NULL, "\
     "category VARCHAR(40) NOT NULL, "\
@@ -71,8 +82,11 @@ const QString Book::TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS Transactions
     "contents TEXT, "\
     "memo TEXT, "\
     "is_recurrent INT, "\
+    "recurrent_id VARCHAR(40), "\
+    "fingerprint INTEGER, "\
     "FOREIGN KEY(account) REFERENCES Accounts(uuid), "\
-    "FOREIGN KEY(category) REFERENCES Categories(uuid))";  // amounts are stored in text so that we can used the most precise number
+    "FOREIGN KEY(category) REFERENCES Categories(uuid), "\
+    "FOREIGN KEY(recurrent_id) REFERENCES RecurrentTransactions(uuid))";  // amounts are stored in text so that we can used the most precise number
 const QString Book::RECURRENT_TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS RecurrentTransactions("\
     "uuid VARCHAR(40) PRIMARY KEY, "\
     "amount TEXT,"\
@@ -92,31 +106,42 @@ const QString Book::RECURRENT_TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS Re
     "defaultType INT, "\
     "numberDays INT, "\
     "occurrences INT, "\
+    "next_due TEXT, "\
     "FOREIGN KEY(account) REFERENCES Accounts(uuid), "\
     "FOREIGN KEY(category) REFERENCES Categories(uuid))";  // amounts are stored in text so that we can used the most precise number
-const QString Book::RECURRENT_TRANSACTIONS_RELATIONS_TABLE = "CREATE TABLE IF NOT EXISTS RecurrentTransactionRelations("\
-    "recurrent_transaction VARCHAR(40),"\
-    "generated_transaction VARCHAR(40),"\
-    "FOREIGN KEY(recurrent_transaction) REFERENCES RecurrentTransactions(uuid),"\
-    "FOREIGN KEY(generated_transaction) REFERENCES Transactions(uuid),"\
-    "PRIMARY KEY(recurrent_transaction, generated_transaction))";
+const QString Book::RECURRENT_NEXT_DUE_INDEX = "CREATE INDEX IF NOT EXISTS recurrent_next_due_index "\
+    "ON RecurrentTransactions(next_due);";  // next_due is an ISO date so that it can be compared as text
+const QString Book::TRANSACTION_RECURRENT_INDEX = "CREATE INDEX IF NOT EXISTS transaction_recurrent_index "\
+    "ON Transactions(recurrent_id);";
+// the fingerprint is not unique, a statement can have two equal transactions in the same day
+const QString Book::TRANSACTION_FINGERPRINT_INDEX = "CREATE INDEX IF NOT EXISTS transaction_fingerprint_index "\
+    "ON Transactions(fingerprint);";
+// while the book generates or rewrites the occurrences of a recurrent transaction the recurrent transaction is kept in
+// this table and the amounts are applied in bulk, the triggers that maintain the aggregated data skip those rows. The
+// rows are added and removed in the same database transaction, the table is empty once it is committed
+const QString Book::BULK_RECURRENT_TRANSACTIONS_TABLE = "CREATE TABLE IF NOT EXISTS BulkRecurrentTransactions("\
+    "recurrent VARCHAR(40) PRIMARY KEY)";
 const QString Book::TRANSACTION_INSERT_TRIGGER = "CREATE TRIGGER UpdateAccountAmountOnTransactionInsert AFTER INSERT ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
     "BEGIN "\
     "UPDATE Accounts SET amount=AddStringNumbers(amount, new.amount) WHERE uuid=new.account; "\
     "END";  // AddStringNumbers is an extension added by the application to the db
-const QString Book::TRANSACTION_UPDATE_SAME_ACCOUNT_TRIGGER = "CREATE TRIGGER UpdateAccountAmountOnTransactionUpdate AFTER UPDATE ON Transactions "\
-    "WHEN old.account = new.account BEGIN "\
+const QString Book::TRANSACTION_UPDATE_SAME_ACCOUNT_TRIGGER = "CREATE TRIGGER UpdateAccountAmountOnTransactionUpdate "\
+    "AFTER UPDATE OF amount, account ON Transactions "\
+    "WHEN old.account = new.account "\
+    "AND NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) BEGIN "\
     "UPDATE Accounts SET amount=AddStringNumbers(SubtractStringNumbers(amount, old.amount), new.amount) WHERE uuid=new.account; "\
     "END";
-const QString Book::TRANSACTION_UPDATE_DIFF_ACCOUNT_TRIGGER = "CREATE TRIGGER UpdateMoveAccountAmountOnTransactionUpdate AFTER UPDATE ON Transactions "\
-    "WHEN old.account != new.account BEGIN "\
+const QString Book::TRANSACTION_UPDATE_DIFF_ACCOUNT_TRIGGER = "CREATE TRIGGER UpdateMoveAccountAmountOnTransactionUpdate "\
+    "AFTER UPDATE OF amount, account ON Transactions "\
+    "WHEN old.account != new.account "\
+    "AND NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) BEGIN "\
     "UPDATE Accounts SET amount=SubtractStringNumbers(amount, old.amount) WHERE uuid=old.account; "\
     "UPDATE Accounts SET amount=AddStringNumbers(amount, new.amount) WHERE uuid=new.account; "\
     "END";
 const QString Book::TRANSACTION_DELETE_TRIGGER = "CREATE TRIGGER UpdateAccountAmountOnTransactionDelete AFTER DELETE ON Transactions "\
     "BEGIN "\
     "UPDATE Accounts SET amount=SubtractStringNumbers(amount, old.amount) WHERE uuid=old.account; "\
-    "DELETE FROM RecurrentTransactionRelations WHERE generated_transaction=old.uuid; "\
     "END";
 const QString Book::ACCOUNT_DELETE_TRIGGER = "CREATE TRIGGER DeleteTransactionsOnAccountDelete BEFORE DELETE ON Accounts "\
     "BEGIN "\
@@ -130,22 +155,300 @@ const QString Book::CATEGORY_UPDATE_DIFF_TYPE_TRIGGER = "CREATE TRIGGER UpdateTr
     "WHEN old.type != new.type BEGIN "\
     "UPDATE Transactions SET amount=NegateStringNumber(amount) WHERE category=new.uuid;"
     "END";
-const QString Book::RECURRENT_RELATIONS_DELETE_TRIGGER = "CREATE TRIGGER DeleteRecurrentRelationsOnDelete AFTER DELETE ON RecurrentTransactions "\
+// the generated transactions that are kept when a recurrent transaction is removed lose the reference to it
+const QString Book::RECURRENT_RELATIONS_DELETE_TRIGGER = "CREATE TRIGGER DeleteRecurrentRelationsOnDelete BEFORE DELETE ON RecurrentTransactions "\
+    "BEGIN "\
+    "UPDATE Transactions SET recurrent_id=NULL WHERE recurrent_id=old.uuid; "\
+    "END";
+const QString Book::BALANCE_CHECKPOINTS_TABLE = "CREATE TABLE IF NOT EXISTS AccountBalanceCheckpoints("\
+    "account VARCHAR(40) NOT NULL, "\
+    "year INT NOT NULL, "\
+    "month INT NOT NULL, "\
+    "amount TEXT, "\
+    "FOREIGN KEY(account) REFERENCES Accounts(uuid), "\
+    "PRIMARY KEY(account, year, month))";  // amount is the movement of the account in the month, not the balance
+const QString Book::CHECKPOINT_INSERT_TRIGGER = "CREATE TRIGGER UpdateCheckpointOnTransactionInsert AFTER INSERT ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
+    "BEGIN "\
+    "INSERT OR IGNORE INTO AccountBalanceCheckpoints(account, year, month, amount) "\
+    "VALUES (new.account, new.year, new.month, '0'); "\
+    "UPDATE AccountBalanceCheckpoints SET amount=AddStringNumbers(amount, new.amount) "\
+    "WHERE account=new.account AND year=new.year AND month=new.month; "\
+    "END";
+const QString Book::CHECKPOINT_UPDATE_TRIGGER = "CREATE TRIGGER UpdateCheckpointOnTransactionUpdate "\
+    "AFTER UPDATE OF amount, account, month, year ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
+    "BEGIN "\
+    "UPDATE AccountBalanceCheckpoints SET amount=SubtractStringNumbers(amount, old.amount) "\
+    "WHERE account=old.account AND year=old.year AND month=old.month; "\
+    "INSERT OR IGNORE INTO AccountBalanceCheckpoints(account, year, month, amount) "\
+    "VALUES (new.account, new.year, new.month, '0'); "\
+    "UPDATE AccountBalanceCheckpoints SET amount=AddStringNumbers(amount, new.amount) "\
+    "WHERE account=new.account AND year=new.year AND month=new.month; "\
+    "END";
+const QString Book::CHECKPOINT_DELETE_TRIGGER = "CREATE TRIGGER UpdateCheckpointOnTransactionDelete AFTER DELETE ON Transactions "\
+    "BEGIN "\
+    "UPDATE AccountBalanceCheckpoints SET amount=SubtractStringNumbers(amount, old.amount) "\
+    "WHERE account=old.account AND year=old.year AND month=old.month; "\
+    "END";
+const QString Book::CHECKPOINT_ACCOUNT_DELETE_TRIGGER = "CREATE TRIGGER DeleteCheckpointsOnAccountDelete AFTER DELETE ON Accounts "\
+    "BEGIN "\
+    "DELETE FROM AccountBalanceCheckpoints WHERE account=old.uuid; "\
+    "END";
+const QString Book::CATEGORY_CLOSURE_TABLE = "CREATE TABLE IF NOT EXISTS CategoryClosure("\
+    "ancestor VARCHAR(40) NOT NULL, "\
+    "descendant VARCHAR(40) NOT NULL, "\
+    "depth INT NOT NULL, "\
+    "PRIMARY KEY(ancestor, descendant))";  // every category is its own ancestor with depth 0
+const QString Book::CATEGORY_CLOSURE_DESCENDANT_INDEX = "CREATE INDEX IF NOT EXISTS category_closure_descendant_index "\
+    "ON CategoryClosure(descendant, depth);";
+const QString Book::CATEGORY_CLOSURE_INSERT_TRIGGER = "CREATE TRIGGER UpdateClosureOnCategoryInsert AFTER INSERT ON Categories "\
+    "BEGIN "\
+    "INSERT INTO CategoryClosure(ancestor, descendant, depth) "\
+    "SELECT new.uuid, new.uuid, 0 "\
+    "UNION ALL SELECT ancestor, new.uuid, depth + 1 FROM CategoryClosure WHERE descendant=new.parent; "\
+    "END";
+const QString Book::CATEGORY_CLOSURE_UPDATE_TRIGGER = "CREATE TRIGGER UpdateClosureOnCategoryParentUpdate "\
+    "AFTER UPDATE OF parent ON Categories WHEN old.parent IS NOT new.parent "\
+    "BEGIN "\
+    "DELETE FROM CategoryClosure WHERE descendant IN (SELECT descendant FROM CategoryClosure WHERE ancestor=new.uuid) "\
+    "AND ancestor NOT IN (SELECT descendant FROM CategoryClosure WHERE ancestor=new.uuid); "\
+    "INSERT INTO CategoryClosure(ancestor, descendant, depth) "\
+    "SELECT p.ancestor, c.descendant, p.depth + c.depth + 1 FROM CategoryClosure AS p, CategoryClosure AS c "\
+    "WHERE p.descendant=new.parent AND c.ancestor=new.uuid; "\
+    "END";
+const QString Book::CATEGORY_CLOSURE_DELETE_TRIGGER = "CREATE TRIGGER UpdateClosureOnCategoryDelete AFTER DELETE ON Categories "\
+    "BEGIN "\
+    "DELETE FROM CategoryClosure WHERE descendant=old.uuid OR ancestor=old.uuid; "\
+    "END";
+const QString Book::CATEGORY_MONTH_TOTALS_TABLE = "CREATE TABLE IF NOT EXISTS CategoryMonthTotals("\
+    "category VARCHAR(40) NOT NULL, "\
+    "year INT NOT NULL, "\
+    "month INT NOT NULL, "\
+    "amount TEXT, "\
+    "FOREIGN KEY(category) REFERENCES Categories(uuid), "\
+    "PRIMARY KEY(category, year, month))";
+const QString Book::CATEGORY_TOTALS_INSERT_TRIGGER = "CREATE TRIGGER UpdateCategoryTotalsOnTransactionInsert "\
+    "AFTER INSERT ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
+    "BEGIN "\
+    "INSERT OR IGNORE INTO CategoryMonthTotals(category, year, month, amount) "\
+    "VALUES (new.category, new.year, new.month, '0'); "\
+    "UPDATE CategoryMonthTotals SET amount=AddStringNumbers(amount, new.amount) "\
+    "WHERE category=new.category AND year=new.year AND month=new.month; "\
+    "END";
+const QString Book::CATEGORY_TOTALS_UPDATE_TRIGGER = "CREATE TRIGGER UpdateCategoryTotalsOnTransactionUpdate "\
+    "AFTER UPDATE OF amount, category, month, year ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
+    "BEGIN "\
+    "UPDATE CategoryMonthTotals SET amount=SubtractStringNumbers(amount, old.amount) "\
+    "WHERE category=old.category AND year=old.year AND month=old.month; "\
+    "INSERT OR IGNORE INTO CategoryMonthTotals(category, year, month, amount) "\
+    "VALUES (new.category, new.year, new.month, '0'); "\
+    "UPDATE CategoryMonthTotals SET amount=AddStringNumbers(amount, new.amount) "\
+    "WHERE category=new.category AND year=new.year AND month=new.month; "\
+    "END";
+const QString Book::CATEGORY_TOTALS_DELETE_TRIGGER = "CREATE TRIGGER UpdateCategoryTotalsOnTransactionDelete "\
+    "AFTER DELETE ON Transactions "\
+    "BEGIN "\
+    "UPDATE CategoryMonthTotals SET amount=SubtractStringNumbers(amount, old.amount) "\
+    "WHERE category=old.category AND year=old.year AND month=old.month; "\
+    "END";
+const QString Book::BUDGETS_TABLE = "CREATE TABLE IF NOT EXISTS Budgets("\
+    "category VARCHAR(40) PRIMARY KEY, "\
+    "amount TEXT, "\
+    "FOREIGN KEY(category) REFERENCES Categories(uuid))";  // monthly budget, the amount is always positive
+const QString Book::BUDGETS_CATEGORY_DELETE_TRIGGER = "CREATE TRIGGER DeleteBudgetsOnCategoryDelete "\
+    "BEFORE DELETE ON Categories "\
+    "BEGIN "\
+    "DELETE FROM Budgets WHERE category=old.uuid; "\
+    "DELETE FROM CategoryMonthTotals WHERE category=old.uuid; "\
+    "END";
+// the index does not keep a copy of the text, it reads it from the transactions using their id
+const QString Book::TRANSACTIONS_SEARCH_TABLE = "CREATE VIRTUAL TABLE IF NOT EXISTS TransactionsSearch "\
+    "USING fts5(contents, memo, content='Transactions', content_rowid='id', prefix='2 3')";
+const QString Book::SEARCH_INSERT_TRIGGER = "CREATE TRIGGER UpdateSearchOnTransactionInsert "\
+    "AFTER INSERT ON Transactions "\
+    "BEGIN "\
+    "INSERT INTO TransactionsSearch(rowid, contents, memo) VALUES (new.id, new.contents, new.memo); "\
+    "END";
+const QString Book::SEARCH_UPDATE_TRIGGER = "CREATE TRIGGER UpdateSearchOnTransactionUpdate "\
+    "AFTER UPDATE OF contents, memo ON Transactions "\
+    "WHEN old.contents IS NOT new.contents OR old.memo IS NOT new.memo "\
     "BEGIN "\
-    "DELETE FROM RecurrentTransactionRelations WHERE recurrent_transaction=old.uuid; "\
+    "INSERT INTO TransactionsSearch(TransactionsSearch, rowid, contents, memo) "\
+    "VALUES ('delete', old.id, old.contents, old.memo); "\
+    "INSERT INTO TransactionsSearch(rowid, contents, memo) VALUES (new.id, new.contents, new.memo); "\
     "END";
-const QString Book::RECURRENT_RELATIONS_INSERT_TRIGGER = "CREATE TRIGGER UpdateRecurrentRelationsOnInsert AFTER INSERT ON RecurrentTransactionRelations "\
+const QString Book::SEARCH_DELETE_TRIGGER = "CREATE TRIGGER UpdateSearchOnTransactionDelete "\
+    "AFTER DELETE ON Transactions "\
     "BEGIN "\
-    "UPDATE Transactions SET is_recurrent=1 WHERE uuid=new.generated_transaction; "\
+    "INSERT INTO TransactionsSearch(TransactionsSearch, rowid, contents, memo) "\
+    "VALUES ('delete', old.id, old.contents, old.memo); "\
     "END";
-const QString Book::RECURRENT_RELATIONS_UPDATE_TRIGGER = "CREATE TRIGGER UpdateGeneratedRelationsOnUpdate AFTER UPDATE ON RecurrentTransactions "\
+// the number of transactions of each year is kept so that the total does not need to attach the archives
+const QString Book::ARCHIVED_YEARS_TABLE = "CREATE TABLE IF NOT EXISTS ArchivedYears("\
+    "year INT PRIMARY KEY, "\
+    "transactions INT NOT NULL)";
+// the queries that have to read the archived transactions name this view, a temp view with the same name that adds
+// the archives shadows it on the connections that have them attached
+const QString Book::ALL_TRANSACTIONS_VIEW = "CREATE VIEW IF NOT EXISTS AllTransactions AS "\
+    "SELECT id, uuid, amount, account, category, day, month, year, contents, memo, is_recurrent, recurrent_id, "\
+    "fingerprint FROM Transactions";
+// the change log keeps the rows that changed so that the book can be synced exporting just the recent changes, the
+// entities and operations are the ones of ChangeLog::Entity and ChangeLog::Operation
+const QString Book::CHANGES_TABLE = "CREATE TABLE IF NOT EXISTS Changes("\
+    "seq INTEGER PRIMARY KEY, "\
+    "entity INT NOT NULL, "\
+    "uuid VARCHAR(40) NOT NULL, "\
+    "op INT NOT NULL)";
+// the amount of an account follows its transactions, just the changes made by the user are logged
+const QString Book::CHANGES_ACCOUNT_INSERT_TRIGGER = "CREATE TRIGGER LogChangeOnAccountInsert AFTER INSERT ON Accounts "\
     "BEGIN "\
-    "UPDATE Transactions SET amount=new.amount, account=new.account, category=new.category, contents=new.contents, memo=new.memo "\
-    "WHERE uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE recurrent_transaction=new.uuid);"\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (0, new.uuid, 0); "\
+    "END";
+const QString Book::CHANGES_ACCOUNT_UPDATE_TRIGGER = "CREATE TRIGGER LogChangeOnAccountUpdate "\
+    "AFTER UPDATE OF name, memo, color, initialAmount ON Accounts "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (0, new.uuid, 1); "\
+    "END";
+const QString Book::CHANGES_ACCOUNT_DELETE_TRIGGER = "CREATE TRIGGER LogChangeOnAccountDelete AFTER DELETE ON Accounts "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (0, old.uuid, 2); "\
+    "END";
+const QString Book::CHANGES_CATEGORY_INSERT_TRIGGER = "CREATE TRIGGER LogChangeOnCategoryInsert AFTER INSERT ON Categories "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (1, new.uuid, 0); "\
+    "END";
+const QString Book::CHANGES_CATEGORY_UPDATE_TRIGGER = "CREATE TRIGGER LogChangeOnCategoryUpdate "\
+    "AFTER UPDATE OF parent, name, type, color ON Categories "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (1, new.uuid, 1); "\
+    "END";
+const QString Book::CHANGES_CATEGORY_DELETE_TRIGGER = "CREATE TRIGGER LogChangeOnCategoryDelete AFTER DELETE ON Categories "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (1, old.uuid, 2); "\
+    "END";
+// every copy of the book generates the occurrences of its recurrent transactions, the generated ones are not logged
+const QString Book::CHANGES_TRANSACTION_INSERT_TRIGGER = "CREATE TRIGGER LogChangeOnTransactionInsert AFTER INSERT ON Transactions "\
+    "WHEN NOT EXISTS (SELECT 1 FROM BulkRecurrentTransactions WHERE recurrent=new.recurrent_id) "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (2, new.uuid, 0); "\
+    "END";
+// the columns kept by the book, such as the link to the recurrent transaction or the fingerprint, are not logged
+const QString Book::CHANGES_TRANSACTION_UPDATE_TRIGGER = "CREATE TRIGGER LogChangeOnTransactionUpdate "\
+    "AFTER UPDATE OF amount, account, category, day, month, year, contents, memo ON Transactions "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (2, new.uuid, 1); "\
+    "END";
+const QString Book::CHANGES_TRANSACTION_DELETE_TRIGGER = "CREATE TRIGGER LogChangeOnTransactionDelete AFTER DELETE ON Transactions "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (2, old.uuid, 2); "\
+    "END";
+const QString Book::CHANGES_RECURRENT_INSERT_TRIGGER = "CREATE TRIGGER LogChangeOnRecurrentTransactionInsert AFTER INSERT ON RecurrentTransactions "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (3, new.uuid, 0); "\
+    "END";
+// the last generated and the next due dates belong to the generation of each copy and are not logged
+const QString Book::CHANGES_RECURRENT_UPDATE_TRIGGER = "CREATE TRIGGER LogChangeOnRecurrentTransactionUpdate "\
+    "AFTER UPDATE OF amount, account, category, contents, memo, startDay, startMonth, startYear, endDay, endMonth, "\
+    "endYear, defaultType, numberDays, occurrences ON RecurrentTransactions "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (3, new.uuid, 1); "\
+    "END";
+const QString Book::CHANGES_RECURRENT_DELETE_TRIGGER = "CREATE TRIGGER LogChangeOnRecurrentTransactionDelete AFTER DELETE ON RecurrentTransactions "\
+    "BEGIN "\
+    "INSERT INTO Changes(entity, uuid, op) VALUES (3, old.uuid, 2); "\
     "END";
 
 namespace {
     const QString DATABASE_NAME = "chancho.db";
+    const QString ARCHIVE_DATABASE_NAME = "chancho-%1.db";
+    const QString ARCHIVE_SCHEMA = "archive_%1";
+    // the columns are named because the order of the columns of an upgraded database differs from a new one
+    const QString ARCHIVE_COLUMNS = "id, uuid, amount, account, category, day, month, year, contents, memo, "\
+        "is_recurrent, recurrent_id, fingerprint";
+    const QString ATTACH_ARCHIVE = "ATTACH DATABASE :path AS %1";
+    const QString DETACH_ARCHIVE = "DETACH DATABASE %1";
+    const QString SELECT_ARCHIVED_YEARS = "SELECT year FROM ArchivedYears ORDER BY year ASC";
+    // the archives do not have foreign keys because the accounts and categories are only in the main database, the
+    // transactions keep their id so that their entries in the search index stay valid
+    const QString ARCHIVE_TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS %1.Transactions("\
+        "id INTEGER PRIMARY KEY, "\
+        "uuid VARCHAR(40) NOT NULL UNIQUE, "\
+        "amount TEXT,"\
+        "account VARCHAR(40) NOT NULL, "\
+        "category VARCHAR(40) NOT NULL, "\
+        "day INT, "\
+        "month INT, "\
+        "year INT, "\
+        "contents TEXT, "\
+        "memo TEXT, "\
+        "is_recurrent INT, "\
+        "recurrent_id VARCHAR(40), "\
+        "fingerprint INTEGER)";
+    // the year is part of the indexes so that the conditions of the view are answered by them
+    const QString ARCHIVE_MONTH_INDEX = "CREATE INDEX IF NOT EXISTS %1.transaction_month_index "\
+        "ON Transactions(year, month, day)";
+    const QString ARCHIVE_CATEGORY_INDEX = "CREATE INDEX IF NOT EXISTS %1.transaction_category_index "\
+        "ON Transactions(category, year, month)";
+    const QString ARCHIVE_ACCOUNT_INDEX = "CREATE INDEX IF NOT EXISTS %1.transaction_account_index "\
+        "ON Transactions(account)";
+    const QString ARCHIVE_RECURRENT_INDEX = "CREATE INDEX IF NOT EXISTS %1.transaction_recurrent_index "\
+        "ON Transactions(recurrent_id)";
+    const QString ARCHIVE_FINGERPRINT_INDEX = "CREATE INDEX IF NOT EXISTS %1.transaction_fingerprint_index "\
+        "ON Transactions(fingerprint)";
+    const QString INSERT_ARCHIVED_TRANSACTIONS = "INSERT OR REPLACE INTO %1.Transactions(%2) "\
+        "SELECT %2 FROM main.Transactions WHERE year=:year";
+    const QString DELETE_ARCHIVED_TRANSACTIONS = "DELETE FROM main.Transactions WHERE year=:year";
+    const QString INSERT_UNARCHIVED_TRANSACTIONS = "INSERT INTO main.Transactions(%2) SELECT %2 FROM %1.Transactions";
+    const QString INSERT_UPDATE_ARCHIVED_YEAR = "INSERT OR REPLACE INTO ArchivedYears(year, transactions) "\
+        "SELECT :year, COUNT(*) FROM %1.Transactions";
+    const QString DELETE_ARCHIVED_YEAR = "DELETE FROM ArchivedYears WHERE year=:year";
+    // the delete trigger removes the archived transactions from the search index, their entries are added again
+    // once they are in the archive
+    const QString SAVE_ARCHIVED_IDS = "CREATE TEMP TABLE SavedArchivedIds AS "\
+        "SELECT id FROM main.Transactions WHERE year=:year";
+    const QString INSERT_ARCHIVED_SEARCH = "INSERT INTO main.TransactionsSearch(rowid, contents, memo) "\
+        "SELECT id, contents, memo FROM %1.Transactions WHERE id IN (SELECT id FROM temp.SavedArchivedIds)";
+    const QString DROP_SAVED_ARCHIVED_IDS = "DROP TABLE temp.SavedArchivedIds";
+    // the insert trigger adds the transactions that leave the archive to the search index, the entries they already
+    // have are removed first
+    const QString DELETE_UNARCHIVED_SEARCH = "INSERT INTO main.TransactionsSearch(TransactionsSearch, rowid, "\
+        "contents, memo) SELECT 'delete', id, contents, memo FROM %1.Transactions";
+    // the archived transactions that are changed are moved back to the main database
+    const QString COUNT_MAIN_TRANSACTIONS = "SELECT COUNT(*) FROM main.Transactions WHERE %1";
+    const QString COUNT_RESTORED_TRANSACTIONS = "SELECT COUNT(*) FROM %1.Transactions WHERE %2";
+    const QString DELETE_RESTORED_SEARCH = "INSERT INTO main.TransactionsSearch(TransactionsSearch, rowid, "\
+        "contents, memo) SELECT 'delete', id, contents, memo FROM %1.Transactions WHERE %2";
+    const QString INSERT_RESTORED_TRANSACTIONS = "INSERT INTO main.Transactions(%2) SELECT %2 FROM %1.Transactions "\
+        "WHERE %3";
+    const QString DELETE_RESTORED_TRANSACTIONS = "DELETE FROM %1.Transactions WHERE %2";
+    // the triggers update the aggregated data when the transactions are moved, the values are saved before moving
+    // them and restored afterwards
+    const QString SAVE_ACCOUNT_AMOUNTS = "CREATE TEMP TABLE SavedAccountAmounts AS SELECT uuid, amount FROM Accounts";
+    const QString SAVE_CHECKPOINTS = "CREATE TEMP TABLE SavedCheckpoints AS "\
+        "SELECT account, month, amount FROM AccountBalanceCheckpoints WHERE year=:year";
+    const QString SAVE_CATEGORY_TOTALS = "CREATE TEMP TABLE SavedCategoryTotals AS "\
+        "SELECT category, month, amount FROM CategoryMonthTotals WHERE year=:year";
+    const QString RESTORE_ACCOUNT_AMOUNTS = "UPDATE Accounts SET "\
+        "amount=(SELECT s.amount FROM temp.SavedAccountAmounts AS s WHERE s.uuid=Accounts.uuid)";
+    const QString RESTORE_CHECKPOINTS = "INSERT OR REPLACE INTO AccountBalanceCheckpoints(account, year, month, amount) "\
+        "SELECT account, :year, month, amount FROM temp.SavedCheckpoints";
+    const QString RESTORE_CATEGORY_TOTALS = "INSERT OR REPLACE INTO CategoryMonthTotals(category, year, month, amount) "\
+        "SELECT category, :year, month, amount FROM temp.SavedCategoryTotals";
+    const QString DROP_SAVED_ACCOUNT_AMOUNTS = "DROP TABLE temp.SavedAccountAmounts";
+    const QString DROP_SAVED_CHECKPOINTS = "DROP TABLE temp.SavedCheckpoints";
+    const QString DROP_SAVED_CATEGORY_TOTALS = "DROP TABLE temp.SavedCategoryTotals";
+    // moving the transactions is not a change of the book, the entries logged while they are moved are removed
+    const QString SAVE_LAST_CHANGE = "CREATE TEMP TABLE SavedLastChange AS "\
+        "SELECT IFNULL(MAX(seq), 0) AS seq FROM Changes";
+    const QString RESTORE_CHANGES = "DELETE FROM Changes WHERE seq > (SELECT seq FROM temp.SavedLastChange)";
+    const QString DROP_SAVED_LAST_CHANGE = "DROP TABLE temp.SavedLastChange";
+    // the archives are attached when the connection is opened, the view lives in the temp schema and is dropped
+    // with the connection
+    const QString CREATE_ALL_YEARS_VIEW = "CREATE TEMP VIEW AllTransactions AS SELECT %1 FROM main.Transactions";
+    const QString ALL_YEARS_VIEW_ARCHIVE = " UNION ALL SELECT %1 FROM %2.Transactions";
     const QString ALTER_TRANSACTION_TABLE = "ALTER TABLE Transactions ADD COLUMN is_recurrent int";
     const QString TRANSACTION_MONTH_INDEX = "CREATE INDEX transaction_month_index ON Transactions(year, month);";
     const QString TRANSACTION_DAY_INDEX = "CREATE INDEX transaction_day_index ON Transactions(day, year, month);";
@@ -159,26 +462,64 @@ namespace {
     const QString UPDATE_CATEGORY = "UPDATE Categories SET parent=:parent, name=:name, type=:type, color=:color " \
         "WHERE uuid=:uuid";
     const QString INSERT_TRANSACTION = "INSERT INTO Transactions(uuid, amount, account, category, "\
-        "day, month, year, contents, memo) VALUES (:uuid, :amount, :account, :category, :day, :month, :year, :contents, :memo)";
+        "day, month, year, contents, memo, fingerprint) VALUES (:uuid, :amount, :account, :category, :day, :month, "\
+        ":year, :contents, :memo, :fingerprint)";
+    // the uuid of a generated transaction is the same in every copy of the book, the occurrences received from another
+    // copy are not generated again
+    const QString INSERT_GENERATED_TRANSACTION = "INSERT OR IGNORE INTO Transactions(uuid, amount, account, category, "\
+        "day, month, year, contents, memo, is_recurrent, recurrent_id, fingerprint) VALUES (:uuid, :amount, :account, "\
+        ":category, :day, :month, :year, :contents, :memo, 1, :recurrent, :fingerprint)";
+    const QString INSERT_BULK_RECURRENT_TRANSACTION = "INSERT OR IGNORE INTO BulkRecurrentTransactions(recurrent) "\
+        "VALUES (:recurrent)";
+    const QString DELETE_BULK_RECURRENT_TRANSACTIONS = "DELETE FROM BulkRecurrentTransactions";
+    const QString UPDATE_ACCOUNT_AMOUNT_DELTA = "UPDATE Accounts SET amount=AddStringNumbers(amount, :amount) "\
+        "WHERE uuid=:uuid";
+    const QString INSERT_EMPTY_CHECKPOINT = "INSERT OR IGNORE INTO AccountBalanceCheckpoints(account, year, month, amount) "\
+        "VALUES (:account, :year, :month, '0')";
+    const QString UPDATE_CHECKPOINT_DELTA = "UPDATE AccountBalanceCheckpoints SET amount=AddStringNumbers(amount, :amount) "\
+        "WHERE account=:account AND year=:year AND month=:month";
+    const QString INSERT_EMPTY_CATEGORY_TOTAL = "INSERT OR IGNORE INTO CategoryMonthTotals(category, year, month, amount) "\
+        "VALUES (:category, :year, :month, '0')";
+    const QString UPDATE_CATEGORY_TOTAL_DELTA = "UPDATE CategoryMonthTotals SET amount=AddStringNumbers(amount, :amount) "\
+        "WHERE category=:category AND year=:year AND month=:month";
+    const int DELTA_PRECISION = 15;  // the aggregated amounts can have more digits than the default 6
     const QString UPDATE_TRANSACTION = "UPDATE Transactions SET amount=:amount, account=:account, category=:category, "\
-        "day=:day, month=:month, year=:year, contents=:contents, memo=:memo WHERE uuid=:uuid";
+        "day=:day, month=:month, year=:year, contents=:contents, memo=:memo, fingerprint=:fingerprint WHERE uuid=:uuid";
     const QString INSERT_UPDATE_RECURRENT_TRANSACTION = "INSERT OR REPLACE INTO RecurrentTransactions("
         "uuid, amount, account, category, contents, memo, startDay, startMonth, startYear, lastDay, lastMonth, lastYear, "\
-        "endDay, endMonth, endYear, defaultType, numberDays, occurrences) "\
+        "endDay, endMonth, endYear, defaultType, numberDays, occurrences, next_due) "\
         "VALUES(:uuid, :amount, :account, :category, :contents, :memo, :startDay, :startMonth, :startYear, :lastDay, "\
-        ":lastMonth, :lastYear, :endDay, :endMonth, :endYear, :defaultType, :numberDays, :occurrences)";
+        ":lastMonth, :lastYear, :endDay, :endMonth, :endYear, :defaultType, :numberDays, :occurrences, :nextDue)";
+    const QString UPDATE_RECURRENT_GENERATION = "UPDATE RecurrentTransactions SET lastDay=:lastDay, "\
+        "lastMonth=:lastMonth, lastYear=:lastYear, next_due=:nextDue WHERE uuid=:uuid";
     const QString UPDATE_RECURRENT_TRANSACTION = "UPDATE RecurrentTransactions SET "\
         "amount=:amount, account=:account, category=:category, contents=:contents, memo=:memo, "\
-        "endDay=:endDay, endMonth=:endMonth, endYear=:endYear WHERE uuid=:uuid";
-    const QString INSERT_UPDATE_RECURRENT_TRANSACTION_RELATION = "INSERT OR REPLACE INTO RecurrentTransactionRelations("\
-        "recurrent_transaction, generated_transaction) VALUES(:recurrent_transaction, :generated_transaction)";
+        "endDay=:endDay, endMonth=:endMonth, endYear=:endYear, next_due=:nextDue WHERE uuid=:uuid";
+    const QString SELECT_GENERATED_TOTALS = "SELECT account, category, year, month, COUNT(*), SSUM(amount) "\
+        "FROM Transactions WHERE recurrent_id=:recurrent GROUP BY account, category, year, month";
+    const QString UPDATE_GENERATED_TRANSACTIONS = "UPDATE Transactions SET amount=:amount, account=:account, "\
+        "category=:category, contents=:contents, memo=:memo WHERE recurrent_id=:recurrent";
+    // the fingerprint depends on the day of each generated transaction, it is computed once the new values are set
+    const QString UPDATE_GENERATED_FINGERPRINTS = "UPDATE Transactions SET "\
+        "fingerprint=TransactionFingerprint(account, day, month, year, amount, contents) "\
+        "WHERE recurrent_id=:recurrent";
+    const QString UPDATE_TRANSACTION_RECURRENT = "UPDATE Transactions SET is_recurrent=1, "\
+        "recurrent_id=:recurrent_transaction WHERE uuid=:generated_transaction";
     const QString DELETE_ACCOUNT = "DELETE FROM Accounts WHERE uuid=:uuid";
-    const QString DELETE_CHILD_CATEGORIES = "DELETE FROM Categories WHERE parent=:uuid";
+    const QString DELETE_CHILD_CATEGORIES = "DELETE FROM Categories WHERE uuid IN "\
+        "(SELECT descendant FROM CategoryClosure WHERE ancestor=:uuid AND depth > 0)";
     const QString DELETE_CATEGORY = "DELETE FROM Categories WHERE uuid=:uuid";
+    const QString INSERT_UPDATE_BUDGET = "INSERT OR REPLACE INTO Budgets(category, amount) VALUES (:category, :amount)";
+    const QString DELETE_BUDGET = "DELETE FROM Budgets WHERE category=:category";
     const QString DELETE_TRANSACTION = "DELETE FROM Transactions WHERE uuid=:uuid";
     const QString DELETE_RECURRENT_TRANSACTION = "DELETE FROM RecurrentTransactions WHERE uuid=:uuid";
-    const QString DELETE_RECURRENT_GENERATED = "DELETE FROM Transactions WHERE uuid IN (SELECT generated_transaction FROM "\
-        "RecurrentTransactionRelations WHERE recurrent_transaction=:recurrent_Transaction)";
+    const QString DELETE_RECURRENT_GENERATED = "DELETE FROM Transactions WHERE recurrent_id=:recurrent_Transaction";
+    // the relations table is present until the RecurrentTransactionRelations migration finishes
+    const QString RECURRENT_RELATIONS_TABLE_NAME = "RecurrentTransactionRelations";
+    const QString SELECT_TABLE = "SELECT name FROM sqlite_master WHERE type='table' AND name=:name";
+    const QString LINK_PENDING_GENERATED = "UPDATE Transactions SET recurrent_id=:recurrent WHERE recurrent_id IS NULL "\
+        "AND uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations "\
+        "WHERE recurrent_transaction=:relationsRecurrent)";
     const QString SELECT_ALL_ACCOUNTS = "SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts ORDER BY name ASC";
     const QString SELECT_ALL_ACCOUNTS_LIMIT = "SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts ORDER BY name ASC "\
         "LIMIT :limit OFFSET :offset";
@@ -199,48 +540,73 @@ namespace {
     const QString SELECT_CATEGORIES_RECURRENT_COUNT = "SELECT count(*) FROM (SELECT category FROM "\
         "RecurrentTransactions GROUP BY category)";
     const QString SELECT_TRANSACTIONS_MONTH = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.month=:month AND t.year=:year ORDER BY t.year, t.month";
     const QString SELECT_TRANSACTIONS_MONTH_LIMIT = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.month=:month AND t.year=:year ORDER BY t.year, t.month LIMIT :limit OFFSET :offset" ;
-    const QString SELECT_TRANSACTIONS_COUNT = "SELECT count(uuid) FROM Transactions";
-    const QString SELECT_TRANSACTIONS_MONTH_COUNT = "SELECT count(uuid) FROM Transactions "\
+    const QString SELECT_TRANSACTIONS_COUNT = "SELECT (SELECT count(uuid) FROM Transactions) + "\
+        "(SELECT IFNULL(SUM(transactions), 0) FROM ArchivedYears)";
+    const QString SELECT_TRANSACTIONS_MONTH_COUNT = "SELECT count(uuid) FROM AllTransactions "\
         "WHERE month=:month AND year=:year";
     const QString SELECT_TRANSACTIONS_DAY = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.day=:day AND t.month=:month AND t.year=:year ORDER BY t.day, t.year, t.month";
     const QString SELECT_TRANSACTIONS_DAY_LIMIT = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.day=:day AND t.month=:month AND t.year=:year ORDER BY t.year, t.month LIMIT :limit OFFSET :offset" ;
-    const QString SELECT_TRANSACTIONS_DAY_COUNT = "SELECT count(uuid) FROM Transactions "\
+    const QString SELECT_TRANSACTIONS_DAY_COUNT = "SELECT count(uuid) FROM AllTransactions "\
         "WHERE day=:day AND month=:month AND year=:year";
     const QString SELECT_TRANSACTIONS_CATEGORY = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.category=:category ORDER BY t.year, t.month";
     const QString SELECT_TRANSACTIONS_CATEGORY_MONTH = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.category=:category AND t.month=:month AND t.year=:year ORDER BY t.year, t.month";
+    // the date is part of the fingerprint, the year limits the lookup to the database that has it
+    const QString SELECT_FINGERPRINT_COUNT = "SELECT COUNT(*) FROM AllTransactions "\
+        "WHERE fingerprint=:fingerprint AND year=:year";
+    // the archived transactions keep their entries in the search index, the matches are joined with the
+    // transactions of each database by their id
+    const QString SELECT_SEARCH = "WITH matches AS (SELECT rowid AS match_id, rank AS match_rank "\
+        "FROM TransactionsSearch WHERE TransactionsSearch MATCH :query) "\
+        "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, t.year, t.contents, t.memo, t.is_recurrent, "\
+        "c.parent, c.name, c.type, a.name, a.memo, a.amount, t.match_rank, t.match_id FROM (%1) AS t "\
+        "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
+        "WHERE t.match_id IS NOT NULL %2"\
+        "ORDER BY t.match_rank, t.match_id LIMIT :limit";
+    const QString SEARCH_MATCHES = "SELECT uuid, amount, account, category, day, month, year, contents, memo, "\
+        "is_recurrent, match_rank, match_id FROM matches INNER JOIN %1.Transactions ON id = match_id";
+    const QString SEARCH_MATCHES_ARCHIVE = " UNION ALL %1";
+    const QString SEARCH_ACCOUNT_FILTER = "AND t.account=:account ";
+    const QString SEARCH_CATEGORY_FILTER = "AND t.category IN "\
+        "(SELECT descendant FROM CategoryClosure WHERE ancestor=:category) ";
+    // the bounds are on the columns of the month index, the day only matters in the first and last months
+    const QString SEARCH_FROM_FILTER = "AND t.year >= :fromYear AND (t.year > :fromEdgeYear OR t.month > :fromMonth "\
+        "OR (t.month = :fromEdgeMonth AND t.day >= :fromDay)) ";
+    const QString SEARCH_TO_FILTER = "AND t.year <= :toYear AND (t.year < :toEdgeYear OR t.month < :toMonth "\
+        "OR (t.month = :toEdgeMonth AND t.day <= :toDay)) ";
+    // the rank is computed for every match before the filter is applied, the cursor only avoids the offset
+    const QString SEARCH_CURSOR_FILTER = "AND (t.match_rank > :rank "\
+        "OR (t.match_rank = :sameRank AND t.match_id > :rowid)) ";
     const QString SELECT_TRANSACTIONS_ACCOUNT = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
         "WHERE t.account=:account ORDER BY t.year, t.month";
     const QString SELECT_TRANSACTIONS_RECURRENT =  "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
-        "WHERE t.uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE "\
-        "recurrent_transaction=:recurrent_Transaction) ORDER BY t.year, t.month";
+        "WHERE t.recurrent_id=:recurrent_Transaction ORDER BY t.year, t.month";
     const QString SELECT_TRANSACTIONS_RECURRENT_LIMIT =  "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
-        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid "\
-        "WHERE t.uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE "\
-        "recurrent_transaction=:recurrent_Transaction) ORDER BY t.year, t.month LIMIT :limit OFFSET :offset";
+        "WHERE t.recurrent_id=:recurrent_Transaction ORDER BY t.year, t.month LIMIT :limit OFFSET :offset";
     const QString SELECT_RECURRENT_TRANSACTIONS_COUNT = "SELECT count(uuid) FROM RecurrentTransactions";
     const QString SELECT_RECURRENT_TRANSACTIONS_CATEGORY_COUNT = "SELECT count(uuid) FROM RecurrentTransactions "\
         "WHERE category=:category";
@@ -264,20 +630,27 @@ namespace {
         "t.defaultType, t.numberDays, t.occurrences, c.parent, c.name, c.type, a.name, a.memo, a.amount "\
         "FROM RecurrentTransactions AS t INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON "\
         "t.account = a.uuid WHERE t.category=:category LIMIT :limit OFFSET :offset";
-    const QString SELECT_GENERATED_TRANSACTIONS_RECURRENT_COUNT = "SELECT count(*) FROM RecurrentTransactionRelations WHERE "\
-        "recurrent_transaction=:recurrent_Transaction";
-    const QString SELECT_MONTHS_WITH_TRANSACTIONS = "SELECT DISTINCT month FROM Transactions WHERE year=:year "\
+    const QString SELECT_RECURRENT_TRANSACTIONS_DUE = "SELECT t.uuid, t.amount, t.account, t.category, t.contents, t.memo, "\
+        "t.startDay, t.startMonth, t.startYear, t.lastDay, t.lastMonth, t.lastYear, t.endDay, t.endMonth, t.endYear, "\
+        "t.defaultType, t.numberDays, t.occurrences, c.parent, c.name, c.type, a.name, a.memo, a.amount "\
+        "FROM RecurrentTransactions AS t INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON "\
+        "t.account = a.uuid WHERE t.next_due IS NOT NULL AND t.next_due <= :date";
+    const QString SELECT_RECURRENT_NEXT_DUE = "SELECT MIN(next_due) FROM RecurrentTransactions "\
+        "WHERE next_due IS NOT NULL";
+    const QString SELECT_GENERATED_TRANSACTIONS_RECURRENT_COUNT = "SELECT count(*) FROM AllTransactions WHERE "\
+        "recurrent_id=:recurrent_Transaction";
+    const QString SELECT_MONTHS_WITH_TRANSACTIONS = "SELECT DISTINCT month FROM AllTransactions WHERE year=:year "\
         "ORDER BY month DESC";
-    const QString SELECT_MONTHS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT month FROM Transactions WHERE year=:year "\
+    const QString SELECT_MONTHS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT month FROM AllTransactions WHERE year=:year "\
             "ORDER BY month DESC LIMIT :limit OFFSET :offset";
-    const QString SELECT_MONTHS_WITH_TRANSACTIONS_COUNT = "SELECT COUNT(DISTINCT month) FROM Transactions WHERE year=:year";
-    const QString SELECT_DAYS_WITH_TRANSACTIONS = "SELECT DISTINCT day FROM Transactions "\
+    const QString SELECT_MONTHS_WITH_TRANSACTIONS_COUNT = "SELECT COUNT(DISTINCT month) FROM AllTransactions WHERE year=:year";
+    const QString SELECT_DAYS_WITH_TRANSACTIONS = "SELECT DISTINCT day FROM AllTransactions "\
         "WHERE year=:year AND month=:month ORDER BY day DESC";
-    const QString SELECT_DAYS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT day FROM Transactions "\
+    const QString SELECT_DAYS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT day FROM AllTransactions "\
         "WHERE year=:year AND month=:month ORDER BY day DESC LIMIT :limit OFFSET :offset";
-    const QString SELECT_DAYS_WITH_TRANSACTIONS_COUNT = "SELECT COUNT(DISTINCT day) FROM Transactions "\
+    const QString SELECT_DAYS_WITH_TRANSACTIONS_COUNT = "SELECT COUNT(DISTINCT day) FROM AllTransactions "\
         "WHERE year=:year AND month=:month";
-    const QString SELECT_DAY_CATEGORY_TYPE_SUM = "SELECT SSUM(t.amount) FROM Transactions AS t "\
+    const QString SELECT_DAY_CATEGORY_TYPE_SUM = "SELECT SSUM(t.amount) FROM AllTransactions AS t "\
         "INNER JOIN Categories AS c ON t.category = c.uuid  WHERE c.type=:type AND t.day=:day AND "\
         "t.month=:month AND t.year=:year";
     // views that are used by the stats, this are present to simplify the select statements
@@ -294,6 +667,11 @@ class BookLock {
             : _book(book) {
         _book->_dbMutex.lock();
         _opened = _book->_db->open();
+        // the archives are attached to the connection once it is opened, the queries read them through the view
+        if (_opened && !Book::attachArchives(_book->_db)) {
+            _book->_db->close();
+            _opened = false;
+        }
     }
 
     ~BookLock() {
@@ -315,17 +693,150 @@ class BookLock {
     Book* _book;
 };
 
+// the filters of the archived transactions that are moved back to the main database, they bind :uuid
+const QString Book::RESTORED_TRANSACTION_FILTER = "uuid=:uuid";
+const QString Book::RESTORED_ACCOUNT_FILTER = "account=:uuid";
+const QString Book::RESTORED_CATEGORY_FILTER = "category IN "\
+    "(SELECT descendant FROM main.CategoryClosure WHERE ancestor=:uuid)";
+const QString Book::RESTORED_RECURRENT_FILTER = "recurrent_id=:uuid";
+
 double Book::DB_VERSION = 0.1;
 std::set<QString> Book::TABLES {"accounts", "categories", "transactions", "recurrenttransactions"};
+std::mutex Book::_archivedMutex;
+QList<int> Book::_archived;
+
+namespace {
+
+    // statements used to create a new database, they are also the input of the schema fingerprint
+    const QStringList&
+    schemaStatements() {
+        static QStringList statements {
+            VERSION_TABLE,
+            FOREIGN_KEY_SUPPORT,
+            ACCOUNTS_TABLE,
+            CATEGORIES_TABLE,
+            TRANSACTION_TABLE,
+            RECURRENT_TRANSACTION_TABLE,
+            BULK_RECURRENT_TRANSACTIONS_TABLE,
+            RECURRENT_NEXT_DUE_INDEX,
+            TRANSACTION_INSERT_TRIGGER,
+            TRANSACTION_UPDATE_SAME_ACCOUNT_TRIGGER,
+            TRANSACTION_UPDATE_DIFF_ACCOUNT_TRIGGER,
+            TRANSACTION_DELETE_TRIGGER,
+            RECURRENT_RELATIONS_DELETE_TRIGGER,
+            CATEGORY_DELETE_TRIGGER,
+            ACCOUNT_DELETE_TRIGGER,
+            CATEGORY_UPDATE_DIFF_TYPE_TRIGGER,
+            TRANSACTION_MONTH_INDEX,
+            TRANSACTION_DAY_INDEX,
+            TRANSACTION_CATEGORY_INDEX,
+            TRANSACTION_CATEGORY_MONTH_INDEX,
+            TRANSACTION_ACCOUNT_INDEX,
+            TRANSACTION_RECURRENT_INDEX,
+            TRANSACTION_FINGERPRINT_INDEX,
+            ACCOUNT_MONTH_TOTAL_VIEW,
+            ALL_TRANSACTIONS_VIEW,
+            BALANCE_CHECKPOINTS_TABLE,
+            CHECKPOINT_INSERT_TRIGGER,
+            CHECKPOINT_UPDATE_TRIGGER,
+            CHECKPOINT_DELETE_TRIGGER,
+            CHECKPOINT_ACCOUNT_DELETE_TRIGGER,
+            CATEGORY_CLOSURE_TABLE,
+            CATEGORY_CLOSURE_DESCENDANT_INDEX,
+            CATEGORY_CLOSURE_INSERT_TRIGGER,
+            CATEGORY_CLOSURE_UPDATE_TRIGGER,
+            CATEGORY_CLOSURE_DELETE_TRIGGER,
+            CATEGORY_MONTH_TOTALS_TABLE,
+            CATEGORY_TOTALS_INSERT_TRIGGER,
+            CATEGORY_TOTALS_UPDATE_TRIGGER,
+            CATEGORY_TOTALS_DELETE_TRIGGER,
+            BUDGETS_TABLE,
+            BUDGETS_CATEGORY_DELETE_TRIGGER,
+            TRANSACTIONS_SEARCH_TABLE,
+            SEARCH_INSERT_TRIGGER,
+            SEARCH_UPDATE_TRIGGER,
+            SEARCH_DELETE_TRIGGER,
+            ARCHIVED_YEARS_TABLE,
+            CHANGES_TABLE,
+            CHANGES_ACCOUNT_INSERT_TRIGGER,
+            CHANGES_ACCOUNT_UPDATE_TRIGGER,
+            CHANGES_ACCOUNT_DELETE_TRIGGER,
+            CHANGES_CATEGORY_INSERT_TRIGGER,
+            CHANGES_CATEGORY_UPDATE_TRIGGER,
+            CHANGES_CATEGORY_DELETE_TRIGGER,
+            CHANGES_TRANSACTION_INSERT_TRIGGER,
+            CHANGES_TRANSACTION_UPDATE_TRIGGER,
+            CHANGES_TRANSACTION_DELETE_TRIGGER,
+            CHANGES_RECURRENT_INSERT_TRIGGER,
+            CHANGES_RECURRENT_UPDATE_TRIGGER,
+            CHANGES_RECURRENT_DELETE_TRIGGER
+        };
+        return statements;
+    }
+
+}
 
 STATIC_INIT(Book) {
-    Book::initDatabse();
+    Book::prepareDatabase();
+}
+
+int
+Book::schemaFingerprint() {
+    // function-local statics are initialized once even when several threads open books at the same time
+    static const int fingerprint = []() {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(QByteArray(VERSION));
+        foreach(const QString& statement, schemaStatements()) {
+            hash.addData(statement.toUtf8());
+        }
+
+        // user_version is a signed 32 bit int and 0 is the value of a new database
+        auto result = hash.result();
+        int value = ((static_cast<unsigned char>(result.at(0)) & 0x7f) << 24)
+            | (static_cast<unsigned char>(result.at(1)) << 16)
+            | (static_cast<unsigned char>(result.at(2)) << 8)
+            | static_cast<unsigned char>(result.at(3));
+        return (value == 0)? 1 : value;
+    }();
+    return fingerprint;
+}
+
+void
+Book::prepareDatabase() {
+    QElapsedTimer timer;
+    timer.start();
+
+    // the fingerprint is read with a single query, when it matches there is no need to look at the schema
     Updater updater;
-    if (updater.needsUpgrade()) {
-        LOG(INFO) << "Database needs to be updated";
-        updater.upgrade();
+    auto fingerprint = schemaFingerprint();
+    auto stored = updater.getSchemaFingerprint();
+    LOG(INFO) << "Reading the schema fingerprint took " << timer.restart() << " ms";
+    if (stored == fingerprint) {
+        LOG(INFO) << "The database schema is up to date";
+        loadArchivedYears();
+        return;
     }
+
+    initDatabse();
+    LOG(INFO) << "Initializing the database took " << timer.restart() << " ms";
+
+    // the fingerprint changes with the statements, the upgrade is executed even if the tables are present so that
+    // the triggers are created again
+    LOG(INFO) << "Database needs to be updated";
+    updater.upgrade();
+    LOG(INFO) << "Upgrading the database took " << timer.restart() << " ms";
+
     updater.setDatabaseVersion();
+
+    // the fingerprint is only stored when the schema is complete so that a failed upgrade is retried on the next start
+    if (!updater.needsUpgrade()) {
+        updater.setSchemaFingerprint(fingerprint);
+    } else {
+        LOG(ERROR) << "The database schema is not complete after the upgrade";
+    }
+    LOG(INFO) << "Storing the database version took " << timer.restart() << " ms";
+
+    loadArchivedYears();
 }
 
 QString
@@ -345,6 +856,95 @@ Book::databasePath() {
     return dbPath;
 }
 
+QString
+Book::archivePath(int year) {
+    // the archives are kept next to the main database so that they are found when the data dir is moved
+    QFileInfo info(Book::databasePath());
+    return info.dir().absoluteFilePath(ARCHIVE_DATABASE_NAME.arg(year));
+}
+
+QList<int>
+Book::archived() {
+    std::lock_guard<std::mutex> lock(_archivedMutex);
+    return _archived;
+}
+
+void
+Book::setArchived(QList<int> years) {
+    std::lock_guard<std::mutex> lock(_archivedMutex);
+    _archived = years;
+}
+
+void
+Book::loadArchivedYears() {
+    auto db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "BOOKS");
+    db->setDatabaseName(Book::databasePath());
+
+    system::DatabaseLock<std::shared_ptr<system::Database>> dbLock(db);
+    if (!dbLock.opened()) {
+        LOG(ERROR) << "Could not open database to read the archived years " << db->lastError().text().toStdString();
+        return;
+    }
+    setArchived(selectArchivedYears(db));
+}
+
+QList<int>
+Book::selectArchivedYears(system::DatabasePtr db) {
+    QList<int> years;
+    auto query = db->createQuery();
+
+    // SELECT_ARCHIVED_YEARS = SELECT year FROM ArchivedYears ORDER BY year ASC
+    if (query->exec(SELECT_ARCHIVED_YEARS)) {
+        while (query->next()) {
+            years.append(query->value(0).toInt());
+        }
+    }
+    return years;
+}
+
+bool
+Book::attachArchive(system::DatabasePtr db, int year) {
+    // ATTACH_ARCHIVE = ATTACH DATABASE :path AS %1
+    auto query = db->createQuery();
+    query->prepare(ATTACH_ARCHIVE.arg(ARCHIVE_SCHEMA.arg(year)));
+    query->bindValue(":path", archivePath(year));
+    auto success = query->exec();
+    if (!success) {
+        LOG(ERROR) << "Could not attach the archive of " << year << " " << db->lastError().text().toStdString();
+    }
+    return success;
+}
+
+bool
+Book::attachArchives(system::DatabasePtr db) {
+    // without archives the AllTransactions view of the main database reads the transactions
+    auto years = archived();
+    if (years.isEmpty()) {
+        return true;
+    }
+
+    // attaching a missing file would create an empty archive, it is left out so that the view fails to be read
+    // instead of missing a year
+    auto view = CREATE_ALL_YEARS_VIEW.arg(ARCHIVE_COLUMNS);
+    foreach(int year, years) {
+        if (!QFile::exists(archivePath(year))) {
+            LOG(ERROR) << "The archive of " << year << " is not present";
+        } else {
+            attachArchive(db, year);
+        }
+        view += ALL_YEARS_VIEW_ARCHIVE.arg(ARCHIVE_COLUMNS, ARCHIVE_SCHEMA.arg(year));
+    }
+
+    // CREATE_ALL_YEARS_VIEW = CREATE TEMP VIEW AllTransactions AS SELECT %1 FROM main.Transactions
+    // ALL_YEARS_VIEW_ARCHIVE = UNION ALL SELECT %1 FROM %2.Transactions
+    auto query = db->createQuery();
+    auto success = query->exec(view);
+    if (!success) {
+        LOG(ERROR) << "Could not create the view of the archives " << db->lastError().text().toStdString();
+    }
+    return success;
+}
+
 QStringList
 Book::getTriggers(std::shared_ptr<system::Database> db) {
     QStringList triggers;
@@ -387,29 +987,9 @@ Book::initDatabse() {
         // create the required tables and indexes
         bool success = true;
         auto query = db->createQuery();
-        success &= query->exec(VERSION_TABLE);
-        success &= query->exec(FOREIGN_KEY_SUPPORT);
-        success &= query->exec(ACCOUNTS_TABLE);
-        success &= query->exec(CATEGORIES_TABLE);
-        success &= query->exec(TRANSACTION_TABLE);
-        success &= query->exec(RECURRENT_TRANSACTION_TABLE);
-        success &= query->exec(RECURRENT_TRANSACTIONS_RELATIONS_TABLE);
-        success &= query->exec(TRANSACTION_INSERT_TRIGGER);
-        success &= query->exec(TRANSACTION_UPDATE_SAME_ACCOUNT_TRIGGER);
-        success &= query->exec(TRANSACTION_UPDATE_DIFF_ACCOUNT_TRIGGER);
-        success &= query->exec(TRANSACTION_DELETE_TRIGGER);
-        success &= query->exec(RECURRENT_RELATIONS_DELETE_TRIGGER);
-        success &= query->exec(RECURRENT_RELATIONS_INSERT_TRIGGER);
-        success &= query->exec(CATEGORY_DELETE_TRIGGER);
-        success &= query->exec(ACCOUNT_DELETE_TRIGGER);
-        success &= query->exec(CATEGORY_UPDATE_DIFF_TYPE_TRIGGER);
-        success &= query->exec(TRANSACTION_MONTH_INDEX);
-        success &= query->exec(TRANSACTION_DAY_INDEX);
-        success &= query->exec(TRANSACTION_CATEGORY_INDEX);
-        success &= query->exec(TRANSACTION_CATEGORY_MONTH_INDEX);
-        success &= query->exec(TRANSACTION_ACCOUNT_INDEX);
-        success &= query->exec(ACCOUNT_MONTH_TOTAL_VIEW);
-        success &= query->exec(RECURRENT_RELATIONS_UPDATE_TRIGGER);
+        foreach(const QString& statement, schemaStatements()) {
+            success &= query->exec(statement);
+        }
 
         if (success)
             db->commit();
@@ -418,6 +998,9 @@ Book::initDatabse() {
 
         if (!success)
             LOG(ERROR) << "Could not create the chancho db " << db->lastError().text().toStdString();
+
+        // a new database has no archived years
+        setArchived(QList<int>());
     }
 }
 
@@ -429,7 +1012,14 @@ Book::tables() {
             "Categories",
             "Transactions",
             "RecurrentTransactions",
-            "RecurrentTransactionRelations"
+            "AccountBalanceCheckpoints",
+            "CategoryClosure",
+            "CategoryMonthTotals",
+            "Budgets",
+            "TransactionsSearch",
+            "ArchivedYears",
+            "Changes",
+            "BulkRecurrentTransactions"
     };
     return expected;
 }
@@ -445,12 +1035,58 @@ Book::triggers() {
             "DeleteTransactionsOnCategoryDelete",
             "UpdateTransactionsOnCategoryTypeUpdate",
             "DeleteRecurrentRelationsOnDelete",
-            "UpdateRecurrentRelationsOnInsert",
-            "UpdateGeneratedRelationsOnUpdate"
+            "UpdateCheckpointOnTransactionInsert",
+            "UpdateCheckpointOnTransactionUpdate",
+            "UpdateCheckpointOnTransactionDelete",
+            "DeleteCheckpointsOnAccountDelete",
+            "UpdateClosureOnCategoryInsert",
+            "UpdateClosureOnCategoryParentUpdate",
+            "UpdateClosureOnCategoryDelete",
+            "UpdateCategoryTotalsOnTransactionInsert",
+            "UpdateCategoryTotalsOnTransactionUpdate",
+            "UpdateCategoryTotalsOnTransactionDelete",
+            "DeleteBudgetsOnCategoryDelete",
+            "UpdateSearchOnTransactionInsert",
+            "UpdateSearchOnTransactionUpdate",
+            "UpdateSearchOnTransactionDelete",
+            "LogChangeOnAccountInsert",
+            "LogChangeOnAccountUpdate",
+            "LogChangeOnAccountDelete",
+            "LogChangeOnCategoryInsert",
+            "LogChangeOnCategoryUpdate",
+            "LogChangeOnCategoryDelete",
+            "LogChangeOnTransactionInsert",
+            "LogChangeOnTransactionUpdate",
+            "LogChangeOnTransactionDelete",
+            "LogChangeOnRecurrentTransactionInsert",
+            "LogChangeOnRecurrentTransactionUpdate",
+            "LogChangeOnRecurrentTransactionDelete"
     };
     return expected;
 }
 
+QStringList
+Book::triggerStatements() {
+    QStringList statements;
+    foreach(const QString& statement, schemaStatements()) {
+        if (statement.startsWith("CREATE TRIGGER")) {
+            statements.append(statement);
+        }
+    }
+    return statements;
+}
+
+QStringList
+Book::transactionIndexStatements() {
+    QStringList statements;
+    foreach(const QString& statement, schemaStatements()) {
+        if (statement.startsWith("CREATE INDEX") && statement.contains(" ON Transactions(")) {
+            statements.append(statement);
+        }
+    }
+    return statements;
+}
+
 Book::Book() {
     auto dbPath = Book::databasePath();
     _db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "BOOKS");
@@ -490,6 +1126,7 @@ Book::storeSingleAcc(AccountPtr acc) {
 
 void
 Book::store(AccountPtr acc) {
+    dropSnapshot();
     BookLock dbLock(this);
     if (!dbLock.opened()) {
         _lastError = _db->lastError().text();
@@ -501,6 +1138,7 @@ Book::store(AccountPtr acc) {
 
 void
 Book::store(QList<AccountPtr> accs) {
+    dropSnapshot();
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
@@ -563,6 +1201,7 @@ Book::storeSingleCat(CategoryPtr cat) {
 
 void
 Book::store(CategoryPtr cat) {
+    dropSnapshot();
     // if the cate has a parent and was not stored, we store it
     if (cat->parent && !cat->parent->wasStoredInDb()) {
         LOG(INFO) << "Storing parent that was not present already";
@@ -581,6 +1220,7 @@ Book::store(CategoryPtr cat) {
 
 void
 Book::store(QList<CategoryPtr> cats) {
+    dropSnapshot();
     // grab all parents, add the to the list of cats to store
     QList<CategoryPtr> parents;
     foreach(const CategoryPtr& cat, cats) {
@@ -669,6 +1309,7 @@ Book::storeSingleTransactions(TransactionPtr tran) {
     query->bindValue(":year", tran->date.year());
     query->bindValue(":contents", tran->contents);
     query->bindValue(":memo", tran->memo);
+    query->bindValue(":fingerprint", fingerprint(tran));
 
     // no need to use a transaction since is a single insert
     auto success = query->exec();
@@ -682,6 +1323,7 @@ Book::storeSingleTransactions(TransactionPtr tran) {
 
 void
 Book::store(TransactionPtr tran) {
+    dropSnapshot();
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
@@ -689,11 +1331,17 @@ Book::store(TransactionPtr tran) {
         LOG(ERROR) << _lastError.toStdString();
         return;
     }
+
+    if (tran->wasStoredInDb()
+            && !restoreArchived(RESTORED_TRANSACTION_FILTER, tran->_dbId.toString(), tran->date.year())) {
+        return;
+    }
     storeSingleTransactions(tran);
 }
 
 void
 Book::store(QList<TransactionPtr> trans) {
+    dropSnapshot();
     DLOG(INFO) << __PRETTY_FUNCTION__;
     BookLock dbLock(this);
 
@@ -710,6 +1358,16 @@ Book::store(QList<TransactionPtr> trans) {
         return;
     }
 
+    // the updated transactions leave the archives within the same transaction
+    foreach(const TransactionPtr tran, trans) {
+        if (tran->wasStoredInDb()
+                && !restoreArchived(_db, RESTORED_TRANSACTION_FILTER, tran->_dbId.toString(), tran->date.year())) {
+            _lastError = _db->lastError().text();
+            _db->rollback();
+            return;
+        }
+    }
+
     foreach(const TransactionPtr tran, trans) {
         auto success = storeSingleTransactions(tran);
         if (!success) {
@@ -746,9 +1404,9 @@ Book::storeSingleRecurrentTransactions(RecurrentTransactionPtr recurrent) {
 
     // INSERT_UPDATE_RECURRENT_TRANSACTION = INSERT OR REPLACE INTO RecurrentTransactions(
     //    uuid, amount, account, category, contents, memo, startDay, startMonth, startYear, lastDay, lastMonth, lastYear,
-    //    endDay, endMonth, endYear, defaultType, numberDays, occurrences)
+    //    endDay, endMonth, endYear, defaultType, numberDays, occurrences, next_due)
     //    VALUES(:uuid, :amount, :account, :category, :contents, :memo, :startDay, :startMonth, :startYear, :lastDay,
-    //    :lastMonth, :lastYear, :endDay, :endMonth, :endYear, :defaultType, :numberDays, :occurrences
+    //    :lastMonth, :lastYear, :endDay, :endMonth, :endYear, :defaultType, :numberDays, :occurrences, :nextDue
     auto query = _db->createQuery();
     query->prepare(INSERT_UPDATE_RECURRENT_TRANSACTION);
     query->bindValue(":uuid", recurrent->_dbId.toString());
@@ -807,6 +1465,14 @@ Book::storeSingleRecurrentTransactions(RecurrentTransactionPtr recurrent) {
         query->bindValue(":occurrences", QVariant());
     }
 
+    // the next due date lets the generation load just the recurrent transactions that have pending occurrences
+    auto nextDue = recurrent->recurrence->nextDue();
+    if (nextDue.isValid()) {
+        query->bindValue(":nextDue", nextDue.toString(Qt::ISODate));
+    } else {
+        query->bindValue(":nextDue", QVariant());
+    }
+
     // no need to use a transaction since is a single insert
     auto stored = query->exec();
     if (!stored) {
@@ -852,8 +1518,10 @@ Book::storeRecurrentNoUpdates(RecurrentTransactionPtr tran) {
     }
 
     // store the relation between the two
+    // UPDATE_TRANSACTION_RECURRENT = UPDATE Transactions SET is_recurrent=1, recurrent_id=:recurrent_transaction
+    //     WHERE uuid=:generated_transaction
     auto query = _db->createQuery();
-    query->prepare(INSERT_UPDATE_RECURRENT_TRANSACTION_RELATION);
+    query->prepare(UPDATE_TRANSACTION_RECURRENT);
     query->bindValue(":recurrent_transaction", tran->_dbId.toString());
     query->bindValue(":generated_transaction", tran->transaction->_dbId.toString());
 
@@ -890,24 +1558,78 @@ Book::storeRecurrentWithUpdate(RecurrentTransactionPtr recurrent) {
         return;
     }
 
+    if (!restoreArchived(RESTORED_RECURRENT_FILTER, recurrent->_dbId.toString())) {
+        return;
+    }
+
+    // a transaction is needed because the recurrent transaction, the generated ones and the aggregated data are
+    // updated with different statements
+    bool transaction = _db->transaction();
+    if (!transaction) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error creating the transaction " << _lastError.toStdString();
+        return;
+    }
+
+    // amounts are positive yet if it is an expense we must multiple by -1 to update the account accordingly
+    auto amount = recurrent->transaction->amount;
+    if (recurrent->transaction->type() == Category::Type::EXPENSE && amount > 0) {
+        amount = -1 * amount;
+    }
+    auto recurrentId = recurrent->_dbId.toString();
+    auto accId = recurrent->transaction->account->_dbId.toString();
+    auto catId = recurrent->transaction->category->_dbId.toString();
+
+    // the generated transactions are grouped so that the aggregated data is updated once per account, category
+    // and month instead of once per generated transaction
+    // SELECT_GENERATED_TOTALS = SELECT account, category, year, month, COUNT(*), SSUM(amount) FROM Transactions
+    //     WHERE recurrent_id=:recurrent GROUP BY account, category, year, month
+    QMap<QString, double> accountDeltas;
+    QMap<QString, QMap<QPair<int, int>, double>> checkpointDeltas;
+    QMap<QString, QMap<QPair<int, int>, double>> categoryDeltas;
+
+    if (!linkPendingGenerated(recurrentId)) {
+        _db->rollback();
+        return;
+    }
+
+    auto query = _db->createQuery();
+    query->prepare(SELECT_GENERATED_TOTALS);
+    query->bindValue(":recurrent", recurrentId);
+    auto success = query->exec();
+    if (!success) {
+        _lastError = query->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        _db->rollback();
+        return;
+    }
+
+    while (query->next()) {
+        auto oldAccId = query->value(0).toString();
+        auto oldCatId = query->value(1).toString();
+        auto month = qMakePair(query->value(2).toInt(), query->value(3).toInt());
+        auto oldTotal = query->value(5).toDouble();
+        auto newTotal = query->value(4).toInt() * amount;
+
+        accountDeltas[oldAccId] -= oldTotal;
+        accountDeltas[accId] += newTotal;
+        checkpointDeltas[oldAccId][month] -= oldTotal;
+        checkpointDeltas[accId][month] += newTotal;
+        categoryDeltas[oldCatId][month] -= oldTotal;
+        categoryDeltas[catId][month] += newTotal;
+    }
+
     // store the data for the specific info
     // UPDATE_RECURRENT_TRANSACTION = UPDATE RecurrentTransactions SET
     //     amount=:amount, account=:account, category=:category, contents=:contents, memo=:memo,
-    //     endDay=:endDay, endMonth=:endMonth, endYear=:endYear WHERE uuid=:uuid;
+    //     endDay=:endDay, endMonth=:endMonth, endYear=:endYear, next_due=:nextDue WHERE uuid=:uuid;
     LOG(INFO) << "Updating recurrent transaction.";
-    auto query = _db->createQuery();
+    query = _db->createQuery();
     query->prepare(UPDATE_RECURRENT_TRANSACTION);
-    query->bindValue(":uuid", recurrent->_dbId.toString());
-
-    // amounts are positive yet if it is an expense we must multiple by -1 to update the account accordingly
-    if (recurrent->transaction->type() == Category::Type::EXPENSE && recurrent->transaction->amount > 0) {
-        query->bindValue(":amount", QString::number(-1 * recurrent->transaction->amount));
-    } else {
-        query->bindValue(":amount", QString::number(recurrent->transaction->amount));
-    }
-
-    query->bindValue(":account", recurrent->transaction->account->_dbId.toString());
-    query->bindValue(":category", recurrent->transaction->category->_dbId.toString());
+    query->bindValue(":uuid", recurrentId);
+    query->bindValue(":amount", QString::number(amount));
+    query->bindValue(":account", accId);
+    query->bindValue(":category", catId);
     query->bindValue(":contents", recurrent->transaction->contents);
     query->bindValue(":memo", recurrent->transaction->memo);
 
@@ -921,16 +1643,78 @@ Book::storeRecurrentWithUpdate(RecurrentTransactionPtr recurrent) {
         query->bindValue(":endYear", QVariant());
     }
 
-    // no need to use a transaction since is a single insert
-    auto stored = query->exec();
-    if (!stored) {
+    // the end date might have changed and with it the next due date
+    auto nextDue = recurrent->recurrence->nextDue();
+    if (nextDue.isValid()) {
+        query->bindValue(":nextDue", nextDue.toString(Qt::ISODate));
+    } else {
+        query->bindValue(":nextDue", QVariant());
+    }
+
+    success = query->exec();
+    if (!success) {
         _lastError = query->lastError().text();
-        LOG(INFO) << _lastError.toStdString();
+        LOG(ERROR) << _lastError.toStdString();
+        _db->rollback();
+        return;
+    }
+
+    // the triggers skip the generated transactions while the recurrent transaction is in the bulk table
+    // INSERT_BULK_RECURRENT_TRANSACTION = INSERT OR IGNORE INTO BulkRecurrentTransactions(recurrent)
+    //     VALUES (:recurrent)
+    query = _db->createQuery();
+    query->prepare(INSERT_BULK_RECURRENT_TRANSACTION);
+    query->bindValue(":recurrent", recurrentId);
+    success = query->exec();
+
+    // UPDATE_GENERATED_TRANSACTIONS = UPDATE Transactions SET amount=:amount, account=:account, category=:category,
+    //     contents=:contents, memo=:memo WHERE recurrent_id=:recurrent
+    if (success) {
+        LOG(INFO) << "Updating generated transactions.";
+        query = _db->createQuery();
+        query->prepare(UPDATE_GENERATED_TRANSACTIONS);
+        query->bindValue(":amount", QString::number(amount));
+        query->bindValue(":account", accId);
+        query->bindValue(":category", catId);
+        query->bindValue(":contents", recurrent->transaction->contents);
+        query->bindValue(":memo", recurrent->transaction->memo);
+        query->bindValue(":recurrent", recurrentId);
+        success = query->exec();
+    }
+
+    // UPDATE_GENERATED_FINGERPRINTS = UPDATE Transactions SET
+    //     fingerprint=TransactionFingerprint(account, day, month, year, amount, contents) WHERE recurrent_id=:recurrent
+    if (success) {
+        query = _db->createQuery();
+        query->prepare(UPDATE_GENERATED_FINGERPRINTS);
+        query->bindValue(":recurrent", recurrentId);
+        success = query->exec();
+    }
+
+    // DELETE_BULK_RECURRENT_TRANSACTIONS = DELETE FROM BulkRecurrentTransactions
+    if (success) {
+        query = _db->createQuery();
+        success = query->exec(DELETE_BULK_RECURRENT_TRANSACTIONS);
+    }
+
+    if (!success) {
+        _lastError = query->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        _db->rollback();
+        return;
+    }
+
+    if (!storeGeneratedDeltas(accountDeltas, checkpointDeltas, categoryDeltas)) {
+        _db->rollback();
+        return;
     }
+
+    _db->commit();
 }
 
 void
 Book::store(RecurrentTransactionPtr tran, bool updatePast) {
+    dropSnapshot();
     // the triggers to update the generated transactions are just executed on an update not on an update
     // insert, therefore we check if we have store the recurrent transactions and we need to update the past
     // or not
@@ -943,6 +1727,7 @@ Book::store(RecurrentTransactionPtr tran, bool updatePast) {
 
 void
 Book::store(QList<RecurrentTransactionPtr> trans) {
+    dropSnapshot();
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
@@ -970,6 +1755,7 @@ Book::store(QList<RecurrentTransactionPtr> trans) {
 
 void
 Book::remove(AccountPtr acc) {
+    dropSnapshot();
     if (acc->_dbId.isNull()) {
         LOG(ERROR) << "Cannot delete account '" << acc->name.toStdString()
                 << "' with a NULL id";
@@ -985,6 +1771,11 @@ Book::remove(AccountPtr acc) {
         return;
     }
 
+    // the delete trigger removes the transactions of the main database, the archived ones are moved there first
+    if (!restoreArchived(RESTORED_ACCOUNT_FILTER, acc->_dbId.toString())) {
+        return;
+    }
+
     auto query = _db->createQuery();
     query->prepare(DELETE_ACCOUNT);
     query->bindValue(":uuid", acc->_dbId.toString());
@@ -1000,6 +1791,7 @@ Book::remove(AccountPtr acc) {
 
 void
 Book::remove(CategoryPtr cat) {
+    dropSnapshot();
     if (cat->_dbId.isNull()) {
         LOG(ERROR) << "Cannot delete category '" << cat->name.toStdString()
                 << "' with a NULL id";
@@ -1015,9 +1807,17 @@ Book::remove(CategoryPtr cat) {
         return;
     }
 
+    // the delete triggers remove the transactions of the main database, the archived ones are moved there first
+    if (!restoreArchived(RESTORED_CATEGORY_FILTER, cat->_dbId.toString())) {
+        return;
+    }
+
     // ensure that we have a transaction so that we do not have the db in a non stable state
     _db->transaction();
 
+    // DELETE_CHILD_CATEGORIES = DELETE FROM Categories WHERE uuid IN
+    //     (SELECT descendant FROM CategoryClosure WHERE ancestor=:uuid AND depth > 0)
+    // the closure table allows to remove the whole subtree in a single statement
     auto deleteChildCats = _db->createQuery();
     deleteChildCats->prepare(DELETE_CHILD_CATEGORIES);
     deleteChildCats->bindValue(":uuid", cat->_dbId.toString());
@@ -1042,6 +1842,7 @@ Book::remove(CategoryPtr cat) {
 
 void
 Book::remove(TransactionPtr tran) {
+    dropSnapshot();
     if (tran->_dbId.isNull()) {
         LOG(ERROR) << "Cannot delete transaction with a NULL id";
         _lastError = "Cannot delete Account that was not added to the db";
@@ -1056,6 +1857,10 @@ Book::remove(TransactionPtr tran) {
         return;
     }
 
+    if (!restoreArchived(RESTORED_TRANSACTION_FILTER, tran->_dbId.toString(), tran->date.year())) {
+        return;
+    }
+
     auto query = _db->createQuery();
     query->prepare(DELETE_TRANSACTION);
     query->bindValue(":uuid", tran->_dbId.toString());
@@ -1071,6 +1876,7 @@ Book::remove(TransactionPtr tran) {
 
 void
 Book::remove(RecurrentTransactionPtr tran, bool removeGenerated) {
+    dropSnapshot();
     if (tran->_dbId.isNull()) {
         LOG(ERROR) << "Cannot delete transaction with a NULL id";
         _lastError = "Cannot delete Account that was not added to the db";
@@ -1085,13 +1891,18 @@ Book::remove(RecurrentTransactionPtr tran, bool removeGenerated) {
         return;
     }
 
+    if (removeGenerated && !restoreArchived(RESTORED_RECURRENT_FILTER, tran->_dbId.toString())) {
+        return;
+    }
+
     bool success = true;
     _db->transaction();
 
     auto query = _db->createQuery();
     if (removeGenerated) {
-        // DELETE_RECURRENT_GENERATED = DELETE FROM Transactions WHERE uuid IN (SELECT generated_transaction FROM
-        //     RecurrentTransactionRelations WHERE recurrent_transaction=:recurrent_Transaction)
+        success &= linkPendingGenerated(tran->_dbId.toString());
+
+        // DELETE_RECURRENT_GENERATED = DELETE FROM Transactions WHERE recurrent_id=:recurrent_Transaction
         query->prepare(DELETE_RECURRENT_GENERATED);
         query->bindValue(":recurrent_Transaction", tran->_dbId.toString());
         success &= query->exec();
@@ -1111,26 +1922,88 @@ Book::remove(RecurrentTransactionPtr tran, bool removeGenerated) {
     tran->_dbId = QUuid();
 }
 
-QList<AccountPtr>
-Book::accounts(boost::optional<int> limit, boost::optional<int> offset) {
-    QList<AccountPtr> accs;
+void
+Book::setBudget(CategoryPtr cat, double amount) {
+    if (cat->_dbId.isNull()) {
+        LOG(ERROR) << "Cannot set the budget of category '" << cat->name.toStdString() << "' with a NULL id";
+        _lastError = "Cannot set the budget of a Category that was not added to the db";
+        return;
+    }
 
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
         _lastError = _db->lastError().text();
         LOG(ERROR) << _lastError.toStdString();
-        return accs;
+        return;
     }
 
+    // INSERT_UPDATE_BUDGET = INSERT OR REPLACE INTO Budgets(category, amount) VALUES (:category, :amount)
     auto query = _db->createQuery();
-    if (limit) {
-        // SELECT_ALL_ACCOUNTS_LIMIT = SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts ORDER BY name ASC
-        //     LIMIT :limit OFFSET :offset;
-        query->prepare(SELECT_ALL_ACCOUNTS_LIMIT);
-        query->bindValue(":limit", *limit);
+    query->prepare(INSERT_UPDATE_BUDGET);
+    query->bindValue(":category", cat->_dbId.toString());
+    query->bindValue(":amount", QString::number(std::abs(amount)));
+    auto success = query->exec();
 
-        if (offset) {
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+    }
+}
+
+void
+Book::removeBudget(CategoryPtr cat) {
+    if (cat->_dbId.isNull()) {
+        LOG(ERROR) << "Cannot remove the budget of category '" << cat->name.toStdString() << "' with a NULL id";
+        _lastError = "Cannot remove the budget of a Category that was not added to the db";
+        return;
+    }
+
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    // DELETE_BUDGET = DELETE FROM Budgets WHERE category=:category
+    auto query = _db->createQuery();
+    query->prepare(DELETE_BUDGET);
+    query->bindValue(":category", cat->_dbId.toString());
+    auto success = query->exec();
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+    }
+}
+
+QList<AccountPtr>
+Book::accounts(boost::optional<int> limit, boost::optional<int> offset) {
+    auto snapshot = currentSnapshot();
+    if (snapshot) {
+        return snapshot->accounts(limit, offset);
+    }
+
+    QList<AccountPtr> accs;
+
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return accs;
+    }
+
+    auto query = _db->createQuery();
+    if (limit) {
+        // SELECT_ALL_ACCOUNTS_LIMIT = SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts ORDER BY name ASC
+        //     LIMIT :limit OFFSET :offset;
+        query->prepare(SELECT_ALL_ACCOUNTS_LIMIT);
+        query->bindValue(":limit", *limit);
+
+        if (offset) {
             query->bindValue(":offset", *offset);
         } else {
             query->bindValue(":offset", 0);
@@ -1172,6 +2045,11 @@ Book::accounts(boost::optional<int> limit, boost::optional<int> offset) {
 
 int
 Book::numberOfAccounts() {
+    auto snapshot = currentSnapshot();
+    if (snapshot) {
+        return snapshot->numberOfAccounts();
+    }
+
     int count = -1;
     BookLock dbLock(this);
 
@@ -1277,6 +2155,11 @@ Book::parseCategories(std::shared_ptr<system::Query> query) {
 
 QList<CategoryPtr>
 Book::categories(boost::optional<Category::Type> type, boost::optional<int> limit, boost::optional<int> offset) {
+    auto snapshot = currentSnapshot();
+    if (snapshot) {
+        return snapshot->categories(type, limit, offset);
+    }
+
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
@@ -1330,6 +2213,11 @@ Book::categories(boost::optional<Category::Type> type, boost::optional<int> limi
 
 int
 Book::numberOfCategories(boost::optional<Category::Type> type) {
+    auto snapshot = currentSnapshot();
+    if (snapshot) {
+        return snapshot->numberOfCategories(type);
+    }
+
     int count = -1;
 
     BookLock dbLock(this);
@@ -1442,7 +2330,7 @@ Book::transactions(int year, int month, boost::optional<int> day, boost::optiona
     if (day) {
         if (limit) {
             // SELECT_TRANSACTIONS_DAY_LIMIT = SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-            //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+            //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
             //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
             //     WHERE t.day=:day AND t.month=:month AND t.year=:year ORDER BY t.year, t.month LIMIT :limit OFFSET :offset
             query->prepare(SELECT_TRANSACTIONS_DAY_LIMIT);
@@ -1457,7 +2345,7 @@ Book::transactions(int year, int month, boost::optional<int> day, boost::optiona
             }
         } else {
             // SELECT_TRANSACTIONS_DAY = SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-            //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+            //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
             //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
             //     WHERE t.day=:day AND t.month=:month AND t.year=:year ORDER BY t.day, t.year, t.month
             query->prepare(SELECT_TRANSACTIONS_DAY);
@@ -1468,7 +2356,7 @@ Book::transactions(int year, int month, boost::optional<int> day, boost::optiona
     } else {
         if (limit) {
             // SELECT_TRANSACTIONS_MONTH_LIMIT = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-            //    t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+            //    t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
             //    INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
             //    WHERE t.month=:month AND t.year=:year ORDER BY t.year, t.month LIMIT :limit OFFSET :offset
             query->prepare(SELECT_TRANSACTIONS_MONTH_LIMIT);
@@ -1483,7 +2371,7 @@ Book::transactions(int year, int month, boost::optional<int> day, boost::optiona
 
         } else {
             // SELECT_TRANSACTIONS_MONTH = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, t.year, t.contents, t.memo, t.is_recurrent,
-            //         c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+            //         c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
             //         INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
             //         WHERE t.month=:month AND t.year=:year";
             query->prepare(SELECT_TRANSACTIONS_MONTH);
@@ -1507,14 +2395,17 @@ Book::transactions(RecurrentTransactionPtr recurrent, boost::optional<int> limit
         return trans;
     }
 
+    if (!linkPendingGenerated(recurrent->_dbId.toString())) {
+        return trans;
+    }
+
     auto query = _db->createQuery();
 
     if (limit) {
         // SELECT_TRANSACTIONS_RECURRENT_LIMIT =  SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-        //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+        //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
         //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
-        //     WHERE t.uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE
-        //     recurrent_transaction=:recurrent_Transaction) ORDER BY t.year, t.month LIMIT :limit OFFSET :offset
+        //     WHERE t.recurrent_id=:recurrent_Transaction ORDER BY t.year, t.month LIMIT :limit OFFSET :offset
         query->prepare(SELECT_TRANSACTIONS_RECURRENT_LIMIT);
         query->bindValue(":limit", *limit);
         if (offset) {
@@ -1524,10 +2415,9 @@ Book::transactions(RecurrentTransactionPtr recurrent, boost::optional<int> limit
         }
     } else {
         // SELECT_TRANSACTIONS_RECURRENT =  SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-        //  t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+        //  t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
         //  INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
-        //  WHERE t.uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE
-        //  recurrent_transaction=:recurrent_Transaction) ORDER BY t.year, t.month
+        //  WHERE t.recurrent_id=:recurrent_Transaction ORDER BY t.year, t.month
         query->prepare(SELECT_TRANSACTIONS_RECURRENT);
     }
     query->bindValue(":recurrent_Transaction", recurrent->_dbId.toString());
@@ -1550,6 +2440,7 @@ Book::numberOfTransactions() {
     }
 
     auto query = _db->createQuery();
+    // the transactions of the archived years are counted when they are archived, the archives are not attached
     query->prepare(SELECT_TRANSACTIONS_COUNT);
     auto success = query->exec();
 
@@ -1632,10 +2523,14 @@ Book::numberOfTransactions(RecurrentTransactionPtr recurrent) {
         return count;
     }
 
+    if (!linkPendingGenerated(recurrent->_dbId.toString())) {
+        return count;
+    }
+
     auto query = _db->createQuery();
 
-    // SELECT_GENERATED_TRANSACTIONS_RECURRENT_COUNT = SELECT count(*) FROM RecurrentTransactionRelations WHERE
-    //     recurrent_transaction=:recurrent_Transaction
+    // SELECT_GENERATED_TRANSACTIONS_RECURRENT_COUNT = SELECT count(*) FROM AllTransactions WHERE
+    //     recurrent_id=:recurrent_Transaction
     query->prepare(SELECT_GENERATED_TRANSACTIONS_RECURRENT_COUNT);
     query->bindValue(":recurrent_Transaction", recurrent->_dbId.toString());
     auto success = query->exec();
@@ -1651,6 +2546,238 @@ Book::numberOfTransactions(RecurrentTransactionPtr recurrent) {
     return count;
 }
 
+bool
+Book::linkPendingGenerated(QString recurrent) {
+    // while the RecurrentTransactionRelations migration runs in the background some generated transactions are only
+    // linked by the relations table, their links are copied before they are looked up by their recurrent transaction
+    // once the migration dropped the table it is not created again, the lookup is not repeated
+    if (_relationsMigrated) {
+        return true;
+    }
+
+    // SELECT_TABLE = SELECT name FROM sqlite_master WHERE type='table' AND name=:name
+    auto query = _db->createQuery();
+    query->prepare(SELECT_TABLE);
+    query->bindValue(":name", RECURRENT_RELATIONS_TABLE_NAME);
+    if (!query->exec()) {
+        _lastError = query->lastError().text();
+        LOG(ERROR) << "Could not look for the relations table " << _lastError.toStdString();
+        return false;
+    }
+    if (!query->next()) {
+        _relationsMigrated = true;
+        return true;
+    }
+
+    // LINK_PENDING_GENERATED = UPDATE Transactions SET recurrent_id=:recurrent WHERE recurrent_id IS NULL
+    //     AND uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations
+    //     WHERE recurrent_transaction=:relationsRecurrent)
+    query->prepare(LINK_PENDING_GENERATED);
+    query->bindValue(":recurrent", recurrent);
+    query->bindValue(":relationsRecurrent", recurrent);
+    auto success = query->exec();
+    if (!success) {
+        _lastError = query->lastError().text();
+        LOG(ERROR) << "Could not link the generated transactions " << _lastError.toStdString();
+    }
+    return success;
+}
+
+qint64
+Book::fingerprint(TransactionPtr tran) {
+    QString account;
+    if (tran->account) {
+        account = tran->account->_dbId.toString();
+    }
+    return transactionFingerprint(account, tran->date.day(), tran->date.month(), tran->date.year(),
+            QString::number(tran->amount), tran->contents);
+}
+
+bool
+Book::isPresent(TransactionPtr tran) {
+    if (!tran->account || !tran->account->wasStoredInDb()) {
+        return false;
+    }
+
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error opening database " << _lastError.toStdString();
+        return false;
+    }
+
+    // SELECT_FINGERPRINT_COUNT = SELECT COUNT(*) FROM AllTransactions
+    //     WHERE fingerprint=:fingerprint AND year=:year
+    auto query = _db->createQuery();
+    query->prepare(SELECT_FINGERPRINT_COUNT);
+    query->bindValue(":fingerprint", fingerprint(tran));
+    query->bindValue(":year", tran->date.year());
+    auto success = query->exec();
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error retrieving the fingerprints " << _lastError.toStdString();
+        return false;
+    }
+    return query->next() && query->value(0).toInt() > 0;
+}
+
+QList<TransactionPtr>
+Book::filterPresent(QList<TransactionPtr> trans) {
+    QHash<qint64, int> seen;
+    return filterPresent(trans, seen);
+}
+
+QList<TransactionPtr>
+Book::filterPresent(QList<TransactionPtr> trans, QHash<qint64, int>& seen) {
+    QList<TransactionPtr> result;
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error opening database " << _lastError.toStdString();
+        return result;
+    }
+
+    // a transaction is present when the book has more transactions with its fingerprint than the seen ones, the
+    // returned ones are seen as well because they are going to be stored
+    QHash<qint64, int> stored;
+    auto query = _db->createQuery();
+    query->prepare(SELECT_FINGERPRINT_COUNT);
+
+    foreach(const TransactionPtr& tran, trans) {
+        // transactions of accounts that have not been stored cannot be present
+        if (!tran->account || !tran->account->wasStoredInDb()) {
+            result.append(tran);
+            continue;
+        }
+
+        auto key = fingerprint(tran);
+        if (!stored.contains(key)) {
+            // SELECT_FINGERPRINT_COUNT = SELECT COUNT(*) FROM AllTransactions
+            //     WHERE fingerprint=:fingerprint AND year=:year
+            query->bindValue(":fingerprint", key);
+            query->bindValue(":year", tran->date.year());
+            if (!query->exec()) {
+                _lastError = _db->lastError().text();
+                LOG(ERROR) << "Error retrieving the fingerprints " << _lastError.toStdString();
+                return QList<TransactionPtr>();
+            }
+            stored[key] = query->next() ? query->value(0).toInt() : 0;
+        }
+
+        if (seen[key] >= stored[key]) {
+            result.append(tran);
+        }
+        seen[key]++;
+    }
+
+    return result;
+}
+
+Book::SearchPage
+Book::search(QString query, SearchFilter filter, SearchCursor cursor, int limit) {
+    SearchPage page;
+
+    // every word is quoted so that the fts operators typed by the user are matched literally, the words are matched
+    // as prefixes to allow searching while typing
+    QStringList terms;
+    foreach(const QString& word, query.simplified().split(' ', QString::SkipEmptyParts)) {
+        auto hasText = std::any_of(word.begin(), word.end(), [](const QChar& c) { return c.isLetterOrNumber(); });
+        if (hasText) {
+            terms.append(QString("\"%1\"*").arg(QString(word).replace("\"", "\"\"")));
+        }
+    }
+
+    if (terms.isEmpty() || limit <= 0) {
+        return page;
+    }
+
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return page;
+    }
+
+    QString filters;
+    if (filter.account) {
+        filters += SEARCH_ACCOUNT_FILTER;
+    }
+    if (filter.category) {
+        filters += SEARCH_CATEGORY_FILTER;
+    }
+    if (filter.from.isValid()) {
+        filters += SEARCH_FROM_FILTER;
+    }
+    if (filter.to.isValid()) {
+        filters += SEARCH_TO_FILTER;
+    }
+    if (cursor.isValid()) {
+        filters += SEARCH_CURSOR_FILTER;
+    }
+
+    // SEARCH_MATCHES = SELECT uuid, amount, account, category, day, month, year, contents, memo,
+    //     is_recurrent, match_rank, match_id FROM matches INNER JOIN %1.Transactions ON id = match_id
+    auto matches = SEARCH_MATCHES.arg("main");
+    foreach(int year, archived()) {
+        matches += SEARCH_MATCHES_ARCHIVE.arg(SEARCH_MATCHES.arg(ARCHIVE_SCHEMA.arg(year)));
+    }
+
+    // SELECT_SEARCH = WITH matches AS (SELECT rowid AS match_id, rank AS match_rank
+    //     FROM TransactionsSearch WHERE TransactionsSearch MATCH :query)
+    //     SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, t.year, t.contents, t.memo, t.is_recurrent,
+    //     c.parent, c.name, c.type, a.name, a.memo, a.amount, t.match_rank, t.match_id FROM (%1) AS t
+    //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
+    //     WHERE t.match_id IS NOT NULL %2
+    //     ORDER BY t.match_rank, t.match_id LIMIT :limit
+    auto sqlQuery = _db->createQuery();
+    sqlQuery->prepare(SELECT_SEARCH.arg(matches, filters));
+    sqlQuery->bindValue(":query", terms.join(" "));
+    if (filter.account) {
+        sqlQuery->bindValue(":account", filter.account->_dbId.toString());
+    }
+    if (filter.category) {
+        sqlQuery->bindValue(":category", filter.category->_dbId.toString());
+    }
+    if (filter.from.isValid()) {
+        sqlQuery->bindValue(":fromYear", filter.from.year());
+        sqlQuery->bindValue(":fromEdgeYear", filter.from.year());
+        sqlQuery->bindValue(":fromMonth", filter.from.month());
+        sqlQuery->bindValue(":fromEdgeMonth", filter.from.month());
+        sqlQuery->bindValue(":fromDay", filter.from.day());
+    }
+    if (filter.to.isValid()) {
+        sqlQuery->bindValue(":toYear", filter.to.year());
+        sqlQuery->bindValue(":toEdgeYear", filter.to.year());
+        sqlQuery->bindValue(":toMonth", filter.to.month());
+        sqlQuery->bindValue(":toEdgeMonth", filter.to.month());
+        sqlQuery->bindValue(":toDay", filter.to.day());
+    }
+    if (cursor.isValid()) {
+        sqlQuery->bindValue(":rank", cursor.rank);
+        sqlQuery->bindValue(":sameRank", cursor.rank);
+        sqlQuery->bindValue(":rowid", cursor.rowid);
+    }
+    // an extra row is requested to know if there is a next page
+    sqlQuery->bindValue(":limit", limit + 1);
+
+    page.transactions = parseTransactions(sqlQuery);
+
+    if (page.transactions.count() > limit) {
+        page.transactions.removeLast();
+        // the cursor points to the last returned result, the next page starts right after it
+        if (sqlQuery->seek(limit - 1)) {
+            page.next.rank = sqlQuery->value(16).toDouble();
+            page.next.rowid = sqlQuery->value(17).toLongLong();
+        }
+    }
+
+    return page;
+}
+
 QList<TransactionPtr>
 Book::transactions(CategoryPtr cat, boost::optional<int> month, boost::optional<int> year) {
     QList<TransactionPtr> trans;
@@ -1671,7 +2798,7 @@ Book::transactions(CategoryPtr cat, boost::optional<int> month, boost::optional<
 
     if (month && year) {
         // SELECT_TRANSACTIONS_CATEGORY_MONTH = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-        //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+        //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
         //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
         //     WHERE t.category=:category AND t.month=:month AND t.year=:year
         query->prepare(SELECT_TRANSACTIONS_CATEGORY_MONTH);
@@ -1680,7 +2807,7 @@ Book::transactions(CategoryPtr cat, boost::optional<int> month, boost::optional<
         query->bindValue(":year", *year);
     } else {
         // SELECT_TRANSACTIONS_CATEGORY = SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-        //    t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+        //    t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
         //    INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
         //    WHERE t.category=:category;
         query->prepare(SELECT_TRANSACTIONS_CATEGORY);
@@ -1711,7 +2838,7 @@ Book::transactions(AccountPtr acc) {
 
 
     // SELECT_TRANSACTIONS_ACCOUNT = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
-    //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM Transactions AS t
+    //     t.year, t.contents, t.memo, t.is_recurrent, c.parent, c.name, c.type, a.name, a.memo, a.amount FROM AllTransactions AS t
     //     INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON t.account = a.uuid
     //     WHERE t.account=:account;
     auto query = _db->createQuery();
@@ -1734,7 +2861,7 @@ Book::monthsWithTransactions(int year, boost::optional<int> limit, boost::option
         return result;
     }
 
-    // SELECT_MONTHS_WITH_TRANSACTIONS = "SELECT DISTINCT month FROM Transactions WHERE year=:year
+    // SELECT_MONTHS_WITH_TRANSACTIONS = "SELECT DISTINCT month FROM AllTransactions WHERE year=:year
     //     ORDER BY month DESC";
     auto query = _db->createQuery();
     // if limit is present, use it, else just get all of the transactions
@@ -1777,7 +2904,7 @@ Book::numberOfMonthsWithTransactions(int year) {
         return count;
     }
 
-    // SELECT_MONTHS_WITH_TRANSACTIONS_COUNT = SELECT count(DISTINCT month) FROM Transactions WHERE year=:year
+    // SELECT_MONTHS_WITH_TRANSACTIONS_COUNT = SELECT count(DISTINCT month) FROM AllTransactions WHERE year=:year
     auto query = _db->createQuery();
     query->prepare(SELECT_MONTHS_WITH_TRANSACTIONS_COUNT);
     query->bindValue(":year", year);
@@ -1795,6 +2922,11 @@ Book::numberOfMonthsWithTransactions(int year) {
 
 QList<int>
 Book::daysWithTransactions(int month, int year, boost::optional<int> limit, boost::optional<int> offset) {
+    auto snapshot = currentSnapshot();
+    if (snapshot && snapshot->covers(month, year)) {
+        return snapshot->days(limit, offset);
+    }
+
     QList<int> result;
     BookLock dbLock(this);
     if (!dbLock.opened()) {
@@ -1805,7 +2937,7 @@ Book::daysWithTransactions(int month, int year, boost::optional<int> limit, boos
 
     auto query = _db->createQuery();
     if (limit) {
-        // SELECT_DAYS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT day FROM Transactions
+        // SELECT_DAYS_WITH_TRANSACTIONS_LIMIT = "SELECT DISTINCT day FROM AllTransactions
         //    WHERE year=:year AND month=:month ORDER BY day DESC LIMIT :limit OFFSET :offset
         query->prepare(SELECT_DAYS_WITH_TRANSACTIONS_LIMIT);
         query->bindValue(":month", month);
@@ -1818,9 +2950,9 @@ Book::daysWithTransactions(int month, int year, boost::optional<int> limit, boos
             query->bindValue(":offset", 0);
         }
     } else {
-        // SELECT_DAYS_WITH_TRANSACTIONS = "SELECT DISTINCT day FROM Transactions
+        // SELECT_DAYS_WITH_TRANSACTIONS = "SELECT DISTINCT day FROM AllTransactions
         //    WHERE year=:year AND month=:month ORDER BY day;
-        query->prepare(SELECT_DAYS_WITH_TRANSACTIONS );
+        query->prepare(SELECT_DAYS_WITH_TRANSACTIONS);
         query->bindValue(":month", month);
         query->bindValue(":year", year);
     }
@@ -1841,6 +2973,11 @@ Book::daysWithTransactions(int month, int year, boost::optional<int> limit, boos
 
 int
 Book::numberOfDaysWithTransactions(int month, int year) {
+    auto snapshot = currentSnapshot();
+    if (snapshot && snapshot->covers(month, year)) {
+        return snapshot->numberOfDays();
+    }
+
     int count = -1;
 
     BookLock dbLock(this);
@@ -1851,7 +2988,7 @@ Book::numberOfDaysWithTransactions(int month, int year) {
         return count;
     }
 
-    // SELECT_DAYS_WITH_TRANSACTIONS_COUNT = SELECT COUNT(DISTINCT day) FROM Transactions
+    // SELECT_DAYS_WITH_TRANSACTIONS_COUNT = SELECT COUNT(DISTINCT day) FROM AllTransactions
     //    WHERE year=:year AND month=:month
     auto query = _db->createQuery();
     query->prepare(SELECT_DAYS_WITH_TRANSACTIONS_COUNT);
@@ -2183,85 +3320,386 @@ Book::numberOfRecurrentCategories() {
     return count;
 }
 
-void
+bool
 Book::storeGeneratedTransactions(QMap<RecurrentTransactionPtr, QList<TransactionPtr>> transMap) {
+    dropSnapshot();
     DLOG(INFO) << __PRETTY_FUNCTION__;
     BookLock dbLock(this);
 
     if (!dbLock.opened()) {
         _lastError = _db->lastError().text();
         LOG(ERROR) << _lastError.toStdString();
-        return;
+        return false;
     }
 
     bool transaction = _db->transaction();
     if (!transaction) {
         _lastError = _db->lastError().text();
         LOG(ERROR) << "Error creating the transaction " << _lastError.toStdString();
-        return;
+        return false;
     }
 
+    // the recurrent transactions are added to the bulk table so that the triggers do not update the aggregated data
+    // per generated row, the movements are accumulated and applied once per account, category and month
+    QMap<QString, double> accountDeltas;
+    QMap<QString, QMap<QPair<int, int>, double>> checkpointDeltas;
+    QMap<QString, QMap<QPair<int, int>, double>> categoryDeltas;
+
+    // INSERT_GENERATED_TRANSACTION = INSERT OR IGNORE INTO Transactions(uuid, amount, account, category, day, month,
+    //     year, contents, memo, is_recurrent, recurrent_id, fingerprint) VALUES (:uuid, :amount, :account, :category,
+    //     :day, :month, :year, :contents, :memo, 1, :recurrent, :fingerprint)
+    auto insertQuery = _db->createQuery();
+    insertQuery->prepare(INSERT_GENERATED_TRANSACTION);
+
+    // UPDATE_RECURRENT_GENERATION = UPDATE RecurrentTransactions SET lastDay=:lastDay, lastMonth=:lastMonth,
+    //     lastYear=:lastYear, next_due=:nextDue WHERE uuid=:uuid
+    auto generationQuery = _db->createQuery();
+    generationQuery->prepare(UPDATE_RECURRENT_GENERATION);
+
+    // INSERT_BULK_RECURRENT_TRANSACTION = INSERT OR IGNORE INTO BulkRecurrentTransactions(recurrent)
+    //     VALUES (:recurrent)
+    auto bulkQuery = _db->createQuery();
+    bulkQuery->prepare(INSERT_BULK_RECURRENT_TRANSACTION);
+
     foreach(const RecurrentTransactionPtr& recurrentTransaction, transMap.keys()) {
         auto trans = transMap[recurrentTransaction];
+
+        bulkQuery->bindValue(":recurrent", recurrentTransaction->_dbId.toString());
+        if (!bulkQuery->exec()) {
+            _lastError = bulkQuery->lastError().text();
+            LOG(ERROR) << _lastError.toStdString();
+            _db->rollback();
+            return false;
+        }
+
         foreach(const TransactionPtr tran, trans) {
-            auto success = storeSingleTransactions(tran);
-            if (!success) {
+            // usually accounts and categories must be stored before storing a transactions
+            if (!tran->account || !tran->account->wasStoredInDb()) {
+                _lastError = "An account must be stored before adding a transaction to it.";
+                LOG(ERROR) << _lastError.toStdString();
                 _db->rollback();
-                return;;
+                return false;
             }
-        }
 
-        // we need to store the relations between the recurrent transaction and the generated ones
-        auto query = _db->createQuery();
-        query->prepare(INSERT_UPDATE_RECURRENT_TRANSACTION_RELATION);
+            if (!tran->category || !tran->category->wasStoredInDb()) {
+                _lastError = "A category must be stored before adding a transaction to it.";
+                LOG(ERROR) << _lastError.toStdString();
+                _db->rollback();
+                return false;
+            }
 
-        foreach(const TransactionPtr tran, trans) {
-            query->bindValue(":recurrent_transaction", recurrentTransaction->_dbId.toString());
-            query->bindValue(":generated_transaction", tran->_dbId.toString());
-            auto success = query->exec();
+            // an occurrence is identified by its recurrent transaction and its date
+            tran->_dbId = QUuid::createUuidV5(recurrentTransaction->_dbId, tran->date.toString(Qt::ISODate));
+
+            // amounts are positive yet if it is an expense we must multiple by -1 to update the account accordingly
+            auto amount = tran->amount;
+            if (tran->type() == Category::Type::EXPENSE && amount > 0) {
+                amount = -1 * amount;
+            }
+
+            auto accId = tran->account->_dbId.toString();
+            auto catId = tran->category->_dbId.toString();
+
+            insertQuery->bindValue(":uuid", tran->_dbId.toString());
+            insertQuery->bindValue(":amount", QString::number(amount));
+            insertQuery->bindValue(":account", accId);
+            insertQuery->bindValue(":category", catId);
+            insertQuery->bindValue(":day", tran->date.day());
+            insertQuery->bindValue(":month", tran->date.month());
+            insertQuery->bindValue(":year", tran->date.year());
+            insertQuery->bindValue(":contents", tran->contents);
+            insertQuery->bindValue(":memo", tran->memo);
+            insertQuery->bindValue(":recurrent", recurrentTransaction->_dbId.toString());
+            insertQuery->bindValue(":fingerprint", fingerprint(tran));
+
+            auto success = insertQuery->exec();
             if (!success) {
+                _lastError = insertQuery->lastError().text();
+                LOG(ERROR) << _lastError.toStdString();
+                tran->_dbId = QUuid();
                 _db->rollback();
-                return;
+                return false;
             }
+
+            // the occurrence was already received from another copy of the book and is in the balances
+            if (insertQuery->numRowsAffected() == 0) {
+                continue;
+            }
+
+            auto month = qMakePair(tran->date.year(), tran->date.month());
+            accountDeltas[accId] += amount;
+            checkpointDeltas[accId][month] += amount;
+            categoryDeltas[catId][month] += amount;
         }
 
-        // we need to update the data in which the last generated transactions was added
+        // we need to update the data in which the last generated transactions was added, just the columns of the
+        // generation are updated so that the recurrent transaction is not logged as changed
         DLOG(INFO) << "Updating last generated transaction";
-        storeSingleRecurrentTransactions(recurrentTransaction);
+        auto recurrence = recurrentTransaction->recurrence;
+        if (recurrence->lastGenerated.isValid()) {
+            generationQuery->bindValue(":lastDay", recurrence->lastGenerated.day());
+            generationQuery->bindValue(":lastMonth", recurrence->lastGenerated.month());
+            generationQuery->bindValue(":lastYear", recurrence->lastGenerated.year());
+        } else {
+            generationQuery->bindValue(":lastDay", QVariant());
+            generationQuery->bindValue(":lastMonth", QVariant());
+            generationQuery->bindValue(":lastYear", QVariant());
+        }
+
+        auto nextDue = recurrence->nextDue();
+        if (nextDue.isValid()) {
+            generationQuery->bindValue(":nextDue", nextDue.toString(Qt::ISODate));
+        } else {
+            generationQuery->bindValue(":nextDue", QVariant());
+        }
+        generationQuery->bindValue(":uuid", recurrentTransaction->_dbId.toString());
+
+        if (!generationQuery->exec()) {
+            _lastError = generationQuery->lastError().text();
+            LOG(ERROR) << _lastError.toStdString();
+            _db->rollback();
+            return false;
+        }
+    }
+
+    if (!storeGeneratedDeltas(accountDeltas, checkpointDeltas, categoryDeltas)) {
+        _db->rollback();
+        return false;
+    }
+
+    // DELETE_BULK_RECURRENT_TRANSACTIONS = DELETE FROM BulkRecurrentTransactions
+    auto clearQuery = _db->createQuery();
+    if (!clearQuery->exec(DELETE_BULK_RECURRENT_TRANSACTIONS)) {
+        _lastError = clearQuery->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        _db->rollback();
+        return false;
     }
 
     _db->commit();
+    return true;
+}
+
+bool
+Book::storeGeneratedDeltas(QMap<QString, double> accounts, QMap<QString, QMap<QPair<int, int>, double>> checkpoints,
+                           QMap<QString, QMap<QPair<int, int>, double>> categories) {
+    // UPDATE_ACCOUNT_AMOUNT_DELTA = UPDATE Accounts SET amount=AddStringNumbers(amount, :amount) WHERE uuid=:uuid
+    auto query = _db->createQuery();
+    query->prepare(UPDATE_ACCOUNT_AMOUNT_DELTA);
+    foreach(const QString& account, accounts.keys()) {
+        query->bindValue(":amount", QString::number(accounts[account], 'g', DELTA_PRECISION));
+        query->bindValue(":uuid", account);
+        if (!query->exec()) {
+            _lastError = query->lastError().text();
+            LOG(ERROR) << _lastError.toStdString();
+            return false;
+        }
+    }
+
+    // INSERT_EMPTY_CHECKPOINT = INSERT OR IGNORE INTO AccountBalanceCheckpoints(account, year, month, amount)
+    //     VALUES (:account, :year, :month, '0')
+    // UPDATE_CHECKPOINT_DELTA = UPDATE AccountBalanceCheckpoints SET amount=AddStringNumbers(amount, :amount)
+    //     WHERE account=:account AND year=:year AND month=:month
+    auto insertQuery = _db->createQuery();
+    insertQuery->prepare(INSERT_EMPTY_CHECKPOINT);
+    auto updateQuery = _db->createQuery();
+    updateQuery->prepare(UPDATE_CHECKPOINT_DELTA);
+    foreach(const QString& account, checkpoints.keys()) {
+        auto months = checkpoints[account];
+        foreach(const auto& month, months.keys()) {
+            insertQuery->bindValue(":account", account);
+            insertQuery->bindValue(":year", month.first);
+            insertQuery->bindValue(":month", month.second);
+
+            updateQuery->bindValue(":amount", QString::number(months[month], 'g', DELTA_PRECISION));
+            updateQuery->bindValue(":account", account);
+            updateQuery->bindValue(":year", month.first);
+            updateQuery->bindValue(":month", month.second);
+
+            if (!insertQuery->exec() || !updateQuery->exec()) {
+                _lastError = _db->lastError().text();
+                LOG(ERROR) << _lastError.toStdString();
+                return false;
+            }
+        }
+    }
+
+    // INSERT_EMPTY_CATEGORY_TOTAL = INSERT OR IGNORE INTO CategoryMonthTotals(category, year, month, amount)
+    //     VALUES (:category, :year, :month, '0')
+    // UPDATE_CATEGORY_TOTAL_DELTA = UPDATE CategoryMonthTotals SET amount=AddStringNumbers(amount, :amount)
+    //     WHERE category=:category AND year=:year AND month=:month
+    insertQuery = _db->createQuery();
+    insertQuery->prepare(INSERT_EMPTY_CATEGORY_TOTAL);
+    updateQuery = _db->createQuery();
+    updateQuery->prepare(UPDATE_CATEGORY_TOTAL_DELTA);
+    foreach(const QString& category, categories.keys()) {
+        auto months = categories[category];
+        foreach(const auto& month, months.keys()) {
+            insertQuery->bindValue(":category", category);
+            insertQuery->bindValue(":year", month.first);
+            insertQuery->bindValue(":month", month.second);
+
+            updateQuery->bindValue(":amount", QString::number(months[month], 'g', DELTA_PRECISION));
+            updateQuery->bindValue(":category", category);
+            updateQuery->bindValue(":year", month.first);
+            updateQuery->bindValue(":month", month.second);
+
+            if (!insertQuery->exec() || !updateQuery->exec()) {
+                _lastError = _db->lastError().text();
+                LOG(ERROR) << _lastError.toStdString();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+QList<RecurrentTransactionPtr>
+Book::dueRecurrentTransactions(QDate date) {
+    QList<RecurrentTransactionPtr> result;
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    // SELECT_RECURRENT_TRANSACTIONS_DUE = "SELECT t.uuid, t.amount, t.account, t.category, t.contents, t.memo,
+    //     t.startDay, t.startMonth, t.startYear, t.lastDay, t.lastMonth, t.lastYear, t.endDay, t.endMonth, t.endYear,
+    //     t.defaultType, t.numberDays, t.occurrences c.parent, c.name, c.type, a.name, a.memo, a.amount
+    //     FROM RecurrentTransactions AS t INNER JOIN Categories AS c ON t.category = c.uuid INNER JOIN Accounts AS a ON
+    //     t.account = a.uuid WHERE t.next_due IS NOT NULL AND t.next_due <= :date;
+    auto query = _db->createQuery();
+    query->prepare(SELECT_RECURRENT_TRANSACTIONS_DUE);
+    query->bindValue(":date", date.toString(Qt::ISODate));
+
+    return parseRecurrentTransactions(query);
+}
+
+QDate
+Book::nextRecurrentDueDate() {
+    QDate result;
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    // SELECT_RECURRENT_NEXT_DUE = SELECT MIN(next_due) FROM RecurrentTransactions WHERE next_due IS NOT NULL
+    auto query = _db->createQuery();
+    query->prepare(SELECT_RECURRENT_NEXT_DUE);
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(INFO) << _lastError.toStdString();
+    } else if (query->next() && !query->value(0).isNull()) {
+        result = QDate::fromString(query->value(0).toString(), Qt::ISODate);
+    }
+
+    return result;
 }
 
 void
 Book::generateRecurrentTransactions() {
-    // get all the recurrent transactions so that we can calculate the missing recurrent transactiosn
-    auto recurrent = recurrentTransactions();
-    QMap<RecurrentTransactionPtr, QList<TransactionPtr>> transMap;
+    generateRecurrentTransactions(GenerationProgress());
+}
+
+QList<QDate>
+Book::generateRecurrentTransactions(GenerationProgress progress, int chunkSize) {
+    // first day of the months that got new transactions
+    QList<QDate> months;
+
+    // get just the recurrent transactions with pending occurrences, when the app is up to date this is a single
+    // lookup in the next due index
+    auto recurrent = dueRecurrentTransactions(QDate::currentDate());
+    if (recurrent.count() == 0) {
+        DLOG(INFO) << "There are no recurrent transactions due";
+        return months;
+    }
 
+    if (chunkSize <= 0) {
+        chunkSize = GENERATION_CHUNK_SIZE;
+    }
+
+    // the missing occurrences are lazy ranges, the total is known without creating a single transaction
+    QList<RecurrentTransaction::Recurrence::Occurrences> ranges;
+    auto total = 0;
     foreach(const RecurrentTransactionPtr& recurrentTrans, recurrent) {
-        auto missingDates = recurrentTrans->recurrence->generateMissingDates();
-        QList<TransactionPtr> trans;
-        DLOG(INFO) << "There are " << missingDates.count() << " transactions that have to be generated";
-        foreach(const QDate& currentDate, missingDates) {
+        auto range = recurrentTrans->recurrence->missingDates();
+        ranges.append(range);
+        total += range.size();
+    }
+    DLOG(INFO) << "There are " << total << " transactions that have to be generated";
+
+    // the transactions are stored in chunks, each of them is committed together with the last generated date of the
+    // recurrent transactions so that memory is bounded and an interrupted generation continues from the last chunk
+    QMap<RecurrentTransactionPtr, QList<TransactionPtr>> chunk;
+    auto chunkCount = 0;
+    auto generated = 0;
+
+    for (int pos = 0; pos < recurrent.count(); pos++) {
+        auto recurrentTrans = recurrent.at(pos);
+        auto range = ranges.at(pos);
+
+        // due recurrent transactions without occurrences are stored anyway to refresh their next due date
+        chunk[recurrentTrans] = QList<TransactionPtr>();
+
+        for (const auto& currentDate : range) {
             auto currentTran = std::make_shared<Transaction>(recurrentTrans->transaction->account,
                 recurrentTrans->transaction->amount, recurrentTrans->transaction->category, currentDate,
                 recurrentTrans->transaction->contents, recurrentTrans->transaction->memo);
             recurrentTrans->recurrence->lastGenerated = currentDate;
-            trans.append(currentTran);
+            chunk[recurrentTrans].append(currentTran);
+            chunkCount++;
+
+            auto month = QDate(currentDate.year(), currentDate.month(), 1);
+            if (!months.contains(month)) {
+                months.append(month);
+            }
+
+            if (chunkCount == chunkSize) {
+                if (!storeGeneratedTransactions(chunk)) {
+                    LOG(INFO) << "Error generating recurrent transactions";
+                    return months;
+                }
+                generated += chunkCount;
+                if (progress) {
+                    progress(generated, total);
+                }
+
+                chunk.clear();
+                chunkCount = 0;
+            }
         }
-        transMap[recurrentTrans] = trans;
     }
 
-    // store the missing the transactions in the database
-    storeGeneratedTransactions(transMap);
-    if (isError()) {
-        LOG(INFO) << "Error generating recurrent transactions";
+    if (!chunk.isEmpty()) {
+        if (!storeGeneratedTransactions(chunk)) {
+            LOG(INFO) << "Error generating recurrent transactions";
+            return months;
+        }
+        generated += chunkCount;
+        if (progress) {
+            progress(generated, total);
+        }
     }
+
+    std::sort(months.begin(), months.end());
+    return months;
 }
 
 double
 Book::amountForTypeInDay(int day, int month, int year, Category::Type type) {
+    auto snapshot = currentSnapshot();
+    if (snapshot && snapshot->covers(month, year)) {
+        auto summary = snapshot->day(day);
+        return (type == Category::Type::INCOME) ? summary.income : summary.expense;
+    }
+
     double result = 0;
 
     BookLock dbLock(this);
@@ -2272,7 +3710,7 @@ Book::amountForTypeInDay(int day, int month, int year, Category::Type type) {
         return result;
     }
 
-    //SELECT_DAY_CATEGORY_TYPE_SUM = SELECT SSUM(t.amount) FROM Transactions AS t
+    //SELECT_DAY_CATEGORY_TYPE_SUM = SELECT SSUM(t.amount) FROM AllTransactions AS t
     //    INNER JOIN Categories AS c ON t.category = c.uuid  WHERE c.type=:type AND t.day=:day AND
     //    t.month=:month AND t.year=:year
     // SSUM is a custom function and returns a STRING.
@@ -2304,6 +3742,357 @@ Book::expenseForDay(int day, int month, int year) {
     return amountForTypeInDay(day, month, year, Category::Type::EXPENSE);
 }
 
+bool
+Book::saveSummaries(system::DatabasePtr db, int year) {
+    auto query = db->createQuery();
+
+    // SAVE_ACCOUNT_AMOUNTS = CREATE TEMP TABLE SavedAccountAmounts AS SELECT uuid, amount FROM Accounts
+    auto success = query->exec(SAVE_ACCOUNT_AMOUNTS);
+
+    // SAVE_CHECKPOINTS = CREATE TEMP TABLE SavedCheckpoints AS
+    //     SELECT account, month, amount FROM AccountBalanceCheckpoints WHERE year=:year
+    query->prepare(SAVE_CHECKPOINTS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    // SAVE_CATEGORY_TOTALS = CREATE TEMP TABLE SavedCategoryTotals AS
+    //     SELECT category, month, amount FROM CategoryMonthTotals WHERE year=:year
+    query->prepare(SAVE_CATEGORY_TOTALS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    // SAVE_LAST_CHANGE = CREATE TEMP TABLE SavedLastChange AS SELECT IFNULL(MAX(seq), 0) AS seq FROM Changes
+    success &= query->exec(SAVE_LAST_CHANGE);
+    return success;
+}
+
+bool
+Book::restoreSummaries(system::DatabasePtr db, int year) {
+    auto query = db->createQuery();
+
+    // RESTORE_ACCOUNT_AMOUNTS = UPDATE Accounts SET
+    //     amount=(SELECT s.amount FROM temp.SavedAccountAmounts AS s WHERE s.uuid=Accounts.uuid)
+    auto success = query->exec(RESTORE_ACCOUNT_AMOUNTS);
+
+    // RESTORE_CHECKPOINTS = INSERT OR REPLACE INTO AccountBalanceCheckpoints(account, year, month, amount)
+    //     SELECT account, :year, month, amount FROM temp.SavedCheckpoints
+    query->prepare(RESTORE_CHECKPOINTS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    // RESTORE_CATEGORY_TOTALS = INSERT OR REPLACE INTO CategoryMonthTotals(category, year, month, amount)
+    //     SELECT category, :year, month, amount FROM temp.SavedCategoryTotals
+    query->prepare(RESTORE_CATEGORY_TOTALS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    success &= query->exec(DROP_SAVED_ACCOUNT_AMOUNTS);
+    success &= query->exec(DROP_SAVED_CHECKPOINTS);
+    success &= query->exec(DROP_SAVED_CATEGORY_TOTALS);
+
+    // RESTORE_CHANGES = DELETE FROM Changes WHERE seq > (SELECT seq FROM temp.SavedLastChange)
+    success &= query->exec(RESTORE_CHANGES);
+    success &= query->exec(DROP_SAVED_LAST_CHANGE);
+    return success;
+}
+
+void
+Book::archive(int year) {
+    dropSnapshot();
+    // only the closed years are archived, the current one keeps receiving transactions
+    if (year >= QDate::currentDate().year()) {
+        _lastError = "Only the past years can be archived.";
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    // the archived years are checked under the lock so that two calls do not archive more years than the ones that
+    // can be attached to a connection
+    auto years = archived();
+    if (!years.contains(year) && years.count() >= MAX_ARCHIVED_YEARS) {
+        _lastError = QString("At most %1 years can be archived.").arg(MAX_ARCHIVED_YEARS);
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    // the archives of the archived years were attached with the connection, databases cannot be attached within a
+    // transaction and the archive is created when it is attached
+    auto path = archivePath(year);
+    auto created = !QFile::exists(path);
+    auto schema = ARCHIVE_SCHEMA.arg(year);
+    if (!years.contains(year) && !attachArchive(_db, year)) {
+        _lastError = _db->lastError().text();
+        if (created) {
+            QFile::remove(path);
+        }
+        return;
+    }
+
+    _db->transaction();
+    auto query = _db->createQuery();
+    auto success = query->exec(ARCHIVE_TRANSACTION_TABLE.arg(schema));
+    success &= query->exec(ARCHIVE_MONTH_INDEX.arg(schema));
+    success &= query->exec(ARCHIVE_CATEGORY_INDEX.arg(schema));
+    success &= query->exec(ARCHIVE_ACCOUNT_INDEX.arg(schema));
+    success &= query->exec(ARCHIVE_RECURRENT_INDEX.arg(schema));
+    success &= query->exec(ARCHIVE_FINGERPRINT_INDEX.arg(schema));
+
+    // SAVE_ARCHIVED_IDS = CREATE TEMP TABLE SavedArchivedIds AS SELECT id FROM main.Transactions WHERE year=:year
+    query->prepare(SAVE_ARCHIVED_IDS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    // INSERT_ARCHIVED_TRANSACTIONS = INSERT OR REPLACE INTO %1.Transactions(%2)
+    //     SELECT %2 FROM main.Transactions WHERE year=:year
+    query->prepare(INSERT_ARCHIVED_TRANSACTIONS.arg(schema, ARCHIVE_COLUMNS));
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    // the delete triggers remove the transactions from the balances, the totals and the search index, the summaries
+    // are restored and the search entries added again
+    success &= saveSummaries(_db, year);
+
+    // DELETE_ARCHIVED_TRANSACTIONS = DELETE FROM main.Transactions WHERE year=:year
+    query->prepare(DELETE_ARCHIVED_TRANSACTIONS);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    success &= restoreSummaries(_db, year);
+
+    // INSERT_ARCHIVED_SEARCH = INSERT INTO main.TransactionsSearch(rowid, contents, memo)
+    //     SELECT id, contents, memo FROM %1.Transactions WHERE id IN (SELECT id FROM temp.SavedArchivedIds)
+    success &= query->exec(INSERT_ARCHIVED_SEARCH.arg(schema));
+    success &= query->exec(DROP_SAVED_ARCHIVED_IDS);
+
+    // INSERT_UPDATE_ARCHIVED_YEAR = INSERT OR REPLACE INTO ArchivedYears(year, transactions)
+    //     SELECT :year, COUNT(*) FROM %1.Transactions
+    query->prepare(INSERT_UPDATE_ARCHIVED_YEAR.arg(schema));
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    if (success) {
+        _db->commit();
+        setArchived(selectArchivedYears(_db));
+        return;
+    }
+
+    _lastError = _db->lastError().text();
+    LOG(ERROR) << "Could not archive " << year << " " << _lastError.toStdString();
+    _db->rollback();
+
+    // an archive created by this call is not used by any year, it is removed so that the next attempt starts again
+    if (created) {
+        query->exec(DETACH_ARCHIVE.arg(schema));
+        if (!QFile::remove(path)) {
+            LOG(ERROR) << "Could not remove the archive " << path.toStdString();
+        }
+    }
+}
+
+void
+Book::unarchive(int year) {
+    dropSnapshot();
+    BookLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    if (!archived().contains(year)) {
+        _lastError = "The year has not been archived.";
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    // the archive was attached with the connection if its file is present
+    auto path = archivePath(year);
+    if (!QFile::exists(path)) {
+        _lastError = "The archive of the year is not present.";
+        LOG(ERROR) << _lastError.toStdString();
+        return;
+    }
+
+    auto schema = ARCHIVE_SCHEMA.arg(year);
+    _db->transaction();
+    auto query = _db->createQuery();
+
+    // the insert triggers add the transactions to the balances and totals that already have them
+    auto success = saveSummaries(_db, year);
+
+    // DELETE_UNARCHIVED_SEARCH = INSERT INTO main.TransactionsSearch(TransactionsSearch, rowid, contents, memo)
+    //     SELECT 'delete', id, contents, memo FROM %1.Transactions
+    success &= query->exec(DELETE_UNARCHIVED_SEARCH.arg(schema));
+
+    // INSERT_UNARCHIVED_TRANSACTIONS = INSERT INTO main.Transactions(%2) SELECT %2 FROM %1.Transactions
+    success &= query->exec(INSERT_UNARCHIVED_TRANSACTIONS.arg(schema, ARCHIVE_COLUMNS));
+
+    success &= restoreSummaries(_db, year);
+
+    // DELETE_ARCHIVED_YEAR = DELETE FROM ArchivedYears WHERE year=:year
+    query->prepare(DELETE_ARCHIVED_YEAR);
+    query->bindValue(":year", year);
+    success &= query->exec();
+
+    if (success) {
+        _db->commit();
+        setArchived(selectArchivedYears(_db));
+    } else {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Could not unarchive " << year << " " << _lastError.toStdString();
+        _db->rollback();
+        return;
+    }
+
+    // the file is no longer used once the transactions are back in the main database
+    query->exec(DETACH_ARCHIVE.arg(schema));
+    if (!QFile::remove(path)) {
+        LOG(ERROR) << "Could not remove the archive " << path.toStdString();
+    }
+}
+
+QList<int>
+Book::archivedYears() {
+    return archived();
+}
+
+bool
+Book::restoreArchived(QString filter, QString uuid, int year) {
+    // without archives there is nothing to restore and no need for a transaction
+    if (archived().isEmpty()) {
+        return true;
+    }
+
+    _db->transaction();
+    if (!restoreArchived(_db, filter, uuid, year)) {
+        _lastError = _db->lastError().text();
+        _db->rollback();
+        return false;
+    }
+    _db->commit();
+    return true;
+}
+
+bool
+Book::restoreArchived(system::DatabasePtr db, QString filter, QString uuid, int year) {
+    // the archived transactions that are changed are moved back to the main database so that the triggers keep the
+    // balances and the totals, archiving the year again moves them to its file. The archives are attached with the
+    // connection and the caller provides the transaction. The filters that do not bind :uuid are used with a null uuid.
+    auto years = archived();
+    if (years.isEmpty()) {
+        return true;
+    }
+
+    auto query = db->createQuery();
+    auto prepare = [&query, &uuid](const QString& statement) {
+        query->prepare(statement);
+        if (!uuid.isNull()) {
+            query->bindValue(":uuid", uuid);
+        }
+    };
+
+    auto single = filter == RESTORED_TRANSACTION_FILTER;
+    if (single) {
+        // COUNT_MAIN_TRANSACTIONS = SELECT COUNT(*) FROM main.Transactions WHERE %1
+        prepare(COUNT_MAIN_TRANSACTIONS.arg(filter));
+        if (!query->exec()) {
+            return false;
+        }
+        if (query->next() && query->value(0).toInt() > 0) {
+            return true;
+        }
+
+        // a transaction is usually found in the archive of its year
+        if (years.removeOne(year)) {
+            years.prepend(year);
+        }
+    }
+
+    foreach(int archivedYear, years) {
+        // COUNT_RESTORED_TRANSACTIONS = SELECT COUNT(*) FROM %1.Transactions WHERE %2
+        auto schema = ARCHIVE_SCHEMA.arg(archivedYear);
+        prepare(COUNT_RESTORED_TRANSACTIONS.arg(schema, filter));
+        if (!query->exec()) {
+            LOG(ERROR) << "Could not read the archive of " << archivedYear << " "
+                << db->lastError().text().toStdString();
+            return false;
+        }
+        if (!query->next() || query->value(0).toInt() == 0) {
+            continue;
+        }
+
+        // the insert triggers add the transactions to the balances and totals that already have them
+        auto success = saveSummaries(db, archivedYear);
+
+        // DELETE_RESTORED_SEARCH = INSERT INTO main.TransactionsSearch(TransactionsSearch, rowid, contents, memo)
+        //     SELECT 'delete', id, contents, memo FROM %1.Transactions WHERE %2
+        prepare(DELETE_RESTORED_SEARCH.arg(schema, filter));
+        success = success && query->exec();
+
+        // INSERT_RESTORED_TRANSACTIONS = INSERT INTO main.Transactions(%2) SELECT %2 FROM %1.Transactions WHERE %3
+        prepare(INSERT_RESTORED_TRANSACTIONS.arg(schema, ARCHIVE_COLUMNS, filter));
+        success = success && query->exec();
+
+        // DELETE_RESTORED_TRANSACTIONS = DELETE FROM %1.Transactions WHERE %2
+        prepare(DELETE_RESTORED_TRANSACTIONS.arg(schema, filter));
+        success = success && query->exec();
+
+        success = success && restoreSummaries(db, archivedYear);
+
+        // INSERT_UPDATE_ARCHIVED_YEAR = INSERT OR REPLACE INTO ArchivedYears(year, transactions)
+        //     SELECT :year, COUNT(*) FROM %1.Transactions
+        query->prepare(INSERT_UPDATE_ARCHIVED_YEAR.arg(schema));
+        query->bindValue(":year", archivedYear);
+        success = success && query->exec();
+
+        if (!success) {
+            LOG(ERROR) << "Could not restore the archived transactions of " << archivedYear << " "
+                << db->lastError().text().toStdString();
+            return false;
+        }
+
+        // a transaction is only in one of the databases
+        if (single) {
+            break;
+        }
+    }
+    return true;
+}
+
+void
+Book::setSnapshot(SnapshotPtr snapshot) {
+    std::lock_guard<std::mutex> lock(_snapshotMutex);
+    // the database could have been changed when it was prepared after the snapshot was loaded
+    if (snapshot && !snapshot->isCurrent()) {
+        DLOG(INFO) << "The database changed, the snapshot is not used";
+        _snapshot.reset();
+        return;
+    }
+    _snapshot = snapshot;
+}
+
+void
+Book::dropSnapshot() {
+    // the operations that change the database drop the snapshot, the accessors then query the database
+    std::lock_guard<std::mutex> lock(_snapshotMutex);
+    _snapshot.reset();
+}
+
+SnapshotPtr
+Book::currentSnapshot() {
+    std::lock_guard<std::mutex> lock(_snapshotMutex);
+    return _snapshot;
+}
+
 std::shared_ptr<Stats>
 Book::stats() {
     auto stats = new Stats(_db);
@@ -22,12 +22,14 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <set>
 
 #include <boost/optional.hpp>
 
+#include <QHash>
 #include <QList>
 
 #include <com/chancho/static_init.h>
@@ -37,6 +39,7 @@
 #include "category.h"
 #include "transaction.h"
 #include "recurrent_transaction.h"
+#include "snapshot.h"
 
 
 namespace com {
@@ -53,10 +56,56 @@ class BookLock;
     \since 0.1
 */
 class Book {
+    friend class Exporter;
     friend class Stats;
     friend class BookLock;
+    friend class ChangeLog;
 
  public:
+    // called with the number of generated transactions and the total number of transactions to generate
+    typedef std::function<void(int, int)> GenerationProgress;
+
+    // number of generated transactions that are committed together
+    static const int GENERATION_CHUNK_SIZE = 500;
+
+    // number of results returned in a page of a search
+    static const int SEARCH_PAGE_SIZE = 50;
+
+    // sqlite attaches at most 10 databases to a connection
+    static const int MAX_ARCHIVED_YEARS = 10;
+
+    /*!
+        \struct SearchFilter
+
+        Restricts the results of a search to an account, a category and its children and a range of dates. The
+        members that are not set do not restrict the results.
+    */
+    struct SearchFilter {
+        AccountPtr account;
+        CategoryPtr category;
+        QDate from;
+        QDate to;
+    };
+
+    /*!
+        \struct SearchCursor
+
+        Position of the last result of a search page. A default constructed cursor points to the start of the results.
+    */
+    struct SearchCursor {
+        double rank = 0;
+        qint64 rowid = 0;
+
+        bool isValid() const {
+            return rowid != 0;
+        }
+    };
+
+    struct SearchPage {
+        QList<TransactionPtr> transactions;
+        SearchCursor next;  // not valid when there are no more results
+    };
+
     Book();
     virtual ~Book();
 
@@ -148,7 +197,7 @@ class Book {
 
         Removes the given \a tran from the database.
 
-        \note If the remove category is a parent category all of its children will be also removed.
+        \note If the remove category is a parent category all of its descendants will be also removed.
     */
     virtual void remove(CategoryPtr cat);
 
@@ -167,6 +216,21 @@ class Book {
     */
     virtual void remove(RecurrentTransactionPtr tran, bool removeGenerated=false);
 
+    /*!
+        \fn virtual void setBudget(CategoryPtr cat, double amount);
+
+        Sets the monthly budget of the given \a cat. The budget is applied to every month and can be evaluated using
+        Stats::budgets.
+    */
+    virtual void setBudget(CategoryPtr cat, double amount);
+
+    /*!
+        \fn virtual void removeBudget(CategoryPtr cat);
+
+        Removes the monthly budget of the given \a cat.
+    */
+    virtual void removeBudget(CategoryPtr cat);
+
     /*!
         \fn virtual QList<AccountPtr> accounts();
 
@@ -276,6 +340,52 @@ class Book {
     */
     virtual int numberOfTransactions(RecurrentTransactionPtr recurrent);
 
+    /*!
+        \fn virtual bool isPresent(TransactionPtr tran);
+
+        Returns if a transaction with the same account, date, amount and contents than \a tran has already been
+        stored, archived years included. The lookup uses the fingerprint index and does not depend on the number of
+        transactions.
+    */
+    virtual bool isPresent(TransactionPtr tran);
+
+    /*!
+        \fn virtual QList<TransactionPtr> filterPresent(QList<TransactionPtr> trans);
+
+        Returns the transactions of \a trans that have not already been stored. Equal transactions are counted, if
+        the book has one transaction equal to two of the given ones, only one of them is returned.
+    */
+    virtual QList<TransactionPtr> filterPresent(QList<TransactionPtr> trans);
+
+    /*!
+        \fn virtual QList<TransactionPtr> filterPresent(QList<TransactionPtr> trans, QHash<qint64, int>& seen);
+
+        Same as filterPresent(trans) but the transactions given in previous calls with the same \a seen hash are
+        counted too. It is used to filter a list that is stored in batches, the returned transactions of a batch must
+        be stored before filtering the next one.
+    */
+    virtual QList<TransactionPtr> filterPresent(QList<TransactionPtr> trans, QHash<qint64, int>& seen);
+
+    /*!
+        \fn static qint64 fingerprint(TransactionPtr tran);
+
+        Returns the fingerprint of the account, date, amount and contents of \a tran, it is the key of the \a seen
+        hash used by filterPresent.
+    */
+    static qint64 fingerprint(TransactionPtr tran);
+
+    /*!
+        \fn virtual SearchPage search(QString query, SearchFilter filter=SearchFilter(),
+                                      SearchCursor cursor=SearchCursor(), int limit=SEARCH_PAGE_SIZE);
+
+        Returns the transactions whose contents or memo contain all the words of \a query, the best matches first.
+        The words are matched as prefixes. The results are returned in pages of \a limit transactions, the next page
+        is retrieved by passing the cursor of the previous one. The cursor keeps the pages from repeating or skipping
+        results, it does not make deep pages cheaper: every page ranks all the matches of the query again.
+    */
+    virtual SearchPage search(QString query, SearchFilter filter=SearchFilter(), SearchCursor cursor=SearchCursor(),
+                              int limit=SEARCH_PAGE_SIZE);
+
     /*!
         \fn virtual QList<TransactionPtr> transactions(CategoryPtr cat, int month, int year);
 
@@ -366,6 +476,14 @@ class Book {
     */
     virtual int numberOfRecurrentCategories();
 
+    /*!
+        \fn virtual QList<RecurrentTransactionPtr> dueRecurrentTransactions(QDate date=QDate::currentDate());
+
+        Returns the recurrent transactions that have an occurrence pending to be generated in or before the given
+        \a date.
+     */
+    virtual QList<RecurrentTransactionPtr> dueRecurrentTransactions(QDate date=QDate::currentDate());
+
     /*!
         \fn void generateRecurrentTransactions();
 
@@ -374,6 +492,27 @@ class Book {
      */
     virtual void generateRecurrentTransactions();
 
+    /*!
+        \fn virtual QList<QDate> generateRecurrentTransactions(GenerationProgress progress,
+                                                               int chunkSize=GENERATION_CHUNK_SIZE);
+
+        Generates the recurrent transactions that have not been added since the last time the application was used
+        committing them in chunks of \a chunkSize transactions. After every chunk \a progress is called with the
+        number of generated transactions and the total that has to be generated.
+
+        Returns the first day of each month that received new transactions.
+     */
+    virtual QList<QDate> generateRecurrentTransactions(GenerationProgress progress,
+                                                       int chunkSize=GENERATION_CHUNK_SIZE);
+
+    /*!
+        \fn virtual QDate nextRecurrentDueDate();
+
+        Returns the closest date in which a recurrent transaction has an occurrence to be generated or an invalid
+        date if none of them has pending occurrences.
+     */
+    virtual QDate nextRecurrentDueDate();
+
     /*!
         \fn virtual int incomeForDay(int day, int month, int year);
 
@@ -390,6 +529,43 @@ class Book {
 
     virtual std::shared_ptr<Stats> stats();
 
+    /*!
+        \fn virtual void archive(int year);
+
+        Moves the transactions of the given closed \a year to their own database file. The account balances, the
+        checkpoints and the category totals stay in the main database, the queries of the year read the archived file
+        and the queries that cross years read all of them. Archived transactions keep their entries in the search
+        index. Archiving a year again moves the transactions that were added to it after it was archived. At most
+        MAX_ARCHIVED_YEARS years can be archived.
+
+        \note Archived transactions that are updated or removed, directly or with their account, category or
+        recurrent transaction, are moved back to the main database first.
+    */
+    virtual void archive(int year);
+
+    /*!
+        \fn virtual void unarchive(int year);
+
+        Moves the transactions of the given archived \a year back to the main database and removes its file.
+    */
+    virtual void unarchive(int year);
+
+    /*!
+        \fn virtual QList<int> archivedYears();
+
+        Returns the years whose transactions have been archived, the oldest first.
+    */
+    virtual QList<int> archivedYears();
+
+    /*!
+        \fn virtual void setSnapshot(SnapshotPtr snapshot);
+
+        Sets a loaded \a snapshot that answers the accounts, the categories and the days of its month without
+        querying the database. The snapshot is not used if the database changed after it was written and it is
+        dropped by the first operation of the book that stores, removes, generates or archives data.
+    */
+    virtual void setSnapshot(SnapshotPtr snapshot);
+
     /*!
         \fn static void initDatabse();
 
@@ -397,6 +573,23 @@ class Book {
      */
     static void initDatabse();
 
+    /*!
+        \fn static int schemaFingerprint();
+
+        Returns a fingerprint of the schema created by this version of the application. The fingerprint is stored
+        in the user_version of the database.
+     */
+    static int schemaFingerprint();
+
+    /*!
+        \fn static void prepareDatabase();
+
+        Ensures that the database has the current schema. When the stored fingerprint matches a single query is
+        executed, else the database is initialized, upgraded and the fingerprint stored. The time used by each
+        phase is logged.
+     */
+    static void prepareDatabase();
+
     /*!
         \fn static QStringList tables();
 
@@ -411,6 +604,20 @@ class Book {
      */
     static QStringList triggers();
 
+    /*!
+        \fn static QStringList triggerStatements();
+
+        Returns the statements that create the triggers of this version of the application.
+     */
+    static QStringList triggerStatements();
+
+    /*!
+        \fn static QStringList transactionIndexStatements();
+
+        Returns the statements that create the indexes of the transactions table of this version of the application.
+     */
+    static QStringList transactionIndexStatements();
+
     /*!
         \fn virtual bool isError();
 
@@ -432,6 +639,22 @@ class Book {
      */
     static QString databasePath();
 
+    /*!
+        \fn static QString archivePath(int year);
+
+        Returns the path of the database that keeps the transactions of the archived \a year.
+     */
+    static QString archivePath(int year);
+
+    /*!
+        \fn static bool attachArchives(system::DatabasePtr db);
+
+        Attaches the archived years to the opened \a db and creates the AllTransactions view that reads them together
+        with the main database. An archive that is not present is not attached and the queries that read the view
+        fail. Returns false if the view could not be created.
+     */
+    static bool attachArchives(system::DatabasePtr db);
+
     static double DB_VERSION;
 
  public:
@@ -441,7 +664,10 @@ class Book {
     static const QString CATEGORIES_TABLE;
     static const QString TRANSACTION_TABLE;
     static const QString RECURRENT_TRANSACTION_TABLE;
-    static const QString RECURRENT_TRANSACTIONS_RELATIONS_TABLE;
+    static const QString BULK_RECURRENT_TRANSACTIONS_TABLE;
+    static const QString RECURRENT_NEXT_DUE_INDEX;
+    static const QString TRANSACTION_RECURRENT_INDEX;
+    static const QString TRANSACTION_FINGERPRINT_INDEX;
     static const QString TRANSACTION_INSERT_TRIGGER;
     static const QString TRANSACTION_UPDATE_SAME_ACCOUNT_TRIGGER;
     static const QString TRANSACTION_UPDATE_DIFF_ACCOUNT_TRIGGER;
@@ -450,8 +676,41 @@ class Book {
     static const QString CATEGORY_DELETE_TRIGGER;
     static const QString CATEGORY_UPDATE_DIFF_TYPE_TRIGGER;
     static const QString RECURRENT_RELATIONS_DELETE_TRIGGER;
-    static const QString RECURRENT_RELATIONS_INSERT_TRIGGER;
-    static const QString RECURRENT_RELATIONS_UPDATE_TRIGGER;
+    static const QString BALANCE_CHECKPOINTS_TABLE;
+    static const QString CHECKPOINT_INSERT_TRIGGER;
+    static const QString CHECKPOINT_UPDATE_TRIGGER;
+    static const QString CHECKPOINT_DELETE_TRIGGER;
+    static const QString CHECKPOINT_ACCOUNT_DELETE_TRIGGER;
+    static const QString CATEGORY_CLOSURE_TABLE;
+    static const QString CATEGORY_CLOSURE_DESCENDANT_INDEX;
+    static const QString CATEGORY_CLOSURE_INSERT_TRIGGER;
+    static const QString CATEGORY_CLOSURE_UPDATE_TRIGGER;
+    static const QString CATEGORY_CLOSURE_DELETE_TRIGGER;
+    static const QString CATEGORY_MONTH_TOTALS_TABLE;
+    static const QString CATEGORY_TOTALS_INSERT_TRIGGER;
+    static const QString CATEGORY_TOTALS_UPDATE_TRIGGER;
+    static const QString CATEGORY_TOTALS_DELETE_TRIGGER;
+    static const QString BUDGETS_TABLE;
+    static const QString BUDGETS_CATEGORY_DELETE_TRIGGER;
+    static const QString TRANSACTIONS_SEARCH_TABLE;
+    static const QString SEARCH_INSERT_TRIGGER;
+    static const QString SEARCH_UPDATE_TRIGGER;
+    static const QString SEARCH_DELETE_TRIGGER;
+    static const QString ARCHIVED_YEARS_TABLE;
+    static const QString ALL_TRANSACTIONS_VIEW;
+    static const QString CHANGES_TABLE;
+    static const QString CHANGES_ACCOUNT_INSERT_TRIGGER;
+    static const QString CHANGES_ACCOUNT_UPDATE_TRIGGER;
+    static const QString CHANGES_ACCOUNT_DELETE_TRIGGER;
+    static const QString CHANGES_CATEGORY_INSERT_TRIGGER;
+    static const QString CHANGES_CATEGORY_UPDATE_TRIGGER;
+    static const QString CHANGES_CATEGORY_DELETE_TRIGGER;
+    static const QString CHANGES_TRANSACTION_INSERT_TRIGGER;
+    static const QString CHANGES_TRANSACTION_UPDATE_TRIGGER;
+    static const QString CHANGES_TRANSACTION_DELETE_TRIGGER;
+    static const QString CHANGES_RECURRENT_INSERT_TRIGGER;
+    static const QString CHANGES_RECURRENT_UPDATE_TRIGGER;
+    static const QString CHANGES_RECURRENT_DELETE_TRIGGER;
 
  protected:
     static std::set<QString> TABLES;
@@ -467,20 +726,46 @@ class Book {
     bool storeSingleCat(CategoryPtr ptr);
     bool storeSingleTransactions(TransactionPtr ptr);
     bool storeSingleRecurrentTransactions(RecurrentTransactionPtr tran);
-    void storeGeneratedTransactions(QMap<RecurrentTransactionPtr, QList<TransactionPtr>> trans);
+    bool storeGeneratedTransactions(QMap<RecurrentTransactionPtr, QList<TransactionPtr>> trans);
+    bool storeGeneratedDeltas(QMap<QString, double> accounts,
+                              QMap<QString, QMap<QPair<int, int>, double>> checkpoints,
+                              QMap<QString, QMap<QPair<int, int>, double>> categories);
     void storeRecurrentNoUpdates(RecurrentTransactionPtr recurrent);
     void storeRecurrentWithUpdate(RecurrentTransactionPtr recurrent);
+    bool linkPendingGenerated(QString recurrent);
+    bool restoreArchived(QString filter, QString uuid, int year = 0);
 
     static QStringList getTriggers(std::shared_ptr<system::Database> db);
+    static QList<int> selectArchivedYears(system::DatabasePtr db);
+    static void loadArchivedYears();
+    static QList<int> archived();
+    static void setArchived(QList<int> years);
+    static bool attachArchive(system::DatabasePtr db, int year);
+    static bool saveSummaries(system::DatabasePtr db, int year);
+    static bool restoreSummaries(system::DatabasePtr db, int year);
+    static bool restoreArchived(system::DatabasePtr db, QString filter, QString uuid, int year = 0);
+
+    static const QString RESTORED_TRANSACTION_FILTER;
+    static const QString RESTORED_ACCOUNT_FILTER;
+    static const QString RESTORED_CATEGORY_FILTER;
+    static const QString RESTORED_RECURRENT_FILTER;
+
+    void dropSnapshot();
+    SnapshotPtr currentSnapshot();
 
 
  protected:
     system::DatabasePtr _db;
     std::mutex _dbMutex;
     QString _lastError = QString::null;
+    bool _relationsMigrated = false;  // set once the RecurrentTransactionRelations table is gone, guarded by _dbMutex
 
  private:
+    std::mutex _snapshotMutex;
+    SnapshotPtr _snapshot;
     static std::mutex _initMutex;
+    static std::mutex _archivedMutex;
+    static QList<int> _archived;  // read when the database is prepared so that the queries do not look it up
 };
 
 typedef std::shared_ptr<Book> BookPtr;
@@ -37,7 +37,9 @@ class Book;
 class Category {
 
  friend class Book;
+ friend class Payees;
  friend class Stats;
+ friend class Snapshot;
 
  public:
     enum class Type {
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <glog/logging.h>
+
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QSqlError>
+#include <QStringList>
+
+#include <com/chancho/system/database_factory.h>
+
+#include "book.h"
+#include "change_log.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+    const QString SELECT_LAST_SEQUENCE = "SELECT IFNULL(MAX(seq), 0) FROM Changes";
+    // sqlite returns the op of the row with the max sequence
+    const QString SELECT_CHANGES = "SELECT MAX(seq) AS seq, entity, uuid, op FROM Changes WHERE seq > :seq "\
+        "GROUP BY entity, uuid ORDER BY seq ASC";
+    const QString SELECT_ENTITY_CHANGES = "SELECT c.seq, c.uuid, c.op, t.uuid, %2 FROM "\
+        "(SELECT MAX(seq) AS seq, uuid, op FROM Changes WHERE entity=:entity AND seq > :seq GROUP BY uuid) AS c "\
+        "LEFT JOIN %1 AS t ON t.uuid = c.uuid ORDER BY c.seq ASC";
+    const QString DELETE_SYNCED_ROW = "DELETE FROM %1 WHERE uuid=:uuid";
+    const QString UPDATE_SYNCED_ROW = "UPDATE %1 SET %2 WHERE uuid=:uuid";
+    const QString INSERT_SYNCED_ROW = "INSERT INTO %1(uuid, %2) VALUES (:uuid, %3)";
+    // the amount of an account is its initial amount plus its transactions, the transactions of the file update it
+    const QString UPDATE_SYNCED_ACCOUNT = "UPDATE Accounts SET name=:name, memo=:memo, color=:color, "\
+        "amount=AddStringNumbers(SubtractStringNumbers(amount, initialAmount), :initialAmount), "\
+        "initialAmount=:initialAmount2 WHERE uuid=:uuid";
+    const QString INSERT_SYNCED_ACCOUNT = "INSERT INTO Accounts(uuid, name, memo, color, initialAmount, amount) "\
+        "VALUES (:uuid, :name, :memo, :color, :initialAmount, :initialAmount2)";
+    // each copy generates the occurrences of its recurrent transactions, a received one is due from its start date so
+    // that the next generation catches up with it
+    const QString UPDATE_SYNCED_RECURRENT_NEXT_DUE = "UPDATE RecurrentTransactions SET "\
+        "next_due=printf('%04d-%02d-%02d', startYear, startMonth, startDay) WHERE uuid=:uuid";
+    // the archived transactions of the rows in the file are moved back to the main database in a single pass
+    const QString CREATE_SYNCED_UUIDS = "CREATE TEMP TABLE SyncedUuids(uuid VARCHAR(40) PRIMARY KEY)";
+    const QString INSERT_SYNCED_UUID = "INSERT OR IGNORE INTO temp.SyncedUuids(uuid) VALUES (:uuid)";
+    const QString DROP_SYNCED_UUIDS = "DROP TABLE temp.SyncedUuids";
+    const QString RESTORED_SYNCED_FILTER = "(uuid IN (SELECT uuid FROM temp.SyncedUuids) "\
+        "OR account IN (SELECT uuid FROM temp.SyncedUuids) "\
+        "OR category IN (SELECT descendant FROM main.CategoryClosure WHERE ancestor IN "\
+        "(SELECT uuid FROM temp.SyncedUuids)))";
+    const QString DELETE_SYNCED_CHANGES = "DELETE FROM Changes WHERE seq > :seq";
+    const QString DELETE_SUPERSEDED_CHANGES = "DELETE FROM Changes WHERE seq NOT IN "\
+        "(SELECT MAX(seq) FROM Changes GROUP BY entity, uuid)";
+    const QString DELETE_APPLIED_CHANGES = "DELETE FROM Changes WHERE seq <= :seq AND "\
+        "seq < (SELECT MAX(seq) FROM Changes)";
+
+    struct EntityTable {
+        ChangeLog::Entity entity;
+        QString table;
+        QStringList columns;  // columns besides the uuid
+    };
+
+    // ordered so that the rows are inserted after the ones they refer to, they are deleted in the inverse order
+    const QList<EntityTable>& entityTables() {
+        static QList<EntityTable> tables {
+            {ChangeLog::Entity::ACCOUNT, "Accounts", {"name", "memo", "color", "initialAmount", "amount"}},
+            {ChangeLog::Entity::CATEGORY, "Categories", {"parent", "name", "type", "color"}},
+            // the last generated and the next due dates are kept by the generation of each copy
+            {ChangeLog::Entity::RECURRENT_TRANSACTION, "RecurrentTransactions", {"amount", "account", "category",
+                "contents", "memo", "startDay", "startMonth", "startYear", "endDay", "endMonth", "endYear",
+                "defaultType", "numberDays", "occurrences"}},
+            {ChangeLog::Entity::TRANSACTION, "Transactions", {"amount", "account", "category", "day", "month", "year",
+                "contents", "memo", "is_recurrent", "recurrent_id", "fingerprint"}}
+        };
+        return tables;
+    }
+
+    void bindRow(std::shared_ptr<system::Query> query, const QStringList& columns, const QJsonObject& row) {
+        foreach(const QString& column, columns) {
+            query->bindValue(":" + column, row.value(column).toVariant());
+        }
+    }
+
+    // parents go before their children so that the closure of the categories is built when they are inserted
+    QList<QJsonObject> parentsFirst(QList<QJsonObject> categories) {
+        QList<QJsonObject> ordered;
+        QSet<QString> pending;
+        foreach(const QJsonObject& change, categories) {
+            pending.insert(change.value("uuid").toString());
+        }
+        while (!categories.isEmpty()) {
+            auto count = categories.count();
+            for (auto it = categories.begin(); it != categories.end();) {
+                auto parent = it->value("row").toObject().value("parent").toString();
+                if (parent.isEmpty() || !pending.contains(parent)) {
+                    pending.remove(it->value("uuid").toString());
+                    ordered.append(*it);
+                    it = categories.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            // a loop in the parents of the file, the rest are applied as they came
+            if (categories.count() == count) {
+                ordered.append(categories);
+                break;
+            }
+        }
+        return ordered;
+    }
+}
+
+class ChangeLogLock {
+ public:
+
+    explicit ChangeLogLock(ChangeLog* log)
+            : _log(log) {
+        _log->_dbMutex.lock();
+        _opened = _log->_db->open();
+        // the changes of archived transactions are applied to the archives attached with the connection
+        if (_opened && !Book::attachArchives(_log->_db)) {
+            _log->_db->close();
+            _opened = false;
+        }
+    }
+
+    ~ChangeLogLock() {
+        if (_opened) {
+            _log->_db->close();
+        }
+        _log->_dbMutex.unlock();
+    }
+
+    bool opened() const {
+        return _opened;
+    }
+
+    ChangeLogLock(const ChangeLogLock&) = delete;
+    ChangeLogLock& operator=(const ChangeLogLock&) = delete;
+
+ private:
+    bool _opened = false;
+    ChangeLog* _log;
+};
+
+ChangeLog::ChangeLog() {
+    auto dbPath = Book::databasePath();
+    _db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "CHANGELOG");
+    _db->setDatabaseName(dbPath);
+}
+
+ChangeLog::~ChangeLog() {
+}
+
+qint64
+ChangeLog::lastSequence() {
+    ChangeLogLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return -1;
+    }
+
+    // SELECT_LAST_SEQUENCE = SELECT IFNULL(MAX(seq), 0) FROM Changes
+    auto query = _db->createQuery();
+    if (!query->exec(SELECT_LAST_SEQUENCE) || !query->next()) {
+        _lastError = _db->lastError().text();
+        LOG(INFO) << "Error retrieving the last change " << _lastError.toStdString();
+        return -1;
+    }
+    return query->value(0).toLongLong();
+}
+
+QList<ChangeLog::Change>
+ChangeLog::changes(qint64 since) {
+    QList<Change> result;
+
+    ChangeLogLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    // SELECT_CHANGES = SELECT MAX(seq) AS seq, entity, uuid, op FROM Changes WHERE seq > :seq
+    //     GROUP BY entity, uuid ORDER BY seq ASC
+    auto query = _db->createQuery();
+    query->setForwardOnly(true);
+    query->prepare(SELECT_CHANGES);
+    query->bindValue(":seq", since);
+
+    if (!query->exec()) {
+        _lastError = _db->lastError().text();
+        LOG(INFO) << "Error retrieving the changes " << _lastError.toStdString();
+        return result;
+    }
+
+    while (query->next()) {
+        Change change;
+        change.sequence = query->value(0).toLongLong();
+        change.entity = static_cast<Entity>(query->value(1).toInt());
+        change.uuid = QUuid(query->value(2).toString());
+        change.operation = static_cast<Operation>(query->value(3).toInt());
+        result.append(change);
+    }
+    return result;
+}
+
+qint64
+ChangeLog::exportChanges(QString path, qint64 since) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not write the changes " << _lastError.toStdString();
+        return -1;
+    }
+
+    ChangeLogLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return -1;
+    }
+
+    // the read transaction keeps the rows and the last sequence consistent
+    _db->transaction();
+    auto query = _db->createQuery();
+    query->setForwardOnly(true);
+
+    // SELECT_LAST_SEQUENCE = SELECT IFNULL(MAX(seq), 0) FROM Changes
+    auto success = query->exec(SELECT_LAST_SEQUENCE) && query->next();
+    qint64 last = (success) ? query->value(0).toLongLong() : -1;
+
+    QJsonObject header;
+    header["format"] = CHANGES_FORMAT;
+    header["from"] = QString::number(since);
+    header["to"] = QString::number(last);
+    file.write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    file.write("\n");
+
+    foreach(const EntityTable& entity, entityTables()) {
+        if (!success) {
+            break;
+        }
+
+        // SELECT_ENTITY_CHANGES = SELECT c.seq, c.uuid, c.op, t.uuid, %2 FROM
+        //     (SELECT MAX(seq) AS seq, uuid, op FROM Changes WHERE entity=:entity AND seq > :seq GROUP BY uuid) AS c
+        //     LEFT JOIN %1 AS t ON t.uuid = c.uuid ORDER BY c.seq ASC
+        QStringList columns;
+        foreach(const QString& column, entity.columns) {
+            columns.append("t." + column);
+        }
+        query->prepare(SELECT_ENTITY_CHANGES.arg(entity.table, columns.join(", ")));
+        query->bindValue(":entity", static_cast<int>(entity.entity));
+        query->bindValue(":seq", since);
+        success = query->exec();
+
+        while (success && query->next()) {
+            auto operation = static_cast<Operation>(query->value(2).toInt());
+            // rows moved to an archive are no longer in the table, they are not exchanged
+            if (operation != Operation::DELETE && query->value(3).isNull()) {
+                continue;
+            }
+
+            QJsonObject change;
+            change["seq"] = QString::number(query->value(0).toLongLong());
+            change["entity"] = static_cast<int>(entity.entity);
+            change["uuid"] = query->value(1).toString();
+            change["op"] = static_cast<int>(operation);
+
+            // the values are written as text so that the big integers and the amounts keep their precision
+            if (operation != Operation::DELETE) {
+                QJsonObject row;
+                for (int index = 0; index < entity.columns.count(); index++) {
+                    auto value = query->value(index + 4);
+                    row[entity.columns.at(index)] = (value.isNull()) ? QJsonValue() : QJsonValue(value.toString());
+                }
+                change["row"] = row;
+            }
+            file.write(QJsonDocument(change).toJson(QJsonDocument::Compact));
+            file.write("\n");
+        }
+    }
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(INFO) << "Error exporting the changes " << _lastError.toStdString();
+        _db->rollback();
+        file.cancelWriting();
+        return -1;
+    }
+    _db->commit();
+
+    if (!file.commit()) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not write the changes " << _lastError.toStdString();
+        return -1;
+    }
+
+    _lastError = QString::null;
+    return last;
+}
+
+int
+ChangeLog::applyChanges(QString path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not read the changes " << _lastError.toStdString();
+        return -1;
+    }
+
+    auto header = QJsonDocument::fromJson(file.readLine()).object();
+    if (header.value("format").toInt() != CHANGES_FORMAT) {
+        _lastError = "The changes were exported with a different format.";
+        LOG(ERROR) << _lastError.toStdString();
+        return -1;
+    }
+
+    // the last change of each row, grouped by entity
+    QHash<int, QList<QJsonObject>> upserts;
+    QHash<int, QList<QJsonObject>> deletes;
+    while (!file.atEnd()) {
+        auto line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        auto change = QJsonDocument::fromJson(line).object();
+        if (change.isEmpty() || change.value("uuid").toString().isEmpty()) {
+            _lastError = "The changes file is not valid.";
+            LOG(ERROR) << _lastError.toStdString();
+            return -1;
+        }
+        auto entity = change.value("entity").toInt();
+        if (static_cast<Operation>(change.value("op").toInt()) == Operation::DELETE) {
+            deletes[entity].append(change);
+        } else {
+            upserts[entity].append(change);
+        }
+    }
+
+    ChangeLogLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return -1;
+    }
+
+    _db->transaction();
+    auto query = _db->createQuery();
+
+    // SELECT_LAST_SEQUENCE = SELECT IFNULL(MAX(seq), 0) FROM Changes
+    auto success = query->exec(SELECT_LAST_SEQUENCE) && query->next();
+    auto last = (success) ? query->value(0).toLongLong() : 0;
+    int applied = 0;
+
+    // the archived transactions of the changed rows are moved back to the main database so that they are updated
+    // instead of inserted again and the triggers keep the balances, the transactions of the removed accounts and
+    // categories are moved as well
+    if (success && !Book::archived().isEmpty()) {
+        QList<QJsonObject> restored = upserts.value(static_cast<int>(Entity::TRANSACTION))
+            + deletes.value(static_cast<int>(Entity::TRANSACTION))
+            + deletes.value(static_cast<int>(Entity::ACCOUNT))
+            + deletes.value(static_cast<int>(Entity::CATEGORY));
+
+        // CREATE_SYNCED_UUIDS = CREATE TEMP TABLE SyncedUuids(uuid VARCHAR(40) PRIMARY KEY)
+        success = query->exec(CREATE_SYNCED_UUIDS);
+
+        // INSERT_SYNCED_UUID = INSERT OR IGNORE INTO temp.SyncedUuids(uuid) VALUES (:uuid)
+        query->prepare(INSERT_SYNCED_UUID);
+        foreach(const QJsonObject& change, restored) {
+            if (!success) {
+                break;
+            }
+            query->bindValue(":uuid", change.value("uuid").toString());
+            success = query->exec();
+        }
+
+        // RESTORED_SYNCED_FILTER = (uuid IN (SELECT uuid FROM temp.SyncedUuids)
+        //     OR account IN (SELECT uuid FROM temp.SyncedUuids)
+        //     OR category IN (SELECT descendant FROM main.CategoryClosure WHERE ancestor IN
+        //     (SELECT uuid FROM temp.SyncedUuids)))
+        success = success && Book::restoreArchived(_db, RESTORED_SYNCED_FILTER, QString());
+
+        // DROP_SYNCED_UUIDS = DROP TABLE temp.SyncedUuids
+        success = success && query->exec(DROP_SYNCED_UUIDS);
+    }
+
+    // the rows that refer to others are deleted first
+    auto tables = entityTables();
+    for (int index = tables.count() - 1; success && index >= 0; index--) {
+        foreach(const QJsonObject& change, deletes.value(static_cast<int>(tables.at(index).entity))) {
+            // DELETE_SYNCED_ROW = DELETE FROM %1 WHERE uuid=:uuid
+            query->prepare(DELETE_SYNCED_ROW.arg(tables.at(index).table));
+            query->bindValue(":uuid", change.value("uuid").toString());
+            success &= query->exec();
+            applied++;
+        }
+    }
+
+    foreach(const EntityTable& entity, tables) {
+        if (!success) {
+            break;
+        }
+
+        QStringList assignments;
+        QStringList placeholders;
+        foreach(const QString& column, entity.columns) {
+            assignments.append(column + "=:" + column);
+            placeholders.append(":" + column);
+        }
+
+        auto changes = upserts.value(static_cast<int>(entity.entity));
+        if (entity.entity == Entity::CATEGORY) {
+            changes = parentsFirst(changes);
+        }
+
+        foreach(const QJsonObject& change, changes) {
+            auto uuid = change.value("uuid").toString();
+            auto row = change.value("row").toObject();
+
+            // the update keeps the triggers of the book in charge of the balances and the totals, the rows that are
+            // not present are inserted
+            if (entity.entity == Entity::ACCOUNT) {
+                // UPDATE_SYNCED_ACCOUNT = UPDATE Accounts SET name=:name, memo=:memo, color=:color,
+                //     amount=AddStringNumbers(SubtractStringNumbers(amount, initialAmount), :initialAmount),
+                //     initialAmount=:initialAmount2 WHERE uuid=:uuid
+                query->prepare(UPDATE_SYNCED_ACCOUNT);
+                bindRow(query, {"name", "memo", "color", "initialAmount"}, row);
+                query->bindValue(":initialAmount2", row.value("initialAmount").toVariant());
+            } else {
+                // UPDATE_SYNCED_ROW = UPDATE %1 SET %2 WHERE uuid=:uuid
+                query->prepare(UPDATE_SYNCED_ROW.arg(entity.table, assignments.join(", ")));
+                bindRow(query, entity.columns, row);
+            }
+            query->bindValue(":uuid", uuid);
+            success &= query->exec();
+
+            if (success && query->numRowsAffected() == 0) {
+                if (entity.entity == Entity::ACCOUNT) {
+                    // INSERT_SYNCED_ACCOUNT = INSERT INTO Accounts(uuid, name, memo, color, initialAmount, amount)
+                    //     VALUES (:uuid, :name, :memo, :color, :initialAmount, :initialAmount2)
+                    query->prepare(INSERT_SYNCED_ACCOUNT);
+                    bindRow(query, {"name", "memo", "color", "initialAmount"}, row);
+                    query->bindValue(":initialAmount2", row.value("initialAmount").toVariant());
+                } else {
+                    // INSERT_SYNCED_ROW = INSERT INTO %1(uuid, %2) VALUES (:uuid, %3)
+                    query->prepare(INSERT_SYNCED_ROW.arg(entity.table, entity.columns.join(", "),
+                        placeholders.join(", ")));
+                    bindRow(query, entity.columns, row);
+                }
+                query->bindValue(":uuid", uuid);
+                success &= query->exec();
+            }
+
+            // UPDATE_SYNCED_RECURRENT_NEXT_DUE = UPDATE RecurrentTransactions SET
+            //     next_due=printf('%04d-%02d-%02d', startYear, startMonth, startDay) WHERE uuid=:uuid
+            if (success && entity.entity == Entity::RECURRENT_TRANSACTION) {
+                query->prepare(UPDATE_SYNCED_RECURRENT_NEXT_DUE);
+                query->bindValue(":uuid", uuid);
+                success &= query->exec();
+            }
+            applied++;
+        }
+    }
+
+    // DELETE_SYNCED_CHANGES = DELETE FROM Changes WHERE seq > :seq
+    if (success) {
+        query->prepare(DELETE_SYNCED_CHANGES);
+        query->bindValue(":seq", last);
+        success = query->exec();
+    }
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Could not apply the changes " << _lastError.toStdString();
+        _db->rollback();
+        return -1;
+    }
+
+    _db->commit();
+    _lastError = QString::null;
+    return applied;
+}
+
+int
+ChangeLog::compact(qint64 upTo) {
+    ChangeLogLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return -1;
+    }
+
+    _db->transaction();
+    auto query = _db->createQuery();
+
+    // DELETE_SUPERSEDED_CHANGES = DELETE FROM Changes WHERE seq NOT IN
+    //     (SELECT MAX(seq) FROM Changes GROUP BY entity, uuid)
+    auto success = query->exec(DELETE_SUPERSEDED_CHANGES);
+    auto removed = (success) ? query->numRowsAffected() : 0;
+
+    // the sequence is the rowid of the table, the last entry is kept so that it is not used again
+    // DELETE_APPLIED_CHANGES = DELETE FROM Changes WHERE seq <= :seq AND seq < (SELECT MAX(seq) FROM Changes)
+    if (success && upTo > 0) {
+        query->prepare(DELETE_APPLIED_CHANGES);
+        query->bindValue(":seq", upTo);
+        success = query->exec();
+        removed += (success) ? query->numRowsAffected() : 0;
+    }
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Could not compact the changes " << _lastError.toStdString();
+        _db->rollback();
+        return -1;
+    }
+
+    _db->commit();
+    _lastError = QString::null;
+    return removed;
+}
+
+bool
+ChangeLog::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+ChangeLog::lastError() {
+    return _lastError;
+}
+
+}
+
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <QList>
+#include <QString>
+#include <QUuid>
+
+#include <com/chancho/system/database.h>
+
+namespace com {
+
+namespace chancho {
+
+class ChangeLogLock;
+
+/*!
+   \class ChangeLog
+   \brief The ChangeLog class exchanges the recent changes of the book with a copy kept in another device.
+
+   The triggers of the accounts, categories, transactions and recurrent transactions append the row that changed and
+   how it changed to the Changes table, each entry gets a sequence number greater than the previous ones. The changes
+   after a sequence number are written to a JSON Lines file with the present values of the rows and the other copy
+   applies the file, therefore a sync costs as much as the rows edited since the last one.
+   \since 0.2
+*/
+class ChangeLog {
+    friend class ChangeLogLock;
+
+ public:
+    // the values are stored by the triggers of the book, they must not change
+    enum class Entity {
+        ACCOUNT = 0,
+        CATEGORY = 1,
+        TRANSACTION = 2,
+        RECURRENT_TRANSACTION = 3
+    };
+
+    enum class Operation {
+        INSERT = 0,
+        UPDATE = 1,
+        DELETE = 2
+    };
+
+    struct Change {
+        qint64 sequence = 0;
+        Entity entity = Entity::ACCOUNT;
+        QUuid uuid;
+        Operation operation = Operation::INSERT;
+    };
+
+    // version of the layout of the exchanged files
+    static const int CHANGES_FORMAT = 1;
+
+    /*!
+        \fn ChangeLog();
+
+        Creates a change log that uses its own connection to the database.
+    */
+    ChangeLog();
+    virtual ~ChangeLog();
+
+    /*!
+        \fn virtual qint64 lastSequence();
+
+        Returns the sequence number of the last change, 0 if there are none and -1 if it could not be read.
+    */
+    virtual qint64 lastSequence();
+
+    /*!
+        \fn virtual QList<Change> changes(qint64 since=0);
+
+        Returns the last change of each row changed after the \a since sequence number, ordered by sequence.
+    */
+    virtual QList<Change> changes(qint64 since=0);
+
+    /*!
+        \fn virtual qint64 exportChanges(QString path, qint64 since=0);
+
+        Writes to \a path the last change of each row changed after the \a since sequence number together with the
+        present values of the row. Returns the sequence number up to which the changes were exported, which is the
+        one to use in the next export, or -1 if there was an error.
+    */
+    virtual qint64 exportChanges(QString path, qint64 since=0);
+
+    /*!
+        \fn virtual int applyChanges(QString path);
+
+        Applies the changes exported to \a path by another copy of the book in a single transaction. The rows are
+        written with the values of the file, the balances and totals are updated by the triggers as if they had been
+        stored by the book. The archived transactions that are changed are moved back to the main database first, as
+        the book does. The changes applied are not logged again so that they are not sent back. Returns the number of
+        changes applied or -1 if there was an error, in which case nothing is applied.
+    */
+    virtual int applyChanges(QString path);
+
+    /*!
+        \fn virtual int compact(qint64 upTo=0);
+
+        Removes the entries of the rows that changed again later and, when \a upTo is given, all the entries up to
+        that sequence number, which should be the last one the other copy applied. The last entry is always kept so
+        that the sequence numbers keep growing. Returns the number of entries removed or -1 if there was an error.
+    */
+    virtual int compact(qint64 upTo=0);
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error in the last operation.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error.
+    */
+    virtual QString lastError();
+
+ private:
+    std::shared_ptr<system::Database> _db;
+    std::mutex _dbMutex;
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<ChangeLog> ChangeLogPtr;
+
+}
+
+}
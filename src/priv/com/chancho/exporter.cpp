@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <glog/logging.h>
+
+#include <QDate>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <com/chancho/system/database_factory.h>
+
+#include "book.h"
+#include "exporter.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+    const QString SELECT_ACCOUNT_NAMES = "SELECT uuid, name FROM Accounts";
+    const QString SELECT_CATEGORY_NAMES = "SELECT uuid, name FROM Categories";
+    // the statements read the archived years as well
+    const QString COUNT_TRANSACTIONS = "SELECT COUNT(*) FROM AllTransactions";
+    const QString SELECT_EXPORTED_TRANSACTIONS = "SELECT account, category, day, month, year, amount, contents, memo "\
+        "FROM AllTransactions ORDER BY year, month, day";
+    const QString CSV_HEADER = "Date,Account,Category,Amount,Contents,Memo\n";
+    const int AMOUNT_PRECISION = 15;
+
+    QString
+    csvField(const QString& value) {
+        if (!value.contains(',') && !value.contains('"') && !value.contains('\n') && !value.contains('\r')) {
+            return value;
+        }
+        auto quoted = value;
+        quoted.replace("\"", "\"\"");
+        return "\"" + quoted + "\"";
+    }
+
+}
+
+class ExporterLock {
+ public:
+
+    explicit ExporterLock(Exporter* exporter)
+            : _exporter(exporter) {
+        _exporter->_dbMutex.lock();
+        _opened = _exporter->_db->open();
+        // the archived years are exported through the view created when they are attached
+        if (_opened && !Book::attachArchives(_exporter->_db)) {
+            _exporter->_db->close();
+            _opened = false;
+        }
+    }
+
+    ~ExporterLock() {
+        if (_opened) {
+            _exporter->_db->close();
+        }
+        _exporter->_dbMutex.unlock();
+    }
+
+    bool opened() const {
+        return _opened;
+    }
+
+    ExporterLock(const ExporterLock&) = delete;
+    ExporterLock& operator=(const ExporterLock&) = delete;
+
+ private:
+    bool _opened = false;
+    Exporter* _exporter;
+};
+
+Exporter::Exporter()
+    : _cancelled(false) {
+    auto dbPath = Book::databasePath();
+    _db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "EXPORTER");
+    _db->setDatabaseName(dbPath);
+}
+
+Exporter::~Exporter() {
+}
+
+boost::optional<Exporter::Format>
+Exporter::formatForFile(QString path) {
+    auto suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "csv") {
+        return Format::CSV;
+    }
+    if (suffix == "json" || suffix == "jsonl") {
+        return Format::JSON;
+    }
+    return boost::none;
+}
+
+qint64
+Exporter::exportTo(QString path, ExportProgress progress) {
+    auto format = formatForFile(path);
+    if (!format) {
+        _lastError = "The format of the export " + path + " is not supported.";
+        LOG(ERROR) << _lastError.toStdString();
+        return 0;
+    }
+
+    // the previous file is kept if the export fails or is cancelled
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        _lastError = "Could not open the export " + path + ": " + file.errorString();
+        LOG(ERROR) << _lastError.toStdString();
+        return 0;
+    }
+
+    auto count = exportTo(&file, *format, progress);
+    if (isError() || wasCancelled()) {
+        file.cancelWriting();
+        return count;
+    }
+
+    if (!file.commit()) {
+        _lastError = "Could not write the export " + path + ": " + file.errorString();
+        LOG(ERROR) << _lastError.toStdString();
+    }
+    return count;
+}
+
+qint64
+Exporter::exportTo(QIODevice* device, Format format, ExportProgress progress) {
+    qint64 count = 0;
+    _lastError = QString::null;
+    _cancelled = false;
+
+    ExporterLock dbLock(this);
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error opening database " << _lastError.toStdString();
+        return count;
+    }
+
+    // accounts and categories are few, their names are read once instead of joining them per row
+    QHash<QString, QString> accounts;
+    QHash<QString, QString> categories;
+    auto query = _db->createQuery();
+    auto success = query->exec(SELECT_ACCOUNT_NAMES);
+    while (success && query->next()) {
+        accounts[query->value(0).toString()] = query->value(1).toString();
+    }
+
+    success = success && query->exec(SELECT_CATEGORY_NAMES);
+    while (success && query->next()) {
+        categories[query->value(0).toString()] = query->value(1).toString();
+    }
+
+    // COUNT_TRANSACTIONS = SELECT COUNT(*) FROM AllTransactions
+    qint64 total = 0;
+    success = success && query->exec(COUNT_TRANSACTIONS);
+    if (success && query->next()) {
+        total = query->value(0).toLongLong();
+    }
+
+    if (!success) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error reading the book " << _lastError.toStdString();
+        return count;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(EXPORT_BUFFER_SIZE + 1024);
+    auto flush = [&]() {
+        if (device->write(buffer) != buffer.size()) {
+            _lastError = "Could not write the export: " + device->errorString();
+            LOG(ERROR) << _lastError.toStdString();
+            return false;
+        }
+        buffer.clear();
+        if (progress) {
+            progress(count, total);
+        }
+        return true;
+    };
+
+    if (format == Format::CSV) {
+        buffer.append(CSV_HEADER.toUtf8());
+    }
+
+    // SELECT_EXPORTED_TRANSACTIONS = SELECT account, category, day, month, year, amount, contents, memo
+    //     FROM AllTransactions ORDER BY year, month, day
+    query = _db->createQuery();
+    query->setForwardOnly(true);
+    if (!query->exec(SELECT_EXPORTED_TRANSACTIONS)) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << "Error reading the transactions " << _lastError.toStdString();
+        return count;
+    }
+
+    while (query->next()) {
+        if (_cancelled) {
+            LOG(INFO) << "Export cancelled after " << count << " transactions";
+            return count;
+        }
+
+        auto date = QDate(query->value(4).toInt(), query->value(3).toInt(), query->value(2).toInt());
+        auto account = accounts.value(query->value(0).toString());
+        auto category = categories.value(query->value(1).toString());
+        auto amount = query->value(5).toString().toDouble();
+        auto contents = query->value(6).toString();
+        auto memo = query->value(7).toString();
+
+        if (format == Format::CSV) {
+            QString line = date.toString(Qt::ISODate) + "," + csvField(account) + "," + csvField(category) + ","
+                + QString::number(amount, 'g', AMOUNT_PRECISION) + "," + csvField(contents) + "," + csvField(memo)
+                + "\n";
+            buffer.append(line.toUtf8());
+        } else {
+            QJsonObject object;
+            object["date"] = date.toString(Qt::ISODate);
+            object["account"] = account;
+            object["category"] = category;
+            object["amount"] = amount;
+            object["contents"] = contents;
+            object["memo"] = memo;
+            buffer.append(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            buffer.append('\n');
+        }
+        count++;
+
+        if (buffer.size() >= EXPORT_BUFFER_SIZE && !flush()) {
+            return count;
+        }
+    }
+
+    flush();
+    return count;
+}
+
+void
+Exporter::cancel() {
+    _cancelled = true;
+}
+
+bool
+Exporter::wasCancelled() {
+    return _cancelled;
+}
+
+bool
+Exporter::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+Exporter::lastError() {
+    return _lastError;
+}
+
+}
+
+}
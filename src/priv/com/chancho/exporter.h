@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <boost/optional.hpp>
+
+#include <QIODevice>
+#include <QString>
+
+#include <com/chancho/system/database.h>
+
+namespace com {
+
+namespace chancho {
+
+class ExporterLock;
+
+/*!
+   \class Exporter
+   \brief The Exporter class writes the transactions of the book as CSV or JSON Lines.
+
+   The transactions are read with a single forward only query and written through a buffer, the names of the
+   accounts and categories are read once before it. The memory used does not depend on the number of transactions.
+   \since 0.2
+*/
+class Exporter {
+    friend class ExporterLock;
+
+ public:
+    enum class Format {
+        CSV,
+        JSON
+    };
+
+    // exported transactions and total transactions of the book
+    typedef std::function<void(qint64, qint64)> ExportProgress;
+
+    // bytes kept in memory before they are written to the device
+    static const int EXPORT_BUFFER_SIZE = 64 * 1024;
+
+    /*!
+        \fn Exporter();
+
+        Creates an exporter that uses its own connection to the database so that a long export does not hold the one
+        used by the book.
+    */
+    Exporter();
+    virtual ~Exporter();
+
+    /*!
+        \fn static boost::optional<Format> formatForFile(QString path);
+
+        Returns the format of the export using the suffix of the file.
+    */
+    static boost::optional<Format> formatForFile(QString path);
+
+    /*!
+        \fn virtual qint64 exportTo(QString path, ExportProgress progress=ExportProgress());
+
+        Exports the book to the file in \a path, the format is detected from the suffix of the file. The file is only
+        replaced when the export finishes. Returns the number of exported transactions.
+    */
+    virtual qint64 exportTo(QString path, ExportProgress progress=ExportProgress());
+
+    /*!
+        \fn virtual qint64 exportTo(QIODevice* device, Format format, ExportProgress progress=ExportProgress());
+
+        Exports the book to the open \a device. The \a progress is called each time the buffer is written. Returns the
+        number of exported transactions.
+    */
+    virtual qint64 exportTo(QIODevice* device, Format format, ExportProgress progress=ExportProgress());
+
+    /*!
+        \fn virtual void cancel();
+
+        Stops the export that is running, it can be called from a different thread. Each export starts again without
+        being cancelled.
+    */
+    virtual void cancel();
+
+    /*!
+        \fn virtual bool wasCancelled();
+
+        Returns if the last export was cancelled.
+    */
+    virtual bool wasCancelled();
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error in the last export.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error that happened in an export.
+    */
+    virtual QString lastError();
+
+ private:
+    std::shared_ptr<system::Database> _db;
+    std::mutex _dbMutex;
+    std::atomic<bool> _cancelled;
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<Exporter> ExporterPtr;
+
+}
+
+}
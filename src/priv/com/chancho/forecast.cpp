@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <queue>
+#include <vector>
+
+#include <QMap>
+
+#include "forecast.h"
+
+namespace {
+
+    // an occurrence of a recurrence, only the next occurrence of each recurrence is kept in memory
+    struct Occurrence {
+        int recurrent;
+        com::chancho::RecurrentTransaction::Recurrence::Occurrences::const_iterator current;
+        com::chancho::RecurrentTransaction::Recurrence::Occurrences::const_iterator end;
+    };
+
+    struct LaterOccurrence {
+        bool operator()(const Occurrence& lhs, const Occurrence& rhs) const {
+            if (*lhs.current != *rhs.current) {
+                return *lhs.current > *rhs.current;
+            }
+            return lhs.recurrent > rhs.recurrent;
+        }
+    };
+
+}
+
+namespace com {
+
+namespace chancho {
+
+Forecast::Forecast(QList<AccountPtr> accounts, QList<RecurrentTransactionPtr> recurrents)
+    : _accounts(accounts),
+      _recurrents(recurrents) {
+}
+
+QList<Forecast::AccountBalances>
+Forecast::balances(QDate from, QDate to) {
+    QList<AccountBalances> result;
+    QMap<QUuid, int> accountIndexes;
+
+    foreach(const AccountPtr& account, _accounts) {
+        AccountBalances balances;
+        balances.account = account;
+        balances.balances.append(qMakePair(from, account->amount));
+        accountIndexes[account->_dbId] = result.count();
+        result.append(balances);
+    }
+
+    // the amount and account of each recurrence are calculated once, the occurrences are merged using a heap that
+    // has at most an occurrence per recurrence
+    std::vector<double> amounts(_recurrents.count(), 0);
+    std::vector<int> accounts(_recurrents.count(), -1);
+    std::priority_queue<Occurrence, std::vector<Occurrence>, LaterOccurrence> pending;
+
+    for (int index = 0; index < _recurrents.count(); index++) {
+        auto recurrent = _recurrents.at(index);
+        if (!recurrent->transaction || !recurrent->transaction->account || !recurrent->recurrence) {
+            continue;
+        }
+
+        auto accountId = recurrent->transaction->account->_dbId;
+        if (!accountIndexes.contains(accountId)) {
+            continue;
+        }
+        accounts[index] = accountIndexes[accountId];
+
+        // amounts are positive yet if it is an expense we must multiple by -1 to update the account accordingly
+        amounts[index] = recurrent->transaction->amount;
+        if (recurrent->transaction->type() == Category::Type::EXPENSE && amounts[index] > 0) {
+            amounts[index] = -1 * amounts[index];
+        }
+
+        // the start date and the generated occurrences are already part of the amount of the account
+        auto recurrence = recurrent->recurrence;
+        auto dates = recurrence->dates().from(recurrence->generatedOccurrences() + 1).until(to);
+        if (!dates.isEmpty()) {
+            pending.push(Occurrence{index, dates.begin(), dates.end()});
+        }
+    }
+
+    while (!pending.empty()) {
+        auto current = pending.top();
+        pending.pop();
+
+        auto& balances = result[accounts[current.recurrent]].balances;
+        auto amount = amounts[current.recurrent];
+        auto date = *current.current;
+
+        // occurrences that are due but not generated yet are part of the starting balance
+        if (date <= from) {
+            balances.first().second += amount;
+        } else if (balances.last().first == date) {
+            balances.last().second += amount;
+        } else {
+            balances.append(qMakePair(date, balances.last().second + amount));
+        }
+
+        if (++current.current != current.end) {
+            pending.push(current);
+        }
+    }
+
+    return result;
+}
+
+QList<Forecast::AccountBalances>
+Forecast::balances(int months) {
+    auto today = QDate::currentDate();
+    return balances(today, today.addMonths(months));
+}
+
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QDate>
+#include <QList>
+#include <QMetaType>
+#include <QPair>
+
+#include "account.h"
+#include "recurrent_transaction.h"
+
+namespace com {
+
+namespace chancho {
+
+/*!
+   \class Forecast
+   \brief The Forecast class projects the balances of the accounts using the occurrences of the recurrent
+          transactions that have not been generated yet.
+   \since 0.2
+*/
+class Forecast {
+
+ public:
+
+    struct AccountBalances {
+        AccountPtr account;
+        QList<QPair<QDate, double>> balances;
+    };
+
+    Forecast(QList<AccountPtr> accounts, QList<RecurrentTransactionPtr> recurrents);
+    virtual ~Forecast() = default;
+
+    /*!
+        \fn virtual QList<AccountBalances> balances(QDate from, QDate to);
+
+        Returns the projected balance of each of the accounts. The series of an account starts with the current
+        amount of the account at \a from, plus the occurrences that are due but were not generated yet, and has a
+        point for each of the days until \a to in which a recurrent transaction of the account happens. The
+        occurrences are never stored, they are enumerated one at a time per recurrence and merged by date.
+    */
+    virtual QList<AccountBalances> balances(QDate from, QDate to);
+
+    /*!
+        \fn virtual QList<AccountBalances> balances(int months);
+
+        Returns the projected balance of each of the accounts from today until the given number of \a months.
+    */
+    virtual QList<AccountBalances> balances(int months);
+
+ private:
+    QList<AccountPtr> _accounts;
+    QList<RecurrentTransactionPtr> _recurrents;
+};
+
+typedef std::shared_ptr<Forecast> ForecastPtr;
+
+}
+
+}
+
+Q_DECLARE_METATYPE(com::chancho::Forecast::AccountBalances)
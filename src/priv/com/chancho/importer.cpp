@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include <glog/logging.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+
+#include "importer.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+
+    // a transaction as found in the statement, the account and category are names that have to be mapped
+    struct StatementRow {
+        QDate date;
+        boost::optional<double> amount;
+        QString contents;
+        QString memo;
+        QString category;
+        QString account;
+    };
+
+    // amounts might use the comma or the dot as the decimal separator and the other one to group the thousands. When
+    // the \a decimal separator is not known it is taken from the first amount that tells it, an amount with a single
+    // separator followed by three digits does not and it is rejected until the separator is known
+    boost::optional<double>
+    parseAmount(QString value, QChar& decimal) {
+        value.remove(' ');
+        value.remove('+');
+        auto comma = value.lastIndexOf(',');
+        auto dot = value.lastIndexOf('.');
+        if (decimal.isNull()) {
+            if (comma >= 0 && dot >= 0) {
+                decimal = comma > dot ? ',' : '.';
+            } else if (comma >= 0 || dot >= 0) {
+                QChar separator = comma >= 0 ? ',' : '.';
+                auto position = std::max(comma, dot);
+                if (value.count(separator) > 1) {
+                    decimal = separator == ',' ? '.' : ',';
+                } else if (value.size() - position - 1 != 3) {
+                    decimal = separator;
+                } else {
+                    // 1.500 is a thousand and five hundred or one and a half depending on the statement
+                    return boost::none;
+                }
+            }
+        }
+
+        if (!decimal.isNull()) {
+            value.remove(decimal == ',' ? '.' : ',');
+            value.replace(decimal, '.');
+        }
+
+        bool ok = false;
+        auto amount = value.toDouble(&ok);
+        if (!ok) {
+            return boost::none;
+        }
+        return amount;
+    }
+
+    QDate
+    parseDate(QString value) {
+        static QStringList formats {"yyyy-MM-dd", "dd/MM/yyyy", "yyyy/MM/dd", "dd-MM-yyyy", "dd.MM.yyyy", "yyyyMMdd"};
+        value = value.trimmed();
+        foreach(const QString& format, formats) {
+            auto date = QDate::fromString(value, format);
+            if (date.isValid()) {
+                return date;
+            }
+        }
+        return QDate();
+    }
+
+    class StatementReader {
+     public:
+        StatementReader(QIODevice* device, QChar decimal)
+            : _stream(device),
+              _decimal(decimal) {
+            _stream.setCodec("UTF-8");
+            // the stream drops the line terminator, statements written on windows use two bytes for it
+            if (device->peek(4096).contains("\r\n")) {
+                _terminatorSize = 2;
+            }
+        }
+        virtual ~StatementReader() = default;
+
+        // reads the next transaction of the statement, returns false when there are no more
+        virtual bool next(StatementRow& row) = 0;
+
+        // bytes of the lines that have been read, the stream reads ahead of them from the device
+        qint64 consumed() const {
+            return _consumed;
+        }
+
+        bool atEnd() const {
+            return _stream.atEnd();
+        }
+
+     protected:
+        QString readLine() {
+            auto line = _stream.readLine();
+            _consumed += line.toUtf8().size() + _terminatorSize;
+            return line;
+        }
+
+        boost::optional<double> amount(const QString& value) {
+            return parseAmount(value, _decimal);
+        }
+
+        QTextStream _stream;
+        QChar _decimal;
+        qint64 _consumed = 0;
+        int _terminatorSize = 1;
+    };
+
+    // comma or semicolon separated values with a header row, quoted fields can contain separators and new lines
+    class CsvReader : public StatementReader {
+     public:
+        CsvReader(QIODevice* device, QChar decimal)
+            : StatementReader(device, decimal) {
+        }
+
+        bool next(StatementRow& row) override {
+            if (!_hasHeader && !readHeader()) {
+                return false;
+            }
+
+            QStringList fields;
+            while (readRecord(fields)) {
+                if (fields.count() == 1 && fields.first().trimmed().isEmpty()) {
+                    continue;
+                }
+
+                row = StatementRow();
+                row.date = parseDate(field(fields, DATE));
+                row.amount = amount(field(fields, AMOUNT));
+                row.contents = field(fields, CONTENTS);
+                row.memo = field(fields, MEMO);
+                row.category = field(fields, CATEGORY);
+                row.account = field(fields, ACCOUNT);
+                return true;
+            }
+            return false;
+        }
+
+     private:
+        enum Column {
+            DATE,
+            AMOUNT,
+            CONTENTS,
+            MEMO,
+            CATEGORY,
+            ACCOUNT
+        };
+
+        bool readHeader() {
+            QString line;
+            while (line.trimmed().isEmpty()) {
+                if (_stream.atEnd()) {
+                    return false;
+                }
+                line = readLine();
+            }
+
+            // the separator used is the one that splits the header in more columns
+            if (line.count(';') > line.count(',')) {
+                _separator = ';';
+            }
+
+            QStringList header;
+            split(line, header);
+            static QMap<QString, Column> names {
+                {"date", DATE},
+                {"amount", AMOUNT},
+                {"description", CONTENTS},
+                {"contents", CONTENTS},
+                {"payee", CONTENTS},
+                {"name", CONTENTS},
+                {"memo", MEMO},
+                {"notes", MEMO},
+                {"category", CATEGORY},
+                {"account", ACCOUNT}
+            };
+            for (int index = 0; index < header.count(); index++) {
+                auto name = header.at(index).trimmed().toLower();
+                if (names.contains(name) && !_columns.contains(names[name])) {
+                    _columns[names[name]] = index;
+                }
+            }
+
+            if (!_columns.contains(DATE) || !_columns.contains(AMOUNT)) {
+                LOG(ERROR) << "The CSV statement does not have a date and an amount column";
+                return false;
+            }
+            _hasHeader = true;
+            return true;
+        }
+
+        // reads a record that might span several lines when a quoted field has new lines
+        bool readRecord(QStringList& fields) {
+            if (_stream.atEnd()) {
+                return false;
+            }
+
+            auto record = readLine();
+            while (!split(record, fields) && !_stream.atEnd()) {
+                record += "\n" + readLine();
+            }
+            return true;
+        }
+
+        // returns false when the line ends inside a quoted field
+        bool split(const QString& line, QStringList& fields) {
+            fields.clear();
+            QString current;
+            auto quoted = false;
+            for (int pos = 0; pos < line.size(); pos++) {
+                auto c = line.at(pos);
+                if (quoted) {
+                    if (c == '"' && pos + 1 < line.size() && line.at(pos + 1) == '"') {
+                        current += '"';
+                        pos++;
+                    } else if (c == '"') {
+                        quoted = false;
+                    } else {
+                        current += c;
+                    }
+                } else if (c == '"') {
+                    quoted = true;
+                } else if (c == _separator) {
+                    fields.append(current);
+                    current.clear();
+                } else {
+                    current += c;
+                }
+            }
+            fields.append(current);
+            return !quoted;
+        }
+
+        QString field(const QStringList& fields, Column column) const {
+            if (!_columns.contains(column)) {
+                return QString();
+            }
+            return fields.value(_columns[column]).trimmed();
+        }
+
+        bool _hasHeader = false;
+        QChar _separator = ',';
+        QMap<Column, int> _columns;
+    };
+
+    // OFX statements are SGML or XML, the transactions are the STMTTRN aggregates and a value ends with the line or
+    // the next tag
+    class OfxReader : public StatementReader {
+     public:
+        OfxReader(QIODevice* device, QChar decimal)
+            : StatementReader(device, decimal) {
+        }
+
+        bool next(StatementRow& row) override {
+            auto inTransaction = false;
+            StatementRow current;
+
+            while (true) {
+                if (_pos >= _line.size()) {
+                    if (_stream.atEnd()) {
+                        return false;
+                    }
+                    _line = readLine();
+                    _pos = 0;
+                    continue;
+                }
+
+                auto open = _line.indexOf('<', _pos);
+                auto close = open < 0 ? -1 : _line.indexOf('>', open);
+                if (close < 0) {
+                    _pos = _line.size();
+                    continue;
+                }
+
+                auto tag = _line.mid(open + 1, close - open - 1).trimmed().toUpper();
+                auto end = _line.indexOf('<', close + 1);
+                if (end < 0) {
+                    end = _line.size();
+                }
+                auto value = decode(_line.mid(close + 1, end - close - 1).trimmed());
+                _pos = end;
+
+                if (tag == "STMTTRN") {
+                    inTransaction = true;
+                    current = StatementRow();
+                } else if (tag == "/STMTTRN" && inTransaction) {
+                    row = current;
+                    return true;
+                } else if (inTransaction) {
+                    if (tag == "DTPOSTED") {
+                        // the date might be followed by the time and the time zone
+                        current.date = QDate::fromString(value.left(8), "yyyyMMdd");
+                    } else if (tag == "TRNAMT") {
+                        // the amounts do not group the thousands, the separator that is present is the decimal one
+                        if (_decimal.isNull() && value.contains(',')) {
+                            _decimal = ',';
+                        } else if (_decimal.isNull() && value.contains('.')) {
+                            _decimal = '.';
+                        }
+                        current.amount = amount(value);
+                    } else if (tag == "NAME" || tag == "PAYEE") {
+                        current.contents = value;
+                    } else if (tag == "MEMO") {
+                        current.memo = value;
+                    }
+                }
+            }
+        }
+
+     private:
+        static QString decode(QString value) {
+            value.replace("&lt;", "<");
+            value.replace("&gt;", ">");
+            value.replace("&quot;", "\"");
+            value.replace("&apos;", "'");
+            value.replace("&amp;", "&");
+            return value;
+        }
+
+        QString _line;
+        int _pos = 0;
+    };
+
+    // QIF statements have a field per line identified by its first char and a record ends with ^
+    class QifReader : public StatementReader {
+     public:
+        QifReader(QIODevice* device, QChar decimal)
+            : StatementReader(device, decimal) {
+        }
+
+        bool next(StatementRow& row) override {
+            StatementRow current;
+            auto hasData = false;
+
+            while (!_stream.atEnd()) {
+                auto line = readLine().trimmed();
+                if (line.isEmpty() || line.startsWith('!')) {
+                    continue;
+                }
+
+                auto code = line.at(0);
+                auto value = line.mid(1).trimmed();
+                if (code == '^') {
+                    if (hasData) {
+                        row = current;
+                        return true;
+                    }
+                    continue;
+                }
+
+                hasData = true;
+                if (code == 'D') {
+                    current.date = parseQifDate(value);
+                } else if (code == 'T' || code == 'U') {
+                    current.amount = amount(value);
+                } else if (code == 'P') {
+                    current.contents = value;
+                } else if (code == 'M') {
+                    current.memo = value;
+                } else if (code == 'L' && !value.startsWith('[')) {
+                    // transfers are written as [account], subcategories as category:subcategory
+                    current.category = value.section(':', -1);
+                }
+            }
+
+            // the last record might not be closed
+            if (hasData) {
+                row = current;
+                return true;
+            }
+            return false;
+        }
+
+     private:
+        // QIF dates are month first and the year might have two digits after an apostrophe, for example 1/31'15
+        static QDate parseQifDate(QString value) {
+            value.replace('\'', '/');
+            value.replace('-', '/');
+            auto parts = value.split('/');
+            if (parts.count() != 3) {
+                return QDate();
+            }
+
+            if (parts.at(0).trimmed().size() == 4) {
+                return QDate(parts.at(0).toInt(), parts.at(1).toInt(), parts.at(2).toInt());
+            }
+
+            auto year = parts.at(2).trimmed().toInt();
+            if (year < 100) {
+                year += 2000;
+            }
+            return QDate(year, parts.at(0).toInt(), parts.at(1).toInt());
+        }
+    };
+
+}
+
+Importer::Importer(BookPtr book, AccountPtr account, CategoryPtr income, CategoryPtr expense)
+    : _book(book),
+      _account(account),
+      _income(income),
+      _expense(expense) {
+}
+
+boost::optional<Importer::Format>
+Importer::formatForFile(QString path) {
+    auto suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "csv" || suffix == "txt") {
+        return Format::CSV;
+    }
+    if (suffix == "ofx" || suffix == "qfx") {
+        return Format::OFX;
+    }
+    if (suffix == "qif") {
+        return Format::QIF;
+    }
+    return boost::none;
+}
+
+QList<QDate>
+Importer::import(QString path, ImportProgress progress, int batchSize) {
+    auto format = formatForFile(path);
+    if (!format) {
+        _lastError = "The format of the statement " + path + " is not supported.";
+        LOG(ERROR) << _lastError.toStdString();
+        return QList<QDate>();
+    }
+
+    QFile file(path);
+    // the stream handles both line terminators, the text mode would hide them from the progress
+    if (!file.open(QIODevice::ReadOnly)) {
+        _lastError = "Could not open the statement " + path + ": " + file.errorString();
+        LOG(ERROR) << _lastError.toStdString();
+        return QList<QDate>();
+    }
+
+    return import(&file, *format, progress, batchSize);
+}
+
+QList<QDate>
+Importer::import(QIODevice* device, Format format, ImportProgress progress, int batchSize) {
+    // first day of the months that got new transactions
+    QList<QDate> months;
+    _imported = 0;
+    _skipped = 0;
+    _duplicates = 0;
+    _lastError = QString::null;
+
+    if (batchSize <= 0) {
+        batchSize = IMPORT_BATCH_SIZE;
+    }
+
+    // the accounts and categories are read once and the names of the statement are mapped in memory
+    QMap<QString, AccountPtr> accounts;
+    foreach(const AccountPtr& account, _book->accounts()) {
+        accounts[account->name.toLower()] = account;
+    }
+
+    QMap<QString, CategoryPtr> categories;
+    foreach(const CategoryPtr& category, _book->categories()) {
+        auto name = category->name.toLower();
+        if (!categories.contains(name)) {
+            categories[name] = category;
+        }
+        if (!_income && category->type == Category::Type::INCOME) {
+            _income = category;
+        }
+        if (!_expense && category->type == Category::Type::EXPENSE) {
+            _expense = category;
+        }
+    }
+
+    if (_book->isError()) {
+        _lastError = _book->lastError();
+        return months;
+    }
+
+    std::unique_ptr<StatementReader> reader;
+    switch (format) {
+        case Format::OFX:
+            reader.reset(new OfxReader(device, _decimalSeparator));
+            break;
+        case Format::QIF:
+            reader.reset(new QifReader(device, _decimalSeparator));
+            break;
+        default:
+            reader.reset(new CsvReader(device, _decimalSeparator));
+            break;
+    }
+
+    QList<TransactionPtr> batch;
+    batch.reserve(batchSize);
+    // the counts of the rows seen are kept for the days close to the last one read, the fingerprint has the date
+    // so the keys of a day are dropped together
+    QHash<qint64, int> seen;
+    QMap<QDate, QSet<qint64>> seenDays;
+    auto lastReported = false;
+    auto storeBatch = [&]() {
+        // transactions of an overlapping statement that was already imported are not stored again, equal rows of
+        // different batches are counted together
+        auto trans = _book->filterPresent(batch, seen);
+        if (!_book->isError() && !trans.isEmpty()) {
+            _book->store(trans);
+        }
+        if (_book->isError()) {
+            _lastError = _book->lastError();
+            LOG(ERROR) << "Error importing the statement " << _lastError.toStdString();
+            return false;
+        }
+
+        foreach(const TransactionPtr& tran, trans) {
+            auto month = QDate(tran->date.year(), tran->date.month(), 1);
+            if (!months.contains(month)) {
+                months.append(month);
+            }
+        }
+
+        _imported += trans.count();
+        _duplicates += batch.count() - trans.count();
+
+        // statements are sorted by date in either direction, the days far from the ones of the batch are dropped and
+        // a later row equal to a dropped one is taken as present
+        auto first = batch.first()->date;
+        auto last = first;
+        foreach(const TransactionPtr& tran, batch) {
+            seenDays[tran->date].insert(Book::fingerprint(tran));
+            first = std::min(first, tran->date);
+            last = std::max(last, tran->date);
+        }
+        foreach(const QDate& day, seenDays.keys()) {
+            if (day < first.addDays(-IMPORT_SEEN_DAYS) || day > last.addDays(IMPORT_SEEN_DAYS)) {
+                foreach(qint64 key, seenDays[day]) {
+                    seen.remove(key);
+                }
+                seenDays.remove(day);
+            }
+        }
+        batch.clear();
+        if (progress) {
+            // the counted bytes are an estimate, the last batch reports the whole statement
+            auto read = reader->atEnd() ? device->size() : std::min(reader->consumed(), device->size());
+            progress(read, device->size());
+            lastReported = read == device->size();
+        }
+        return true;
+    };
+
+    StatementRow row;
+    while (reader->next(row)) {
+        if (!row.date.isValid() || !row.amount) {
+            _skipped++;
+            continue;
+        }
+
+        auto account = _account;
+        if (!row.account.isEmpty() && accounts.contains(row.account.toLower())) {
+            account = accounts[row.account.toLower()];
+        }
+
+        // the amounts of the transactions are positive, the type of the category tells if it is an expense, a
+        // category of the statement that does not agree with the sign is replaced by the default one
+        auto type = *row.amount < 0 ? Category::Type::EXPENSE : Category::Type::INCOME;
+        auto category = type == Category::Type::EXPENSE ? _expense : _income;
+        if (!row.category.isEmpty() && categories.contains(row.category.toLower())
+                && categories[row.category.toLower()]->type == type) {
+            category = categories[row.category.toLower()];
+        }
+
+        if (!account || !category) {
+            _skipped++;
+            continue;
+        }
+
+        batch.append(std::make_shared<Transaction>(account, std::abs(*row.amount), category, row.date, row.contents,
+            row.memo));
+
+        if (batch.count() == batchSize && !storeBatch()) {
+            return months;
+        }
+    }
+
+    if (!batch.isEmpty() && !storeBatch()) {
+        return months;
+    }
+
+    // the last rows might have been skipped after the last stored batch
+    if (progress && !lastReported) {
+        progress(device->size(), device->size());
+    }
+
+    std::sort(months.begin(), months.end());
+    return months;
+}
+
+void
+Importer::setDecimalSeparator(QChar separator) {
+    _decimalSeparator = separator;
+}
+
+int
+Importer::imported() const {
+    return _imported;
+}
+
+int
+Importer::skipped() const {
+    return _skipped;
+}
+
+int
+Importer::duplicates() const {
+    return _duplicates;
+}
+
+bool
+Importer::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+Importer::lastError() {
+    return _lastError;
+}
+
+}
+
+}
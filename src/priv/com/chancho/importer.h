@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <boost/optional.hpp>
+
+#include <QChar>
+#include <QDate>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+
+#include "account.h"
+#include "book.h"
+#include "category.h"
+
+namespace com {
+
+namespace chancho {
+
+/*!
+   \class Importer
+   \brief The Importer class stores the transactions of a bank statement in the book.
+
+   The statement is parsed while it is read and the transactions are stored in batches, therefore the memory used
+   does not depend on the size of the statement. CSV, OFX and QIF statements are supported.
+   \since 0.2
+*/
+class Importer {
+
+ public:
+    enum class Format {
+        CSV,
+        OFX,
+        QIF
+    };
+
+    // read bytes and total bytes of the statement
+    typedef std::function<void(qint64, qint64)> ImportProgress;
+
+    // number of transactions stored in each database transaction
+    static const int IMPORT_BATCH_SIZE = 500;
+
+    // days before the last one read whose rows are counted to tell equal rows of the statement from duplicates
+    static const int IMPORT_SEEN_DAYS = 31;
+
+    /*!
+        \fn Importer(BookPtr book, AccountPtr account, CategoryPtr income=CategoryPtr(),
+                     CategoryPtr expense=CategoryPtr());
+
+        Creates an importer that stores the transactions in the given \a account unless the statement names another
+        account of the book. Rows whose category is not found in the book, or whose category does not agree with the
+        sign of the amount, use the \a income or \a expense category according to the sign, when not given the first
+        category of each type is used.
+    */
+    Importer(BookPtr book, AccountPtr account, CategoryPtr income=CategoryPtr(), CategoryPtr expense=CategoryPtr());
+    virtual ~Importer() = default;
+
+    /*!
+        \fn static boost::optional<Format> formatForFile(QString path);
+
+        Returns the format of the statement using the suffix of the file.
+    */
+    static boost::optional<Format> formatForFile(QString path);
+
+    /*!
+        \fn virtual QList<QDate> import(QString path, ImportProgress progress=ImportProgress(),
+                                        int batchSize=IMPORT_BATCH_SIZE);
+
+        Imports the statement found in \a path, the format is detected from the suffix of the file. Returns the
+        first day of the months that got new transactions.
+    */
+    virtual QList<QDate> import(QString path, ImportProgress progress=ImportProgress(),
+                                int batchSize=IMPORT_BATCH_SIZE);
+
+    /*!
+        \fn virtual QList<QDate> import(QIODevice* device, Format format, ImportProgress progress=ImportProgress(),
+                                        int batchSize=IMPORT_BATCH_SIZE);
+
+        Imports the statement read from the open \a device. Each batch of \a batchSize transactions is stored in a
+        database transaction and the \a progress is called after it with the bytes of the parsed lines. Transactions
+        already present in the book are not stored again. Returns the first day of the months that got new
+        transactions.
+    */
+    virtual QList<QDate> import(QIODevice* device, Format format, ImportProgress progress=ImportProgress(),
+                                int batchSize=IMPORT_BATCH_SIZE);
+
+    /*!
+        \fn virtual void setDecimalSeparator(QChar separator);
+
+        Sets the \a separator used by the amounts of the statements. When it is not set the separator is detected
+        from the amounts, those with a single separator followed by three digits, like 1.500, are skipped until an
+        amount tells which one is used.
+    */
+    virtual void setDecimalSeparator(QChar separator);
+
+    /*!
+        \fn virtual int imported() const;
+
+        Returns the number of transactions stored by the last import.
+    */
+    virtual int imported() const;
+
+    /*!
+        \fn virtual int skipped() const;
+
+        Returns the number of rows of the last import that were ignored because they could not be parsed.
+    */
+    virtual int skipped() const;
+
+    /*!
+        \fn virtual int duplicates() const;
+
+        Returns the number of transactions of the last import that were not stored because the book already had them.
+    */
+    virtual int duplicates() const;
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error in the last import.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error that happened in an import.
+    */
+    virtual QString lastError();
+
+ protected:
+    BookPtr _book;
+    AccountPtr _account;
+    CategoryPtr _income;
+    CategoryPtr _expense;
+    int _imported = 0;
+    int _skipped = 0;
+    int _duplicates = 0;
+    QChar _decimalSeparator;
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<Importer> ImporterPtr;
+
+}
+
+}
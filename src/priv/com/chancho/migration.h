@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QString>
+#include <QVariant>
+
+#include <com/chancho/system/database.h>
+
+namespace com {
+
+namespace chancho {
+
+/*!
+    \class Migration
+
+    Data migration that rewrites the rows of a table in bounded batches. The Updater runs each batch in its own
+    database transaction together with the progress of the migration, therefore the write lock is released between
+    batches and an interrupted migration continues from the last committed batch.
+*/
+class Migration {
+ public:
+    Migration() = default;
+    virtual ~Migration() = default;
+
+    /*!
+        \fn virtual int id() const = 0;
+
+        Returns the id of the migration. The migrations are executed ordered by id and the progress is stored with it,
+        the id of a released migration must never change.
+    */
+    virtual int id() const = 0;
+
+    /*!
+        \fn virtual QString name() const = 0;
+
+        Returns a name that describes the migration, used in the logs and the progress.
+    */
+    virtual QString name() const = 0;
+
+    /*!
+        \fn virtual int total(system::DatabasePtr db) = 0;
+
+        Returns the number of rows that have to be migrated.
+    */
+    virtual int total(system::DatabasePtr db) = 0;
+
+    /*!
+        \fn virtual bool migrateBatch(system::DatabasePtr db, int batchSize, QVariant& cursor, int& processed) = 0;
+
+        Migrates at most \a batchSize rows after the given \a cursor, an invalid cursor means that no row has been
+        migrated. The \a cursor is updated to point to the last migrated row and \a processed to the number of rows
+        in the batch, a batch smaller than \a batchSize means that all the rows were migrated. Returns false if
+        there was an error.
+    */
+    virtual bool migrateBatch(system::DatabasePtr db, int batchSize, QVariant& cursor, int& processed) = 0;
+
+    /*!
+        \fn virtual bool finish(system::DatabasePtr db);
+
+        Executed in the same database transaction as the last batch, allows to remove the data that is no longer
+        needed. Returns false if there was an error.
+    */
+    virtual bool finish(system::DatabasePtr db);
+};
+
+typedef std::shared_ptr<Migration> MigrationPtr;
+
+}
+
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include <QSqlError>
+
+#include <com/chancho/system/database_factory.h>
+
+#include "book.h"
+#include "payees.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+    const QString SELECT_PAYEE_CATEGORIES = "SELECT uuid, name, type FROM Categories";
+    const QString SELECT_PAYEES = "SELECT contents, category, amount, day, month, year FROM Transactions "\
+        "WHERE contents IS NOT NULL AND contents != ''";
+}
+
+class PayeesLock {
+ public:
+
+    explicit PayeesLock(Payees* payees)
+            : _payees(payees) {
+        _payees->_dbMutex.lock();
+        _opened = _payees->_db->open();
+    }
+
+    ~PayeesLock() {
+        if (_opened) {
+            _payees->_db->close();
+        }
+        _payees->_dbMutex.unlock();
+    }
+
+    bool opened() const {
+        return _opened;
+    }
+
+    PayeesLock(const PayeesLock&) = delete;
+    PayeesLock& operator=(const PayeesLock&) = delete;
+
+ private:
+    bool _opened = false;
+    Payees* _payees;
+};
+
+Payees::Payees() {
+    auto dbPath = Book::databasePath();
+    _db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "PAYEES");
+    _db->setDatabaseName(dbPath);
+}
+
+Payees::~Payees() {
+}
+
+QString
+Payees::key(const QString& contents) {
+    return contents.simplified().toLower();
+}
+
+void
+Payees::addToEntry(Entry& entry, const QString& contents, QUuid category, double amount, QDate date,
+                   QDate reference) {
+    entry.count++;
+    entry.weight += std::pow(0.5, date.daysTo(reference) / static_cast<double>(PAYEE_HALF_LIFE_DAYS));
+
+    // the last transaction decides how the payee is written and the amount that is suggested
+    if (!entry.last.isValid() || date >= entry.last) {
+        entry.last = date;
+        entry.contents = contents.simplified();
+        entry.amount = amount;
+    }
+
+    if (category.isNull()) {
+        return;
+    }
+
+    for (auto it = entry.categories.begin(); it != entry.categories.end(); ++it) {
+        if (it->first == category) {
+            it->second++;
+            return;
+        }
+    }
+    entry.categories.append(qMakePair(category, 1));
+}
+
+void
+Payees::removeFromEntry(Entry& entry, QUuid category, QDate date, QDate reference) {
+    entry.count--;
+    entry.weight = std::max(0.0,
+        entry.weight - std::pow(0.5, date.daysTo(reference) / static_cast<double>(PAYEE_HALF_LIFE_DAYS)));
+
+    if (category.isNull()) {
+        return;
+    }
+
+    for (auto it = entry.categories.begin(); it != entry.categories.end(); ++it) {
+        if (it->first == category) {
+            it->second--;
+            if (it->second <= 0) {
+                entry.categories.erase(it);
+            }
+            return;
+        }
+    }
+}
+
+bool
+Payees::build() {
+    // the transactions are weighted against the first one read and scaled to the most recent one once all of them
+    // have been read, the ranking is the same for any reference
+    QDate reference;
+    QDate latest;
+    {
+        std::lock_guard<std::mutex> lock(_entriesMutex);
+        _building = true;
+    }
+
+    QHash<QString, Entry> entries;
+    QHash<QUuid, CategoryPtr> categories;
+    QString error = QString::null;
+    {
+        PayeesLock dbLock(this);
+
+        if (!dbLock.opened()) {
+            error = _db->lastError().text();
+        } else {
+            auto query = _db->createQuery();
+            query->setForwardOnly(true);
+            if (query->exec(SELECT_PAYEE_CATEGORIES)) {
+                while (query->next()) {
+                    auto uuid = QUuid(query->value(0).toString());
+                    auto type = static_cast<Category::Type>(query->value(2).toInt());
+                    auto category = std::make_shared<Category>(query->value(1).toString(), type);
+                    category->_dbId = uuid;
+                    categories[uuid] = category;
+                }
+            } else {
+                error = query->lastError().text();
+            }
+
+            // the transactions are read once and grouped by payee, only the groups are kept in memory
+            query = _db->createQuery();
+            query->setForwardOnly(true);
+            if (error.isNull() && query->exec(SELECT_PAYEES)) {
+                while (query->next()) {
+                    auto contents = query->value(0).toString();
+                    auto payee = key(contents);
+                    if (payee.isEmpty()) {
+                        continue;
+                    }
+
+                    auto& entry = entries[payee];
+                    entry.key = payee;
+                    auto date = QDate(query->value(5).toInt(), query->value(4).toInt(), query->value(3).toInt());
+                    if (!reference.isValid()) {
+                        reference = date;
+                        latest = date;
+                    }
+                    latest = std::max(latest, date);
+                    addToEntry(entry, contents, QUuid(query->value(1).toString()),
+                               std::abs(query->value(2).toString().toDouble()), date, reference);
+                }
+            } else if (error.isNull()) {
+                error = query->lastError().text();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+    _building = false;
+
+    if (!error.isNull()) {
+        // the index is kept as it was, the pending transactions are added to it
+        _lastError = error;
+        LOG(ERROR) << "Could not build the payees " << _lastError.toStdString();
+        applyPendingUnlocked();
+        return false;
+    }
+
+    if (reference.isValid() && latest != reference) {
+        auto scale = std::pow(0.5, reference.daysTo(latest) / static_cast<double>(PAYEE_HALF_LIFE_DAYS));
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            it->weight *= scale;
+        }
+    }
+
+    auto sorted = entries.values().toVector();
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& first, const Entry& second) {
+        return first.key < second.key;
+    });
+
+    _entries.swap(sorted);
+    _categories.swap(categories);
+    _reference = latest;
+    _built = true;
+    _lastError = QString::null;
+
+    // the transactions stored or removed while the index was built
+    applyPendingUnlocked();
+    return true;
+}
+
+void
+Payees::add(TransactionPtr tran) {
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+    if (_building) {
+        _pending.append(qMakePair(tran, true));
+        return;
+    }
+    addUnlocked(tran);
+}
+
+void
+Payees::remove(TransactionPtr tran) {
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+    if (_building) {
+        _pending.append(qMakePair(tran, false));
+        return;
+    }
+    removeUnlocked(tran);
+}
+
+void
+Payees::applyPendingUnlocked() {
+    typedef QPair<TransactionPtr, bool> PendingChange;
+    foreach(const PendingChange& change, _pending) {
+        if (change.second) {
+            addUnlocked(change.first);
+        } else {
+            removeUnlocked(change.first);
+        }
+    }
+    _pending.clear();
+}
+
+void
+Payees::addUnlocked(TransactionPtr tran) {
+    auto payee = key(tran->contents);
+    if (payee.isEmpty()) {
+        return;
+    }
+
+    if (!_reference.isValid()) {
+        _reference = tran->date;
+    }
+
+    QUuid category;
+    if (tran->category) {
+        category = tran->category->_dbId;
+        if (!category.isNull() && !_categories.contains(category)) {
+            _categories[category] = tran->category;
+        }
+    }
+
+    // keep the entries sorted, a new payee is inserted in its position
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), payee, [](const Entry& entry, const QString& value) {
+        return entry.key < value;
+    });
+    if (it == _entries.end() || it->key != payee) {
+        Entry entry;
+        entry.key = payee;
+        it = _entries.insert(it, entry);
+    }
+    addToEntry(*it, tran->contents, category, std::abs(tran->amount), tran->date, _reference);
+}
+
+void
+Payees::removeUnlocked(TransactionPtr tran) {
+    auto payee = key(tran->contents);
+    if (payee.isEmpty()) {
+        return;
+    }
+
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), payee, [](const Entry& entry, const QString& value) {
+        return entry.key < value;
+    });
+    if (it == _entries.end() || it->key != payee) {
+        return;
+    }
+
+    QUuid category;
+    if (tran->category) {
+        category = tran->category->_dbId;
+    }
+    removeFromEntry(*it, category, tran->date, _reference);
+
+    // the payee is no longer suggested once its last transaction is gone
+    if (it->count <= 0) {
+        _entries.erase(it);
+    }
+}
+
+QList<Payees::Suggestion>
+Payees::suggestions(QString prefix, int count) {
+    QList<Suggestion> result;
+
+    auto payee = key(prefix);
+    if (payee.isEmpty() || count <= 0) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+
+    // the payees that start with the prefix are next to each other in the sorted entries
+    QVector<const Entry*> matches;
+    auto first = std::lower_bound(_entries.constBegin(), _entries.constEnd(), payee,
+        [](const Entry& entry, const QString& value) {
+            return entry.key < value;
+        });
+    for (auto it = first; it != _entries.constEnd() && it->key.startsWith(payee); ++it) {
+        matches.append(&(*it));
+    }
+
+    auto top = std::min(count, matches.count());
+    std::partial_sort(matches.begin(), matches.begin() + top, matches.end(),
+        [](const Entry* left, const Entry* right) {
+            if (left->weight != right->weight) {
+                return left->weight > right->weight;
+            }
+            return left->key < right->key;
+        });
+
+    for (int index = 0; index < top; index++) {
+        auto entry = matches.at(index);
+
+        Suggestion suggestion;
+        suggestion.contents = entry->contents;
+        suggestion.amount = entry->amount;
+        suggestion.count = entry->count;
+
+        QUuid category;
+        int uses = 0;
+        foreach(const QPair<QUuid, int>& pair, entry->categories) {
+            if (pair.second > uses) {
+                category = pair.first;
+                uses = pair.second;
+            }
+        }
+        suggestion.category = _categories.value(category);
+
+        result.append(suggestion);
+    }
+
+    return result;
+}
+
+bool
+Payees::isBuilt() {
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+    return _built;
+}
+
+int
+Payees::numberOfPayees() {
+    std::lock_guard<std::mutex> lock(_entriesMutex);
+    return _entries.count();
+}
+
+bool
+Payees::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+Payees::lastError() {
+    return _lastError;
+}
+
+}
+
+}
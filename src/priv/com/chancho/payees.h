@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+#include <com/chancho/system/database.h>
+
+#include "category.h"
+#include "transaction.h"
+
+namespace com {
+
+namespace chancho {
+
+class PayeesLock;
+
+/*!
+   \class Payees
+   \brief The Payees class suggests the contents of a transaction while the user types them.
+
+   The distinct contents of the transactions are kept in memory sorted by their lower case text, the payees that
+   start with a prefix are a contiguous range found with a binary search so that no query is performed per
+   keystroke. The index is built from the database with build(), usually in a worker thread, and updated with
+   add() and remove() when a transaction is stored, edited or removed.
+   \since 0.2
+*/
+class Payees {
+    friend class PayeesLock;
+
+ public:
+    struct Suggestion {
+        QString contents;
+        CategoryPtr category;  // category used the most with the payee
+        double amount = 0;  // amount of the last transaction of the payee, always positive
+        int count = 0;  // number of transactions of the payee
+    };
+
+    // number of suggestions returned by default
+    static const int PAYEE_SUGGESTIONS = 5;
+
+    // days after which the transactions of a payee weight half when ranking the suggestions
+    static const int PAYEE_HALF_LIFE_DAYS = 90;
+
+    /*!
+        \fn Payees();
+
+        Creates an empty index that uses its own connection to the database so that building it does not hold the
+        one used by the book.
+    */
+    Payees();
+    virtual ~Payees();
+
+    /*!
+        \fn virtual bool build();
+
+        Reads the contents of all the transactions with a single forward only query and replaces the index. The
+        suggestions can be requested from other threads while it is built. Returns false if the transactions could
+        not be read.
+    */
+    virtual bool build();
+
+    /*!
+        \fn virtual void add(TransactionPtr tran);
+
+        Adds a stored transaction to the index. Transactions added while the index is being built are added once it
+        has been built.
+    */
+    virtual void add(TransactionPtr tran);
+
+    /*!
+        \fn virtual void remove(TransactionPtr tran);
+
+        Removes a transaction from the index, used when it is removed from the book and with the old values of an
+        edited one. A payee without transactions is no longer suggested. Transactions removed while the index is
+        being built are removed once it has been built.
+    */
+    virtual void remove(TransactionPtr tran);
+
+    /*!
+        \fn virtual QList<Suggestion> suggestions(QString prefix, int count=PAYEE_SUGGESTIONS);
+
+        Returns at most \a count payees whose contents start with \a prefix ignoring the case. The payees are ranked
+        by their number of transactions, each one weighting half every PAYEE_HALF_LIFE_DAYS before the most recent
+        transaction of the book, so the ranking does not depend on the current date.
+    */
+    virtual QList<Suggestion> suggestions(QString prefix, int count=PAYEE_SUGGESTIONS);
+
+    /*!
+        \fn virtual bool isBuilt();
+
+        Returns if the index has been built.
+    */
+    virtual bool isBuilt();
+
+    /*!
+        \fn virtual int numberOfPayees();
+
+        Returns the number of distinct payees in the index.
+    */
+    virtual int numberOfPayees();
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error building the index.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error that happened building the index.
+    */
+    virtual QString lastError();
+
+ private:
+    struct Entry {
+        QString key;  // simplified lower case contents, the index is sorted by it
+        QString contents;  // contents of the last transaction
+        QDate last;
+        double amount = 0;
+        // sum of the transactions weighted by their age at the reference date, the age at any other date scales
+        // all the weights by the same factor so the ranking does not change with the current date
+        double weight = 0;
+        int count = 0;
+        QVector<QPair<QUuid, int>> categories;
+    };
+
+    static QString key(const QString& contents);
+    static void addToEntry(Entry& entry, const QString& contents, QUuid category, double amount, QDate date,
+                           QDate reference);
+    static void removeFromEntry(Entry& entry, QUuid category, QDate date, QDate reference);
+    void addUnlocked(TransactionPtr tran);
+    void removeUnlocked(TransactionPtr tran);
+    void applyPendingUnlocked();
+
+ private:
+    std::shared_ptr<system::Database> _db;
+    std::mutex _dbMutex;
+
+    // guards the entries, the categories and the pending transactions
+    std::mutex _entriesMutex;
+    QVector<Entry> _entries;
+    QHash<QUuid, CategoryPtr> _categories;
+    QList<QPair<TransactionPtr, bool>> _pending;  // transactions added (true) or removed while building
+    QDate _reference;  // most recent transaction when the index was built, used to weight the transactions
+    bool _building = false;
+    bool _built = false;
+
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<Payees> PayeesPtr;
+
+}
+
+}
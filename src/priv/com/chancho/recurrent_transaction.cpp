@@ -20,6 +20,9 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <limits>
+
 #include <glog/logging.h>
 
 #include "recurrent_transaction.h"
@@ -64,52 +67,118 @@ RecurrentTransaction::Recurrence::defaults() const {
     return _defaults;
 }
 
+boost::optional<int>
+RecurrentTransaction::Recurrence::periodInDays() const {
+    if (_defaults) {
+        switch (*_defaults) {
+            case Recurrence::Defaults::DAILY:
+                return 1;
+            case Recurrence::Defaults::WEEKLY:
+                return 7;
+            default:
+                // monthly recurrences do not have a fixed number of days
+                return boost::none;
+        }
+    }
+    return _numberOfDays;
+}
+
+QDate
+RecurrentTransaction::Recurrence::occurrence(int n) const {
+    auto period = periodInDays();
+    if (period) {
+        return startDate.addDays(static_cast<qint64>(*period) * n);
+    }
+    return startDate.addMonths(n);
+}
+
 int
-RecurrentTransaction::Recurrence::ocurrencesPassed() {
-    // simply, do the reverse of the generateMissingDate, we go from last to start
-    int count = 0;
-    QDate lastCalculated;
+RecurrentTransaction::Recurrence::occurrencesUntil(QDate date) const {
+    if (!startDate.isValid() || !date.isValid() || date <= startDate) {
+        return 0;
+    }
 
-    if(lastGenerated.isValid()) {
-        lastCalculated = QDate(lastGenerated);
-    } else {
-        lastCalculated = startDate;
-    }
-
-    if(_defaults) {
-        while (lastCalculated > startDate) {
-            switch (*_defaults) {
-                case Recurrence::Defaults::DAILY:
-                    DLOG(INFO) << "Daily increased";
-                    lastCalculated = lastCalculated.addDays(-1);
-                    break;
-                case Recurrence::Defaults::WEEKLY:
-                    DLOG(INFO) << "Weekly increased";
-                    lastCalculated = lastCalculated.addDays(-7);
-                    break;
-                default:
-                    DLOG(INFO) << "Monthly increased";
-                    lastCalculated = lastCalculated.addMonths(-1);
-                    break;
-            }
-            if (lastCalculated >= startDate) {
-                count++;
-            }
-        }
-    } else {
-        while(lastCalculated > startDate) {
-            lastCalculated = lastCalculated.addDays(*_numberOfDays * -1);
-            if (lastCalculated >= startDate) {
-                count++;
-            }
+    auto period = periodInDays();
+    if (period) {
+        if (*period <= 0) {
+            return 0;
         }
+        return static_cast<int>(startDate.daysTo(date) / *period);
     }
-    return count;
+
+    // the number of months between the dates is an upper bound, the day of the month tells if the last one happened
+    auto months = (date.year() - startDate.year()) * 12 + date.month() - startDate.month();
+    if (startDate.addMonths(months) > date) {
+        months--;
+    }
+    return months;
 }
 
-QList<QDate>
-RecurrentTransaction::Recurrence::generateMissingDates() {
-    QList<QDate> result;
+int
+RecurrentTransaction::Recurrence::generatedOccurrences() const {
+    if (!lastGenerated.isValid() || !startDate.isValid() || lastGenerated <= startDate) {
+        return 0;
+    }
+
+    auto period = periodInDays();
+    if (period) {
+        return occurrencesUntil(lastGenerated);
+    }
+
+    // books generated before the occurrences were calculated from the start date stepped a month from the previous
+    // one, a recurrence started the 31st drifted to an earlier day (31/01, 28/02, 28/03) but never left the month of
+    // the occurrence, therefore the month tells which one was generated last
+    return (lastGenerated.year() - startDate.year()) * 12 + lastGenerated.month() - startDate.month();
+}
+
+QDate
+RecurrentTransaction::Recurrence::nextOccurrence(QDate date) const {
+    auto period = periodInDays();
+    if (period && *period <= 0) {
+        return QDate();
+    }
+
+    auto next = occurrencesUntil(date) + 1;
+    if (occurrences && next > *occurrences) {
+        return QDate();
+    }
+
+    auto nextDate = occurrence(next);
+    if (endDate.isValid() && nextDate > endDate) {
+        return QDate();
+    }
+    return nextDate;
+}
+
+QDate
+RecurrentTransaction::Recurrence::nextDue() const {
+    // the start date is the transaction stored by the user, the generated ones begin with the next occurrence
+    auto period = periodInDays();
+    if (!startDate.isValid() || (period && *period <= 0)) {
+        return QDate();
+    }
+
+    auto next = generatedOccurrences() + 1;
+    if (occurrences && next > *occurrences) {
+        return QDate();
+    }
+
+    auto nextDate = occurrence(next);
+    if (endDate.isValid() && nextDate > endDate) {
+        return QDate();
+    }
+    return nextDate;
+}
+
+int
+RecurrentTransaction::Recurrence::ocurrencesPassed() {
+    return generatedOccurrences();
+}
+
+QPair<int, int>
+RecurrentTransaction::Recurrence::missingOccurrences() {
+    // an empty range is returned as a first index that is larger than the last one
+    auto none = qMakePair(1, 0);
 
     // calculate which dates should be used since the last time we had a recurrence created
     auto today = QDate::currentDate();
@@ -120,65 +189,199 @@ RecurrentTransaction::Recurrence::generateMissingDates() {
 
     if (startDate > today) {
         LOG(INFO) << "Returning empty list because the start date is smaller than the current date";
-        return result;
+        return none;
     }
 
     if (lastGenerated.isValid() && lastGenerated == today) {
         LOG(INFO) << "Returning empty list because we are up to date with all the occurrences";
-        return result;
+        return none;
     }
 
-    QDate lastCalculated;
-    if(lastGenerated.isValid()) {
-        lastCalculated = QDate(lastGenerated);
-    } else {
-        lastCalculated = startDate;
-    }
-
-    if(_defaults) {
-        while (lastCalculated < today) {
-            switch (*_defaults) {
-                case Recurrence::Defaults::DAILY:
-                    DLOG(INFO) << "Daily increased";
-                    lastCalculated = lastCalculated.addDays(1);
-                    break;
-                case Recurrence::Defaults::WEEKLY:
-                    DLOG(INFO) << "Weekly increased";
-                    lastCalculated = lastCalculated.addDays(7);
-                    break;
-                default:
-                    DLOG(INFO) << "Monthly increased";
-                    lastCalculated = lastCalculated.addMonths(1);
-                    break;
-            }
-            if (lastCalculated <= today) {
-                DLOG(INFO) << "New date appended " << lastCalculated.day() << "/" << lastCalculated.month()
-                    << "/" << lastCalculated.year();
-                result.append(lastCalculated);
-            }
-        }
-    } else {
-        while(lastCalculated < today) {
-            lastCalculated = lastCalculated.addDays(*_numberOfDays);
-            if (lastCalculated <= today) {
-                result.append(lastCalculated);
-            }
-        }
+    auto period = periodInDays();
+    if (period && *period <= 0) {
+        LOG(ERROR) << "Recurrence with an invalid number of days " << *period;
+        return none;
     }
 
+    // the occurrences are calculated by index, there is no need to iterate over the periods that already passed
+    auto first = ocurrencesPassed() + 1;
+    auto last = occurrencesUntil(today);
+
     if (occurrences) {
-        auto left = *occurrences - ocurrencesPassed();
-        LOG(INFO) << "We have " << left << " occurrences left";
-        if (left > 0) {
-            return result.mid(0, left);
-        } else {
-            return QList<QDate>();
-        }
+        LOG(INFO) << "We have " << *occurrences - first + 1 << " occurrences left";
+        last = std::min(last, *occurrences);
+    }
+
+    return qMakePair(first, last);
+}
+
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::dates() const {
+    auto period = periodInDays();
+    if (!startDate.isValid() || (period && *period <= 0)) {
+        return Occurrences();
     }
 
+    // the last index is kept one below the largest int so that the end iterator does not overflow
+    auto last = std::numeric_limits<int>::max() - 1;
+    if (occurrences) {
+        last = std::min(last, *occurrences);
+    }
+
+    Occurrences result(this, 0, last);
+    if (endDate.isValid()) {
+        return result.until(endDate);
+    }
     return result;
 }
 
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::missingDates() {
+    auto range = missingOccurrences();
+    return Occurrences(this, range.first, range.second);
+}
+
+QList<QDate>
+RecurrentTransaction::Recurrence::generateMissingDates() {
+    QList<QDate> result;
+
+    auto range = missingDates();
+    result.reserve(range.size());
+    for (const auto& date : range) {
+        result.append(date);
+    }
+
+    return result;
+}
+
+RecurrentTransaction::Recurrence::Occurrences::Occurrences(const Recurrence* recurrence, int first, int last)
+    : _recurrence(recurrence),
+      _first(first),
+      _last(last) {
+}
+
+RecurrentTransaction::Recurrence::Occurrences::const_iterator
+RecurrentTransaction::Recurrence::Occurrences::begin() const {
+    if (isEmpty()) {
+        return end();
+    }
+    return const_iterator(_recurrence, _first, _last);
+}
+
+RecurrentTransaction::Recurrence::Occurrences::const_iterator
+RecurrentTransaction::Recurrence::Occurrences::end() const {
+    if (isEmpty()) {
+        return const_iterator(_recurrence, _first, _first - 1);
+    }
+    return const_iterator(_recurrence, _last + 1, _last);
+}
+
+bool
+RecurrentTransaction::Recurrence::Occurrences::isEmpty() const {
+    return _recurrence == nullptr || _first > _last;
+}
+
+int
+RecurrentTransaction::Recurrence::Occurrences::size() const {
+    if (isEmpty()) {
+        return 0;
+    }
+    return _last - _first + 1;
+}
+
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::Occurrences::take(int n) const {
+    if (n <= 0) {
+        return Occurrences(_recurrence, _first, _first - 1);
+    }
+    if (n < size()) {
+        return Occurrences(_recurrence, _first, _first + n - 1);
+    }
+    return *this;
+}
+
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::Occurrences::until(QDate date) const {
+    if (isEmpty()) {
+        return *this;
+    }
+
+    // the indexes are calculated from the dates, no occurrence has to be visited
+    if (!date.isValid() || date < _recurrence->startDate) {
+        return Occurrences(_recurrence, _first, _first - 1);
+    }
+    return Occurrences(_recurrence, _first, std::min(_last, _recurrence->occurrencesUntil(date)));
+}
+
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::Occurrences::from(int index) const {
+    if (isEmpty()) {
+        return *this;
+    }
+    return Occurrences(_recurrence, std::max(_first, index), _last);
+}
+
+RecurrentTransaction::Recurrence::Occurrences
+RecurrentTransaction::Recurrence::Occurrences::after(QDate date) const {
+    if (isEmpty() || !date.isValid() || date < _recurrence->startDate) {
+        return *this;
+    }
+    return Occurrences(_recurrence, std::max(_first, _recurrence->occurrencesUntil(date) + 1), _last);
+}
+
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::const_iterator(const Recurrence* recurrence,
+        int index, int last)
+    : _recurrence(recurrence),
+      _index(index),
+      _last(last) {
+    if (_recurrence != nullptr && _index <= _last) {
+        _date = _recurrence->occurrence(_index);
+    }
+}
+
+const QDate&
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator*() const {
+    return _date;
+}
+
+const QDate*
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator->() const {
+    return &_date;
+}
+
+RecurrentTransaction::Recurrence::Occurrences::const_iterator&
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator++() {
+    _index++;
+    if (_index <= _last) {
+        _date = _recurrence->occurrence(_index);
+    } else {
+        _date = QDate();
+    }
+    return *this;
+}
+
+RecurrentTransaction::Recurrence::Occurrences::const_iterator
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator++(int) {
+    auto result = *this;
+    ++(*this);
+    return result;
+}
+
+bool
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator==(const const_iterator& other) const {
+    return _recurrence == other._recurrence && _index == other._index;
+}
+
+bool
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::operator!=(const const_iterator& other) const {
+    return !(*this == other);
+}
+
+int
+RecurrentTransaction::Recurrence::Occurrences::const_iterator::index() const {
+    return _index;
+}
+
 RecurrentTransaction::RecurrentTransaction(TransactionPtr t, RecurrencePtr r)
     : transaction(t),
       recurrence(r) {
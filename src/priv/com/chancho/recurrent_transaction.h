@@ -22,10 +22,13 @@
 
 #pragma once
 
+#include <iterator>
+
 #include <boost/optional.hpp>
 
 #include <QDate>
 #include <QMetaType>
+#include <QPair>
 
 #include "transaction.h"
 
@@ -50,6 +53,105 @@ class RecurrentTransaction {
            OTHER
         };
 
+        /*!
+            \class Occurrences
+
+            Lazy range over the occurrences of a recurrence. The range only stores the indexes of the first and last
+            occurrences, the dates are calculated while iterating so that no memory is allocated per occurrence. The
+            recurrence must outlive the range and its iterators.
+        */
+        class Occurrences {
+
+           friend class Recurrence;
+
+         public:
+            class const_iterator {
+
+               friend class Occurrences;
+
+             public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef QDate value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const QDate* pointer;
+                typedef const QDate& reference;
+
+                const_iterator() = default;
+
+                const QDate& operator*() const;
+                const QDate* operator->() const;
+                const_iterator& operator++();
+                const_iterator operator++(int);
+                bool operator==(const const_iterator& other) const;
+                bool operator!=(const const_iterator& other) const;
+
+                /*!
+                    \fn int index() const;
+
+                    Returns the index of the current occurrence, the start date is the occurrence 0.
+                */
+                int index() const;
+
+             private:
+                const_iterator(const Recurrence* recurrence, int index, int last);
+
+                const Recurrence* _recurrence = nullptr;
+                int _index = 0;
+                int _last = -1;
+                QDate _date;
+            };
+
+            Occurrences() = default;
+
+            const_iterator begin() const;
+            const_iterator end() const;
+
+            bool isEmpty() const;
+
+            /*!
+                \fn int size() const;
+
+                Returns the number of occurrences in the range. Ranges without a limit return the largest int.
+            */
+            int size() const;
+
+            /*!
+                \fn Occurrences take(int n) const;
+
+                Returns a range with at most the first \a n occurrences of this one.
+            */
+            Occurrences take(int n) const;
+
+            /*!
+                \fn Occurrences until(QDate date) const;
+
+                Returns a range with the occurrences of this one that happen before or in the given \a date. The range is
+                empty when the date is not valid.
+            */
+            Occurrences until(QDate date) const;
+
+            /*!
+                \fn Occurrences after(QDate date) const;
+
+                Returns a range with the occurrences of this one that happen after the given \a date.
+            */
+            Occurrences after(QDate date) const;
+
+            /*!
+                \fn Occurrences from(int index) const;
+
+                Returns a range with the occurrences of this one whose index is \a index or larger.
+            */
+            Occurrences from(int index) const;
+
+         private:
+            Occurrences(const Recurrence* recurrence, int first, int last);
+
+            const Recurrence* _recurrence = nullptr;
+            int _first = 1;
+            int _last = 0;
+        };
+
         Recurrence() = default;
         Recurrence(int n, QDate s, QDate e=QDate());
         Recurrence(int n, QDate s, boost::optional<int> o);
@@ -65,11 +167,68 @@ class RecurrentTransaction {
         virtual boost::optional<int> numberOfDays() const;
         virtual boost::optional<Recurrence::Defaults> defaults() const;
 
+        /*!
+            \fn virtual QDate occurrence(int n) const;
+
+            Returns the date of the \a n occurrence, the start date is the occurrence 0. The date is calculated
+            without iterating, monthly recurrences add the months to the start date so that the day of the month is
+            kept whenever the month has it.
+        */
+        virtual QDate occurrence(int n) const;
+
+        /*!
+            \fn virtual int occurrencesUntil(QDate date) const;
+
+            Returns the number of occurrences after the start date that happen before or in the given \a date. Limits
+            set by the end date or the number of occurrences are not taken into account.
+        */
+        virtual int occurrencesUntil(QDate date) const;
+
+        /*!
+            \fn virtual int generatedOccurrences() const;
+
+            Returns the index of the last generated occurrence, 0 when only the start date is in the book. Monthly
+            dates generated by older versions that drifted to an earlier day of the month are identified by their
+            month.
+        */
+        virtual int generatedOccurrences() const;
+
+        /*!
+            \fn virtual QDate nextOccurrence(QDate date) const;
+
+            Returns the first occurrence that happens after the given \a date or an invalid date if the recurrence
+            ended before it.
+        */
+        virtual QDate nextOccurrence(QDate date) const;
+
+        /*!
+            \fn virtual QDate nextDue() const;
+
+            Returns the first occurrence that has not been generated yet or an invalid date if the recurrence has no
+            more occurrences.
+        */
+        virtual QDate nextDue() const;
+
+        /*!
+            \fn Occurrences dates() const;
+
+            Returns a lazy range with all the occurrences of the recurrence, starting with the start date and
+            honouring the end date and the number of occurrences.
+        */
+        Occurrences dates() const;
+
      protected:
         virtual int ocurrencesPassed();
+        // indexes of the first and last occurrences that have to be generated, empty when first > last
+        virtual QPair<int, int> missingOccurrences();
         virtual QList<QDate> generateMissingDates();
+        // lazy range with the occurrences that have to be generated
+        Occurrences missingDates();
 
      private:
+        // period of the recurrence when it can be expressed in days
+        boost::optional<int> periodInDays() const;
+
         boost::optional<int> _numberOfDays = boost::none;
         boost::optional<Recurrence::Defaults> _defaults = boost::none;
     };
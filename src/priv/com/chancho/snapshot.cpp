@@ -0,0 +1,517 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <glog/logging.h>
+
+#include <QDataStream>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QtEndian>
+
+#include <com/chancho/system/database_factory.h>
+
+#include "book.h"
+#include "snapshot.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace {
+    const QString SNAPSHOT_NAME = "chancho.snapshot";
+
+    // the header of a sqlite database keeps the file change counter at byte 24 and the user version, used as the
+    // schema fingerprint, at byte 60, both as big endian integers
+    const int DB_HEADER_SIZE = 100;
+    const int DB_CHANGE_COUNTER_OFFSET = 24;
+    const int DB_USER_VERSION_OFFSET = 60;
+
+    const QString SELECT_SNAPSHOT_ACCOUNTS = "SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts "\
+        "ORDER BY name ASC";
+    const QString SELECT_SNAPSHOT_CATEGORIES = "SELECT uuid, parent, name, type, color FROM Categories "\
+        "ORDER BY name ASC";
+    const QString SELECT_SNAPSHOT_DAYS = "SELECT DISTINCT day FROM Transactions "\
+        "WHERE year=:year AND month=:month ORDER BY day DESC";
+    const QString SELECT_SNAPSHOT_DAY_TOTALS = "SELECT t.day, c.type, SSUM(t.amount) FROM Transactions AS t "\
+        "INNER JOIN Categories AS c ON t.category = c.uuid WHERE t.month=:month AND t.year=:year "\
+        "GROUP BY t.day, c.type";
+
+    template<typename T>
+    QList<T> page(const QList<T>& list, boost::optional<int> limit, boost::optional<int> offset) {
+        // same semantics as LIMIT and OFFSET, the offset is ignored without a limit
+        if (!limit) {
+            return list;
+        }
+        auto start = (offset) ? *offset : 0;
+        return list.mid(start, (*limit < 0) ? -1 : *limit);
+    }
+}
+
+class SnapshotLock {
+ public:
+
+    explicit SnapshotLock(Snapshot* snapshot)
+            : _snapshot(snapshot) {
+        _snapshot->_dbMutex.lock();
+        // the connection of a loaded snapshot is kept open to check if it is current
+        _opened = _snapshot->_db->isOpen() || _snapshot->_db->open();
+    }
+
+    ~SnapshotLock() {
+        if (_opened && !_snapshot->_loaded) {
+            _snapshot->_db->close();
+        }
+        _snapshot->_dbMutex.unlock();
+    }
+
+    bool opened() const {
+        return _opened;
+    }
+
+    SnapshotLock(const SnapshotLock&) = delete;
+    SnapshotLock& operator=(const SnapshotLock&) = delete;
+
+ private:
+    bool _opened = false;
+    Snapshot* _snapshot;
+};
+
+Snapshot::Snapshot() {
+    auto dbPath = Book::databasePath();
+    _db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "SNAPSHOT");
+    _db->setDatabaseName(dbPath);
+}
+
+Snapshot::~Snapshot() {
+    if (_db->isOpen()) {
+        _db->close();
+    }
+}
+
+QString
+Snapshot::snapshotPath() {
+    QFileInfo info(Book::databasePath());
+    return info.dir().absoluteFilePath(SNAPSHOT_NAME);
+}
+
+bool
+Snapshot::dataVersion(system::DatabasePtr db, quint32& counter, qint32& fingerprint) {
+    char header[DB_HEADER_SIZE];
+    if (!db->readHeader(header, DB_HEADER_SIZE)) {
+        return false;
+    }
+    counter = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(header + DB_CHANGE_COUNTER_OFFSET));
+    fingerprint = qFromBigEndian<qint32>(reinterpret_cast<const uchar*>(header + DB_USER_VERSION_OFFSET));
+    return true;
+}
+
+bool
+Snapshot::write() {
+    auto today = QDate::currentDate();
+    QList<AccountRecord> accounts;
+    QList<CategoryRecord> categories;
+    QList<DaySummary> days;
+    quint32 counter = 0;
+    qint32 fingerprint = 0;
+
+    {
+        SnapshotLock dbLock(this);
+
+        if (!dbLock.opened()) {
+            _lastError = _db->lastError().text();
+            LOG(ERROR) << _lastError.toStdString();
+            return false;
+        }
+
+        // the read transaction keeps the writers out until the header has been read, therefore the change counter
+        // that is stored is the one of the data in the snapshot
+        _db->transaction();
+        auto query = _db->createQuery();
+        query->setForwardOnly(true);
+
+        // SELECT_SNAPSHOT_ACCOUNTS = SELECT uuid, name, memo, color, initialAmount, amount FROM Accounts
+        //     ORDER BY name ASC
+        auto success = query->exec(SELECT_SNAPSHOT_ACCOUNTS);
+        while (success && query->next()) {
+            AccountRecord acc;
+            acc.uuid = QUuid(query->value(0).toString());
+            acc.name = query->value(1).toString();
+            acc.memo = query->value(2).toString();
+            acc.color = query->value(3).toString();
+            acc.initialAmount = query->value(4).toString().toDouble();
+            acc.amount = query->value(5).toString().toDouble();
+            accounts.append(acc);
+        }
+
+        // SELECT_SNAPSHOT_CATEGORIES = SELECT uuid, parent, name, type, color FROM Categories ORDER BY name ASC
+        success = success && query->exec(SELECT_SNAPSHOT_CATEGORIES);
+        while (success && query->next()) {
+            CategoryRecord cat;
+            cat.uuid = QUuid(query->value(0).toString());
+            if (!query->value(1).isNull()) {
+                cat.parent = QUuid(query->value(1).toString());
+            }
+            cat.name = query->value(2).toString();
+            cat.type = query->value(3).toInt();
+            cat.color = query->value(4).toString();
+            categories.append(cat);
+        }
+
+        // SELECT_SNAPSHOT_DAYS = SELECT DISTINCT day FROM Transactions WHERE year=:year AND month=:month
+        //     ORDER BY day DESC
+        if (success) {
+            query->prepare(SELECT_SNAPSHOT_DAYS);
+            query->bindValue(":year", today.year());
+            query->bindValue(":month", today.month());
+            success = query->exec();
+        }
+        QMap<int, int> dayIndexes;
+        while (success && query->next()) {
+            DaySummary summary;
+            summary.day = query->value(0).toInt();
+            dayIndexes[summary.day] = days.count();
+            days.append(summary);
+        }
+
+        // SELECT_SNAPSHOT_DAY_TOTALS = SELECT t.day, c.type, SSUM(t.amount) FROM Transactions AS t
+        //     INNER JOIN Categories AS c ON t.category = c.uuid WHERE t.month=:month AND t.year=:year
+        //     GROUP BY t.day, c.type
+        // SSUM is a custom function and returns a STRING.
+        if (success) {
+            query->prepare(SELECT_SNAPSHOT_DAY_TOTALS);
+            query->bindValue(":year", today.year());
+            query->bindValue(":month", today.month());
+            success = query->exec();
+        }
+        while (success && query->next()) {
+            auto day = query->value(0).toInt();
+            if (!dayIndexes.contains(day)) {
+                continue;
+            }
+            auto type = static_cast<Category::Type>(query->value(1).toInt());
+            auto amount = query->value(2).toString().toDouble();
+            if (type == Category::Type::INCOME) {
+                days[dayIndexes[day]].income = amount;
+            } else {
+                days[dayIndexes[day]].expense = amount;
+            }
+        }
+
+        if (success) {
+            success = dataVersion(_db, counter, fingerprint);
+        }
+        auto error = _db->lastError().text();
+        _db->commit();
+
+        if (!success) {
+            _lastError = error.isEmpty() ? "Could not read the version of the database." : error;
+            LOG(INFO) << "Error reading the snapshot data " << _lastError.toStdString();
+            return false;
+        }
+    }
+
+    // the file is replaced atomically so that a snapshot is never read half written
+    QSaveFile file(snapshotPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not write the snapshot " << _lastError.toStdString();
+        return false;
+    }
+
+    // strings are written as utf8 to keep the file small
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << SNAPSHOT_MAGIC << SNAPSHOT_FORMAT << counter << fingerprint
+        << static_cast<qint32>(today.year()) << static_cast<qint32>(today.month());
+
+    stream << static_cast<quint32>(accounts.count());
+    foreach(const AccountRecord& acc, accounts) {
+        stream << acc.uuid << acc.name.toUtf8() << acc.memo.toUtf8() << acc.color.toUtf8() << acc.initialAmount
+            << acc.amount;
+    }
+
+    stream << static_cast<quint32>(categories.count());
+    foreach(const CategoryRecord& cat, categories) {
+        stream << cat.uuid << cat.parent << cat.name.toUtf8() << static_cast<qint32>(cat.type)
+            << cat.color.toUtf8();
+    }
+
+    stream << static_cast<quint32>(days.count());
+    foreach(const DaySummary& summary, days) {
+        stream << static_cast<qint32>(summary.day) << summary.income << summary.expense;
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not write the snapshot " << _lastError.toStdString();
+        return false;
+    }
+
+    _lastError = QString::null;
+    return true;
+}
+
+bool
+Snapshot::parse(const QByteArray& data) {
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 format = 0;
+    qint32 year = 0;
+    qint32 month = 0;
+    stream >> magic >> format;
+    if (magic != SNAPSHOT_MAGIC || format != SNAPSHOT_FORMAT) {
+        _lastError = "The snapshot was written with a different format.";
+        return false;
+    }
+    stream >> _counter >> _fingerprint >> year >> month;
+    _year = year;
+    _month = month;
+
+    QByteArray name, memo, color;
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++) {
+        AccountRecord acc;
+        stream >> acc.uuid >> name >> memo >> color >> acc.initialAmount >> acc.amount;
+        acc.name = QString::fromUtf8(name);
+        acc.memo = QString::fromUtf8(memo);
+        acc.color = QString::fromUtf8(color);
+        _accounts.append(acc);
+    }
+
+    stream >> count;
+    for (quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++) {
+        CategoryRecord cat;
+        qint32 type = 0;
+        stream >> cat.uuid >> cat.parent >> name >> type >> color;
+        cat.name = QString::fromUtf8(name);
+        cat.type = type;
+        cat.color = QString::fromUtf8(color);
+        _categories.append(cat);
+    }
+
+    stream >> count;
+    for (quint32 index = 0; index < count && stream.status() == QDataStream::Ok; index++) {
+        DaySummary summary;
+        qint32 day = 0;
+        stream >> day >> summary.income >> summary.expense;
+        summary.day = day;
+        _days.append(summary);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        _lastError = "The snapshot is truncated.";
+        return false;
+    }
+    return true;
+}
+
+bool
+Snapshot::load() {
+    _loaded = false;
+    _accounts.clear();
+    _categories.clear();
+    _days.clear();
+
+    QFile file(snapshotPath());
+    if (!file.exists()) {
+        _lastError = "There is no snapshot.";
+        return false;
+    }
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not open the snapshot " << _lastError.toStdString();
+        return false;
+    }
+
+    // the records are parsed straight from the mapped pages, the file is small and read once
+    auto size = file.size();
+    auto mapped = file.map(0, size);
+    if (mapped == nullptr) {
+        _lastError = file.errorString();
+        LOG(ERROR) << "Could not map the snapshot " << _lastError.toStdString();
+        return false;
+    }
+    auto parsed = parse(QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(size)));
+    file.unmap(mapped);
+
+    if (!parsed) {
+        LOG(INFO) << "Snapshot not used: " << _lastError.toStdString();
+        _accounts.clear();
+        _categories.clear();
+        _days.clear();
+        return false;
+    }
+
+    _loaded = true;
+    if (!isCurrent()) {
+        std::lock_guard<std::mutex> lock(_dbMutex);
+        _loaded = false;
+        _db->close();
+        _lastError = (_lastError.isNull()) ? "The database changed after the snapshot was written." : _lastError;
+        LOG(INFO) << "Snapshot not used: " << _lastError.toStdString();
+        return false;
+    }
+
+    _lastError = QString::null;
+    return true;
+}
+
+bool
+Snapshot::isLoaded() {
+    return _loaded;
+}
+
+bool
+Snapshot::isCurrent() {
+    if (!_loaded) {
+        return false;
+    }
+
+    SnapshotLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return false;
+    }
+
+    // the change counter is increased by sqlite every time a transaction that changed the database is committed
+    quint32 counter = 0;
+    qint32 fingerprint = 0;
+    if (!dataVersion(_db, counter, fingerprint)) {
+        return false;
+    }
+    return counter == _counter && fingerprint == _fingerprint;
+}
+
+bool
+Snapshot::covers(int month, int year) {
+    return _loaded && month == _month && year == _year;
+}
+
+QList<AccountPtr>
+Snapshot::accounts(boost::optional<int> limit, boost::optional<int> offset) {
+    QList<AccountPtr> accs;
+    foreach(const AccountRecord& record, page(_accounts, limit, offset)) {
+        auto acc = std::make_shared<Account>(record.name, record.amount, record.memo, record.color);
+        acc->initialAmount = record.initialAmount;
+        acc->_dbId = record.uuid;
+        accs.append(acc);
+    }
+    return accs;
+}
+
+int
+Snapshot::numberOfAccounts() {
+    return _accounts.count();
+}
+
+QList<CategoryPtr>
+Snapshot::categories(boost::optional<Category::Type> type, boost::optional<int> limit,
+        boost::optional<int> offset) {
+    QList<CategoryRecord> records;
+    foreach(const CategoryRecord& record, _categories) {
+        if (!type || record.type == static_cast<int>(*type)) {
+            records.append(record);
+        }
+    }
+
+    // as with the queries of the book, just the parents present in the page are set
+    QList<CategoryPtr> cats;
+    QMap<QUuid, CategoryPtr> catsMap;
+    foreach(const CategoryRecord& record, page(records, limit, offset)) {
+        auto cat = std::make_shared<Category>(record.name, static_cast<Category::Type>(record.type), record.color);
+        cat->_dbId = record.uuid;
+        catsMap[cat->_dbId] = cat;
+        cats.append(cat);
+    }
+    foreach(const CategoryRecord& record, _categories) {
+        if (!record.parent.isNull() && catsMap.contains(record.uuid) && catsMap.contains(record.parent)) {
+            catsMap[record.uuid]->parent = catsMap[record.parent];
+        }
+    }
+    return cats;
+}
+
+int
+Snapshot::numberOfCategories(boost::optional<Category::Type> type) {
+    if (!type) {
+        return _categories.count();
+    }
+    int count = 0;
+    foreach(const CategoryRecord& record, _categories) {
+        if (record.type == static_cast<int>(*type)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+QList<int>
+Snapshot::days(boost::optional<int> limit, boost::optional<int> offset) {
+    QList<int> result;
+    foreach(const DaySummary& summary, page(_days, limit, offset)) {
+        result.append(summary.day);
+    }
+    return result;
+}
+
+int
+Snapshot::numberOfDays() {
+    return _days.count();
+}
+
+Snapshot::DaySummary
+Snapshot::day(int day) {
+    foreach(const DaySummary& summary, _days) {
+        if (summary.day == day) {
+            return summary;
+        }
+    }
+    DaySummary empty;
+    empty.day = day;
+    return empty;
+}
+
+bool
+Snapshot::isError() {
+    return !_lastError.isNull();
+}
+
+QString
+Snapshot::lastError() {
+    return _lastError;
+}
+
+}
+
+}
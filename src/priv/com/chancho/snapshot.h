@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QUuid>
+
+#include <boost/optional.hpp>
+
+#include <com/chancho/system/database.h>
+
+#include "account.h"
+#include "category.h"
+
+namespace com {
+
+namespace chancho {
+
+class SnapshotLock;
+
+/*!
+   \class Snapshot
+   \brief The Snapshot class keeps in a small binary file the data the application shows when it starts.
+
+   The accounts, the categories and the income and expense of the days of the current month are written to a file
+   next to the database. At start up the file is memory mapped and parsed without opening a connection, the snapshot
+   is only used while the database has not changed since it was written, which is known by comparing the change
+   counter and the schema fingerprint stored in the header of the database with the ones kept in the file.
+   \since 0.2
+*/
+class Snapshot {
+    friend class SnapshotLock;
+
+ public:
+    struct DaySummary {
+        int day = 0;
+        double income = 0;
+        double expense = 0;
+    };
+
+    // identifies the snapshot files and the layout of their records
+    static const quint32 SNAPSHOT_MAGIC = 0x43484e53;
+    static const quint32 SNAPSHOT_FORMAT = 1;
+
+    /*!
+        \fn Snapshot();
+
+        Creates an empty snapshot that uses its own connection to write the file so that the one used by the book is
+        not held.
+    */
+    Snapshot();
+    virtual ~Snapshot();
+
+    /*!
+        \fn virtual bool write();
+
+        Reads the accounts, the categories and the days of the current month in a single read transaction and
+        replaces the snapshot file. Returns false if the data could not be read or the file could not be written.
+    */
+    virtual bool write();
+
+    /*!
+        \fn virtual bool load();
+
+        Memory maps the snapshot file and parses it. Returns false if there is no file, it was written by a different
+        format or the database changed after it was written.
+    */
+    virtual bool load();
+
+    /*!
+        \fn virtual bool isLoaded();
+
+        Returns if the snapshot was loaded.
+    */
+    virtual bool isLoaded();
+
+    /*!
+        \fn virtual bool isCurrent();
+
+        Returns if the snapshot was loaded and the database has not changed since it was written. The header of the
+        database is read in every call, no connection is opened.
+    */
+    virtual bool isCurrent();
+
+    /*!
+        \fn virtual bool covers(int month, int year);
+
+        Returns if the days of the given \a month and \a year are in the snapshot.
+    */
+    virtual bool covers(int month, int year);
+
+    /*!
+        \fn virtual QList<AccountPtr> accounts(boost::optional<int> limit=boost::optional<int>(),
+                boost::optional<int> offset=boost::optional<int>());
+
+        Returns the accounts ordered by name as the book does. New objects are returned in every call.
+    */
+    virtual QList<AccountPtr> accounts(boost::optional<int> limit=boost::optional<int>(),
+            boost::optional<int> offset=boost::optional<int>());
+
+    /*!
+        \fn virtual int numberOfAccounts();
+
+        Returns the number of accounts in the snapshot.
+    */
+    virtual int numberOfAccounts();
+
+    /*!
+        \fn virtual QList<CategoryPtr> categories(boost::optional<Category::Type> type=boost::optional<Category::Type>(),
+                boost::optional<int> limit=boost::optional<int>(), boost::optional<int> offset=boost::optional<int>());
+
+        Returns the categories ordered by name as the book does, the parents are set when they are in the same page.
+        New objects are returned in every call.
+    */
+    virtual QList<CategoryPtr> categories(boost::optional<Category::Type> type=boost::optional<Category::Type>(),
+            boost::optional<int> limit=boost::optional<int>(), boost::optional<int> offset=boost::optional<int>());
+
+    /*!
+        \fn virtual int numberOfCategories(boost::optional<Category::Type> type=boost::optional<Category::Type>());
+
+        Returns the number of categories of the given \a type, or all of them.
+    */
+    virtual int numberOfCategories(boost::optional<Category::Type> type=boost::optional<Category::Type>());
+
+    /*!
+        \fn virtual QList<int> days(boost::optional<int> limit=boost::optional<int>(),
+                boost::optional<int> offset=boost::optional<int>());
+
+        Returns the days of the month of the snapshot that have transactions, the latest first.
+    */
+    virtual QList<int> days(boost::optional<int> limit=boost::optional<int>(),
+            boost::optional<int> offset=boost::optional<int>());
+
+    /*!
+        \fn virtual int numberOfDays();
+
+        Returns the number of days of the month of the snapshot that have transactions.
+    */
+    virtual int numberOfDays();
+
+    /*!
+        \fn virtual DaySummary day(int day);
+
+        Returns the income and expense of the given \a day of the month of the snapshot.
+    */
+    virtual DaySummary day(int day);
+
+    /*!
+        \fn virtual bool isError();
+
+        Returns if there was an error writing or loading the snapshot.
+    */
+    virtual bool isError();
+
+    /*!
+        \fn virtual QString lastError();
+
+        Returns the last error that happened writing or loading the snapshot.
+    */
+    virtual QString lastError();
+
+    /*!
+        \fn static QString snapshotPath();
+
+        Returns the path of the snapshot file, it is kept next to the database.
+    */
+    static QString snapshotPath();
+
+ private:
+    struct AccountRecord {
+        QUuid uuid;
+        QString name;
+        QString memo;
+        QString color;
+        double initialAmount = 0;
+        double amount = 0;
+    };
+
+    struct CategoryRecord {
+        QUuid uuid;
+        QUuid parent;
+        QString name;
+        int type = 0;
+        QString color;
+    };
+
+    static bool dataVersion(system::DatabasePtr db, quint32& counter, qint32& fingerprint);
+    bool parse(const QByteArray& data);
+
+ private:
+    std::shared_ptr<system::Database> _db;
+    std::mutex _dbMutex;
+
+    bool _loaded = false;
+    quint32 _counter = 0;
+    qint32 _fingerprint = 0;
+    int _month = 0;
+    int _year = 0;
+    QList<AccountRecord> _accounts;
+    QList<CategoryRecord> _categories;
+    QList<DaySummary> _days;  // ordered by day, the latest first
+
+    QString _lastError = QString::null;
+};
+
+typedef std::shared_ptr<Snapshot> SnapshotPtr;
+
+}
+
+}
@@ -20,8 +20,15 @@
  * THE SOFTWARE.
  */
 
+#include <cmath>
+#include <queue>
+#include <vector>
+
 #include <glog/logging.h>
 
+#include <QMap>
+#include <QStringList>
+
 #include <com/chancho/system/database_lock.h>
 #include <com/chancho/system/database_factory.h>
 
@@ -29,13 +36,100 @@
 #include "stats.h"
 
 namespace {
-    const QString SELECT_ACCOUNT_MONTHS_FOR_YEAR = "SELECT month, month_amount FROM AccountsMonthTotal "\
-        "WHERE account=:account AND year=:year ORDER BY month ASC";
+    // the totals are computed from the transactions so that the archived years are read
+    const QString SELECT_ACCOUNT_MONTHS_FOR_YEAR = "SELECT month, SSUM(amount) FROM AllTransactions "\
+        "WHERE account=:account AND year=:year GROUP BY month ORDER BY month ASC";
     const QString SELECT_OCURRENCES_FOR_MONTH = "SELECT c.uuid AS uuid, c.name AS name, c.type AS type, "\
-        "c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM Transactions AS t INNER JOIN Categories AS c WHERE "\
+        "c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c WHERE "\
         "t.category=c.uuid AND t.year=:year AND t.month=:month GROUP BY t.category";
-    const QString SELECT_OCURRENCES_FOR_CATEGORY = "SELECT month, sum(amount) FROM Transactions "\
+    const QString SELECT_OCURRENCES_FOR_CATEGORY = "SELECT month, sum(amount) FROM AllTransactions "\
         "WHERE year=:year AND category=:category GROUP BY category, month ORDER BY month ASC";
+    const QString SELECT_OCURRENCES_FOR_CATEGORY_TREE = "SELECT t.month, SSUM(t.amount) FROM CategoryClosure AS cc "\
+        "INNER JOIN AllTransactions AS t ON t.category=cc.descendant WHERE cc.ancestor=:category AND t.year=:year "\
+        "GROUP BY t.month ORDER BY t.month ASC";
+    const QString SELECT_OCURRENCES_FOR_MONTH_TREE = "SELECT c.uuid AS uuid, c.name AS name, c.type AS type, "\
+        "c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM AllTransactions AS t "\
+        "INNER JOIN CategoryClosure AS cc ON cc.descendant=t.category INNER JOIN Categories AS c ON c.uuid=cc.ancestor "\
+        "WHERE c.parent IS NULL AND t.year=:year AND t.month=:month GROUP BY c.uuid";
+    const QString SELECT_AMOUNTS_TYPE_YEAR = "SELECT t.uuid, t.amount FROM AllTransactions AS t "\
+        "INNER JOIN Categories AS c ON t.category=c.uuid WHERE c.type=:type AND t.year=:year";
+    const QString SELECT_AMOUNTS_TYPE_MONTH = "SELECT t.uuid, t.amount FROM AllTransactions AS t "\
+        "INNER JOIN Categories AS c ON t.category=c.uuid WHERE c.type=:type AND t.year=:year AND t.month=:month";
+    const QString SELECT_TRANSACTIONS_UUIDS = "SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month, "\
+        "t.year, t.contents, t.memo, t.is_recurrent, c.name, c.type, c.color, a.name, a.memo, a.amount "\
+        "FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid "\
+        "INNER JOIN Accounts AS a ON t.account=a.uuid WHERE t.uuid IN (%1)";
+    const QString SELECT_CATEGORY_TOTALS_TYPE_YEAR = "SELECT c.uuid, c.name, c.type, c.color, COUNT(*), "\
+        "SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid "\
+        "WHERE c.type=:type AND t.year=:year GROUP BY t.category";
+    const QString SELECT_CATEGORY_TOTALS_TYPE_MONTH = "SELECT c.uuid, c.name, c.type, c.color, COUNT(*), "\
+        "SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid "\
+        "WHERE c.type=:type AND t.year=:year AND t.month=:month GROUP BY t.category";
+    const QString SELECT_CONTENTS_TOTALS_TYPE_YEAR = "SELECT t.contents, COUNT(*), SSUM(t.amount) "\
+        "FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid "\
+        "WHERE c.type=:type AND t.year=:year AND t.contents IS NOT NULL AND t.contents != '' GROUP BY t.contents";
+    const QString SELECT_CONTENTS_TOTALS_TYPE_MONTH = "SELECT t.contents, COUNT(*), SSUM(t.amount) "\
+        "FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid "\
+        "WHERE c.type=:type AND t.year=:year AND t.month=:month AND t.contents IS NOT NULL AND t.contents != '' "\
+        "GROUP BY t.contents";
+
+    // keeps the values with the largest keys seen so far without storing more than size of them
+    template<typename T>
+    class BoundedHeap {
+     public:
+        explicit BoundedHeap(int size)
+            : _size(size) {
+        }
+
+        void push(double key, const T& value) {
+            if (_size <= 0) {
+                return;
+            }
+            if (static_cast<int>(_heap.size()) < _size) {
+                _heap.push(Entry(key, value));
+            } else if (_heap.top().first < key) {
+                _heap.pop();
+                _heap.push(Entry(key, value));
+            }
+        }
+
+        // returns the values from the largest key to the smallest one, the heap is emptied
+        QList<T> take() {
+            QList<T> result;
+            while (!_heap.empty()) {
+                result.prepend(_heap.top().second);
+                _heap.pop();
+            }
+            return result;
+        }
+
+     private:
+        typedef std::pair<double, T> Entry;
+
+        struct Compare {
+            bool operator()(const Entry& left, const Entry& right) const {
+                return left.first > right.first;
+            }
+        };
+
+        int _size;
+        std::priority_queue<Entry, std::vector<Entry>, Compare> _heap;
+    };
+    const QString SELECT_BUDGETS_FOR_MONTH = "SELECT c.uuid, c.name, c.type, c.color, b.amount, m.amount "\
+        "FROM Budgets AS b INNER JOIN Categories AS c ON c.uuid=b.category "\
+        "LEFT JOIN CategoryMonthTotals AS m ON m.category=b.category AND m.year=:year AND m.month=:month "\
+        "ORDER BY c.name ASC";
+    const QString SELECT_BALANCE_FOR_DATE = "SELECT SubtractStringNumbers(SubtractStringNumbers(a.amount, "\
+        "(SELECT SSUM(c.amount) FROM AccountBalanceCheckpoints AS c WHERE c.account=a.uuid AND "\
+        "(c.year > :checkpointYear OR (c.year = :checkpointYear2 AND c.month > :checkpointMonth)))), "\
+        "(SELECT SSUM(t.amount) FROM AllTransactions AS t WHERE t.account=a.uuid AND t.year=:year AND t.month=:month "\
+        "AND t.day > :day)) FROM Accounts AS a WHERE a.uuid=:account";
+    // the range is on the columns of the month index, the day only matters in the first and last months
+    const QString SELECT_DAILY_AMOUNTS = "SELECT year, month, day, SSUM(amount) FROM AllTransactions "\
+        "WHERE account=:account AND year >= :fromYear AND year <= :toYear "\
+        "AND (year > :fromEdgeYear OR month > :fromMonth OR (month = :fromEdgeMonth AND day >= :fromDay)) "\
+        "AND (year < :toEdgeYear OR month < :toMonth OR (month = :toEdgeMonth AND day <= :toDay)) "\
+        "GROUP BY year, month, day ORDER BY year, month, day ASC";
 }
 
 namespace com {
@@ -49,6 +143,11 @@ class StatsLock {
             : _stats(stats) {
         _stats->_dbMutex.lock();
         _opened = _stats->_db->open();
+        // the archived years are read through the view created when they are attached
+        if (_opened && !Book::attachArchives(_stats->_db)) {
+            _stats->_db->close();
+            _opened = false;
+        }
     }
 
     ~StatsLock() {
@@ -100,8 +199,8 @@ Stats::monthsTotalForAccount(AccountPtr acc, int year) {
 
     auto query = _db->createQuery();
 
-    // SELECT_ACCOUNT_MONTHS_FOR_YEAR = SELECT month, month_amount FROM AccountsMonthTotal
-    //     WHERE account=:account ORDER BY month ASC;
+    // SELECT_ACCOUNT_MONTHS_FOR_YEAR = SELECT month, SSUM(amount) FROM AllTransactions
+    //     WHERE account=:account AND year=:year GROUP BY month ORDER BY month ASC
     query->prepare(SELECT_ACCOUNT_MONTHS_FOR_YEAR);
     DLOG(INFO) << "Query is " << SELECT_ACCOUNT_MONTHS_FOR_YEAR.toStdString();
     query->bindValue(":account", acc->_dbId);
@@ -161,7 +260,7 @@ Stats::categoryPercentages(int month, int year) {
     auto query = _db->createQuery();
 
     // SELECT_OCURRENCES_FOR_MONTH = SELECT c.uuid AS uuid, c.name AS name, c.type AS type,
-    //     c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM Transactions AS t INNER JOIN Categories AS c WHERE
+    //     c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c WHERE
     //     t.category=c.uuid AND t.year=:year AND t.month=:month GROUP BY t.category
     query->prepare(SELECT_OCURRENCES_FOR_MONTH);
     query->bindValue(":month", month);
@@ -214,7 +313,7 @@ Stats::monthsTotalForCategory(CategoryPtr cat, int year) {
 
     auto query = _db->createQuery();
 
-    // SELECT_OCURRENCES_FOR_CATEGORY = SELECT month, sum(amount) FROM Transactions
+    // SELECT_OCURRENCES_FOR_CATEGORY = SELECT month, sum(amount) FROM AllTransactions
     //    WHERE year=:year AND category=:category GROUP BY category, month ORDER BY month ASC"
     query->prepare(SELECT_OCURRENCES_FOR_CATEGORY);
     query->bindValue(":category", cat->_dbId);
@@ -261,6 +360,504 @@ Stats::monthsTotalForCategory(CategoryPtr cat, int year) {
     return result;
 }
 
+QList<double>
+Stats::monthsTotalForCategoryTree(CategoryPtr cat, int year) {
+    QList<double> result;
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+
+    // SELECT_OCURRENCES_FOR_CATEGORY_TREE = SELECT t.month, SSUM(t.amount) FROM CategoryClosure AS cc
+    //     INNER JOIN AllTransactions AS t ON t.category=cc.descendant WHERE cc.ancestor=:category AND t.year=:year
+    //     GROUP BY t.month ORDER BY t.month ASC
+    query->prepare(SELECT_OCURRENCES_FOR_CATEGORY_TREE);
+    query->bindValue(":category", cat->_dbId.toString());
+    query->bindValue(":year", year);
+
+    auto sucess = query->exec();
+    if (!sucess) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => month
+    // index 1 => month_amount
+    auto index = 0;
+    while (query->next()) {
+        auto month = query->value(0).toInt();
+        auto currentAmount = query->value(1).toString().toDouble();
+        if (currentAmount < 0) {
+            currentAmount = -1 * currentAmount;
+        }
+        while(index != month -1) {
+            result.append(0.0);
+            index++;
+        }
+        result.append(currentAmount);
+        index = month;
+    }
+
+    while(result.count() < 12) {
+        result.append(0);
+    }
+
+    return result;
+}
+
+QPair<Stats::CategoryPercentageTotal, QList<Stats::CategoryPercentage>>
+Stats::categoryTreePercentages(int month, int year) {
+    CategoryPercentageTotal total {0, 0};
+    QList<CategoryPercentage> list;
+    QPair<CategoryPercentageTotal, QList<CategoryPercentage>> result(total, list);
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+
+    // SELECT_OCURRENCES_FOR_MONTH_TREE = SELECT c.uuid AS uuid, c.name AS name, c.type AS type,
+    //     c.color AS color, COUNT(*) AS occurrences, SSUM(t.amount) FROM AllTransactions AS t
+    //     INNER JOIN CategoryClosure AS cc ON cc.descendant=t.category INNER JOIN Categories AS c ON c.uuid=cc.ancestor
+    //     WHERE c.parent IS NULL AND t.year=:year AND t.month=:month GROUP BY c.uuid
+    query->prepare(SELECT_OCURRENCES_FOR_MONTH_TREE);
+    query->bindValue(":month", month);
+    query->bindValue(":year", year);
+
+    auto sucess = query->exec();
+    if (!sucess) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => uuid
+    // index 1 => name
+    // index 2 => type
+    // index 3 => color
+    // index 4 => occurrences
+    // index 5 => amount
+    while (query->next()) {
+        auto uuid = QUuid(query->value(0).toString());
+        auto name = query->value(1).toString();
+        auto type = static_cast<Category::Type>(query->value(2).toInt());
+        auto color = query->value(3).toString();
+        auto count = query->value(4).toInt();
+        auto amount = query->value(5).toString().toDouble();
+        auto cat = std::make_shared<Category>(name, type, color);
+        cat->_dbId = uuid;
+        CategoryPercentage percentage {cat, count, amount};
+        result.first.amount += amount;
+        result.second.append(percentage);
+    }
+
+    result.first.count = result.second.count();
+
+    return result;
+}
+
+QList<TransactionPtr>
+Stats::largestTransactions(Category::Type type, int count, int year, boost::optional<int> month) {
+    QList<TransactionPtr> result;
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+    // the cursor does not need to cache the visited rows
+    query->setForwardOnly(true);
+    if (month) {
+        // SELECT_AMOUNTS_TYPE_MONTH = SELECT t.uuid, t.amount FROM AllTransactions AS t
+        //     INNER JOIN Categories AS c ON t.category=c.uuid WHERE c.type=:type AND t.year=:year AND t.month=:month
+        query->prepare(SELECT_AMOUNTS_TYPE_MONTH);
+        query->bindValue(":month", month.get());
+    } else {
+        // SELECT_AMOUNTS_TYPE_YEAR = SELECT t.uuid, t.amount FROM AllTransactions AS t
+        //     INNER JOIN Categories AS c ON t.category=c.uuid WHERE c.type=:type AND t.year=:year
+        query->prepare(SELECT_AMOUNTS_TYPE_YEAR);
+    }
+    query->bindValue(":type", static_cast<int>(type));
+    query->bindValue(":year", year);
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => uuid
+    // index 1 => amount
+    BoundedHeap<QString> heap(count);
+    while (query->next()) {
+        heap.push(std::abs(query->value(1).toString().toDouble()), query->value(0).toString());
+    }
+
+    auto uuids = heap.take();
+    if (uuids.isEmpty()) {
+        return result;
+    }
+
+    // only the selected transactions are fully loaded
+    QStringList placeholders;
+    for (int index = 0; index < uuids.count(); index++) {
+        placeholders.append(QString(":uuid%1").arg(index));
+    }
+
+    auto transQuery = _db->createQuery();
+    // SELECT_TRANSACTIONS_UUIDS = SELECT t.uuid, t.amount, t.account, t.category, t.day, t.month,
+    //     t.year, t.contents, t.memo, t.is_recurrent, c.name, c.type, c.color, a.name, a.memo, a.amount
+    //     FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid
+    //     INNER JOIN Accounts AS a ON t.account=a.uuid WHERE t.uuid IN (%1)
+    transQuery->prepare(SELECT_TRANSACTIONS_UUIDS.arg(placeholders.join(", ")));
+    for (int index = 0; index < uuids.count(); index++) {
+        transQuery->bindValue(placeholders.at(index), uuids.at(index));
+    }
+
+    success = transQuery->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the transactions " << _lastError.toStdString();
+        return result;
+    }
+
+    QMap<QUuid, AccountPtr> accounts;
+    QMap<QUuid, CategoryPtr> categories;
+    QMap<QString, TransactionPtr> trans;
+    while (transQuery->next()) {
+        auto transUuid = transQuery->value(0).toString();
+        auto accUuid = QUuid(transQuery->value(2).toString());
+        auto catUuid = QUuid(transQuery->value(3).toString());
+
+        if (!categories.contains(catUuid)) {
+            auto category = std::make_shared<Category>(transQuery->value(10).toString(),
+                static_cast<Category::Type>(transQuery->value(11).toInt()), transQuery->value(12).toString());
+            category->_dbId = catUuid;
+            categories[catUuid] = category;
+        }
+
+        if (!accounts.contains(accUuid)) {
+            auto account = std::make_shared<Account>(transQuery->value(13).toString(),
+                transQuery->value(15).toString().toDouble(), transQuery->value(14).toString());
+            account->_dbId = accUuid;
+            accounts[accUuid] = account;
+        }
+
+        auto date = QDate(transQuery->value(6).toInt(), transQuery->value(5).toInt(), transQuery->value(4).toInt());
+        auto transaction = std::make_shared<Transaction>(accounts[accUuid], transQuery->value(1).toString().toDouble(),
+            categories[catUuid], date, transQuery->value(7).toString(), transQuery->value(8).toString());
+        transaction->_dbId = QUuid(transUuid);
+        transaction->is_recurrent = transQuery->value(9).toInt() != 0;
+        trans[transUuid] = transaction;
+    }
+
+    // keep the order of the heap
+    foreach(const QString& uuid, uuids) {
+        if (trans.contains(uuid)) {
+            result.append(trans[uuid]);
+        }
+    }
+    return result;
+}
+
+QList<Stats::CategoryPercentage>
+Stats::topCategories(Category::Type type, int count, int year, boost::optional<int> month) {
+    QList<CategoryPercentage> result;
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+    query->setForwardOnly(true);
+    if (month) {
+        // SELECT_CATEGORY_TOTALS_TYPE_MONTH = SELECT c.uuid, c.name, c.type, c.color, COUNT(*),
+        //     SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid
+        //     WHERE c.type=:type AND t.year=:year AND t.month=:month GROUP BY t.category
+        query->prepare(SELECT_CATEGORY_TOTALS_TYPE_MONTH);
+        query->bindValue(":month", month.get());
+    } else {
+        // SELECT_CATEGORY_TOTALS_TYPE_YEAR = SELECT c.uuid, c.name, c.type, c.color, COUNT(*),
+        //     SSUM(t.amount) FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid
+        //     WHERE c.type=:type AND t.year=:year GROUP BY t.category
+        query->prepare(SELECT_CATEGORY_TOTALS_TYPE_YEAR);
+    }
+    query->bindValue(":type", static_cast<int>(type));
+    query->bindValue(":year", year);
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => uuid
+    // index 1 => name
+    // index 2 => type
+    // index 3 => color
+    // index 4 => occurrences
+    // index 5 => amount
+    BoundedHeap<CategoryPercentage> heap(count);
+    while (query->next()) {
+        auto amount = query->value(5).toString().toDouble();
+        auto cat = std::make_shared<Category>(query->value(1).toString(),
+            static_cast<Category::Type>(query->value(2).toInt()), query->value(3).toString());
+        cat->_dbId = QUuid(query->value(0).toString());
+        CategoryPercentage percentage {cat, query->value(4).toInt(), amount};
+        heap.push(std::abs(amount), percentage);
+    }
+
+    result = heap.take();
+    return result;
+}
+
+QList<Stats::ContentsTotal>
+Stats::topContents(Category::Type type, int count, int year, boost::optional<int> month) {
+    QList<ContentsTotal> result;
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+    query->setForwardOnly(true);
+    if (month) {
+        // SELECT_CONTENTS_TOTALS_TYPE_MONTH = SELECT t.contents, COUNT(*), SSUM(t.amount)
+        //     FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid
+        //     WHERE c.type=:type AND t.year=:year AND t.month=:month AND t.contents IS NOT NULL AND t.contents != ''
+        //     GROUP BY t.contents
+        query->prepare(SELECT_CONTENTS_TOTALS_TYPE_MONTH);
+        query->bindValue(":month", month.get());
+    } else {
+        // SELECT_CONTENTS_TOTALS_TYPE_YEAR = SELECT t.contents, COUNT(*), SSUM(t.amount)
+        //     FROM AllTransactions AS t INNER JOIN Categories AS c ON t.category=c.uuid
+        //     WHERE c.type=:type AND t.year=:year AND t.contents IS NOT NULL AND t.contents != '' GROUP BY t.contents
+        query->prepare(SELECT_CONTENTS_TOTALS_TYPE_YEAR);
+    }
+    query->bindValue(":type", static_cast<int>(type));
+    query->bindValue(":year", year);
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => contents
+    // index 1 => occurrences
+    // index 2 => amount
+    BoundedHeap<ContentsTotal> heap(count);
+    while (query->next()) {
+        auto amount = query->value(2).toString().toDouble();
+        ContentsTotal total {query->value(0).toString(), query->value(1).toInt(), amount};
+        heap.push(std::abs(amount), total);
+    }
+
+    result = heap.take();
+    return result;
+}
+
+QList<Stats::BudgetStatus>
+Stats::budgets(int month, int year) {
+    QList<BudgetStatus> result;
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    auto query = _db->createQuery();
+
+    // SELECT_BUDGETS_FOR_MONTH = SELECT c.uuid, c.name, c.type, c.color, b.amount, m.amount
+    //     FROM Budgets AS b INNER JOIN Categories AS c ON c.uuid=b.category
+    //     LEFT JOIN CategoryMonthTotals AS m ON m.category=b.category AND m.year=:year AND m.month=:month
+    //     ORDER BY c.name ASC
+    query->prepare(SELECT_BUDGETS_FOR_MONTH);
+    query->bindValue(":month", month);
+    query->bindValue(":year", year);
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the budgets " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => uuid
+    // index 1 => name
+    // index 2 => type
+    // index 3 => color
+    // index 4 => budget
+    // index 5 => month amount, null if there are no transactions
+    while (query->next()) {
+        auto cat = std::make_shared<Category>(query->value(1).toString(),
+            static_cast<Category::Type>(query->value(2).toInt()), query->value(3).toString());
+        cat->_dbId = QUuid(query->value(0).toString());
+        auto budget = query->value(4).toString().toDouble();
+        auto spent = (query->isNull(5))?0:std::abs(query->value(5).toString().toDouble());
+        BudgetStatus status {cat, budget, spent, budget - spent};
+        result.append(status);
+    }
+    return result;
+}
+
+bool
+Stats::balanceAt(AccountPtr acc, QDate date, double& balance) {
+    auto query = _db->createQuery();
+
+    // SELECT_BALANCE_FOR_DATE = SELECT SubtractStringNumbers(SubtractStringNumbers(a.amount,
+    //     (SELECT SSUM(c.amount) FROM AccountBalanceCheckpoints AS c WHERE c.account=a.uuid AND
+    //     (c.year > :checkpointYear OR (c.year = :checkpointYear2 AND c.month > :checkpointMonth)))),
+    //     (SELECT SSUM(t.amount) FROM AllTransactions AS t WHERE t.account=a.uuid AND t.year=:year AND t.month=:month
+    //     AND t.day > :day)) FROM Accounts AS a WHERE a.uuid=:account
+    query->prepare(SELECT_BALANCE_FOR_DATE);
+    query->bindValue(":checkpointYear", date.year());
+    query->bindValue(":checkpointYear2", date.year());
+    query->bindValue(":checkpointMonth", date.month());
+    query->bindValue(":year", date.year());
+    query->bindValue(":month", date.month());
+    query->bindValue(":day", date.day());
+    query->bindValue(":account", acc->_dbId.toString());
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the balance " << _lastError.toStdString();
+        return false;
+    }
+
+    balance = 0;
+    if (query->next()) {
+        balance = query->value(0).toString().toDouble();
+    }
+    return true;
+}
+
+double
+Stats::balanceForDate(AccountPtr acc, QDate date) {
+    double balance = 0;
+    if (!acc->wasStoredInDb()) {
+        return balance;
+    }
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return balance;
+    }
+
+    balanceAt(acc, date, balance);
+    return balance;
+}
+
+QList<QPair<QDate, double>>
+Stats::dailyBalances(AccountPtr acc, QDate from, QDate to) {
+    QList<QPair<QDate, double>> result;
+    if (!acc->wasStoredInDb() || from > to) {
+        return result;
+    }
+
+    StatsLock dbLock(this);
+
+    if (!dbLock.opened()) {
+        _lastError = _db->lastError().text();
+        LOG(ERROR) << _lastError.toStdString();
+        return result;
+    }
+
+    // the balance at the end of the day before is the starting point, from there we just have to add the amounts
+    // of each of the days in the range
+    double balance = 0;
+    if (!balanceAt(acc, from.addDays(-1), balance)) {
+        return result;
+    }
+
+    auto query = _db->createQuery();
+
+    // SELECT_DAILY_AMOUNTS = SELECT year, month, day, SSUM(amount) FROM AllTransactions
+    //     WHERE account=:account AND year >= :fromYear AND year <= :toYear
+    //     AND (year > :fromEdgeYear OR month > :fromMonth OR (month = :fromEdgeMonth AND day >= :fromDay))
+    //     AND (year < :toEdgeYear OR month < :toMonth OR (month = :toEdgeMonth AND day <= :toDay))
+    //     GROUP BY year, month, day ORDER BY year, month, day ASC
+    query->prepare(SELECT_DAILY_AMOUNTS);
+    query->bindValue(":account", acc->_dbId.toString());
+    query->bindValue(":fromYear", from.year());
+    query->bindValue(":fromEdgeYear", from.year());
+    query->bindValue(":fromMonth", from.month());
+    query->bindValue(":fromEdgeMonth", from.month());
+    query->bindValue(":fromDay", from.day());
+    query->bindValue(":toYear", to.year());
+    query->bindValue(":toEdgeYear", to.year());
+    query->bindValue(":toMonth", to.month());
+    query->bindValue(":toEdgeMonth", to.month());
+    query->bindValue(":toDay", to.day());
+
+    auto success = query->exec();
+    if (!success) {
+        _lastError = _db->lastError().text();
+        DLOG(INFO) << "Error retrieving the daily amounts " << _lastError.toStdString();
+        return result;
+    }
+
+    // index 0 => year
+    // index 1 => month
+    // index 2 => day
+    // index 3 => amount
+    auto current = from;
+    while (query->next()) {
+        auto day = QDate(query->value(0).toInt(), query->value(1).toInt(), query->value(2).toInt());
+        auto amount = query->value(3).toString().toDouble();
+
+        // days without transactions keep the balance of the previous day
+        while (current < day) {
+            result.append(QPair<QDate, double>(current, balance));
+            current = current.addDays(1);
+        }
+        balance += amount;
+        result.append(QPair<QDate, double>(current, balance));
+        current = current.addDays(1);
+    }
+
+    while (current <= to) {
+        result.append(QPair<QDate, double>(current, balance));
+        current = current.addDays(1);
+    }
+
+    return result;
+}
+
 bool
 Stats::isError() {
     return _lastError != QString::null;
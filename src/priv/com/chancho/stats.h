@@ -25,6 +25,9 @@
 #include <memory>
 #include <mutex>
 
+#include <boost/optional.hpp>
+
+#include <QDate>
 #include <QList>
 #include <QPair>
 
@@ -32,6 +35,7 @@
 
 #include "account.h"
 #include "category.h"
+#include "transaction.h"
 
 namespace com {
 
@@ -63,6 +67,19 @@ class Stats {
         double amount;
     };
 
+    struct ContentsTotal {
+        QString contents;
+        int count;
+        double amount;
+    };
+
+    struct BudgetStatus {
+        CategoryPtr category;
+        double budget;
+        double spent;
+        double remaining;
+    };
+
     Stats();
     virtual ~Stats();
 
@@ -94,6 +111,80 @@ class Stats {
     */
     virtual QList<double> monthsTotalForCategory(CategoryPtr cat, int year);
 
+    /*!
+        \fn virtual QList<double> monthsTotalForCategoryTree(CategoryPtr cat, int year);
+
+        Returns a list with the values of the total amount used in each month for a category and all its
+        descendants during the \a year. The result can be assume to allways return 12 doubles.
+    */
+    virtual QList<double> monthsTotalForCategoryTree(CategoryPtr cat, int year);
+
+    /*!
+        \fn virtual QPair<CategoryPercentageTotal, QList<CategoryPercentage>> categoryTreePercentages(int month, int year);
+
+        Returns a list of the root categories for a month where the occurrences and the amount of each of them
+        include those of all their descendants.
+    */
+    virtual QPair<CategoryPercentageTotal, QList<CategoryPercentage>> categoryTreePercentages(int month, int year);
+
+    /*!
+        \fn virtual QList<TransactionPtr> largestTransactions(Category::Type type, int count, int year,
+                boost::optional<int> month=boost::optional<int>());
+
+        Returns the \a count transactions of the given \a type with the largest absolute amount in the \a year, or
+        in the \a month of the year when present, ordered from the largest to the smallest one. The transactions are
+        visited with a forward only cursor and only the best \a count are kept in memory.
+    */
+    virtual QList<TransactionPtr> largestTransactions(Category::Type type, int count, int year,
+            boost::optional<int> month=boost::optional<int>());
+
+    /*!
+        \fn virtual QList<CategoryPercentage> topCategories(Category::Type type, int count, int year,
+                boost::optional<int> month=boost::optional<int>());
+
+        Returns the \a count categories of the given \a type with the largest absolute total in the \a year, or in
+        the \a month of the year when present, ordered from the largest to the smallest one.
+    */
+    virtual QList<CategoryPercentage> topCategories(Category::Type type, int count, int year,
+            boost::optional<int> month=boost::optional<int>());
+
+    /*!
+        \fn virtual QList<ContentsTotal> topContents(Category::Type type, int count, int year,
+                boost::optional<int> month=boost::optional<int>());
+
+        Returns the \a count contents (payees) of the transactions of the given \a type with the largest absolute
+        total in the \a year, or in the \a month of the year when present, ordered from the largest to the smallest
+        one. Transactions without contents are ignored.
+    */
+    virtual QList<ContentsTotal> topContents(Category::Type type, int count, int year,
+            boost::optional<int> month=boost::optional<int>());
+
+    /*!
+        \fn virtual QList<BudgetStatus> budgets(int month, int year);
+
+        Returns the state of the budgets of all the categories that have one for the given \a month. The amount spent
+        is read from the month totals of the categories that are kept up to date when transactions are stored, so no
+        transactions are visited.
+    */
+    virtual QList<BudgetStatus> budgets(int month, int year);
+
+    /*!
+        \fn virtual double balanceForDate(AccountPtr acc, QDate date);
+
+        Returns the balance of the account at the end of the given \a date. The balance is calculated from the
+        current amount of the account and the monthly checkpoints of the account so that only the transactions of the
+        month of the \a date have to be visited.
+    */
+    virtual double balanceForDate(AccountPtr acc, QDate date);
+
+    /*!
+        \fn virtual QList<QPair<QDate, double>> dailyBalances(AccountPtr acc, QDate from, QDate to);
+
+        Returns the balance of the account at the end of each of the days between \a from and \a to, both included.
+        Days without transactions are present in the result with the balance of the previous day.
+    */
+    virtual QList<QPair<QDate, double>> dailyBalances(AccountPtr acc, QDate from, QDate to);
+
     /*!
         \fn virtual bool isError();
 
@@ -115,6 +206,9 @@ class Stats {
     std::mutex _dbMutex;
 
  private:
+    // the caller must hold the lock of the db
+    bool balanceAt(AccountPtr acc, QDate date, double& balance);
+
     QString _lastError = QString::null;
 };
 
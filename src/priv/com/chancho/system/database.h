@@ -27,6 +27,7 @@
 #include <glog/logging.h>
 #include <sqlite3.h>
 
+#include <QCryptographicHash>
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QSqlError>
@@ -109,6 +110,35 @@ static void stringSumFinal(sqlite3_context *context) {
     sqlite3_result_text(context, amountStr.c_str(), -1, SQLITE_TRANSIENT);
 }
 
+// hash of the fields that identify a transaction in a bank statement, the sign of the amount is ignored so that the
+// hash does not change when the type of the category is changed
+static qint64 transactionFingerprint(const QString& account, int day, int month, int year, const QString& amount,
+        const QString& contents) {
+    auto key = QString("%1|%2-%3-%4|%5|%6").arg(account).arg(year).arg(month).arg(day)
+        .arg(QString::number(qAbs(amount.toDouble()), 'f', 2)).arg(contents.simplified().toLower());
+    auto hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1);
+
+    qint64 fingerprint = 0;
+    for (int index = 0; index < 8; index++) {
+        fingerprint = (fingerprint << 8) | static_cast<unsigned char>(hash.at(index));
+    }
+    return fingerprint;
+}
+
+static void transactionFingerprintFunction(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    if (argc == 6) {
+        auto account = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+        auto amount = reinterpret_cast<const char*>(sqlite3_value_text(argv[4]));
+        auto contents = reinterpret_cast<const char*>(sqlite3_value_text(argv[5]));
+        auto fingerprint = transactionFingerprint(QString::fromUtf8(account), sqlite3_value_int(argv[1]),
+                sqlite3_value_int(argv[2]), sqlite3_value_int(argv[3]), QString::fromUtf8(amount),
+                QString::fromUtf8(contents));
+        sqlite3_result_int64(context, fingerprint);
+        return;
+    }
+    sqlite3_result_null(context);
+}
+
 static void trace(void*, const char* query ) {
     DLOG(INFO) << "SQlite: " << query;
 }
@@ -321,11 +351,41 @@ class Database {
             return false;
         }
 
+        added = sqlite3_create_function(handler, "TransactionFingerprint", 6, SQLITE_UTF8, nullptr,
+                &transactionFingerprintFunction, nullptr, nullptr);
+
+        if (added == SQLITE_OK) {
+            DLOG(INFO) << "TransactionFingerprint added";
+        } else {
+            LOG(WARNING) << "Cannot create SQLite functions: TransactionFingerprint";
+            return false;
+        }
+
         sqlite3_trace(handler, trace, NULL);
 
         return true;
     }
 
+    virtual bool readHeader(char* buffer, int size) {
+        // the header is read with the file handle of sqlite, opening another descriptor of the database file and
+        // closing it would release the posix locks that sqlite holds on it
+        auto v = _db.driver()->handle();
+        if (!_db.isOpen() || !v.isValid() || qstrcmp(v.typeName(), "sqlite3*") != 0) {
+            LOG(INFO) << "Cannot get a sqlite3 handle to the driver.";
+            return false;
+        }
+
+        auto handler = *static_cast<sqlite3**>(v.data());
+        sqlite3_file* file = nullptr;
+        auto found = sqlite3_file_control(handler, "main", SQLITE_FCNTL_FILE_POINTER, &file);
+        if (found != SQLITE_OK || file == nullptr || file->pMethods == nullptr) {
+            LOG(INFO) << "Cannot get the file of the database.";
+            return false;
+        }
+
+        return file->pMethods->xRead(file, buffer, size, 0) == SQLITE_OK;
+    }
+
  protected:
     QSqlDatabase _db;
 };
@@ -39,6 +39,7 @@ class Transaction {
 
  friend class Book;
  friend class RecurrentTransaction;
+ friend class Stats;
 
  public:
     Transaction() = default;
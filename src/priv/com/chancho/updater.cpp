@@ -20,6 +20,8 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+
 #include <com/chancho/system/database_factory.h>
 #include <com/chancho/system/database_lock.h>
 
@@ -36,7 +38,235 @@ namespace {
     const QString INSERT_CURRENT_VERSION = "INSERT OR REPLACE INTO Versions(major, minor, patch) " \
         "VALUES (:major, :minor, :patch)";
     const QString SELECT_TRIGGERS = "SELECT name FROM sqlite_master WHERE type = 'trigger'";
+    const QString SELECT_USER_VERSION = "PRAGMA user_version";
+    // pragmas do not accept bound values
+    const QString UPDATE_USER_VERSION = "PRAGMA user_version = %1";
     const QString ALTER_TRANSACTION_TABLE = "ALTER TABLE Transactions ADD COLUMN is_recurrent int";
+    const QString SELECT_INDEXES = "SELECT name FROM sqlite_master WHERE type = 'index'";
+    // existing rows get a date in the past so that the next generation evaluates them once and stores the real one
+    const QString ALTER_RECURRENT_TRANSACTION_TABLE = "ALTER TABLE RecurrentTransactions ADD COLUMN next_due TEXT "\
+        "DEFAULT '0001-01-01'";
+    const QString RECURRENT_NEXT_DUE_INDEX_NAME = "recurrent_next_due_index";
+    // trigger names cannot be bound
+    const QString DROP_TRIGGER = "DROP TRIGGER IF EXISTS %1";
+    const QString ALTER_TRANSACTION_TABLE_RECURRENT = "ALTER TABLE Transactions ADD COLUMN recurrent_id VARCHAR(40) "\
+        "REFERENCES RecurrentTransactions(uuid)";
+    const QString TRANSACTION_RECURRENT_INDEX_NAME = "transaction_recurrent_index";
+    const QString RECURRENT_RELATIONS_TABLE_NAME = "RecurrentTransactionRelations";
+    // the generated transactions used to be linked to their recurrent transaction with a relations table
+    const QString LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE = "CREATE TABLE IF NOT EXISTS RecurrentTransactionRelations("\
+        "recurrent_transaction VARCHAR(40),"\
+        "generated_transaction VARCHAR(40),"\
+        "FOREIGN KEY(recurrent_transaction) REFERENCES RecurrentTransactions(uuid),"\
+        "FOREIGN KEY(generated_transaction) REFERENCES Transactions(uuid),"\
+        "PRIMARY KEY(recurrent_transaction, generated_transaction))";
+    const QString LEGACY_RECURRENT_RELATIONS_DELETE_TRIGGER = "CREATE TRIGGER DeleteRecurrentRelationsOnDelete "\
+        "AFTER DELETE ON RecurrentTransactions "\
+        "BEGIN "\
+        "DELETE FROM RecurrentTransactionRelations WHERE recurrent_transaction=old.uuid; "\
+        "END";
+    const QString LEGACY_RECURRENT_RELATIONS_INSERT_TRIGGER = "CREATE TRIGGER UpdateRecurrentRelationsOnInsert "\
+        "AFTER INSERT ON RecurrentTransactionRelations "\
+        "BEGIN "\
+        "UPDATE Transactions SET is_recurrent=1 WHERE uuid=new.generated_transaction; "\
+        "END";
+    const QString LEGACY_RECURRENT_RELATIONS_UPDATE_TRIGGER = "CREATE TRIGGER UpdateGeneratedRelationsOnUpdate "\
+        "AFTER UPDATE ON RecurrentTransactions "\
+        "BEGIN "\
+        "UPDATE Transactions SET amount=new.amount, account=new.account, category=new.category, contents=new.contents, memo=new.memo "\
+        "WHERE uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations WHERE recurrent_transaction=new.uuid);"\
+        "END";
+    // the relations table has no index on the generated transactions, one is added so that the copy is not quadratic
+    const QString RECURRENT_RELATIONS_GENERATED_INDEX = "CREATE INDEX IF NOT EXISTS relations_generated_index "\
+        "ON RecurrentTransactionRelations(generated_transaction)";
+    // relations of recurrent transactions removed before the migration are ignored to respect the foreign key
+    const QString FILL_TRANSACTION_RECURRENT_BATCH = "UPDATE Transactions SET recurrent_id=("\
+        "SELECT r.recurrent_transaction FROM RecurrentTransactionRelations AS r "\
+        "INNER JOIN RecurrentTransactions AS t ON t.uuid=r.recurrent_transaction "\
+        "WHERE r.generated_transaction=Transactions.uuid) "\
+        "WHERE uuid IN (SELECT generated_transaction FROM RecurrentTransactionRelations "\
+        "WHERE rowid > :first AND rowid <= :last)";
+    const QString SELECT_RECURRENT_RELATIONS_BATCH = "SELECT MAX(rowid), COUNT(*) FROM ("\
+        "SELECT rowid FROM RecurrentTransactionRelations WHERE rowid > :cursor ORDER BY rowid LIMIT :limit)";
+    const QString COUNT_RECURRENT_RELATIONS = "SELECT COUNT(*) FROM RecurrentTransactionRelations";
+    const QString DROP_RECURRENT_RELATIONS_TABLE = "DROP TABLE IF EXISTS RecurrentTransactionRelations";
+    const QString DROP_TRANSACTION_DELETE_TRIGGER = "DROP TRIGGER IF EXISTS UpdateAccountAmountOnTransactionDelete";
+    const QString DROP_RECURRENT_RELATIONS_DELETE_TRIGGER = "DROP TRIGGER IF EXISTS DeleteRecurrentRelationsOnDelete";
+    const QString DROP_RECURRENT_RELATIONS_UPDATE_TRIGGER = "DROP TRIGGER IF EXISTS UpdateGeneratedRelationsOnUpdate";
+    const QString FILL_CATEGORY_CLOSURE = "WITH RECURSIVE tree(ancestor, descendant, depth) AS ("\
+        "SELECT uuid, uuid, 0 FROM Categories "\
+        "UNION ALL SELECT tree.ancestor, c.uuid, tree.depth + 1 FROM tree INNER JOIN Categories AS c "\
+        "ON c.parent=tree.descendant) "\
+        "INSERT OR IGNORE INTO CategoryClosure(ancestor, descendant, depth) SELECT ancestor, descendant, depth FROM tree";
+    const QString FILL_CATEGORY_MONTH_TOTALS = "INSERT OR REPLACE INTO CategoryMonthTotals(category, year, month, amount) "\
+        "SELECT category, year, month, SSUM(amount) FROM Transactions GROUP BY category, year, month";
+    const QString FILL_BALANCE_CHECKPOINTS = "INSERT OR REPLACE INTO AccountBalanceCheckpoints(account, year, month, amount) "\
+        "SELECT account, year, month, SSUM(amount) FROM Transactions GROUP BY account, year, month";
+    const QString ALTER_TRANSACTION_TABLE_FINGERPRINT = "ALTER TABLE Transactions ADD COLUMN fingerprint INTEGER";
+    const QString TRANSACTION_FINGERPRINT_INDEX_NAME = "transaction_fingerprint_index";
+    const QString SELECT_TRANSACTION_COLUMNS = "PRAGMA table_info(Transactions)";
+    const QString TRANSACTION_ID_COLUMN = "id";
+    const QString ALL_TRANSACTIONS_VIEW_NAME = "AllTransactions";
+    // with the legacy behaviour the rename does not rewrite or check the views and triggers that use the table, they
+    // keep using the name Transactions and read the rebuilt table once the old one is dropped
+    const QString LEGACY_ALTER_TABLE_ON = "PRAGMA legacy_alter_table=ON";
+    const QString LEGACY_ALTER_TABLE_OFF = "PRAGMA legacy_alter_table=OFF";
+    const QString RENAME_TRANSACTION_TABLE = "ALTER TABLE Transactions RENAME TO TransactionsWithoutId";
+    // the rowid becomes the id so that the transactions keep their order and new ids come after the present ones
+    const QString COPY_TRANSACTIONS_WITHOUT_ID = "INSERT INTO Transactions(id, uuid, amount, account, category, day, "\
+        "month, year, contents, memo, is_recurrent, recurrent_id, fingerprint) "\
+        "SELECT rowid, uuid, amount, account, category, day, month, year, contents, memo, is_recurrent, recurrent_id, "\
+        "fingerprint FROM TransactionsWithoutId";
+    const QString DROP_TRANSACTIONS_WITHOUT_ID = "DROP TABLE TransactionsWithoutId";
+    const QString DROP_TRANSACTIONS_SEARCH = "DROP TABLE IF EXISTS TransactionsSearch";
+    const QString REBUILD_TRANSACTIONS_SEARCH = "INSERT INTO TransactionsSearch(TransactionsSearch) VALUES('rebuild')";
+    // the present rows are logged as inserted so that exporting the changes from the start exports the whole book
+    const QString LOG_PRESENT_ACCOUNTS = "INSERT INTO Changes(entity, uuid, op) SELECT 0, uuid, 0 FROM Accounts";
+    const QString LOG_PRESENT_CATEGORIES = "INSERT INTO Changes(entity, uuid, op) SELECT 1, uuid, 0 FROM Categories";
+    // the occurrences generated after the first transaction of a recurrent transaction are generated by every copy
+    const QString LOG_PRESENT_TRANSACTIONS = "INSERT INTO Changes(entity, uuid, op) SELECT 2, t.uuid, 0 "\
+        "FROM Transactions AS t WHERE NOT EXISTS (SELECT 1 FROM RecurrentTransactions AS r "\
+        "WHERE r.uuid=t.recurrent_id AND NOT (r.startDay=t.day AND r.startMonth=t.month AND r.startYear=t.year))";
+    const QString LOG_PRESENT_RECURRENT_TRANSACTIONS = "INSERT INTO Changes(entity, uuid, op) "\
+        "SELECT 3, uuid, 0 FROM RecurrentTransactions";
+    // earlier versions flagged the generated transactions with is_recurrent 3 and 2 while they were stored in bulk
+    const QString RESET_BULK_GENERATED_TRANSACTIONS = "UPDATE Transactions SET is_recurrent=1 "\
+        "WHERE is_recurrent IN (2, 3)";
+    const QString COUNT_MISSING_FINGERPRINTS = "SELECT COUNT(*) FROM Transactions WHERE fingerprint IS NULL";
+    const QString SELECT_MISSING_FINGERPRINTS_BATCH = "SELECT MAX(rowid), COUNT(*) FROM ("\
+        "SELECT rowid FROM Transactions WHERE fingerprint IS NULL AND rowid > :cursor ORDER BY rowid LIMIT :limit)";
+    const QString FILL_FINGERPRINTS_BATCH = "UPDATE Transactions SET "\
+        "fingerprint=TransactionFingerprint(account, day, month, year, amount, contents) "\
+        "WHERE fingerprint IS NULL AND rowid > :first AND rowid <= :last";
+    const QString MIGRATIONS_TABLE_NAME = "Migrations";
+    const QString MIGRATIONS_TABLE = "CREATE TABLE IF NOT EXISTS Migrations("\
+        "id INT PRIMARY KEY, "\
+        "name TEXT, "\
+        "cursor TEXT, "\
+        "processed INT, "\
+        "done INT)";
+    const QString SELECT_MIGRATION = "SELECT cursor, processed, done FROM Migrations WHERE id=:id";
+    const QString INSERT_UPDATE_MIGRATION = "INSERT OR REPLACE INTO Migrations(id, name, cursor, processed, done) "\
+        "VALUES (:id, :name, :cursor, :processed, :done)";
+
+    // copies the links of the relations table to the recurrent_id column of the generated transactions
+    class RecurrentRelationsMigration : public Migration {
+     public:
+        int id() const override {
+            return 1;
+        }
+
+        QString name() const override {
+            return "RecurrentTransactionRelations";
+        }
+
+        int total(system::DatabasePtr db) override {
+            if (!db->tables().contains(RECURRENT_RELATIONS_TABLE_NAME, Qt::CaseInsensitive)) {
+                return 0;
+            }
+
+            auto query = db->createQuery();
+            if (query->exec(COUNT_RECURRENT_RELATIONS) && query->next()) {
+                return query->value(0).toInt();
+            }
+            return 0;
+        }
+
+        bool migrateBatch(system::DatabasePtr db, int batchSize, QVariant& cursor, int& processed) override {
+            processed = 0;
+            if (!db->tables().contains(RECURRENT_RELATIONS_TABLE_NAME, Qt::CaseInsensitive)) {
+                return true;
+            }
+
+            // the rowid of the relations is used as the cursor, the batch is the range of rowids after it
+            qlonglong first = 0;
+            if (cursor.isValid()) {
+                first = cursor.toLongLong();
+            }
+            auto query = db->createQuery();
+            query->prepare(SELECT_RECURRENT_RELATIONS_BATCH);
+            query->bindValue(":cursor", first);
+            query->bindValue(":limit", batchSize);
+            if (!query->exec() || !query->next()) {
+                return false;
+            }
+
+            processed = query->value(1).toInt();
+            if (processed == 0) {
+                return true;
+            }
+            auto last = query->value(0).toLongLong();
+
+            query->prepare(FILL_TRANSACTION_RECURRENT_BATCH);
+            query->bindValue(":first", first);
+            query->bindValue(":last", last);
+            if (!query->exec()) {
+                return false;
+            }
+
+            cursor = last;
+            return true;
+        }
+
+        bool finish(system::DatabasePtr db) override {
+            auto query = db->createQuery();
+            return query->exec(DROP_RECURRENT_RELATIONS_TABLE);
+        }
+    };
+
+    // computes the fingerprint of the transactions stored before the column was added
+    class TransactionFingerprintsMigration : public Migration {
+     public:
+        int id() const override {
+            return 2;
+        }
+
+        QString name() const override {
+            return "TransactionFingerprints";
+        }
+
+        int total(system::DatabasePtr db) override {
+            auto query = db->createQuery();
+            if (query->exec(COUNT_MISSING_FINGERPRINTS) && query->next()) {
+                return query->value(0).toInt();
+            }
+            return 0;
+        }
+
+        bool migrateBatch(system::DatabasePtr db, int batchSize, QVariant& cursor, int& processed) override {
+            processed = 0;
+
+            // as with the relations the rowid of the transactions is used as the cursor
+            qlonglong first = 0;
+            if (cursor.isValid()) {
+                first = cursor.toLongLong();
+            }
+            auto query = db->createQuery();
+            query->prepare(SELECT_MISSING_FINGERPRINTS_BATCH);
+            query->bindValue(":cursor", first);
+            query->bindValue(":limit", batchSize);
+            if (!query->exec() || !query->next()) {
+                return false;
+            }
+
+            processed = query->value(1).toInt();
+            if (processed == 0) {
+                return true;
+            }
+            auto last = query->value(0).toLongLong();
+
+            query->prepare(FILL_FINGERPRINTS_BATCH);
+            query->bindValue(":first", first);
+            query->bindValue(":last", last);
+            if (!query->exec()) {
+                return false;
+            }
+
+            cursor = last;
+            return true;
+        }
+    };
+
 }
 
 class UpdaterLock {
@@ -97,6 +327,36 @@ Updater::setDatabaseVersion() {
     }
 }
 
+int
+Updater::getSchemaFingerprint() {
+    UpdaterLock dbLock(this);
+    if (!dbLock.opened()) {
+        return 0;
+    }
+
+    auto query = _db->createQuery();
+    auto success = query->exec(SELECT_USER_VERSION);
+    if (!success || !query->next()) {
+        LOG(INFO) << "Error retrieving the schema fingerprint;";
+        return 0;
+    }
+    return query->value(0).toInt();
+}
+
+void
+Updater::setSchemaFingerprint(int fingerprint) {
+    UpdaterLock dbLock(this);
+    if (!dbLock.opened()) {
+        return;
+    }
+
+    auto query = _db->createQuery();
+    auto success = query->exec(UPDATE_USER_VERSION.arg(fingerprint));
+    if (!success) {
+        LOG(INFO) << "Error setting the schema fingerprint;";
+    }
+}
+
 bool
 Updater::needsUpgrade() {
     auto dbVersion = QString("");
@@ -118,7 +378,45 @@ Updater::needsUpgrade() {
         auto patch = query->value(2).toInt();
         dbVersion = QString("%1.%2.%3").arg(major).arg(minor).arg(patch);
     }
-    return dbVersion == QString(VERSION);
+
+    // an upgrade is needed when the versions differ, the check used to be inverted and databases with an older
+    // version were reported as up to date
+    if (dbVersion != QString(VERSION)) {
+        return true;
+    }
+
+    // the version might be the same and yet a table or a trigger could be missing if the db was created by a
+    // development build, make sure that all of them are present
+    auto tables = _db->tables();
+    foreach(const QString& table, Book::tables()) {
+        if (!tables.contains(table, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+
+    auto triggers = getTriggers(_db);
+    foreach(const QString& trigger, Book::triggers()) {
+        if (!triggers.contains(trigger, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+
+    auto indexes = getIndexes(_db);
+    if (!indexes.contains(RECURRENT_NEXT_DUE_INDEX_NAME, Qt::CaseInsensitive)
+            || !indexes.contains(TRANSACTION_RECURRENT_INDEX_NAME, Qt::CaseInsensitive)
+            || !indexes.contains(TRANSACTION_FINGERPRINT_INDEX_NAME, Qt::CaseInsensitive)) {
+        return true;
+    }
+
+    if (!getTransactionColumns(_db).contains(TRANSACTION_ID_COLUMN, Qt::CaseInsensitive)) {
+        return true;
+    }
+
+    if (!_db->tables(QSql::Views).contains(ALL_TRANSACTIONS_VIEW_NAME, Qt::CaseInsensitive)) {
+        return true;
+    }
+
+    return false;
 }
 
 void
@@ -135,10 +433,10 @@ Updater::addRecurrenceTables(std::shared_ptr<system::Database> db) {
 
     success &= query->exec(Book::VERSION_TABLE);
     success &= query->exec(Book::RECURRENT_TRANSACTION_TABLE);
-    success &= query->exec(Book::RECURRENT_TRANSACTIONS_RELATIONS_TABLE);
-    success &= query->exec(Book::RECURRENT_RELATIONS_DELETE_TRIGGER);
-    success &= query->exec(Book::RECURRENT_RELATIONS_INSERT_TRIGGER);
-    success &= query->exec(Book::RECURRENT_RELATIONS_UPDATE_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_DELETE_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_INSERT_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_UPDATE_TRIGGER);
 
     if (success)
         db->commit();
@@ -162,10 +460,10 @@ Updater::addRecurrenceRelation(std::shared_ptr<system::Database> db) {
         success = true;
     }
     success &= query->exec(Book::VERSION_TABLE);
-    success &= query->exec(Book::RECURRENT_TRANSACTIONS_RELATIONS_TABLE);
-    success &= query->exec(Book::RECURRENT_RELATIONS_DELETE_TRIGGER);
-    success &= query->exec(Book::RECURRENT_RELATIONS_INSERT_TRIGGER);
-    success &= query->exec(Book::RECURRENT_RELATIONS_UPDATE_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_DELETE_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_INSERT_TRIGGER);
+    success &= query->exec(LEGACY_RECURRENT_RELATIONS_UPDATE_TRIGGER);
 
     if (success)
         db->commit();
@@ -181,7 +479,7 @@ void
 Updater::addRecurrenceTrigger(std::shared_ptr<system::Database> db) {
     db->transaction();
     auto query = db->createQuery();
-    auto success = query->exec(Book::RECURRENT_RELATIONS_UPDATE_TRIGGER);
+    auto success = query->exec(LEGACY_RECURRENT_RELATIONS_UPDATE_TRIGGER);
     success &= query->exec(Book::VERSION_TABLE);
 
     if (success) {
@@ -192,6 +490,298 @@ Updater::addRecurrenceTrigger(std::shared_ptr<system::Database> db) {
     }
 }
 
+void
+Updater::addBalanceCheckpoints(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::BALANCE_CHECKPOINTS_TABLE);
+    success &= query->exec(Book::CHECKPOINT_INSERT_TRIGGER);
+    success &= query->exec(Book::CHECKPOINT_UPDATE_TRIGGER);
+    success &= query->exec(Book::CHECKPOINT_DELETE_TRIGGER);
+    success &= query->exec(Book::CHECKPOINT_ACCOUNT_DELETE_TRIGGER);
+
+    // the checkpoints of the already present transactions are calculated once, from then on the triggers keep them
+    // up to date
+    success &= query->exec(FILL_BALANCE_CHECKPOINTS);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addCategoryClosure(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::CATEGORY_CLOSURE_TABLE);
+    success &= query->exec(Book::CATEGORY_CLOSURE_DESCENDANT_INDEX);
+    success &= query->exec(Book::CATEGORY_CLOSURE_INSERT_TRIGGER);
+    success &= query->exec(Book::CATEGORY_CLOSURE_UPDATE_TRIGGER);
+    success &= query->exec(Book::CATEGORY_CLOSURE_DELETE_TRIGGER);
+
+    // walk the parent relations once to build the closure of the present categories
+    success &= query->exec(FILL_CATEGORY_CLOSURE);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addBudgets(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::CATEGORY_MONTH_TOTALS_TABLE);
+    success &= query->exec(Book::CATEGORY_TOTALS_INSERT_TRIGGER);
+    success &= query->exec(Book::CATEGORY_TOTALS_UPDATE_TRIGGER);
+    success &= query->exec(Book::CATEGORY_TOTALS_DELETE_TRIGGER);
+    success &= query->exec(Book::BUDGETS_TABLE);
+    success &= query->exec(Book::BUDGETS_CATEGORY_DELETE_TRIGGER);
+    success &= query->exec(FILL_CATEGORY_MONTH_TOTALS);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addRecurrentNextDue(std::shared_ptr<system::Database> db) {
+    db->transaction();
+
+    bool success = true;
+    auto query = db->createQuery();
+    success &= query->exec(ALTER_RECURRENT_TRANSACTION_TABLE);
+    if (!success) {
+        // tables created by the recurrence upgrade already have the column
+        LOG(ERROR) << "Error when upgrading db " << query->lastError().text().toStdString();
+        success = true;
+    }
+    success &= query->exec(Book::RECURRENT_NEXT_DUE_INDEX);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addTransactionRecurrentId(std::shared_ptr<system::Database> db) {
+    db->transaction();
+
+    bool success = true;
+    auto query = db->createQuery();
+    success &= query->exec(ALTER_TRANSACTION_TABLE_RECURRENT);
+    if (!success) {
+        // tables created by a newer version already have the column
+        LOG(ERROR) << "Error when upgrading db " << query->lastError().text().toStdString();
+        success = true;
+    }
+    success &= query->exec(Book::TRANSACTION_RECURRENT_INDEX);
+
+    // the triggers that used the relations table are replaced by those that use the column
+    success &= query->exec(DROP_TRANSACTION_DELETE_TRIGGER);
+    success &= query->exec(DROP_RECURRENT_RELATIONS_DELETE_TRIGGER);
+    success &= query->exec(DROP_RECURRENT_RELATIONS_UPDATE_TRIGGER);
+    success &= query->exec(Book::TRANSACTION_DELETE_TRIGGER);
+    success &= query->exec(Book::RECURRENT_RELATIONS_DELETE_TRIGGER);
+
+    // the links are copied in batches by the RecurrentTransactionRelations migration, the index keeps them linear
+    if (db->tables().contains(RECURRENT_RELATIONS_TABLE_NAME, Qt::CaseInsensitive)) {
+        success &= query->exec(RECURRENT_RELATIONS_GENERATED_INDEX);
+    }
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addTransactionFingerprint(std::shared_ptr<system::Database> db) {
+    db->transaction();
+
+    bool success = true;
+    auto query = db->createQuery();
+    success &= query->exec(ALTER_TRANSACTION_TABLE_FINGERPRINT);
+    if (!success) {
+        // tables created by a newer version already have the column
+        LOG(ERROR) << "Error when upgrading db " << query->lastError().text().toStdString();
+        success = true;
+    }
+    // the fingerprints of the stored transactions are computed in batches by the TransactionFingerprints migration
+    success &= query->exec(Book::TRANSACTION_FINGERPRINT_INDEX);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addTransactionsSearch(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::TRANSACTIONS_SEARCH_TABLE);
+    success &= query->exec(Book::SEARCH_INSERT_TRIGGER);
+    success &= query->exec(Book::SEARCH_UPDATE_TRIGGER);
+    success &= query->exec(Book::SEARCH_DELETE_TRIGGER);
+    // the index reads the text of the stored transactions, rebuilding it indexes all of them
+    success &= query->exec(REBUILD_TRANSACTIONS_SEARCH);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addTransactionId(std::shared_ptr<system::Database> db) {
+    // sqlite cannot add a primary key to a table, the table is created again and the rows copied to it
+    auto query = db->createQuery();
+    auto success = query->exec(LEGACY_ALTER_TABLE_ON);
+
+    db->transaction();
+    // the triggers and indexes of the old table are dropped with it and created again for the new one
+    success &= query->exec(RENAME_TRANSACTION_TABLE);
+    success &= query->exec(Book::TRANSACTION_TABLE);
+    success &= query->exec(COPY_TRANSACTIONS_WITHOUT_ID);
+    success &= query->exec(DROP_TRANSACTIONS_WITHOUT_ID);
+    foreach(const QString& statement, Book::transactionIndexStatements()) {
+        success &= query->exec(statement);
+    }
+
+    // the search index pointed to the rowid of the old table
+    success &= query->exec(DROP_TRANSACTIONS_SEARCH);
+    success &= query->exec(Book::TRANSACTIONS_SEARCH_TABLE);
+    success &= query->exec(REBUILD_TRANSACTIONS_SEARCH);
+    foreach(const QString& trigger, Book::triggers()) {
+        success &= query->exec(DROP_TRIGGER.arg(trigger));
+    }
+    foreach(const QString& statement, Book::triggerStatements()) {
+        success &= query->exec(statement);
+    }
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+    query->exec(LEGACY_ALTER_TABLE_OFF);
+}
+
+void
+Updater::addArchivedYears(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::ARCHIVED_YEARS_TABLE);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addAllTransactionsView(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::ALL_TRANSACTIONS_VIEW);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addChanges(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::CHANGES_TABLE);
+    success &= query->exec(LOG_PRESENT_ACCOUNTS);
+    success &= query->exec(LOG_PRESENT_CATEGORIES);
+    success &= query->exec(LOG_PRESENT_RECURRENT_TRANSACTIONS);
+    success &= query->exec(LOG_PRESENT_TRANSACTIONS);
+    success &= query->exec(Book::CHANGES_ACCOUNT_INSERT_TRIGGER);
+    success &= query->exec(Book::CHANGES_ACCOUNT_UPDATE_TRIGGER);
+    success &= query->exec(Book::CHANGES_ACCOUNT_DELETE_TRIGGER);
+    success &= query->exec(Book::CHANGES_CATEGORY_INSERT_TRIGGER);
+    success &= query->exec(Book::CHANGES_CATEGORY_UPDATE_TRIGGER);
+    success &= query->exec(Book::CHANGES_CATEGORY_DELETE_TRIGGER);
+    success &= query->exec(Book::CHANGES_TRANSACTION_INSERT_TRIGGER);
+    success &= query->exec(Book::CHANGES_TRANSACTION_UPDATE_TRIGGER);
+    success &= query->exec(Book::CHANGES_TRANSACTION_DELETE_TRIGGER);
+    success &= query->exec(Book::CHANGES_RECURRENT_INSERT_TRIGGER);
+    success &= query->exec(Book::CHANGES_RECURRENT_UPDATE_TRIGGER);
+    success &= query->exec(Book::CHANGES_RECURRENT_DELETE_TRIGGER);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::addBulkRecurrentTransactions(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+    auto success = query->exec(Book::BULK_RECURRENT_TRANSACTIONS_TABLE);
+    success &= query->exec(RESET_BULK_GENERATED_TRANSACTIONS);
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
+void
+Updater::refreshTriggers(std::shared_ptr<system::Database> db) {
+    db->transaction();
+    auto query = db->createQuery();
+
+    // the book updates the generated transactions itself, the trigger on the recurrent transactions is not needed
+    auto success = query->exec(DROP_RECURRENT_RELATIONS_UPDATE_TRIGGER);
+    foreach(const QString& trigger, Book::triggers()) {
+        success &= query->exec(DROP_TRIGGER.arg(trigger));
+    }
+    foreach(const QString& statement, Book::triggerStatements()) {
+        success &= query->exec(statement);
+    }
+
+    if (success) {
+        db->commit();
+    } else {
+        db->rollback();
+        LOG(ERROR) << "Could not update the chancho db " << db->lastError().text().toStdString();
+    }
+}
+
 void
 Updater::upgrade() {
     // before version 0.2.1 we did not store the version of the database, therefore we need to check for different
@@ -236,6 +826,86 @@ Updater::upgrade() {
             addRecurrenceTrigger(db);
         }
     }
+
+    std::shared_ptr<system::Database> db;
+    auto dbPath = Book::databasePath();
+    db = system::DatabaseFactory::instance()->addDatabase("QSQLITE", "BOOKS");
+    db->setDatabaseName(dbPath);
+
+    system::DatabaseLock<std::shared_ptr<system::Database>> dbLock(db);
+    if (!dbLock.opened()) {
+        LOG(ERROR) << "Could not open database to upgrade it " << db->lastError().text().toStdString();
+        return;
+    }
+
+    // from here on the steps do not depend on the version but on the presence of the tables they add
+    auto tables = db->tables();
+    if (!tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the account balance checkpoints.";
+        addBalanceCheckpoints(db);
+    }
+
+    if (!tables.contains("CategoryClosure", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the category closure.";
+        addCategoryClosure(db);
+    }
+
+    if (!tables.contains("Budgets", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the budgets.";
+        addBudgets(db);
+    }
+
+    auto indexes = getIndexes(db);
+    if (!indexes.contains(RECURRENT_NEXT_DUE_INDEX_NAME, Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the recurrent transactions next due date.";
+        addRecurrentNextDue(db);
+    }
+
+    if (!getIndexes(db).contains(TRANSACTION_RECURRENT_INDEX_NAME, Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the recurrent transaction column to the transactions.";
+        addTransactionRecurrentId(db);
+    }
+
+    if (!getIndexes(db).contains(TRANSACTION_FINGERPRINT_INDEX_NAME, Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the fingerprint column to the transactions.";
+        addTransactionFingerprint(db);
+    }
+
+    // the search index is created again by this step, it has to run before the search index is looked for
+    if (!getTransactionColumns(db).contains(TRANSACTION_ID_COLUMN, Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the id column to the transactions.";
+        addTransactionId(db);
+    }
+
+    if (!db->tables().contains("TransactionsSearch", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the full text search of the transactions.";
+        addTransactionsSearch(db);
+    }
+
+    if (!db->tables().contains("ArchivedYears", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the archived years.";
+        addArchivedYears(db);
+    }
+
+    if (!db->tables(QSql::Views).contains(ALL_TRANSACTIONS_VIEW_NAME, Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the view of the transactions of all the years.";
+        addAllTransactionsView(db);
+    }
+
+    if (!db->tables().contains("Changes", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the change log.";
+        addChanges(db);
+    }
+
+    if (!db->tables().contains("BulkRecurrentTransactions", Qt::CaseInsensitive)) {
+        LOG(INFO) << "Adding the bulk recurrent transactions.";
+        addBulkRecurrentTransactions(db);
+    }
+
+    // a trigger keeps its name when its body changes, the upgrade runs when the schema fingerprint differs and the
+    // triggers are created again from the statements of this version
+    LOG(INFO) << "Refreshing the triggers.";
+    refreshTriggers(db);
 }
 
 
@@ -278,6 +948,173 @@ Updater::getTriggers(std::shared_ptr<system::Database> db) {
     return triggers;
 }
 
+QStringList
+Updater::getTransactionColumns(std::shared_ptr<system::Database> db) {
+    QStringList columns;
+    auto query = db->createQuery();
+    bool success = true;
+    success &= query->exec(SELECT_TRANSACTION_COLUMNS);
+    if (success) {
+        while(query->next()){
+            // the name is the second column of the table info
+            auto name = query->value(1).toString();
+            columns.append(name);
+        }
+    }
+    return columns;
+}
+
+QStringList
+Updater::getIndexes(std::shared_ptr<system::Database> db) {
+    QStringList indexes;
+    auto query = db->createQuery();
+    bool success = true;
+    success &= query->exec(SELECT_INDEXES);
+    if (success) {
+        while(query->next()){
+            auto name = query->value(0).toString();
+            indexes.append(name);
+        }
+    }
+    return indexes;
+}
+
+QList<MigrationPtr>
+Updater::migrations() {
+    static QList<MigrationPtr> known {
+        std::make_shared<RecurrentRelationsMigration>(),
+        std::make_shared<TransactionFingerprintsMigration>()
+    };
+    return known;
+}
+
+bool
+Updater::needsMigration() {
+    UpdaterLock dbLock(this);
+    if (!dbLock.opened()) {
+        return false;
+    }
+
+    // the migrations table is created by the first migration
+    if (!_db->tables().contains(MIGRATIONS_TABLE_NAME, Qt::CaseInsensitive)) {
+        return !migrations().isEmpty();
+    }
+
+    auto query = _db->createQuery();
+    foreach(const MigrationPtr& migration, migrations()) {
+        query->prepare(SELECT_MIGRATION);
+        query->bindValue(":id", migration->id());
+        if (!query->exec() || !query->next() || query->value(2).toInt() == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Updater::migrate(MigrationProgress progress, int batchSize) {
+    if (batchSize <= 0) {
+        batchSize = MIGRATION_BATCH_SIZE;
+    }
+
+    {
+        UpdaterLock dbLock(this);
+        if (!dbLock.opened()) {
+            LOG(ERROR) << "Could not open database to migrate it " << _db->lastError().text().toStdString();
+            return false;
+        }
+
+        auto query = _db->createQuery();
+        if (!query->exec(MIGRATIONS_TABLE)) {
+            LOG(ERROR) << "Could not create the migrations table " << query->lastError().text().toStdString();
+            return false;
+        }
+    }
+
+    auto pending = migrations();
+    std::sort(pending.begin(), pending.end(), [](const MigrationPtr& lhs, const MigrationPtr& rhs) {
+        return lhs->id() < rhs->id();
+    });
+
+    foreach(const MigrationPtr& migration, pending) {
+        // resume from the progress stored by the last committed batch
+        QVariant cursor;
+        auto processed = 0;
+        auto total = 0;
+        auto done = false;
+        {
+            UpdaterLock dbLock(this);
+            if (!dbLock.opened()) {
+                LOG(ERROR) << "Could not open database to migrate it " << _db->lastError().text().toStdString();
+                return false;
+            }
+
+            auto query = _db->createQuery();
+            query->prepare(SELECT_MIGRATION);
+            query->bindValue(":id", migration->id());
+            if (query->exec() && query->next()) {
+                done = query->value(2).toInt() != 0;
+                cursor = query->value(0);
+                processed = query->value(1).toInt();
+            }
+
+            if (!done) {
+                total = migration->total(_db);
+            }
+        }
+
+        if (done) {
+            continue;
+        }
+        LOG(INFO) << "Migrating " << migration->name().toStdString() << " from row " << processed << " of " << total;
+
+        // the lock is taken per batch so that the book can store transactions while a long migration runs
+        while (!done) {
+            auto count = 0;
+            {
+                UpdaterLock dbLock(this);
+                if (!dbLock.opened()) {
+                    LOG(ERROR) << "Could not open database to migrate it " << _db->lastError().text().toStdString();
+                    return false;
+                }
+
+                _db->transaction();
+
+                auto success = migration->migrateBatch(_db, batchSize, cursor, count);
+                done = success && count < batchSize;
+                if (done) {
+                    success &= migration->finish(_db);
+                }
+
+                // INSERT_UPDATE_MIGRATION = INSERT OR REPLACE INTO Migrations(id, name, cursor, processed, done)
+                //     VALUES (:id, :name, :cursor, :processed, :done)
+                auto query = _db->createQuery();
+                query->prepare(INSERT_UPDATE_MIGRATION);
+                query->bindValue(":id", migration->id());
+                query->bindValue(":name", migration->name());
+                query->bindValue(":cursor", cursor);
+                query->bindValue(":processed", processed + count);
+                query->bindValue(":done", done ? 1 : 0);
+                success &= query->exec();
+
+                if (!success) {
+                    _db->rollback();
+                    LOG(ERROR) << "Could not migrate " << migration->name().toStdString() << " "
+                        << _db->lastError().text().toStdString();
+                    return false;
+                }
+                _db->commit();
+            }
+
+            processed += count;
+            if (progress) {
+                progress(migration->name(), processed, total);
+            }
+        }
+    }
+    return true;
+}
+
 }
 
 }
@@ -22,13 +22,17 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <mutex>
 
+#include <QList>
 #include <QString>
 
 #include <com/chancho/system/database.h>
 
+#include "migration.h"
+
 namespace com {
 
 namespace chancho {
@@ -43,20 +47,88 @@ class Updater {
     friend class UpdaterLock;
 
  public:
+    // migration name, migrated rows and total rows of the migration
+    typedef std::function<void(QString, int, int)> MigrationProgress;
+
+    // number of rows migrated in each database transaction
+    static const int MIGRATION_BATCH_SIZE = 500;
+
     Updater();
     virtual ~Updater();
 
     virtual QString getDatabaseVersion();
     virtual void setDatabaseVersion();
 
+    /*!
+        \fn virtual bool needsUpgrade();
+
+        Returns true when the stored version differs from the version of the application, when no version was
+        stored or when a table, view, trigger, index or column of the current schema is missing. Earlier releases
+        returned true only when the versions were equal, which skipped the upgrade of the databases that actually
+        needed it.
+    */
     virtual bool needsUpgrade();
     virtual void upgrade();
 
+    /*!
+        \fn virtual int getSchemaFingerprint();
+
+        Returns the schema fingerprint stored in the user_version of the database, 0 when none was stored.
+    */
+    virtual int getSchemaFingerprint();
+
+    /*!
+        \fn virtual void setSchemaFingerprint(int fingerprint);
+
+        Stores the given \a fingerprint in the user_version of the database.
+    */
+    virtual void setSchemaFingerprint(int fingerprint);
+
+    /*!
+        \fn virtual QList<MigrationPtr> migrations();
+
+        Returns the data migrations known by this version of the application.
+    */
+    virtual QList<MigrationPtr> migrations();
+
+    /*!
+        \fn virtual bool needsMigration();
+
+        Returns if any of the data migrations has not been completed.
+    */
+    virtual bool needsMigration();
+
+    /*!
+        \fn virtual bool migrate(MigrationProgress progress=MigrationProgress(),
+                                 int batchSize=MIGRATION_BATCH_SIZE);
+
+        Runs the pending data migrations ordered by id. Each batch of \a batchSize rows is committed together with
+        the progress of the migration so that an interrupted migration is resumed from the last batch. The database
+        is opened for each batch, other operations are not blocked between them. The \a progress is called after
+        each batch. Returns false if a migration failed.
+    */
+    virtual bool migrate(MigrationProgress progress=MigrationProgress(), int batchSize=MIGRATION_BATCH_SIZE);
+
  protected:
     static QStringList getTriggers(std::shared_ptr<system::Database> db);
+    static QStringList getIndexes(std::shared_ptr<system::Database> db);
+    static QStringList getTransactionColumns(std::shared_ptr<system::Database> db);
     inline void addRecurrenceTables(std::shared_ptr<system::Database> db);
     inline void addRecurrenceRelation(std::shared_ptr<system::Database> db);
     inline void addRecurrenceTrigger(std::shared_ptr<system::Database> db);
+    inline void addBalanceCheckpoints(std::shared_ptr<system::Database> db);
+    inline void addCategoryClosure(std::shared_ptr<system::Database> db);
+    inline void addBudgets(std::shared_ptr<system::Database> db);
+    inline void addRecurrentNextDue(std::shared_ptr<system::Database> db);
+    inline void addTransactionRecurrentId(std::shared_ptr<system::Database> db);
+    inline void addTransactionFingerprint(std::shared_ptr<system::Database> db);
+    inline void addTransactionId(std::shared_ptr<system::Database> db);
+    inline void addTransactionsSearch(std::shared_ptr<system::Database> db);
+    inline void addArchivedYears(std::shared_ptr<system::Database> db);
+    inline void addAllTransactionsView(std::shared_ptr<system::Database> db);
+    inline void addChanges(std::shared_ptr<system::Database> db);
+    inline void addBulkRecurrentTransactions(std::shared_ptr<system::Database> db);
+    inline void refreshTriggers(std::shared_ptr<system::Database> db);
     virtual Version lastVersion();
 
  private:
@@ -65,6 +137,8 @@ class Updater {
 
 };
 
+typedef std::shared_ptr<Updater> UpdaterPtr;
+
 }
 
 }
@@ -51,33 +51,14 @@ MainView {
             pagestack.push(tabsComponent);
             pagestack.push(Qt.resolvedUrl("components/wizard/WelcomeWizard.qml"));
         } else {
-            splashComponent.operationText = i18n.tr("Updating database");
             pagestack.push(tabsComponent);
-            pagestack.push(splashComponent.component);
-            Book.generateRecurrentTransactions();
-        }
-    }
-
-    Item {
-        Timer {
-            id: delay
-            interval: 2000
-            running: false
-            repeat: false
-            onTriggered:  {
-                pagestack.pop();
-            }
-        }
-    }
-
-    Connections {
-        target: Book
-        onRecurrentTransactionsGenerated: {
-            console.log("Recurrent transactions completed");
-            splashComponent.progressUnknown = true;
-            splashComponent.progressValue = 0.5;
-            delay.start();
         }
+        // the data migrations, the recurrent transactions, the weekly backup and the payees index run in the
+        // background once the first page has been rendered
+        Book.migrateDatabase();
+        Book.scheduleRecurrentTransactions();
+        Book.backupBook(7);
+        Book.buildPayees();
     }
 
 
@@ -93,22 +74,6 @@ MainView {
         id: pagestack
     }
 
-    Item {
-        id: splashComponent
-        property string operationText
-        property bool progressUnknown: true
-        property real progressValue: 0
-
-        property var component: Component {
-            SplashScreen {
-                id: splashScreen
-                operationText: splashComponent.operationText
-                progressUnknown: splashComponent.progressUnknown
-                progressValue: splashComponent.progressValue
-            }
-        }
-    }
-
     Component {
         id: tabsComponent
         Tabs {
@@ -24,6 +24,7 @@ import QtQuick 2.0
 import QtQuick.Layouts 1.1
 
 import Ubuntu.Components 1.1
+import Ubuntu.Components.ListItems 1.0 as ListItems
 import Ubuntu.Components.Pickers 0.1
 import Ubuntu.Components.Popups 1.0
 
@@ -224,6 +225,35 @@ UbuntuShape {
                 anchors.right: parent.right
 
                 placeholderText: i18n.tr("Contents")
+
+                onTextChanged: {
+                    suggestionsColumn.suggestions = activeFocus ? Book.payeeSuggestions(text) : [];
+                }
+            }
+
+            Column {
+                id: suggestionsColumn
+                property var suggestions: []
+
+                anchors.left: parent.left
+                anchors.right: parent.right
+                visible: contentsField.activeFocus && suggestions.length > 0
+
+                Repeater {
+                    model: suggestionsColumn.suggestions
+
+                    delegate: ListItems.Standard {
+                        text: modelData.contents
+
+                        onClicked: {
+                            contentsField.text = modelData.contents;
+                            if (amountField.text == "") {
+                                amountField.text = modelData.amount;
+                            }
+                            suggestionsColumn.suggestions = [];
+                        }
+                    }
+                }
             }
 
             TextArea {
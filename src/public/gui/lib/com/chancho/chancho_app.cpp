@@ -27,6 +27,7 @@
 #include <QtQml>
 
 #include <com/chancho/book.h>
+#include <com/chancho/snapshot.h>
 #include <com/chancho/qml/category.h>
 
 #include "qml/account.h"
@@ -75,9 +76,24 @@ ChanchoApp::setup() {
     // register all the diff types with the qml engine
     // register the cpp types used in qml
     auto bookProvider = [](QQmlEngine*, QJSEngine*) -> QObject* {
-        com::chancho::Book::initDatabse();
+        // the snapshot is loaded before the database is prepared, if the preparation changes the database the book
+        // drops it and uses the queries
+        auto snapshot = std::make_shared<com::chancho::Snapshot>();
+        auto loaded = snapshot->load();
 
-        auto model = new com::chancho::qml::Book();
+        com::chancho::Book::prepareDatabase();
+
+        auto book = std::make_shared<com::chancho::Book>();
+        if (loaded) {
+            book->setSnapshot(snapshot);
+        }
+        auto model = new com::chancho::qml::Book(book);
+
+        // the snapshot used by the next start is written when the application quits, it is small enough to be
+        // written in place
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, model, [snapshot]() {
+            snapshot->write();
+        });
         return model;
     };
 
@@ -40,6 +40,7 @@ class RecurrentTransaction;
 namespace models {
 
 class Accounts;
+class Search;
 
 }
 
@@ -51,6 +52,7 @@ class Account : public QObject {
     Q_PROPERTY(QString memo READ getMemo WRITE setMemo NOTIFY memoChanged)
 
     friend class models::Accounts;
+    friend class models::Search;
     friend class qml::Book;
     friend class qml::Stats;
     friend class qml::Transaction;
@@ -20,6 +20,8 @@
  * THE SOFTWARE.
  */
 
+#include <QUrl>
+
 #include <com/chancho/stats.h>
 
 #include "models/accounts.h"
@@ -29,6 +31,7 @@
 #include "models/month.h"
 #include "models/recurrent_categories.h"
 #include "models/recurrent_transactions.h"
+#include "models/search.h"
 
 #include "workers/accounts.h"
 #include "workers/categories.h"
@@ -36,6 +39,7 @@
 
 #include "account.h"
 #include "transaction.h"
+#include "recurrence_scheduler.h"
 #include "recurrent_transaction.h"
 
 #include "book.h"
@@ -68,6 +72,17 @@ Book::Book(BookPtr book, std::shared_ptr<workers::accounts::WorkerFactory> accou
      _transactionWorkersFactory(transactions),
       _book(book) {
     qRegisterMetaType<Book::TransactionType>("Book::TransactionType");
+
+    // the scheduler notifies the months that got new transactions as if the user stored them and generates again
+    // whenever the recurrent transactions change, plain transactions do not change what has to be generated
+    _scheduler = new RecurrenceScheduler(this, _transactionWorkersFactory, this);
+    connect(_scheduler, &RecurrenceScheduler::monthGenerated, this, &Book::transactionStored);
+    connect(this, &Book::recurrentTransactionStored, _scheduler,
+            &RecurrenceScheduler::onRecurrentTransactionsChanged);
+    connect(this, &Book::recurrentTransactionUpdated, _scheduler,
+            &RecurrenceScheduler::onRecurrentTransactionsChanged);
+    connect(this, &Book::recurrentTransactionRemoved, _scheduler,
+            &RecurrenceScheduler::onRecurrentTransactionsChanged);
 }
 
 QObject*
@@ -113,6 +128,45 @@ Book::monthsTotalForAccount(QObject* acc, int year) {
     return result;
 }
 
+void
+Book::forecastBalances(int months) {
+    auto worker = _accountWorkersFactory->forecast(this, months);
+    worker->start();
+}
+
+void
+Book::onBalancesForecasted(QList<com::chancho::Forecast::AccountBalances> balances) {
+    QVariantList result;
+    foreach(const com::chancho::Forecast::AccountBalances& accountBalances, balances) {
+        QVariantList points;
+        for (auto it = accountBalances.balances.begin(); it != accountBalances.balances.end(); ++it) {
+            QVariantMap point;
+            point["date"] = it->first;
+            point["amount"] = it->second;
+            points.append(point);
+        }
+
+        QVariantMap map;
+        map["account"] = QVariant::fromValue(new com::chancho::qml::Account(accountBalances.account));
+        map["balances"] = points;
+        result.append(map);
+    }
+    emit balancesForecasted(result);
+}
+
+void
+Book::onStatementImported(QList<QDate> months, int count) {
+    foreach(const QDate& month, months) {
+        emit transactionStored(month);
+    }
+
+    // the imported payees are not added one by one, the index is built again
+    if (_payees && count > 0) {
+        buildPayees();
+    }
+    emit statementImported(count);
+}
+
 bool
 Book::storeAccount(QString name, QString memo, QString color, double initialAmount) {
     auto worker = _accountWorkersFactory->storeAccount(this, name, memo, color, initialAmount);
@@ -152,8 +206,59 @@ Book::updateAccount(QObject* account, QString name, QString memo, QString color)
 
 void
 Book::generateRecurrentTransactions() {
-    auto worker = _transactionWorkersFactory->generateRecurrentTransactions(this);
-    worker->start();  // the factory makes sure that when the thread is done the resource is cleaned
+    _scheduler->generate();
+}
+
+void
+Book::scheduleRecurrentTransactions() {
+    _scheduler->start();
+}
+
+void
+Book::migrateDatabase() {
+    auto worker = _transactionWorkersFactory->migrateDatabase(this);
+    worker->start();
+}
+
+void
+Book::exportBook(QString path) {
+    // file dialogs hand back urls rather than local paths
+    if (path.startsWith("file:")) {
+        path = QUrl(path).toLocalFile();
+    }
+
+    // the exporter is kept so that the export can be cancelled
+    _exporter = std::make_shared<com::chancho::Exporter>();
+    auto worker = _transactionWorkersFactory->exportBook(this, _exporter, path);
+    worker->start();
+}
+
+void
+Book::cancelExport() {
+    if (_exporter) {
+        _exporter->cancel();
+    }
+}
+
+void
+Book::backupBook(int intervalDays) {
+    auto worker = _transactionWorkersFactory->backupBook(this, intervalDays);
+    worker->start();
+}
+
+QStringList
+Book::backups() {
+    return com::chancho::Backup().backups();
+}
+
+void
+Book::restoreBook(QString path) {
+    if (path.startsWith("file:")) {
+        path = QUrl(path).toLocalFile();
+    }
+
+    auto worker = _transactionWorkersFactory->restoreBook(this, path);
+    worker->start();
 }
 
 bool
@@ -174,6 +279,12 @@ Book::storeTransaction(QObject* account, QObject* category, QDate date, double a
     auto worker = _transactionWorkersFactory->storeTransaction(this, acc->getAccount(), cat->getCategory(), date,
                                                                amount, contents, memo, recurrence);
     worker->start();
+
+    // the suggestions do not wait for the worker, the payee is offered again right away
+    if (_payees) {
+        _payees->add(std::make_shared<com::chancho::Transaction>(acc->getAccount(), amount, cat->getCategory(),
+                                                                 date, contents, memo));
+    }
     return true;
 }
 
@@ -185,9 +296,62 @@ Book::removeTransaction(QObject* transaction) {
     }
     auto worker = _transactionWorkersFactory->removeTransaction(this, tran->getTransaction());
     worker->start();
+
+    if (_payees) {
+        _payees->remove(tran->getTransaction());
+    }
     return true;
 }
 
+bool
+Book::importStatement(QObject* account, QString path) {
+    auto acc = qobject_cast<qml::Account*>(account);
+    if (acc == nullptr) {
+        LOG(ERROR) << "Method called with wrong object type as an account model";
+        return false;
+    }
+
+    // file dialogs hand back urls rather than local paths
+    if (path.startsWith("file:")) {
+        path = QUrl(path).toLocalFile();
+    }
+
+    auto worker = _transactionWorkersFactory->importStatement(this, acc->getAccount(), path);
+    worker->start();
+    return true;
+}
+
+void
+Book::buildPayees() {
+    // the index is kept so that the stored transactions are added to it while it is built
+    if (!_payees) {
+        _payees = std::make_shared<com::chancho::Payees>();
+    }
+    auto worker = _transactionWorkersFactory->buildPayees(this, _payees);
+    worker->start();
+}
+
+QVariantList
+Book::payeeSuggestions(QString prefix, int count) {
+    QVariantList result;
+    if (!_payees) {
+        return result;
+    }
+
+    auto suggestions = _payees->suggestions(prefix, count);
+    foreach(const com::chancho::Payees::Suggestion& suggestion, suggestions) {
+        QVariantMap map;
+        map["contents"] = suggestion.contents;
+        map["amount"] = suggestion.amount;
+        map["count"] = suggestion.count;
+        if (suggestion.category) {
+            map["category"] = QVariant::fromValue(new com::chancho::qml::Category(suggestion.category));
+        }
+        result.append(map);
+    }
+    return result;
+}
+
 bool
 Book::updateTransaction(QObject* tranObj, QObject* accObj, QObject* catObj, QDate date,
                         QString contents, QString memo, double amount) {
@@ -219,6 +383,13 @@ Book::updateTransaction(QObject* tranObj, QObject* accObj, QObject* catObj, QDat
         return false;
     }
 
+    // the worker changes the transaction, the payee of the old values is removed before it runs
+    if (_payees) {
+        _payees->remove(std::make_shared<com::chancho::Transaction>(tran->account, tran->amount, tran->category,
+                                                                    tran->date, tran->contents, tran->memo));
+        _payees->add(std::make_shared<com::chancho::Transaction>(acc, amount, cat, date, contents, memo));
+    }
+
     auto worker = _transactionWorkersFactory->updateTransaction(this, tran, acc, cat, date, contents, memo, amount);
     worker->start();
     return true;
@@ -378,6 +549,33 @@ Book::monthsTotalForCategory(QObject* category, int year) {
     return result;
 }
 
+QVariantList
+Book::budgetsForMonth(int month, int year) {
+    QVariantList result;
+    auto stats = _book->stats();
+    auto budgets = stats->budgets(month, year);
+    foreach(const com::chancho::Stats::BudgetStatus& status, budgets) {
+        QVariantMap map;
+        map["category"] = QVariant::fromValue(new com::chancho::qml::Category(status.category));
+        map["budget"] = status.budget;
+        map["spent"] = status.spent;
+        map["remaining"] = status.remaining;
+        result.append(map);
+    }
+
+    return result;
+}
+
+bool
+Book::setCategoryBudget(QObject* category, double amount) {
+    auto qmlCat = qobject_cast<qml::Category*>(category);
+    if (qmlCat == nullptr) {
+        return false;
+    }
+    _book->setBudget(qmlCat->getCategory(), amount);
+    return !_book->isError();
+}
+
 bool
 Book::storeCategory(QString name, QString color, Book::TransactionType type) {
     auto worker = _categoryWorkersFactory->storeCategory(this, name, color, type);
@@ -430,6 +628,16 @@ Book::monthModel(QDate date) {
     return model;
 }
 
+QObject*
+Book::searchModel(QString query) {
+    auto model = new models::Search(_book);
+    model->setQuery(query);
+    connect(this, &Book::transactionStored, model, &models::Search::onTransactionStored);
+    connect(this, &Book::transactionRemoved, model, &models::Search::onTransactionRemoved);
+    connect(this, &Book::transactionUpdated, model, &models::Search::onTransactionUpdated);
+    return model;
+}
+
 }
 }
 
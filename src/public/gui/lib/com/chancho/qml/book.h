@@ -24,7 +24,11 @@
 
 #include <QObject>
 
+#include <com/chancho/backup.h>
 #include <com/chancho/book.h>
+#include <com/chancho/exporter.h>
+#include <com/chancho/forecast.h>
+#include <com/chancho/payees.h>
 
 namespace com {
 
@@ -32,6 +36,8 @@ namespace chancho {
 
 namespace qml {
 
+class RecurrenceScheduler;
+
 namespace workers {
 
 namespace accounts {
@@ -94,16 +100,27 @@ class Book : public QObject {
     Q_INVOKABLE QObject* accountsModel();
     Q_INVOKABLE QVariantList accounts();
     Q_INVOKABLE QVariantList monthsTotalForAccount(QObject* account, int year);
+    Q_INVOKABLE void forecastBalances(int months);
     Q_INVOKABLE bool storeAccount(QString name, QString memo, QString color, double initialAmount);
     Q_INVOKABLE bool storeAccounts(QVariantList accounts);
     Q_INVOKABLE bool removeAccount(QObject* account);
     Q_INVOKABLE bool updateAccount(QObject* account, QString name, QString memo, QString color);
 
     Q_INVOKABLE void generateRecurrentTransactions();
+    Q_INVOKABLE void scheduleRecurrentTransactions();
+    Q_INVOKABLE void migrateDatabase();
+    Q_INVOKABLE void exportBook(QString path);
+    Q_INVOKABLE void cancelExport();
+    Q_INVOKABLE void backupBook(int intervalDays=0);
+    Q_INVOKABLE QStringList backups();
+    Q_INVOKABLE void restoreBook(QString path);
 
     Q_INVOKABLE bool storeTransaction(QObject* account, QObject* category, QDate date, double amount,
             QString contents, QString memo, QVariantMap recurrence=QVariantMap());
     Q_INVOKABLE bool removeTransaction(QObject* transaction);
+    Q_INVOKABLE bool importStatement(QObject* account, QString path);
+    Q_INVOKABLE void buildPayees();
+    Q_INVOKABLE QVariantList payeeSuggestions(QString prefix, int count=com::chancho::Payees::PAYEE_SUGGESTIONS);
     Q_INVOKABLE bool updateTransaction(QObject* transaction, QObject* accModel, QObject* catModel, QDate date,
                                        QString contents, QString memo, double amount);
     Q_INVOKABLE QObject* recurrentTransactionsModel(QObject* category);
@@ -118,6 +135,8 @@ class Book : public QObject {
     Q_INVOKABLE QObject* categoriesModelForType(TransactionType type);
     Q_INVOKABLE QVariantList categoryPercentagesForMonth(int month, int year);
     Q_INVOKABLE QVariantList monthsTotalForCategory(QObject* category, int year);
+    Q_INVOKABLE QVariantList budgetsForMonth(int month, int year);
+    Q_INVOKABLE bool setCategoryBudget(QObject* category, double amount);
     Q_INVOKABLE bool storeCategory(QString name, QString color, Book::TransactionType type);
     Q_INVOKABLE bool storeCategories(QVariantList categories);
     Q_INVOKABLE bool updateCategory(QObject* category, QString name, QString color, Book::TransactionType type);
@@ -125,11 +144,13 @@ class Book : public QObject {
 
     Q_INVOKABLE QObject* dayModel(int day, int month, int year);
     Q_INVOKABLE QObject* monthModel(QDate date);
+    Q_INVOKABLE QObject* searchModel(QString query=QString());
 
  signals:
     void accountStored();
     void accountRemoved();
     void accountUpdated();
+    void balancesForecasted(QVariantList balances);
     void categoryStored(Book::TransactionType type);
     void categoryUpdated(Book::TransactionType type);
     void categoryRemoved(Book::TransactionType type);
@@ -138,8 +159,26 @@ class Book : public QObject {
     void transactionRemoved(QDate date);
     void transactionUpdated(QDate oldDate, QDate newDate);
     void recurrentTransactionsGenerated();
+    void recurrentTransactionsProgress(int generated, int total);
+    void recurrentTransactionStored();
     void recurrentTransactionUpdated();
     void recurrentTransactionRemoved();
+    void databaseMigrated();
+    void databaseMigrationProgress(QString migration, int migrated, int total);
+    void statementImported(int count);
+    void statementImportProgress(qint64 read, qint64 total);
+    void bookExported(QString path, qint64 count);
+    void bookExportProgress(qint64 exported, qint64 total);
+    void bookExportFailed();
+    void bookBackedUp(QString path);
+    void bookBackupProgress(int copied, int total);
+    void bookRestored();
+    void bookRestoreFailed();
+    void payeesBuilt(int payees);
+
+ protected slots:
+    void onBalancesForecasted(QList<com::chancho::Forecast::AccountBalances> balances);
+    void onStatementImported(QList<QDate> months, int count);
 
  protected:
     // protected for testing purposes
@@ -151,9 +190,12 @@ class Book : public QObject {
     std::shared_ptr<workers::accounts::WorkerFactory> _accountWorkersFactory;
     std::shared_ptr<workers::categories::WorkerFactory> _categoryWorkersFactory;
     std::shared_ptr<workers::transactions::WorkerFactory> _transactionWorkersFactory;
+    RecurrenceScheduler* _scheduler;
 
  private:
     BookPtr _book;
+    ExporterPtr _exporter;
+    PayeesPtr _payees;
 };
 
 }
@@ -42,6 +42,7 @@ namespace models {
 class Categories;
 class RecurrentCategories;
 class RecurrentTransactions;
+class Search;
 
 }
 
@@ -54,6 +55,7 @@ class Category : public QObject {
     friend class models::Categories;
     friend class models::RecurrentCategories;
     friend class models::RecurrentTransactions;
+    friend class models::Search;
     friend class qml::Book;
     friend class qml::Transaction;
     friend class qml::RecurrentTransaction;
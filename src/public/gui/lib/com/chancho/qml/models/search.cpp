@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "com/chancho/qml/account.h"
+#include "com/chancho/qml/category.h"
+#include "com/chancho/qml/transaction.h"
+#include "search.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+class Book;
+
+namespace models {
+
+Search::Search(QObject* parent)
+        : Search(std::make_shared<com::chancho::Book>(), parent) {
+}
+
+Search::Search(BookPtr book, QObject* parent)
+        : QAbstractListModel(parent),
+          _book(book) {
+}
+
+Search::~Search() {
+}
+
+int
+Search::rowCount(const QModelIndex&) const {
+    return _transactions.count();
+}
+
+QVariant
+Search::data(int row, int role) const {
+    if (row < 0 || row >= _transactions.count()) {
+        DLOG(INFO) << "Querying data for to large index";
+        return QVariant();
+    }
+
+    if (role == Qt::DisplayRole) {
+        auto model = new com::chancho::qml::Transaction(_transactions.at(row));
+        return QVariant::fromValue(model);
+    }
+    return QVariant();
+}
+
+QVariant
+Search::data(const QModelIndex& index, int role) const {
+    if (!index.isValid()) {
+        DLOG(INFO) << "Querying data for not valid index.";
+        return QVariant();
+    }
+    return data(index.row(), role);
+}
+
+QVariant
+Search::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+        return QString("Column %1").arg(section);
+    else
+        return QString("Row %1").arg(section);
+}
+
+bool
+Search::canFetchMore(const QModelIndex& parent) const {
+    if (parent.isValid()) {
+        return false;
+    }
+    return _hasMore;
+}
+
+void
+Search::fetchMore(const QModelIndex& parent) {
+    if (parent.isValid() || !_hasMore) {
+        return;
+    }
+
+    auto page = _book->search(_query, _filter, _cursor);
+    if (_book->isError()) {
+        LOG(INFO) << "Error when searching the transactions " << _book->lastError().toStdString();
+        _hasMore = false;
+        return;
+    }
+
+    if (!page.transactions.isEmpty()) {
+        auto first = _transactions.count();
+        beginInsertRows(QModelIndex(), first, first + page.transactions.count() - 1);
+        _transactions.append(page.transactions);
+        endInsertRows();
+    }
+
+    _cursor = page.next;
+    _hasMore = _cursor.isValid();
+}
+
+QString
+Search::getQuery() const {
+    return _query;
+}
+
+void
+Search::setQuery(QString query) {
+    if (_query != query) {
+        _query = query;
+        resetResults();
+        emit queryChanged(_query);
+    }
+}
+
+QObject*
+Search::getAccount() const {
+    if (_filter.account) {
+        return new qml::Account(_filter.account);
+    }
+    return nullptr;
+}
+
+void
+Search::setAccount(QObject* account) {
+    auto accModel = qobject_cast<qml::Account*>(account);
+    _filter.account = (accModel != nullptr) ? accModel->getAccount() : AccountPtr();
+    resetResults();
+    emit accountChanged(account);
+}
+
+QObject*
+Search::getCategory() const {
+    if (_filter.category) {
+        return new qml::Category(_filter.category);
+    }
+    return nullptr;
+}
+
+void
+Search::setCategory(QObject* category) {
+    auto catModel = qobject_cast<qml::Category*>(category);
+    _filter.category = (catModel != nullptr) ? catModel->getCategory() : CategoryPtr();
+    resetResults();
+    emit categoryChanged(category);
+}
+
+QDate
+Search::getFrom() const {
+    return _filter.from;
+}
+
+void
+Search::setFrom(QDate from) {
+    if (_filter.from != from) {
+        _filter.from = from;
+        resetResults();
+        emit fromChanged(from);
+    }
+}
+
+QDate
+Search::getTo() const {
+    return _filter.to;
+}
+
+void
+Search::setTo(QDate to) {
+    if (_filter.to != to) {
+        _filter.to = to;
+        resetResults();
+        emit toChanged(to);
+    }
+}
+
+void
+Search::onTransactionStored(QDate) {
+    // the rank of the results depends on all the transactions, any change forces the search to be performed again
+    resetResults();
+}
+
+void
+Search::onTransactionRemoved(QDate) {
+    resetResults();
+}
+
+void
+Search::onTransactionUpdated(QDate, QDate) {
+    resetResults();
+}
+
+void
+Search::resetResults() {
+    beginResetModel();
+    _transactions.clear();
+    _cursor = com::chancho::Book::SearchCursor();
+    _hasMore = !_query.trimmed().isEmpty();
+    endResetModel();
+}
+
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QModelIndex>
+
+#include <com/chancho/book.h>
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+class Book;
+
+namespace models {
+
+class Search : public QAbstractListModel {
+    Q_OBJECT
+    Q_PROPERTY(QString query READ getQuery WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(QObject* account READ getAccount WRITE setAccount NOTIFY accountChanged)
+    Q_PROPERTY(QObject* category READ getCategory WRITE setCategory NOTIFY categoryChanged)
+    Q_PROPERTY(QDate from READ getFrom WRITE setFrom NOTIFY fromChanged)
+    Q_PROPERTY(QDate to READ getTo WRITE setTo NOTIFY toChanged)
+
+    friend class com::chancho::qml::Book;
+
+ public:
+    explicit Search(QObject* parent = 0);
+    virtual ~Search();
+
+    // methods to override to allow the model to be used from qml, the results are loaded a page at a time when the
+    // view requests more rows
+    int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+    QVariant data(int row, int role) const;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+    QString getQuery() const;
+    void setQuery(QString query);
+
+    QObject* getAccount() const;
+    void setAccount(QObject* account);
+
+    QObject* getCategory() const;
+    void setCategory(QObject* category);
+
+    QDate getFrom() const;
+    void setFrom(QDate from);
+
+    QDate getTo() const;
+    void setTo(QDate to);
+
+ signals:
+    void queryChanged(QString query);
+    void accountChanged(QObject* account);
+    void categoryChanged(QObject* category);
+    void fromChanged(QDate from);
+    void toChanged(QDate to);
+
+ protected:
+    Search(BookPtr book, QObject* parent = 0);
+
+    void onTransactionStored(QDate date);
+    void onTransactionRemoved(QDate date);
+    void onTransactionUpdated(QDate oldDate, QDate date);
+
+ private:
+    void resetResults();
+
+    QString _query;
+    com::chancho::Book::SearchFilter _filter;
+    com::chancho::Book::SearchCursor _cursor;
+    QList<TransactionPtr> _transactions;
+    bool _hasMore = false;
+    BookPtr _book;
+
+};
+
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <QDateTime>
+
+#include "workers/transactions.h"
+
+#include "book.h"
+#include "recurrence_scheduler.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+RecurrenceScheduler::RecurrenceScheduler(Book* book,
+                                         std::shared_ptr<workers::transactions::WorkerFactory> factory,
+                                         QObject* parent)
+    : QObject(parent),
+      _book(book),
+      _factory(factory) {
+    // the generated months are sent from the worker thread
+    qRegisterMetaType<QList<QDate>>("QList<QDate>");
+
+    _timer.setSingleShot(true);
+    connect(&_timer, &QTimer::timeout, this, &RecurrenceScheduler::onTimeout);
+}
+
+void
+RecurrenceScheduler::start(int delay) {
+    _started = true;
+    _nextDue = QDate::currentDate();
+    _timer.start(std::max(0, delay));
+}
+
+void
+RecurrenceScheduler::generate() {
+    _started = true;
+    if (_running) {
+        DLOG(INFO) << "Generation already running, it will be executed again when done.";
+        _pending = true;
+        return;
+    }
+
+    _running = true;
+    _timer.stop();
+
+    auto worker = _factory->generateRecurrentTransactions(_book);
+    connect(worker->implementation(), &workers::transactions::GenerateRecurrent::generated,
+            this, &RecurrenceScheduler::onGenerated);
+    connect(worker->implementation(), &workers::transactions::GenerateRecurrent::failure,
+            this, &RecurrenceScheduler::onFailure);
+    worker->start();  // the factory makes sure that when the thread is done the resource is cleaned
+}
+
+QDate
+RecurrenceScheduler::nextDue() const {
+    return _nextDue;
+}
+
+bool
+RecurrenceScheduler::isRunning() const {
+    return _running;
+}
+
+void
+RecurrenceScheduler::onGenerated(QList<QDate> months, QDate nextDue) {
+    // just the months that got new transactions have to be refreshed
+    foreach(const QDate& month, months) {
+        emit monthGenerated(month);
+    }
+
+    _running = false;
+    _nextDue = nextDue;
+
+    if (_pending) {
+        _pending = false;
+        generate();
+        return;
+    }
+    arm();
+}
+
+void
+RecurrenceScheduler::onFailure() {
+    LOG(WARNING) << "Could not generate the recurrent transactions, trying again later.";
+    _running = false;
+    _pending = false;
+    _nextDue = QDate::currentDate();
+    _timer.start(MAX_INTERVAL);
+}
+
+void
+RecurrenceScheduler::onRecurrentTransactionsChanged() {
+    if (!_started) {
+        return;
+    }
+
+    // the running pass might have read the recurrent transactions before the change, generate again once it is done
+    if (_running) {
+        _pending = true;
+        return;
+    }
+    start(0);
+}
+
+void
+RecurrenceScheduler::onTimeout() {
+    if (_nextDue.isValid() && QDate::currentDate() >= _nextDue) {
+        generate();
+    } else {
+        arm();
+    }
+}
+
+void
+RecurrenceScheduler::arm() {
+    if (!_nextDue.isValid()) {
+        DLOG(INFO) << "There are no recurrent transactions with pending occurrences.";
+        _timer.stop();
+        return;
+    }
+
+    qint64 maxInterval = MAX_INTERVAL;
+    auto interval = QDateTime::currentDateTime().msecsTo(QDateTime(_nextDue, QTime(0, 0)));
+    interval = std::max<qint64>(0, std::min(interval, maxInterval));
+    _timer.start(static_cast<int>(interval));
+}
+
+}
+}
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QDate>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+class Book;
+
+namespace workers {
+
+namespace transactions {
+class WorkerFactory;
+}
+
+}
+
+/*!
+    \class RecurrenceScheduler
+    \brief The RecurrenceScheduler generates the recurrent transactions in a worker thread and keeps a timer armed
+           for the next date in which a recurrent transaction has an occurrence.
+*/
+class RecurrenceScheduler : public QObject {
+    Q_OBJECT
+
+ public:
+    // time to wait after the app started so that the first screen is rendered before generating
+    static const int STARTUP_DELAY = 1000;
+
+    // the timer is never armed for longer than an hour so that suspends or clock changes do not delay a generation
+    static const int MAX_INTERVAL = 60 * 60 * 1000;
+
+    RecurrenceScheduler(Book* book, std::shared_ptr<workers::transactions::WorkerFactory> factory,
+                        QObject* parent=0);
+    virtual ~RecurrenceScheduler() = default;
+
+    /*!
+        \fn void start(int delay=STARTUP_DELAY);
+
+        Arms the scheduler so that the recurrent transactions are generated after \a delay milliseconds.
+     */
+    void start(int delay=STARTUP_DELAY);
+
+    /*!
+        \fn void generate();
+
+        Generates the pending recurrent transactions in a worker thread. If a generation is already running a new
+        one is executed once it is done.
+     */
+    void generate();
+
+    /*!
+        \fn QDate nextDue() const;
+
+        Returns the date for which the timer is armed or an invalid date if no recurrent transaction has pending
+        occurrences.
+     */
+    QDate nextDue() const;
+
+    /*!
+        \fn bool isRunning() const;
+
+        Returns if a generation is being executed.
+     */
+    bool isRunning() const;
+
+ signals:
+    void monthGenerated(QDate date);
+
+ public slots:
+    void onGenerated(QList<QDate> months, QDate nextDue);
+    void onFailure();
+    void onRecurrentTransactionsChanged();
+
+ protected slots:
+    void onTimeout();
+
+ protected:
+    void arm();
+
+ private:
+    Book* _book;
+    std::shared_ptr<workers::transactions::WorkerFactory> _factory;
+    QTimer _timer;
+    QDate _nextDue;
+    bool _started = false;
+    bool _running = false;
+    bool _pending = false;
+};
+
+}
+}
+}
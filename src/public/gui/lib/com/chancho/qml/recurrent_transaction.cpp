@@ -182,6 +182,17 @@ RecurrentTransaction::getRecurrenceType() const {
     }
 }
 
+QVariantList
+RecurrentTransaction::nextOccurrences(int count) const {
+    // only the requested occurrences are calculated, the recurrence might not have an end
+    QVariantList result;
+    auto dates = _transaction->recurrence->dates().after(QDate::currentDate()).take(count);
+    foreach(const QDate& date, dates) {
+        result.append(date);
+    }
+    return result;
+}
+
 QObject*
 RecurrentTransaction::getAccountModel() {
     // pass this as the parent to ensure that we clean the memory on destruction
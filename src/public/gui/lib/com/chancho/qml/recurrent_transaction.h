@@ -23,6 +23,9 @@
 #pragma once
 
 #include <memory>
+
+#include <QVariantList>
+
 #include <com/chancho/recurrent_transaction.h>
 #include "book.h"
 
@@ -101,6 +104,13 @@ class RecurrentTransaction : public QObject {
     QObject* getCategoryModel();
     void setCategoryModel(QObject* category);
 
+    /*!
+        \fn Q_INVOKABLE QVariantList nextOccurrences(int count) const;
+
+        Returns the dates of the next \a count occurrences that happen after today, used to preview the recurrence.
+    */
+    Q_INVOKABLE QVariantList nextOccurrences(int count) const;
+
  signals:
     void accountChanged(QString account);
     void amountChanged(double amount);
@@ -40,6 +40,7 @@ namespace models {
 
 class Day;
 class GeneratedTransactions;
+class Search;
 
 }
 
@@ -58,6 +59,7 @@ class Transaction : public QObject {
 
     friend class models::Day;
     friend class models::GeneratedTransactions;
+    friend class models::Search;
     friend class qml::Book;
 
  public:
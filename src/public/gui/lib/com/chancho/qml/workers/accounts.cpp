@@ -79,6 +79,19 @@ WorkerFactory::updateAccount(qml::Book* book, com::chancho::AccountPtr account,
     return worker;
 }
 
+WorkerThread<Forecast>*
+WorkerFactory::forecast(qml::Book* book, int months) {
+    qRegisterMetaType<QList<com::chancho::Forecast::AccountBalances>>("QList<com::chancho::Forecast::AccountBalances>");
+
+    auto worker = new WorkerThread<Forecast>(new Forecast(book->_book, months));
+    CHECK(QObject::connect(worker->implementation(), &Forecast::forecasted, book, &Book::onBalancesForecasted))
+        << "Could not connect to the forecasted signal";
+    CHECK(QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater))
+        << "Could ot connect to the finished signal";
+    // TODO: connect the failure signal
+    return worker;
+}
+
 }
 }
 }
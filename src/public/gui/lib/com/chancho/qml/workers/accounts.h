@@ -26,6 +26,7 @@
 #include "com/chancho/qml/workers/worker_thread.h"
 
 // make the include simpler
+#include "accounts/forecast.h"
 #include "accounts/multi_store.h"
 #include "accounts/single_remove.h"
 #include "accounts/single_store.h"
@@ -54,6 +55,7 @@ class WorkerFactory {
     virtual WorkerThread<SingleRemove>* removeAccount(qml::Book* book, com::chancho::AccountPtr account);
     virtual WorkerThread<SingleUpdate>* updateAccount(qml::Book* book, com::chancho::AccountPtr account, QString name,
                                                      QString memo, QString color);
+    virtual WorkerThread<Forecast>* forecast(qml::Book* book, int months);
 };
 
 }
@@ -108,6 +108,11 @@ WorkerFactory::storeTransaction(qml::Book* book, chancho::AccountPtr account, ch
 
     CHECK(QObject::connect(worker->implementation(), &SingleStore::success, book, &Book::accountUpdated))
           << "Could not connect to the success signal!";
+    // a new recurrent transaction can be due before the date the scheduler is waiting for
+    if (recurrence.count() > 0) {
+        CHECK(QObject::connect(worker->implementation(), &SingleStore::success, book,
+                               &Book::recurrentTransactionStored)) << "Could not connect to the success signal!";
+    }
     // XXX: Are we leaking a handler here?
 #if QT_VERSION >= 0x050300
 
@@ -205,6 +210,67 @@ WorkerThread<GenerateRecurrent>*
 WorkerFactory::generateRecurrentTransactions(qml::Book* book) {
     auto worker = new WorkerThread<GenerateRecurrent>(new GenerateRecurrent(book->_book));
     QObject::connect(worker->implementation(), &SingleUpdate::success, book, &Book::recurrentTransactionsGenerated);
+    QObject::connect(worker->implementation(), &GenerateRecurrent::progress, book,
+                     &Book::recurrentTransactionsProgress);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+
+WorkerThread<MigrateDatabase>*
+WorkerFactory::migrateDatabase(qml::Book* book) {
+    auto worker = new WorkerThread<MigrateDatabase>(new MigrateDatabase(std::make_shared<com::chancho::Updater>()));
+    QObject::connect(worker->implementation(), &MigrateDatabase::success, book, &Book::databaseMigrated);
+    QObject::connect(worker->implementation(), &MigrateDatabase::progress, book, &Book::databaseMigrationProgress);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+WorkerThread<ImportStatement>*
+WorkerFactory::importStatement(qml::Book* book, chancho::AccountPtr account, QString path) {
+    qRegisterMetaType<QList<QDate>>("QList<QDate>");
+
+    auto importer = std::make_shared<com::chancho::Importer>(book->_book, account);
+    auto worker = new WorkerThread<ImportStatement>(new ImportStatement(importer, path));
+    QObject::connect(worker->implementation(), &ImportStatement::imported, book, &Book::onStatementImported);
+    QObject::connect(worker->implementation(), &ImportStatement::progress, book, &Book::statementImportProgress);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+WorkerThread<ExportBook>*
+WorkerFactory::exportBook(qml::Book* book, chancho::ExporterPtr exporter, QString path) {
+    auto worker = new WorkerThread<ExportBook>(new ExportBook(exporter, path));
+    QObject::connect(worker->implementation(), &ExportBook::exported, book, &Book::bookExported);
+    QObject::connect(worker->implementation(), &ExportBook::progress, book, &Book::bookExportProgress);
+    QObject::connect(worker->implementation(), &ExportBook::failure, book, &Book::bookExportFailed);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+WorkerThread<BackupBook>*
+WorkerFactory::backupBook(qml::Book* book, int intervalDays) {
+    auto worker = new WorkerThread<BackupBook>(new BackupBook(std::make_shared<com::chancho::Backup>(),
+        intervalDays));
+    QObject::connect(worker->implementation(), &BackupBook::backedUp, book, &Book::bookBackedUp);
+    QObject::connect(worker->implementation(), &BackupBook::progress, book, &Book::bookBackupProgress);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+WorkerThread<RestoreBook>*
+WorkerFactory::restoreBook(qml::Book* book, QString path) {
+    auto worker = new WorkerThread<RestoreBook>(new RestoreBook(std::make_shared<com::chancho::Backup>(), path));
+    QObject::connect(worker->implementation(), &RestoreBook::restored, book, &Book::bookRestored);
+    QObject::connect(worker->implementation(), &RestoreBook::failure, book, &Book::bookRestoreFailed);
+    QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
+    return worker;
+}
+
+WorkerThread<BuildPayees>*
+WorkerFactory::buildPayees(qml::Book* book, chancho::PayeesPtr payees) {
+    auto worker = new WorkerThread<BuildPayees>(new BuildPayees(payees));
+    QObject::connect(worker->implementation(), &BuildPayees::built, book, &Book::payeesBuilt);
     QObject::connect(worker->thread(), &QThread::finished, worker, &QObject::deleteLater);
     return worker;
 }
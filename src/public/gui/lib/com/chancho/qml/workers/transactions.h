@@ -26,7 +26,13 @@
 #include "com/chancho/qml/workers/worker_thread.h"
 
 // make the include simpler
+#include "transactions/backup_book.h"
+#include "transactions/build_payees.h"
+#include "transactions/export_book.h"
 #include "transactions/generate_recurrent.h"
+#include "transactions/import_statement.h"
+#include "transactions/migrate_database.h"
+#include "transactions/restore_book.h"
 #include "transactions/single_remove.h"
 #include "transactions/single_store.h"
 #include "transactions/single_update.h"
@@ -65,6 +71,13 @@ class WorkerFactory {
                                                                    QDate date, QString contents, QString memo,
                                                                    double amount, bool updateAll=false);
     virtual WorkerThread<GenerateRecurrent>* generateRecurrentTransactions(qml::Book* book);
+    virtual WorkerThread<MigrateDatabase>* migrateDatabase(qml::Book* book);
+    virtual WorkerThread<ImportStatement>* importStatement(qml::Book* book, chancho::AccountPtr account,
+                                                           QString path);
+    virtual WorkerThread<ExportBook>* exportBook(qml::Book* book, chancho::ExporterPtr exporter, QString path);
+    virtual WorkerThread<BackupBook>* backupBook(qml::Book* book, int intervalDays);
+    virtual WorkerThread<RestoreBook>* restoreBook(qml::Book* book, QString path);
+    virtual WorkerThread<BuildPayees>* buildPayees(qml::Book* book, chancho::PayeesPtr payees);
 };
 
 }
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "backup_book.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+BackupBook::BackupBook(BackupPtr backup, int intervalDays)
+    : Worker(),
+      _backup(backup),
+      _intervalDays(intervalDays) {
+
+}
+
+void
+BackupBook::run() {
+    // scheduled backups are only done when the last one is old enough
+    if (_intervalDays > 0 && !_backup->isDue(_intervalDays)) {
+        emit success();
+        return;
+    }
+
+    auto path = _backup->backup([this](int copied, int total) {
+        emit progress(copied, total);
+    });
+    if (_backup->isError()) {
+        emit failure();
+        return;
+    }
+
+    emit backedUp(path);
+    emit success();
+}
+
+
+}
+}
+}
+}
+}
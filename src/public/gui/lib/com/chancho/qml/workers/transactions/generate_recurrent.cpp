@@ -40,12 +40,23 @@ GenerateRecurrent::GenerateRecurrent(BookPtr book)
 
 void
 GenerateRecurrent::run() {
-    _book->generateRecurrentTransactions();
+    auto months = _book->generateRecurrentTransactions([this](int generated, int total) {
+        emit progress(generated, total);
+    });
     if (_book->isError()) {
         emit failure();
-    } else {
-        emit success();
+        return;
     }
+
+    // let the listeners know when the next generation has to take place
+    auto nextDue = _book->nextRecurrentDueDate();
+    if (_book->isError()) {
+        emit failure();
+        return;
+    }
+
+    emit generated(months, nextDue);
+    emit success();
 }
 
 
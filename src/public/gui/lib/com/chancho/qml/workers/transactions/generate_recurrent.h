@@ -23,6 +23,7 @@
 #pragma once
 
 #include <QDate>
+#include <QList>
 #include <QObject>
 #include <QString>
 #include <QThread>
@@ -42,10 +43,16 @@ namespace workers {
 namespace transactions {
 
 class GenerateRecurrent : public workers::Worker {
+    Q_OBJECT
+
  public:
     GenerateRecurrent(BookPtr book);
     void run() override;
 
+ signals:
+    void progress(int generated, int total);
+    void generated(QList<QDate> months, QDate nextDue);
+
  private:
     BookPtr _book;
 };
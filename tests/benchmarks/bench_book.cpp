@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+
+#include <QFile>
+#include <QString>
+
+#include <com/chancho/book.h>
+
+#include "public_book.h"
+#include "benchmarks.h"
+#include "dataset.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace benchmarks {
+
+namespace {
+
+    const int BULK_SIZE = 100;
+    // the occurrences of the recurrent transactions are generated in a year already past
+    const int GENERATION_YEAR = 2015;
+    // a daily recurrent transaction per this number of transactions of the dataset
+    const int GENERATION_RATIO = 1000;
+
+    void
+    storeSingle(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Book book;
+        while (state.KeepRunning()) {
+            auto tran = std::make_shared<Transaction>(dataset->accounts.at(0), 20, dataset->categories.at(0),
+                QDate(dataset->lastYear(), 6, 15), "Benchmark");
+            book.store(tran);
+
+            // keep the dataset size stable
+            state.PauseTiming();
+            book.remove(tran);
+            state.ResumeTiming();
+        }
+    }
+
+    void
+    storeBulk(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Book book;
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            QList<TransactionPtr> trans;
+            for (int index = 0; index < BULK_SIZE; index++) {
+                trans.append(std::make_shared<Transaction>(dataset->accounts.at(index % dataset->accounts.count()),
+                    20 + index, dataset->categories.at(index % dataset->categories.count()),
+                    QDate(dataset->lastYear(), 6, 1 + index % 28), "Benchmark"));
+            }
+            state.ResumeTiming();
+
+            book.store(trans);
+
+            state.PauseTiming();
+            foreach(const TransactionPtr& tran, trans) {
+                book.remove(tran);
+            }
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * BULK_SIZE);
+    }
+
+    void
+    transactionsMonth(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    transactionsMonthLimit(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(6, Dataset::instance()->lastYear(), 50, 0));
+        }
+    }
+
+    void
+    transactionsDay(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(15, 6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    transactionsCategory(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(dataset->categories.at(0), 6, dataset->lastYear()));
+        }
+    }
+
+    void
+    transactionsAccount(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(dataset->accounts.at(0)));
+        }
+    }
+
+    void
+    transactionsRecurrent(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.transactions(dataset->recurrent.at(0)));
+        }
+    }
+
+    void
+    monthsWithTransactions(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.monthsWithTransactions(Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    daysWithTransactions(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.daysWithTransactions(6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    incomeForDay(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.incomeForDay(15, 6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    expenseForDay(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Book book;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(book.expenseForDay(15, 6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    // the generation writes into the book, it works on a database of its own so that the dataset used by the rest
+    // of the benchmarks is not modified, the dataset is moved aside while it runs
+    class SeparateDatabase {
+     public:
+        SeparateDatabase()
+                : _path(PublicBook::databasePath()),
+                  _stash(_path + ".dataset") {
+            QFile::remove(_stash);
+            QFile::rename(_path, _stash);
+        }
+
+        ~SeparateDatabase() {
+            QFile::remove(_path);
+            QFile::rename(_stash, _path);
+        }
+
+     private:
+        QString _path;
+        QString _stash;
+    };
+
+    // stores daily recurrent transactions that start and end in a fixed year so that the amount of work does not
+    // depend on the day the benchmark is ran, returns the number of transactions that will be generated
+    int
+    seedRecurrentFixture(int size) {
+        QFile::remove(PublicBook::databasePath());
+        PublicBook::initDatabse();
+
+        PublicBook book;
+        auto account = std::make_shared<Account>("Bankia", 1000);
+        book.store(account);
+        auto category = std::make_shared<Category>("Rent", Category::Type::EXPENSE);
+        book.store(category);
+
+        auto first = QDate(GENERATION_YEAR, 1, 1);
+        auto last = QDate(GENERATION_YEAR, 12, 31);
+        QList<RecurrentTransactionPtr> recurrent;
+        for (int index = 0; index < std::max(1, size / GENERATION_RATIO); index++) {
+            auto tran = std::make_shared<Transaction>(account, 10 + index, category, first, "Benchmark");
+            auto recurrence = std::make_shared<RecurrentTransaction::Recurrence>(
+                RecurrentTransaction::Recurrence::Defaults::DAILY, first, last);
+            recurrent.append(std::make_shared<RecurrentTransaction>(tran, recurrence));
+        }
+        book.store(recurrent);
+        return recurrent.count() * first.daysTo(last) + recurrent.count();
+    }
+
+    void
+    generateRecurrentTransactions(benchmark::State& state, int size) {
+        SeparateDatabase database;
+        Book book;
+        auto generated = 0;
+        while (state.KeepRunning()) {
+            // each iteration starts from recurrent transactions that never generated an occurrence
+            state.PauseTiming();
+            generated += seedRecurrentFixture(size);
+            state.ResumeTiming();
+
+            book.generateRecurrentTransactions();
+        }
+        state.SetItemsProcessed(generated);
+    }
+
+    template<typename F>
+    void
+    add(const QString& name, F function, int size) {
+        benchmark::RegisterBenchmark(QString("%1/%2").arg(name).arg(size).toStdString().c_str(), function, size)
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+void
+registerBookBenchmarks(int size) {
+    add("Book::store/single", storeSingle, size);
+    add("Book::store/bulk", storeBulk, size);
+    add("Book::transactions/month", transactionsMonth, size);
+    add("Book::transactions/month_limit", transactionsMonthLimit, size);
+    add("Book::transactions/day", transactionsDay, size);
+    add("Book::transactions/category", transactionsCategory, size);
+    add("Book::transactions/account", transactionsAccount, size);
+    add("Book::transactions/recurrent", transactionsRecurrent, size);
+    add("Book::monthsWithTransactions", monthsWithTransactions, size);
+    add("Book::daysWithTransactions", daysWithTransactions, size);
+    add("Book::incomeForDay", incomeForDay, size);
+    add("Book::expenseForDay", expenseForDay, size);
+    add("Book::generateRecurrentTransactions", generateRecurrentTransactions, size);
+}
+
+}
+
+}
+
+}
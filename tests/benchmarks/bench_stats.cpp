@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <QString>
+
+#include <com/chancho/stats.h>
+
+#include "benchmarks.h"
+#include "dataset.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace benchmarks {
+
+namespace {
+
+    const int TOP_SIZE = 20;
+
+    void
+    monthsTotalForAccount(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.monthsTotalForAccount(dataset->accounts.at(0), dataset->lastYear()));
+        }
+    }
+
+    void
+    categoryPercentages(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.categoryPercentages(6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    monthsTotalForCategory(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.monthsTotalForCategory(dataset->categories.at(0), dataset->lastYear()));
+        }
+    }
+
+    void
+    monthsTotalForCategoryTree(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.monthsTotalForCategoryTree(dataset->categories.at(0),
+                dataset->lastYear()));
+        }
+    }
+
+    void
+    categoryTreePercentages(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.categoryTreePercentages(6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    largestTransactions(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.largestTransactions(Category::Type::EXPENSE, TOP_SIZE,
+                Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    topCategories(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.topCategories(Category::Type::EXPENSE, TOP_SIZE,
+                Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    topContents(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.topContents(Category::Type::EXPENSE, TOP_SIZE,
+                Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    budgets(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.budgets(6, Dataset::instance()->lastYear()));
+        }
+    }
+
+    void
+    balanceForDate(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.balanceForDate(dataset->accounts.at(0),
+                QDate(dataset->firstYear() + 1, 6, 15)));
+        }
+    }
+
+    void
+    dailyBalances(benchmark::State& state, int size) {
+        Dataset::instance()->ensure(size);
+        auto dataset = Dataset::instance();
+        Stats stats;
+        while (state.KeepRunning()) {
+            benchmark::DoNotOptimize(stats.dailyBalances(dataset->accounts.at(0),
+                QDate(dataset->lastYear(), 1, 1), QDate(dataset->lastYear(), 12, 31)));
+        }
+    }
+
+    template<typename F>
+    void
+    add(const QString& name, F function, int size) {
+        benchmark::RegisterBenchmark(QString("%1/%2").arg(name).arg(size).toStdString().c_str(), function, size)
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+void
+registerStatsBenchmarks(int size) {
+    add("Stats::monthsTotalForAccount", monthsTotalForAccount, size);
+    add("Stats::categoryPercentages", categoryPercentages, size);
+    add("Stats::monthsTotalForCategory", monthsTotalForCategory, size);
+    add("Stats::monthsTotalForCategoryTree", monthsTotalForCategoryTree, size);
+    add("Stats::categoryTreePercentages", categoryTreePercentages, size);
+    add("Stats::largestTransactions", largestTransactions, size);
+    add("Stats::topCategories", topCategories, size);
+    add("Stats::topContents", topContents, size);
+    add("Stats::budgets", budgets, size);
+    add("Stats::balanceForDate", balanceForDate, size);
+    add("Stats::dailyBalances", dailyBalances, size);
+}
+
+}
+
+}
+
+}
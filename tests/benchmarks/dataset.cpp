@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <random>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <com/chancho/book.h>
+
+#include "public_book.h"
+#include "dataset.h"
+
+namespace com {
+
+namespace chancho {
+
+namespace benchmarks {
+
+namespace {
+    const int FIRST_YEAR = 2010;
+    const int LAST_YEAR = 2015;
+    const int CHUNK_SIZE = 10000;
+    const int RECURRENT_COUNT = 20;
+    const QStringList CONTENTS {"Mercadona", "Carrefour", "Renfe", "Amazon", "Bakery", "Cinema", "Pharmacy",
+        "Gas station", "Restaurant", "Landlord"};
+}
+
+Dataset*
+Dataset::instance() {
+    static Dataset dataset;
+    return &dataset;
+}
+
+void
+Dataset::ensure(int size) {
+    if (_size == size) {
+        return;
+    }
+    seed(size);
+    _size = size;
+}
+
+int
+Dataset::size() const {
+    return _size;
+}
+
+int
+Dataset::firstYear() const {
+    return FIRST_YEAR;
+}
+
+int
+Dataset::lastYear() const {
+    return LAST_YEAR;
+}
+
+void
+Dataset::seed(int size) {
+    accounts.clear();
+    categories.clear();
+    recurrent.clear();
+
+    // start from an empty db
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists()) {
+        QDir().remove(dbPath);
+    }
+    PublicBook::initDatabse();
+
+    PublicBook book;
+    accounts.append(std::make_shared<Account>("Bankia", 1000));
+    accounts.append(std::make_shared<Account>("BBVA", 500));
+    accounts.append(std::make_shared<Account>("Cash", 0));
+    book.store(accounts);
+
+    auto food = std::make_shared<Category>("Food", Category::Type::EXPENSE);
+    auto restaurants = std::make_shared<Category>("Restaurants", Category::Type::EXPENSE, food);
+    auto groceries = std::make_shared<Category>("Groceries", Category::Type::EXPENSE, food);
+    auto home = std::make_shared<Category>("Home", Category::Type::EXPENSE);
+    auto rent = std::make_shared<Category>("Rent", Category::Type::EXPENSE, home);
+    auto transport = std::make_shared<Category>("Transport", Category::Type::EXPENSE);
+    auto salary = std::make_shared<Category>("Salary", Category::Type::INCOME);
+    auto bonus = std::make_shared<Category>("Bonus", Category::Type::INCOME);
+    categories << food << restaurants << groceries << home << rent << transport << salary << bonus;
+    book.store(categories);
+
+    foreach(const CategoryPtr& cat, categories) {
+        if (cat->type == Category::Type::EXPENSE) {
+            book.setBudget(cat, 400);
+        }
+    }
+
+    std::default_random_engine re;
+    std::uniform_int_distribution<int> accUnif(0, accounts.count() - 1);
+    std::uniform_int_distribution<int> catUnif(0, categories.count() - 1);
+    std::uniform_int_distribution<int> contentsUnif(0, CONTENTS.count() - 1);
+    std::uniform_int_distribution<int> dayUnif(0, QDate(FIRST_YEAR, 1, 1).daysTo(QDate(LAST_YEAR, 12, 31)));
+    std::uniform_real_distribution<double> amountUnif(1, 2000);
+
+    // store in chunks to keep the memory used by the seeding bounded
+    auto firstDay = QDate(FIRST_YEAR, 1, 1);
+    auto stored = 0;
+    while (stored < size) {
+        QList<TransactionPtr> trans;
+        auto chunk = std::min(CHUNK_SIZE, size - stored);
+        for (int index = 0; index < chunk; index++) {
+            auto amount = static_cast<int>(amountUnif(re) * 100) / 100.0;
+            trans.append(std::make_shared<Transaction>(accounts.at(accUnif(re)), amount, categories.at(catUnif(re)),
+                firstDay.addDays(dayUnif(re)), CONTENTS.at(contentsUnif(re))));
+        }
+        book.store(trans);
+        stored += chunk;
+    }
+
+    for (int index = 0; index < RECURRENT_COUNT; index++) {
+        auto tran = std::make_shared<Transaction>(accounts.at(accUnif(re)), 10 + index, categories.at(catUnif(re)),
+            QDate(LAST_YEAR, 1, 1 + index), CONTENTS.at(contentsUnif(re)));
+        auto recurrence = std::make_shared<RecurrentTransaction::Recurrence>(
+            (index % 2 == 0)?RecurrentTransaction::Recurrence::Defaults::WEEKLY:
+                RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(LAST_YEAR, 1, 1 + index));
+        recurrent.append(std::make_shared<RecurrentTransaction>(tran, recurrence));
+    }
+    book.store(recurrent);
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <QList>
+
+#include <com/chancho/account.h>
+#include <com/chancho/category.h>
+#include <com/chancho/recurrent_transaction.h>
+
+namespace com {
+
+namespace chancho {
+
+namespace benchmarks {
+
+/*!
+    \class Dataset
+    \brief The Dataset class seeds the book used by the benchmarks with a given number of transactions.
+
+    The transactions are spread over several years, accounts and categories so that the queries used by the
+    benchmarks visit a realistic amount of rows. Seeding is expensive, therefore the dataset is only rebuilt when the
+    requested size differs from the current one.
+*/
+class Dataset {
+ public:
+    static Dataset* instance();
+
+    /*!
+        \fn void ensure(int size);
+
+        Ensures that the book holds \a size transactions, recreating the database if needed.
+    */
+    void ensure(int size);
+
+    int size() const;
+    int firstYear() const;
+    int lastYear() const;
+
+    QList<AccountPtr> accounts;
+    QList<CategoryPtr> categories;
+    QList<RecurrentTransactionPtr> recurrent;
+
+ private:
+    Dataset() = default;
+    void seed(int size);
+
+    int _size = -1;
+};
+
+}
+
+}
+
+}
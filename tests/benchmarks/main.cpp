@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QStringList>
+
+#include "benchmarks.h"
+
+namespace benchmarks = com::chancho::benchmarks;
+
+namespace {
+    // sizes can be overridden with a comma separated list so that quick runs are possible
+    const char* SIZES_ENV = "CHANCHO_BENCHMARK_SIZES";
+    const QList<int> DEFAULT_SIZES {10000, 100000, 1000000};
+}
+
+int
+main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("chancho-benchmarks");
+    // do not touch the data of the user
+    QStandardPaths::enableTestMode(true);
+
+    QList<int> sizes = DEFAULT_SIZES;
+    if (qEnvironmentVariableIsSet(SIZES_ENV)) {
+        sizes.clear();
+        foreach(const QString& size, QString(qgetenv(SIZES_ENV)).split(",", QString::SkipEmptyParts)) {
+            sizes.append(size.toInt());
+        }
+    }
+
+    // benchmarks are registered grouped by size so that each dataset is seeded only once
+    foreach(int size, sizes) {
+        benchmarks::registerBookBenchmarks(size);
+        benchmarks::registerStatsBenchmarks(size);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -59,6 +59,7 @@ class MockBook: public com::chancho::Book {
     MOCK_METHOD1(numberOfTransactions, int(com::chancho::RecurrentTransactionPtr));
     MOCK_METHOD3(transactions, QList<TransactionPtr>(CategoryPtr, boost::optional<int>, boost::optional<int>));
     MOCK_METHOD1(transactions, QList<TransactionPtr>(AccountPtr));
+    MOCK_METHOD4(search, Book::SearchPage(QString, Book::SearchFilter, Book::SearchCursor, int));
     MOCK_METHOD3(monthsWithTransactions, QList<int>(int, boost::optional<int>, boost::optional<int>));
     MOCK_METHOD1(numberOfMonthsWithTransactions, int(int));
     MOCK_METHOD4(daysWithTransactions, QList<int>(int, int, boost::optional<int>, boost::optional<int>));
@@ -68,12 +69,19 @@ class MockBook: public com::chancho::Book {
     MOCK_METHOD3(incomeForDay, double(int, int, int));
     MOCK_METHOD3(expenseForDay, double(int, int, int));
     MOCK_METHOD0(generateRecurrentTransactions, void());
+    MOCK_METHOD2(generateRecurrentTransactions, QList<QDate>(GenerationProgress, int));
+    MOCK_METHOD0(nextRecurrentDueDate, QDate());
     MOCK_METHOD2(recurrentTransactions, QList<RecurrentTransactionPtr>(boost::optional<int>, boost::optional<int>));
     MOCK_METHOD3(recurrentTransactions, QList<RecurrentTransactionPtr>(CategoryPtr, boost::optional<int>, boost::optional<int>));
+    MOCK_METHOD1(dueRecurrentTransactions, QList<RecurrentTransactionPtr>(QDate));
     MOCK_METHOD0(numberOfRecurrentTransactions, int());
     MOCK_METHOD1(numberOfRecurrentTransactions, int(CategoryPtr));
     MOCK_METHOD2(recurrentCategories, QList<CategoryPtr>(boost::optional<int> limit, boost::optional<int> offset));
     MOCK_METHOD0(numberOfRecurrentCategories, int());
+    MOCK_METHOD1(archive, void(int));
+    MOCK_METHOD1(unarchive, void(int));
+    MOCK_METHOD0(archivedYears, QList<int>());
+    MOCK_METHOD1(setSnapshot, void(SnapshotPtr));
 };
 
 }
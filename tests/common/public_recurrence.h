@@ -39,4 +39,6 @@ class PublicRecurrence : public com::chancho::RecurrentTransaction::Recurrence {
             : com::chancho::RecurrentTransaction::Recurrence(n, s, o) {}
 
     using com::chancho::RecurrentTransaction::Recurrence::generateMissingDates;
+    using com::chancho::RecurrentTransaction::Recurrence::missingDates;
+    using com::chancho::RecurrentTransaction::Recurrence::ocurrencesPassed;
 };
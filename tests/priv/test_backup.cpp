@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <com/chancho/updater.h>
+#include <com/chancho/system/database.h>
+#include <com/chancho/system/database_factory.h>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_transaction.h"
+
+#include "test_backup.h"
+
+namespace sys = com::chancho::system;
+
+namespace {
+
+    void
+    storeTransactions(PublicBook& book, int count) {
+        auto account = std::make_shared<PublicAccount>("Bankia", 0);
+        book.store(account);
+        auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+        book.store(food);
+
+        QList<chancho::TransactionPtr> trans;
+        for (int index = 0; index < count; index++) {
+            trans.append(std::make_shared<PublicTransaction>(account, index + 1, food,
+                QDate(2015, 1, 1).addDays(index % 365), QString("Transaction number %1").arg(index)));
+        }
+        book.store(trans);
+    }
+
+}
+
+void
+TestBackup::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestBackup::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestBackup::testBackup() {
+    PublicBook book;
+    storeTransactions(book, 2000);
+    QVERIFY(!book.isError());
+
+    // a few pages per step so that the copy is done in several of them
+    QList<int> progress;
+    chancho::Backup backup;
+    auto path = backup.backup([&progress](int copied, int total) {
+        QVERIFY(copied <= total);
+        progress.append(copied);
+    }, 4);
+
+    QVERIFY(!backup.isError());
+    QVERIFY(QFile::exists(path));
+    QVERIFY(!QFile::exists(path + ".part"));
+    QCOMPARE(backup.backups(), QStringList() << path);
+    QVERIFY(progress.count() > 1);
+
+    // the copy is a complete book
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(path);
+    QVERIFY(db->open());
+    auto query = db->createQuery();
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Transactions"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 2000);
+    db->close();
+}
+
+void
+TestBackup::testBackupRotation() {
+    PublicBook book;
+    storeTransactions(book, 10);
+    QVERIFY(!book.isError());
+
+    chancho::Backup backup(2);
+    QStringList paths;
+    for (int index = 0; index < 3; index++) {
+        paths.prepend(backup.backup());
+        QVERIFY(!backup.isError());
+        QTest::qWait(5);
+    }
+
+    // only the two newest are kept
+    QCOMPARE(backup.backups(), paths.mid(0, 2));
+    QVERIFY(!QFile::exists(paths.last()));
+}
+
+void
+TestBackup::testIsDue() {
+    chancho::Backup backup;
+    QVERIFY(backup.isDue(7));
+
+    auto path = backup.backup();
+    QVERIFY(!backup.isError());
+
+    auto created = QFileInfo(path).lastModified();
+    QVERIFY(!backup.isDue(7, created.addDays(6)));
+    QVERIFY(backup.isDue(7, created.addDays(7)));
+}
+
+void
+TestBackup::testRestore() {
+    PublicBook book;
+    storeTransactions(book, 10);
+    QVERIFY(!book.isError());
+
+    chancho::Backup backup;
+    auto path = backup.backup();
+    QVERIFY(!backup.isError());
+
+    // changes done after the backup are lost
+    storeTransactions(book, 5);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(), 15);
+
+    QVERIFY(backup.restore(path));
+    QVERIFY(!backup.isError());
+    QCOMPARE(book.numberOfTransactions(), 10);
+    QCOMPARE(book.accounts().count(), 1);
+
+    chancho::Updater updater;
+    QVERIFY(!updater.needsUpgrade());
+}
+
+void
+TestBackup::testRestoreArchives() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 10, food, QDate(2014, 1, 10), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2014, 2, 10), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2015, 1, 10), "Mercadona"));
+    book.store(trans);
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    chancho::Backup backup;
+    auto path = backup.backup();
+    QVERIFY(!backup.isError());
+    QVERIFY(QFile::exists(path + "-archive-2014"));
+    QCOMPARE(backup.backups(), QStringList() << path);
+
+    // the archive is removed by unarchiving the year and restored with the backup
+    book.unarchive(2014);
+    QVERIFY(!book.isError());
+    QVERIFY(!QFile::exists(PublicBook::archivePath(2014)));
+
+    QVERIFY(backup.restore(path));
+    QVERIFY(!backup.isError());
+    QCOMPARE(book.archivedYears(), QList<int>() << 2014);
+    QVERIFY(QFile::exists(PublicBook::archivePath(2014)));
+    QCOMPARE(book.numberOfTransactions(), 3);
+    QCOMPARE(book.transactions(1, 2014).count(), 1);
+    QVERIFY(!book.isError());
+}
+
+void
+TestBackup::testRestoreMissingArchive() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 10, food, QDate(2014, 1, 10), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2015, 1, 10), "Mercadona"));
+    book.store(trans);
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    chancho::Backup backup;
+    auto path = backup.backup();
+    QVERIFY(!backup.isError());
+
+    // a backup without the archive of an archived year is refused and the book is not touched
+    QVERIFY(QFile::remove(path + "-archive-2014"));
+    storeTransactions(book, 5);
+    QVERIFY(!backup.restore(path));
+    QVERIFY(backup.isError());
+    QCOMPARE(book.numberOfTransactions(), 7);
+    QCOMPARE(book.transactions(1, 2014).count(), 1);
+}
+
+void
+TestBackup::testRestoreInvalidFile() {
+    PublicBook book;
+    storeTransactions(book, 10);
+    QVERIFY(!book.isError());
+
+    auto path = chancho::Backup::backupsPath() + "/chancho-invalid.db";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("this is not a database");
+    file.close();
+
+    chancho::Backup backup;
+    QVERIFY(!backup.restore(path));
+    QVERIFY(backup.isError());
+    QVERIFY(!backup.restore(path + ".missing"));
+
+    // the book is not touched
+    QCOMPARE(book.numberOfTransactions(), 10);
+}
+
+QTEST_MAIN(TestBackup)
@@ -63,13 +63,21 @@ TestBook::testInitDatabase() {
 
     // once the db has been created we need to check that it has the correct version and the required tables
     auto tables = db->tables();
-    QCOMPARE(tables.count(), 6);
+    QCOMPARE(tables.count(), 18);  // the search index adds four tables and the transaction ids sqlite_sequence
     QVERIFY(tables.contains("Accounts", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Categories", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Transactions", Qt::CaseInsensitive));
     QVERIFY(tables.contains("RecurrentTransactions", Qt::CaseInsensitive));
-    QVERIFY(tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Versions", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryClosure", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryMonthTotals", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Budgets", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("TransactionsSearch", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("ArchivedYears", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Changes", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("BulkRecurrentTransactions", Qt::CaseInsensitive));
     db->close();
 }
 
@@ -98,13 +106,21 @@ TestBook::testInitDatabaseNoPresentTables() {
 
     // once the db has been created we need to check that it has the correct version and the required tables
     auto tables = db->tables();
-    QCOMPARE(tables.count(), 6);
+    QCOMPARE(tables.count(), 18);  // the search index adds four tables and the transaction ids sqlite_sequence
     QVERIFY(tables.contains("Accounts", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Categories", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Transactions", Qt::CaseInsensitive));
     QVERIFY(tables.contains("RecurrentTransactions", Qt::CaseInsensitive));
-    QVERIFY(tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Versions", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryClosure", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryMonthTotals", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Budgets", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("TransactionsSearch", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("ArchivedYears", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Changes", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("BulkRecurrentTransactions", Qt::CaseInsensitive));
     db->close();
 }
 
@@ -128,13 +144,21 @@ TestBook::testInitDatabasePresentTables() {
 
     // once the db has been created we need to check that it has the correct version and the required tables
     auto tables = db->tables();
-    QCOMPARE(tables.count(), 6);
+    QCOMPARE(tables.count(), 18);  // the search index adds four tables and the transaction ids sqlite_sequence
     QVERIFY(tables.contains("Accounts", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Categories", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Transactions", Qt::CaseInsensitive));
     QVERIFY(tables.contains("RecurrentTransactions", Qt::CaseInsensitive));
-    QVERIFY(tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Versions", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryClosure", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryMonthTotals", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Budgets", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("TransactionsSearch", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("ArchivedYears", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Changes", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("BulkRecurrentTransactions", Qt::CaseInsensitive));
     db->close();
 }
 
@@ -375,6 +375,63 @@ TestBookCategory::testRemoveParentCategory() {
     db->close();
 }
 
+void
+TestBookCategory::testRemoveCategorySubtree() {
+    // create a tree with several levels, remove a middle node and ensure that only its subtree is removed
+    auto root = std::make_shared<PublicCategory>("Root", chancho::Category::Type::EXPENSE);
+    auto middle = std::make_shared<PublicCategory>("Middle", chancho::Category::Type::EXPENSE, root);
+    auto leaf = std::make_shared<PublicCategory>("Leaf", chancho::Category::Type::EXPENSE, middle);
+    auto deepLeaf = std::make_shared<PublicCategory>("Deep leaf", chancho::Category::Type::EXPENSE, leaf);
+    auto sibling = std::make_shared<PublicCategory>("Sibling", chancho::Category::Type::EXPENSE, root);
+
+    PublicBook book;
+    book.store(deepLeaf);
+    book.store(sibling);
+    QVERIFY(!book.isError());
+    QVERIFY(root->wasStoredInDb());
+    QVERIFY(middle->wasStoredInDb());
+    QVERIFY(leaf->wasStoredInDb());
+
+    book.remove(middle);
+    QVERIFY(!book.isError());
+    QVERIFY(!middle->wasStoredInDb());
+
+    auto dbPath = PublicBook::databasePath();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QList<std::shared_ptr<PublicCategory>> removed {leaf, deepLeaf};
+    foreach(const std::shared_ptr<PublicCategory>& cat, removed) {
+        query->prepare(SELECT_CATEGORY_QUERY);
+        query->bindValue(":uuid", cat->_dbId.toString());
+        auto success = query->exec();
+        QVERIFY(success);
+        QVERIFY(!query->next());
+    }
+
+    QList<std::shared_ptr<PublicCategory>> present {root, sibling};
+    foreach(const std::shared_ptr<PublicCategory>& cat, present) {
+        query->prepare(SELECT_CATEGORY_QUERY);
+        query->bindValue(":uuid", cat->_dbId.toString());
+        auto success = query->exec();
+        QVERIFY(success);
+        QVERIFY(query->next());
+    }
+
+    // the closure must not keep references to the removed categories
+    auto success = query->exec("SELECT count(*) FROM CategoryClosure");
+    QVERIFY(success);
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 3);
+
+    db->close();
+}
+
 void
 TestBookCategory::testRemoveNotAdded() {
     // ensure that we cannot delete a not present cat
@@ -52,6 +52,7 @@ class TestBookCategory : public BaseTestCase {
     void testRemoveCategoryNoParent();
     void testRemoveCategoryParent();
     void testRemoveParentCategory();
+    void testRemoveCategorySubtree();
     void testRemoveNotAdded();
 
     void testGetCategoriesEmpty();
@@ -41,8 +41,8 @@ namespace {
     const QString SELECT_RECURRENT_TRANSACTION_QUERY = "SELECT amount, account, category, contents, memo, startDay, startMonth, "\
         "startYear, lastDay, lastMonth, lastYear, endDay, endMonth, endYear, defaultType, numberDays, occurrences "\
         "FROM RecurrentTransactions WHERE uuid=:uuid";
-    const QString SELECT_RECURRENT_TRANSACTION_RELATION = "SELECT generated_transaction FROM "\
-        "RecurrentTransactionRelations WHERE recurrent_transaction=:recurrent_transaction";
+    const QString SELECT_RECURRENT_TRANSACTION_RELATION = "SELECT uuid AS generated_transaction FROM "\
+        "Transactions WHERE recurrent_id=:recurrent_transaction";
 }
 
 void
@@ -1177,6 +1177,209 @@ TestBookRecurrentTransaction::testGenerateRecurrentTransactions() {
     QCOMPARE(transactions.count(), count);
 }
 
+void
+TestBookRecurrentTransaction::testDueRecurrentTransactions() {
+    // just those recurrent transactions with pending occurrences are due, once they are generated the next due date
+    // moves to the future and they are no longer returned
+    auto acc = std::make_shared<PublicAccount>("Bankia", 23.4);
+    auto cat = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto currentDate = QDate::currentDate();
+
+    auto pending = std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 19, cat, currentDate.addMonths(-1)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY, currentDate.addMonths(-1)));
+    auto future = std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 21, cat, currentDate.addDays(1)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, currentDate.addDays(1)));
+    auto ended = std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 150, cat, currentDate.addMonths(-2)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, currentDate.addMonths(-2),
+                    currentDate.addMonths(-2)));
+
+    QList<chancho::RecurrentTransactionPtr> trans;
+    trans << pending << future << ended;
+
+    PublicBook book;
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    book.store(cat);
+    QVERIFY(!book.isError());
+
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto due = book.dueRecurrentTransactions(currentDate);
+    QVERIFY(!book.isError());
+    QCOMPARE(due.count(), 1);
+    QCOMPARE(due.at(0)->transaction->amount, pending->transaction->amount);
+
+    // the future one is due the day it starts repeating
+    due = book.dueRecurrentTransactions(currentDate.addDays(2));
+    QVERIFY(!book.isError());
+    QCOMPARE(due.count(), 2);
+
+    book.generateRecurrentTransactions();
+    QVERIFY(!book.isError());
+
+    due = book.dueRecurrentTransactions(currentDate);
+    QVERIFY(!book.isError());
+    QCOMPARE(due.count(), 0);
+}
+
+void
+TestBookRecurrentTransaction::testGenerateRecurrentTransactionsChunks() {
+    // the occurrences are committed in chunks that can mix different recurrent transactions and the progress is
+    // reported after each one of them
+    auto acc = std::make_shared<PublicAccount>("Bankia", 23.4);
+    auto cat = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto currentDate = QDate::currentDate();
+    auto startDate = currentDate.addDays(-30);
+
+    QList<chancho::RecurrentTransactionPtr> trans;
+    trans.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 19, cat, startDate),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate)
+    ));
+    trans.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 21, cat, startDate),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate)
+    ));
+
+    PublicBook book;
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    book.store(cat);
+    QVERIFY(!book.isError());
+
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QList<int> stored;
+    QList<int> totals;
+    auto months = book.generateRecurrentTransactions([&stored, &totals](int generated, int total) {
+        stored.append(generated);
+        totals.append(total);
+    }, 7);
+    QVERIFY(!book.isError());
+
+    // the first day of the months that got transactions
+    QList<QDate> expectedMonths;
+    auto month = QDate(startDate.year(), startDate.month(), 1);
+    if (startDate.addDays(1).month() != startDate.month()) {
+        month = month.addMonths(1);
+    }
+    while (month <= currentDate) {
+        expectedMonths.append(month);
+        month = month.addMonths(1);
+    }
+    QCOMPARE(months, expectedMonths);
+
+    // 30 occurrences per recurrent transaction stored in chunks of 7
+    QCOMPARE(stored.count(), 9);
+    QCOMPARE(stored.first(), 7);
+    QCOMPARE(stored.last(), 60);
+    foreach(int total, totals) {
+        QCOMPARE(total, 60);
+    }
+
+    QCOMPARE(book.numberOfTransactions(), 60);
+
+    // the last generated date was stored so there is nothing else to generate
+    auto recurrent = book.recurrentTransactions();
+    QCOMPARE(recurrent.count(), 2);
+    foreach(const chancho::RecurrentTransactionPtr& current, recurrent) {
+        QCOMPARE(current->recurrence->lastGenerated, currentDate);
+    }
+    QCOMPARE(book.dueRecurrentTransactions(currentDate).count(), 0);
+}
+
+void
+TestBookRecurrentTransaction::testGenerateRecurrentTransactionsAggregates() {
+    // generated transactions do not go through the insert triggers, the account amount, checkpoints and category
+    // totals must be the same as if they did
+    auto acc = std::make_shared<PublicAccount>("Bankia", 100);
+    auto cat = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+    auto currentDate = QDate::currentDate();
+    auto startDate = currentDate.addDays(-45);
+
+    auto recurrent = std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(acc, 5, cat, startDate),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate));
+
+    PublicBook book;
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    book.store(cat);
+    QVERIFY(!book.isError());
+
+    book.store(recurrent);
+    QVERIFY(!book.isError());
+
+    book.generateRecurrentTransactions([](int, int) {}, 10);
+    QVERIFY(!book.isError());
+
+    auto count = book.numberOfTransactions();
+    QVERIFY(count > 0);
+    QCOMPARE(book.numberOfTransactions(recurrent), count);
+
+    auto accounts = book.accounts();
+    QCOMPARE(accounts.count(), 1);
+    QCOMPARE(accounts.at(0)->amount, 100.0 - 5 * count);
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    query->prepare("SELECT COUNT(*) FROM Transactions WHERE is_recurrent=1");
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), count);
+
+    // the recurrent transaction is not left in the bulk table once the generation is committed
+    query->prepare("SELECT COUNT(*) FROM BulkRecurrentTransactions");
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 0);
+
+    query->prepare("SELECT COUNT(*) FROM Transactions WHERE recurrent_id=:recurrent");
+    query->bindValue(":recurrent", recurrent->_dbId.toString());
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), count);
+
+    // the checkpoints and the category totals add up to the generated amounts
+    double checkpoints = 0;
+    query->prepare("SELECT amount FROM AccountBalanceCheckpoints WHERE account=:account");
+    query->bindValue(":account", acc->_dbId.toString());
+    QVERIFY(query->exec());
+    while (query->next()) {
+        checkpoints += query->value(0).toDouble();
+    }
+    QCOMPARE(checkpoints, -5.0 * count);
+
+    double totals = 0;
+    query->prepare("SELECT amount FROM CategoryMonthTotals WHERE category=:category");
+    query->bindValue(":category", cat->_dbId.toString());
+    QVERIFY(query->exec());
+    while (query->next()) {
+        totals += query->value(0).toDouble();
+    }
+    QCOMPARE(totals, -5.0 * count);
+}
+
 void
 TestBookRecurrentTransaction::testNumberOfRecurrentTransactions_data() {
     QTest::addColumn<PublicAccountPtr>("account");
@@ -2083,6 +2286,99 @@ TestBookRecurrentTransaction::testUpdateRecurrentTransactionsWithUpdates() {
     }
 }
 
+void
+TestBookRecurrentTransaction::testUpdateRecurrentTransactionsAggregates() {
+    // the generated transactions are updated in bulk, the accounts, checkpoints and category totals must be the
+    // same as if each of them was updated
+    auto first = std::make_shared<PublicAccount>("Bankia", 100);
+    auto second = std::make_shared<PublicAccount>("BBVA", 100);
+    auto cat = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto startDate = QDate::currentDate().addDays(-40);
+
+    auto tran = std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(first, 10, cat, startDate),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate));
+
+    PublicBook book;
+    book.store(first);
+    QVERIFY(!book.isError());
+
+    book.store(second);
+    QVERIFY(!book.isError());
+
+    book.store(cat);
+    QVERIFY(!book.isError());
+
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    book.generateRecurrentTransactions([](int, int) {}, 10);
+    QVERIFY(!book.isError());
+
+    auto count = book.numberOfTransactions(tran);
+    QVERIFY(count > 1);
+
+    // move all the occurrences to the second account with a different amount
+    tran->transaction->amount = 4;
+    tran->transaction->account = second;
+    book.store(tran, true);
+    QVERIFY(!book.isError());
+
+    auto accounts = book.accounts();
+    QCOMPARE(accounts.count(), 2);
+    foreach(const chancho::AccountPtr& acc, accounts) {
+        if (acc->name == first->name) {
+            QCOMPARE(acc->amount, 100.0);
+        } else {
+            QCOMPARE(acc->amount, 100.0 + 4 * count);
+        }
+    }
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    query->prepare("SELECT COUNT(*) FROM Transactions WHERE recurrent_id=:recurrent AND is_recurrent=1");
+    query->bindValue(":recurrent", tran->_dbId.toString());
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), count);
+
+    // the recurrent transaction is not left in the bulk table once the update is committed
+    query->prepare("SELECT COUNT(*) FROM BulkRecurrentTransactions");
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 0);
+
+    double firstCheckpoints = 0;
+    double secondCheckpoints = 0;
+    query->prepare("SELECT account, amount FROM AccountBalanceCheckpoints");
+    QVERIFY(query->exec());
+    while (query->next()) {
+        if (query->value(0).toString() == first->_dbId.toString()) {
+            firstCheckpoints += query->value(1).toDouble();
+        } else {
+            secondCheckpoints += query->value(1).toDouble();
+        }
+    }
+    QCOMPARE(firstCheckpoints, 0.0);
+    QCOMPARE(secondCheckpoints, 4.0 * count);
+
+    double totals = 0;
+    query->prepare("SELECT amount FROM CategoryMonthTotals WHERE category=:category");
+    query->bindValue(":category", cat->_dbId.toString());
+    QVERIFY(query->exec());
+    while (query->next()) {
+        totals += query->value(0).toDouble();
+    }
+    QCOMPARE(totals, 4.0 * count);
+}
+
 void
 TestBookRecurrentTransaction::testRemoveGeneratedOnDelete() {
     // create a list of recurrent transactions wit diff last dates and state that all the required transactions are
@@ -69,6 +69,9 @@ class TestBookRecurrentTransaction : public BaseTestCase {
     void testRemoveStoredTransaction();
     void testRemoveMissingTransaction();
     void testGenerateRecurrentTransactions();
+    void testDueRecurrentTransactions();
+    void testGenerateRecurrentTransactionsChunks();
+    void testGenerateRecurrentTransactionsAggregates();
     void testNumberOfRecurrentTransactions_data();
     void testNumberOfRecurrentTransactions();
     void testRecurrentTransactionsForCategory_data();
@@ -87,6 +90,7 @@ class TestBookRecurrentTransaction : public BaseTestCase {
     void testUpdateRecurrentTransactionsNoUpdates();
     void testUpdateRecurrentTransactionsWithUpdates_data();
     void testUpdateRecurrentTransactionsWithUpdates();
+    void testUpdateRecurrentTransactionsAggregates();
     void testRemoveGeneratedOnDelete();
 };
 
@@ -21,7 +21,9 @@
  */
 
 #include <QDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QSet>
 
 #include <com/chancho/system/database.h>
 #include <com/chancho/system/database_factory.h>
@@ -2132,4 +2134,628 @@ TestBookTransaction::testCategoryTypeChanged() {
     db->close();
 }
 
+void
+TestBookTransaction::testIsPresent() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto tran = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), "Groceries");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    // white spaces and case are not part of the fingerprint
+    auto same = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), " GROCERIES ");
+    QVERIFY(book.isPresent(same));
+
+    auto otherDay = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 3), "Groceries");
+    QVERIFY(!book.isPresent(otherDay));
+
+    auto otherAmount = std::make_shared<PublicTransaction>(acc, 31, category, QDate(2015, 3, 2), "Groceries");
+    QVERIFY(!book.isPresent(otherAmount));
+
+    auto otherAcc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(otherAcc);
+    QVERIFY(!book.isError());
+    auto otherAccTran = std::make_shared<PublicTransaction>(otherAcc, 30, category, QDate(2015, 3, 2), "Groceries");
+    QVERIFY(!book.isPresent(otherAccTran));
+    QVERIFY(!book.isError());
+}
+
+void
+TestBookTransaction::testFilterPresent() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    // a single coffee is stored yet the statement has two of them in the same day
+    auto coffee = std::make_shared<PublicTransaction>(acc, 2, category, QDate(2015, 3, 2), "Coffee");
+    book.store(coffee);
+    QVERIFY(!book.isError());
+
+    auto firstCoffee = std::make_shared<PublicTransaction>(acc, 2, category, QDate(2015, 3, 2), "Coffee");
+    auto secondCoffee = std::make_shared<PublicTransaction>(acc, 2, category, QDate(2015, 3, 2), "Coffee");
+    auto lunch = std::make_shared<PublicTransaction>(acc, 12, category, QDate(2015, 3, 2), "Lunch");
+
+    auto result = book.filterPresent(QList<chancho::TransactionPtr>() << firstCoffee << lunch << secondCoffee);
+    QVERIFY(!book.isError());
+    QCOMPARE(result.count(), 2);
+    QCOMPARE(result.at(0), std::static_pointer_cast<chancho::Transaction>(lunch));
+    QCOMPARE(result.at(1), std::static_pointer_cast<chancho::Transaction>(secondCoffee));
+
+    book.store(result);
+    QVERIFY(!book.isError());
+    result = book.filterPresent(QList<chancho::TransactionPtr>() << firstCoffee << lunch << secondCoffee);
+    QVERIFY(result.isEmpty());
+}
+
+void
+TestBookTransaction::testFingerprintUpdated() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto tran = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), "Groceries");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    tran->amount = 40;
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    auto old = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), "Groceries");
+    QVERIFY(!book.isPresent(old));
+    auto updated = std::make_shared<PublicTransaction>(acc, 40, category, QDate(2015, 3, 2), "Groceries");
+    QVERIFY(book.isPresent(updated));
+
+    // changing the type of the category negates the stored amounts but not the fingerprint
+    category->type = chancho::Category::Type::INCOME;
+    book.store(category);
+    QVERIFY(!book.isError());
+    QVERIFY(book.isPresent(updated));
+}
+
 QTEST_MAIN(TestBookTransaction)
+
+void
+TestBookTransaction::testSearch() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto order = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), "Amazon order", "Books");
+    auto twice = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 3, 3), "Amazon amazon");
+    auto groceries = std::make_shared<PublicTransaction>(acc, 50, category, QDate(2015, 3, 4), "Groceries",
+                                                         "Paid with the amazon card");
+    auto rent = std::make_shared<PublicTransaction>(acc, 500, category, QDate(2015, 3, 5), "Rent");
+    book.store(QList<chancho::TransactionPtr>() << order << twice << groceries << rent);
+    QVERIFY(!book.isError());
+
+    // the memo is searched too and the transactions that repeat the word are ranked first
+    auto page = book.search("AMAZON");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 3);
+    QCOMPARE(page.transactions.at(0)->contents, twice->contents);
+    QVERIFY(!page.next.isValid());
+
+    // words are matched as prefixes and all of them must be present
+    page = book.search("ama boo");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 1);
+    QCOMPARE(page.transactions.at(0)->contents, order->contents);
+    QCOMPARE(page.transactions.at(0)->memo, order->memo);
+    QCOMPARE(page.transactions.at(0)->account->name, acc->name);
+    QCOMPARE(page.transactions.at(0)->category->name, category->name);
+
+    // the fts operators are not interpreted
+    page = book.search("\"rent OR amazon\"");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 0);
+
+    page = book.search("  ");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 0);
+}
+
+void
+TestBookTransaction::testSearchFilter() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    auto otherAcc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(QList<chancho::AccountPtr>() << acc << otherAcc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    QVERIFY(!book.isError());
+
+    auto restaurants = std::make_shared<chancho::Category>("Restaurants", chancho::Category::Type::EXPENSE, food);
+    auto rent = std::make_shared<chancho::Category>("Rent", chancho::Category::Type::EXPENSE);
+    book.store(QList<chancho::CategoryPtr>() << restaurants << rent);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, food, QDate(2015, 1, 31), "Payment");
+    auto second = std::make_shared<PublicTransaction>(acc, 20, restaurants, QDate(2015, 2, 1), "Payment");
+    auto third = std::make_shared<PublicTransaction>(otherAcc, 10, rent, QDate(2015, 3, 1), "Payment");
+    book.store(QList<chancho::TransactionPtr>() << first << second << third);
+    QVERIFY(!book.isError());
+
+    chancho::Book::SearchFilter filter;
+    filter.account = acc;
+    auto page = book.search("payment", filter);
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 2);
+
+    // the children of the category are part of the results
+    filter = chancho::Book::SearchFilter();
+    filter.category = food;
+    page = book.search("payment", filter);
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 2);
+
+    filter = chancho::Book::SearchFilter();
+    filter.from = QDate(2015, 2, 1);
+    page = book.search("payment", filter);
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 2);
+
+    filter.to = QDate(2015, 2, 28);
+    page = book.search("payment", filter);
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 1);
+    QCOMPARE(page.transactions.at(0)->date, second->date);
+}
+
+void
+TestBookTransaction::testSearchPages() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    // all the transactions have the same rank, the pages must not skip or repeat any of them
+    QList<chancho::TransactionPtr> trans;
+    for (int day = 1; day <= 7; day++) {
+        trans.append(std::make_shared<PublicTransaction>(acc, day, category, QDate(2015, 3, day), "Coffee"));
+    }
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QSet<int> found;
+    QList<int> pages;
+    chancho::Book::SearchCursor cursor;
+    do {
+        auto page = book.search("coffee", chancho::Book::SearchFilter(), cursor, 3);
+        QVERIFY(!book.isError());
+        pages.append(page.transactions.count());
+        foreach(const chancho::TransactionPtr& tran, page.transactions) {
+            found.insert(tran->date.day());
+        }
+        cursor = page.next;
+    } while (cursor.isValid());
+
+    QCOMPARE(pages, QList<int>() << 3 << 3 << 1);
+    QCOMPARE(found.count(), 7);
+}
+
+void
+TestBookTransaction::testSearchUpdatedTransactions() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto tran = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 3, 2), "Groceries");
+    book.store(tran);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.search("groceries").transactions.count(), 1);
+
+    tran->contents = "Bakery";
+    book.store(tran);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.search("groceries").transactions.count(), 0);
+    QCOMPARE(book.search("bakery").transactions.count(), 1);
+
+    book.remove(tran);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.search("bakery").transactions.count(), 0);
+}
+
+void
+TestBookTransaction::testArchive() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 20, category, QDate(2014, 3, 5), "Groceries");
+    auto third = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second << third);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.archivedYears(), QList<int>() << 2014);
+    QVERIFY(QFile::exists(PublicBook::archivePath(2014)));
+
+    // the queries of the archived year read its file
+    auto trans = book.transactions(1, 2014);
+    QVERIFY(!book.isError());
+    QCOMPARE(trans.count(), 1);
+    QCOMPARE(trans.at(0)->date, first->date);
+    QCOMPARE(book.numberOfTransactions(3, 2014), 1);
+    QCOMPARE(book.numberOfTransactions(10, 1, 2014), 1);
+    QCOMPARE(book.monthsWithTransactions(2014), QList<int>() << 3 << 1);
+    QCOMPARE(book.daysWithTransactions(3, 2014), QList<int>() << 5);
+
+    // the queries that cross years read all the archives
+    QCOMPARE(book.numberOfTransactions(), 3);
+    QCOMPARE(book.transactions(acc).count(), 3);
+    QCOMPARE(book.transactions(category).count(), 3);
+
+    // the archived transactions keep their entries in the search index
+    auto page = book.search("groceries");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 3);
+
+    // the filters apply to the archived transactions as well
+    chancho::Book::SearchFilter filter;
+    filter.to = QDate(2014, 12, 31);
+    QCOMPARE(book.search("groceries", filter).transactions.count(), 2);
+}
+
+void
+TestBookTransaction::testArchiveKeepsSummaries() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 100);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 20, category, QDate(2014, 3, 5), "Groceries");
+    auto third = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second << third);
+    QVERIFY(!book.isError());
+
+    auto stats = book.stats();
+    auto amount = book.accounts().at(0)->amount;
+    auto balance = stats->balanceForDate(acc, QDate(2014, 2, 1));
+    auto months = stats->monthsTotalForCategory(category, 2014);
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    QCOMPARE(book.accounts().at(0)->amount, amount);
+    QCOMPARE(stats->balanceForDate(acc, QDate(2014, 2, 1)), balance);
+    QCOMPARE(stats->monthsTotalForCategory(category, 2014), months);
+    QVERIFY(!stats->isError());
+}
+
+void
+TestBookTransaction::testArchiveCurrentYear() {
+    PublicBook book;
+
+    book.archive(QDate::currentDate().year());
+    QVERIFY(book.isError());
+    QVERIFY(book.archivedYears().isEmpty());
+}
+
+void
+TestBookTransaction::testArchiveAgain() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    book.store(first);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // transactions added to an archived year are read with the archived ones
+    auto second = std::make_shared<PublicTransaction>(acc, 20, category, QDate(2014, 1, 12), "Groceries");
+    book.store(second);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.transactions(1, 2014).count(), 2);
+    QCOMPARE(book.numberOfTransactions(), 2);
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.transactions(1, 2014).count(), 2);
+    QCOMPARE(book.numberOfTransactions(), 2);
+    QCOMPARE(book.search("groceries").transactions.count(), 2);
+}
+
+void
+TestBookTransaction::testArchivePresent() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    book.store(first);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // the transactions of the archived years are found in their archive
+    auto equal = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto other = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2015, 1, 10), "Groceries");
+    QVERIFY(book.isPresent(equal));
+    QVERIFY(!book.isPresent(other));
+    QVERIFY(!book.isError());
+
+    auto filtered = book.filterPresent(QList<chancho::TransactionPtr>() << equal << other);
+    QVERIFY(!book.isError());
+    QCOMPARE(filtered.count(), 1);
+    QCOMPARE(filtered.at(0)->date, other->date);
+}
+
+void
+TestBookTransaction::testArchiveUpdateAndRemove() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // updating an archived transaction moves it back to the main database
+    first->amount = 50;
+    book.store(first);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.accounts().at(0)->amount, -60.0);
+    QCOMPARE(book.transactions(1, 2014).count(), 1);
+    QCOMPARE(book.transactions(1, 2014).at(0)->amount, first->amount);
+    QCOMPARE(book.numberOfTransactions(), 2);
+    QCOMPARE(book.search("groceries").transactions.count(), 2);
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // removing an archived transaction removes it from its archive and from the search index
+    book.remove(first);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.accounts().at(0)->amount, -10.0);
+    QCOMPARE(book.transactions(1, 2014).count(), 0);
+    QCOMPARE(book.numberOfTransactions(), 1);
+    QCOMPARE(book.search("groceries").transactions.count(), 1);
+}
+
+void
+TestBookTransaction::testArchiveMissing() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+    QVERIFY(QFile::remove(PublicBook::archivePath(2014)));
+
+    // a missing archive is reported instead of returning an empty year
+    book.transactions(1, 2014);
+    QVERIFY(book.isError());
+
+    auto stats = book.stats();
+    stats->monthsTotalForCategory(category, 2014);
+    QVERIFY(stats->isError());
+}
+
+void
+TestBookTransaction::testArchiveRemoveAccount() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    auto other = std::make_shared<PublicAccount>("Cash", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+    book.store(other);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(other, 10, category, QDate(2014, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // the archived transactions of the account are removed with it
+    book.remove(acc);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(), 1);
+    QCOMPARE(book.transactions(1, 2014).count(), 0);
+    QCOMPARE(book.transactions(2, 2014).count(), 1);
+    QCOMPARE(book.transactions(other).count(), 1);
+}
+
+void
+TestBookTransaction::testArchiveRemoveCategory() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    auto other = std::make_shared<chancho::Category>("Rent", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+    book.store(other);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 10, other, QDate(2014, 2, 1), "Rent");
+    book.store(QList<chancho::TransactionPtr>() << first << second);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    // the archived transactions of the category are removed with it
+    book.remove(category);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(), 1);
+    QCOMPARE(book.transactions(1, 2014).count(), 0);
+    QCOMPARE(book.transactions(other).count(), 1);
+    QCOMPARE(book.accounts().at(0)->amount, -10.0);
+}
+
+void
+TestBookTransaction::testArchiveLimit() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    QList<chancho::TransactionPtr> trans;
+    for (int year = 2000; year <= 2000 + PublicBook::MAX_ARCHIVED_YEARS; year++) {
+        trans.append(std::make_shared<PublicTransaction>(acc, 1, category, QDate(year, 1, 10), "Groceries"));
+    }
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    for (int year = 2000; year < 2000 + PublicBook::MAX_ARCHIVED_YEARS; year++) {
+        book.archive(year);
+        QVERIFY(!book.isError());
+    }
+
+    // no more years than the databases sqlite can attach are archived
+    book.archive(2000 + PublicBook::MAX_ARCHIVED_YEARS);
+    QVERIFY(book.isError());
+    QCOMPARE(book.archivedYears().count(), PublicBook::MAX_ARCHIVED_YEARS);
+
+    // the years already archived can be archived again
+    PublicBook other;
+    other.archive(2000);
+    QVERIFY(!other.isError());
+    QCOMPARE(other.numberOfTransactions(), PublicBook::MAX_ARCHIVED_YEARS + 1);
+    QCOMPARE(other.transactions(acc).count(), PublicBook::MAX_ARCHIVED_YEARS + 1);
+}
+
+void
+TestBookTransaction::testUnarchive() {
+    PublicBook book;
+
+    auto acc = std::make_shared<PublicAccount>("BBVA", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto category = std::make_shared<chancho::Category>("Food", chancho::Category::Type::EXPENSE);
+    book.store(category);
+    QVERIFY(!book.isError());
+
+    auto first = std::make_shared<PublicTransaction>(acc, 30, category, QDate(2014, 1, 10), "Groceries");
+    auto second = std::make_shared<PublicTransaction>(acc, 10, category, QDate(2015, 2, 1), "Groceries");
+    book.store(QList<chancho::TransactionPtr>() << first << second);
+    QVERIFY(!book.isError());
+    auto amount = book.accounts().at(0)->amount;
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    book.unarchive(2014);
+    QVERIFY(!book.isError());
+    QVERIFY(book.archivedYears().isEmpty());
+    QVERIFY(!QFile::exists(PublicBook::archivePath(2014)));
+
+    QCOMPARE(book.transactions(1, 2014).count(), 1);
+    QCOMPARE(book.numberOfTransactions(), 2);
+    QCOMPARE(book.accounts().at(0)->amount, amount);
+    QCOMPARE(book.search("groceries").transactions.count(), 2);
+
+    // only the archived years can be unarchived
+    book.unarchive(2015);
+    QVERIFY(book.isError());
+}
@@ -106,4 +106,25 @@ class TestBookTransaction : public BaseTestCase {
     void testMoveIncomeAccounts();
 
     void testCategoryTypeChanged();
+
+    void testIsPresent();
+    void testFilterPresent();
+    void testFingerprintUpdated();
+
+    void testSearch();
+    void testSearchFilter();
+    void testSearchPages();
+    void testSearchUpdatedTransactions();
+
+    void testArchive();
+    void testArchiveKeepsSummaries();
+    void testArchiveCurrentYear();
+    void testArchiveAgain();
+    void testArchivePresent();
+    void testArchiveUpdateAndRemove();
+    void testArchiveMissing();
+    void testArchiveRemoveAccount();
+    void testArchiveRemoveCategory();
+    void testArchiveLimit();
+    void testUnarchive();
 };
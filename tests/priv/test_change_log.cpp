@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_recurrence.h"
+#include "public_recurrent_transaction.h"
+#include "public_transaction.h"
+
+#include "test_change_log.h"
+
+void
+TestChangeLog::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestChangeLog::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestChangeLog::testTriggersLogChanges() {
+    chancho::ChangeLog log;
+    auto first = log.lastSequence();
+    QVERIFY(!log.isError());
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Mercadona");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    // the account also changed its amount but only the changes done by the user are logged
+    auto changes = log.changes(first);
+    QVERIFY(!log.isError());
+    QCOMPARE(changes.count(), 3);
+    QCOMPARE(changes.at(0).entity, chancho::ChangeLog::Entity::ACCOUNT);
+    QCOMPARE(changes.at(0).uuid, account->_dbId);
+    QCOMPARE(changes.at(0).operation, chancho::ChangeLog::Operation::INSERT);
+    QCOMPARE(changes.at(1).entity, chancho::ChangeLog::Entity::CATEGORY);
+    QCOMPARE(changes.at(1).uuid, food->_dbId);
+    QCOMPARE(changes.at(2).entity, chancho::ChangeLog::Entity::TRANSACTION);
+    QCOMPARE(changes.at(2).uuid, tran->_dbId);
+
+    // the last change of a row is the one returned
+    tran->amount = 30;
+    book.store(tran);
+    book.remove(food);
+    QVERIFY(!book.isError());
+
+    changes = log.changes(first);
+    QCOMPARE(changes.count(), 3);
+    QCOMPARE(changes.at(0).entity, chancho::ChangeLog::Entity::ACCOUNT);
+    QCOMPARE(changes.at(1).entity, chancho::ChangeLog::Entity::TRANSACTION);
+    QCOMPARE(changes.at(1).operation, chancho::ChangeLog::Operation::DELETE);
+    QCOMPARE(changes.at(2).entity, chancho::ChangeLog::Entity::CATEGORY);
+    QCOMPARE(changes.at(2).operation, chancho::ChangeLog::Operation::DELETE);
+}
+
+void
+TestChangeLog::testChangesSince() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    chancho::ChangeLog log;
+    auto since = log.lastSequence();
+    QVERIFY(since > 0);
+
+    account->name = "BBVA";
+    book.store(account);
+    QVERIFY(!book.isError());
+
+    auto changes = log.changes(since);
+    QCOMPARE(changes.count(), 1);
+    QCOMPARE(changes.at(0).uuid, account->_dbId);
+    QCOMPARE(changes.at(0).operation, chancho::ChangeLog::Operation::UPDATE);
+    QVERIFY(changes.at(0).sequence > since);
+    QCOMPARE(log.lastSequence(), changes.at(0).sequence);
+    QCOMPARE(log.changes(log.lastSequence()).count(), 0);
+}
+
+void
+TestChangeLog::testExportChanges() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    chancho::ChangeLog log;
+    auto since = log.exportChanges(path);
+    QVERIFY(!log.isError());
+    QCOMPARE(since, log.lastSequence());
+
+    auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Mercadona");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    // the header and a line per row changed after the last export
+    auto last = log.exportChanges(path, since);
+    QVERIFY(!log.isError());
+    QVERIFY(last > since);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    auto lines = QString(file.readAll()).split("\n", QString::SkipEmptyParts);
+    QCOMPARE(lines.count(), 2);
+    QVERIFY(lines.at(1).contains(tran->_dbId.toString()));
+    QVERIFY(lines.at(1).contains("Mercadona"));
+}
+
+void
+TestChangeLog::testApplyChanges() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+
+    {
+        PublicBook book;
+        auto account = std::make_shared<PublicAccount>("Bankia", 100);
+        book.store(account);
+        auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+        book.store(food);
+        auto bakery = std::make_shared<PublicCategory>("Bakery", chancho::Category::Type::EXPENSE, food);
+        book.store(bakery);
+
+        QList<chancho::TransactionPtr> trans;
+        trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Mercadona"));
+        trans.append(std::make_shared<PublicTransaction>(account, 5, bakery, QDate(2015, 1, 11), "Bread"));
+        book.store(trans);
+        QVERIFY(!book.isError());
+
+        chancho::ChangeLog log;
+        QVERIFY(log.exportChanges(path) > 0);
+        QVERIFY(!log.isError());
+    }
+
+    // the database is removed so that the changes are applied to a different copy
+    QFileInfo fi(PublicBook::databasePath());
+    QVERIFY(removeDir(fi.absolutePath()));
+    PublicBook::initDatabse();
+
+    chancho::ChangeLog log;
+    QVERIFY(log.applyChanges(path) > 0);
+    QVERIFY(!log.isError());
+
+    // the balances are calculated by the book as if the transactions were stored in it
+    PublicBook book;
+    auto accounts = book.accounts();
+    QCOMPARE(accounts.count(), 1);
+    QCOMPARE(accounts.at(0)->name, QString("Bankia"));
+    QCOMPARE(accounts.at(0)->initialAmount, 100.0);
+    QCOMPARE(accounts.at(0)->amount, 75.0);
+
+    auto categories = book.categories();
+    bool found = false;
+    foreach(const chancho::CategoryPtr& cat, categories) {
+        if (cat->name == "Bakery") {
+            found = true;
+            QVERIFY(cat->parent != nullptr);
+            QCOMPARE(cat->parent->name, QString("Food"));
+        }
+    }
+    QVERIFY(found);
+    QCOMPARE(book.numberOfTransactions(1, 2015), 2);
+
+    // applying the same file again does not duplicate the rows
+    QVERIFY(log.applyChanges(path) > 0);
+    QCOMPARE(book.numberOfTransactions(1, 2015), 2);
+    QCOMPARE(book.accounts().at(0)->amount, 75.0);
+}
+
+void
+TestChangeLog::testApplyChangesNotLogged() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    chancho::ChangeLog log;
+    auto since = log.lastSequence();
+
+    // the other copy edits the account and removes the category
+    account->initialAmount = 50;
+    book.store(account);
+    book.remove(food);
+    QVERIFY(log.exportChanges(path, since) > since);
+
+    account->initialAmount = 0;
+    book.store(account);
+    QVERIFY(!book.isError());
+    since = log.lastSequence();
+
+    QCOMPARE(log.applyChanges(path), 2);
+    QVERIFY(!log.isError());
+    QCOMPARE(log.changes(since).count(), 0);
+    QCOMPARE(book.accounts().at(0)->initialAmount, 50.0);
+    QCOMPARE(book.accounts().at(0)->amount, 50.0);
+    foreach(const chancho::CategoryPtr& cat, book.categories()) {
+        QVERIFY(cat->name != "Food");
+    }
+}
+
+void
+TestChangeLog::testApplyChangesArchived() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2014, 1, 10), "Mercadona");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    chancho::ChangeLog log;
+    auto since = log.lastSequence();
+
+    // the other copy edits a transaction of a year that this one has archived
+    tran->amount = 30;
+    book.store(tran);
+    QVERIFY(log.exportChanges(path, since) > since);
+
+    tran->amount = 20;
+    book.store(tran);
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    QCOMPARE(log.applyChanges(path), 1);
+    QVERIFY(!log.isError());
+
+    // the archived transaction is updated instead of inserted again
+    QCOMPARE(book.numberOfTransactions(), 1);
+    auto trans = book.transactions(1, 2014);
+    QCOMPARE(trans.count(), 1);
+    QCOMPARE(trans.at(0)->amount, 30.0);
+    QCOMPARE(book.accounts().at(0)->amount, -30.0);
+    QVERIFY(!book.isError());
+}
+
+void
+TestChangeLog::testGeneratedTransactionsNotLogged() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+    book.store(rent);
+    QVERIFY(!book.isError());
+
+    chancho::ChangeLog log;
+    auto since = log.lastSequence();
+
+    auto transaction = std::make_shared<PublicTransaction>(account, 3, rent);
+    auto recurrence = std::make_shared<PublicRecurrence>(
+            chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 1), QDate(2015, 3, 1));
+    auto recurrent = std::make_shared<PublicRecurrentTransaction>(transaction, recurrence);
+    book.store(recurrent);
+    QVERIFY(!book.isError());
+    auto stored = log.lastSequence();
+
+    // every copy generates the occurrences, neither them nor the generation dates of the recurrent transaction are
+    // changes of the user
+    book.generateRecurrentTransactions();
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(recurrent), 3);
+    QCOMPARE(log.lastSequence(), stored);
+
+    int count = 0;
+    foreach(const chancho::ChangeLog::Change& change, log.changes(since)) {
+        if (change.entity == chancho::ChangeLog::Entity::TRANSACTION) {
+            QCOMPARE(change.uuid, transaction->_dbId);
+            count++;
+        }
+    }
+    QCOMPARE(count, 1);
+}
+
+void
+TestChangeLog::testApplyRecurrentTransactions() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+    auto editPath = dir.path() + "/edit.jsonl";
+
+    {
+        PublicBook book;
+        auto account = std::make_shared<PublicAccount>("Bankia", 0);
+        book.store(account);
+        auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+        book.store(rent);
+
+        auto transaction = std::make_shared<PublicTransaction>(account, 3, rent);
+        auto recurrence = std::make_shared<PublicRecurrence>(
+                chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 1), QDate(2015, 3, 1));
+        auto recurrent = std::make_shared<PublicRecurrentTransaction>(transaction, recurrence);
+        book.store(recurrent);
+        book.generateRecurrentTransactions();
+        QVERIFY(!book.isError());
+
+        chancho::ChangeLog log;
+        auto since = log.exportChanges(path);
+        QVERIFY(since > 0);
+
+        // the other copy edits an occurrence that it generated
+        foreach(const chancho::TransactionPtr& tran, book.transactions(recurrent)) {
+            if (tran->date == QDate(2015, 2, 1)) {
+                tran->amount = 5;
+                book.store(tran);
+            }
+        }
+        QVERIFY(!book.isError());
+        QCOMPARE(book.accounts().at(0)->amount, -11.0);
+        QVERIFY(log.exportChanges(editPath, since) > since);
+    }
+
+    QFileInfo fi(PublicBook::databasePath());
+    QVERIFY(removeDir(fi.absolutePath()));
+    PublicBook::initDatabse();
+
+    chancho::ChangeLog log;
+    QVERIFY(log.applyChanges(path) > 0);
+    QVERIFY(!log.isError());
+
+    // the occurrences are generated by this copy from the start of the recurrent transaction
+    PublicBook book;
+    auto recurrent = book.recurrentTransactions();
+    QCOMPARE(recurrent.count(), 1);
+    QCOMPARE(book.numberOfTransactions(recurrent.at(0)), 1);
+    book.generateRecurrentTransactions();
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(recurrent.at(0)), 3);
+    QCOMPARE(book.accounts().at(0)->amount, -9.0);
+
+    // the occurrences have the same uuid in both copies, the edit updates the one generated here
+    QCOMPARE(log.applyChanges(editPath), 1);
+    QVERIFY(!log.isError());
+    QCOMPARE(book.numberOfTransactions(recurrent.at(0)), 3);
+    QCOMPARE(book.accounts().at(0)->amount, -11.0);
+}
+
+void
+TestChangeLog::testApplyInvalidFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto path = dir.path() + "/changes.jsonl";
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("this is not a change log\n");
+    file.close();
+
+    chancho::ChangeLog log;
+    QCOMPARE(log.applyChanges(path), -1);
+    QVERIFY(log.isError());
+    QCOMPARE(log.applyChanges(path + ".missing"), -1);
+    QVERIFY(log.isError());
+}
+
+void
+TestChangeLog::testCompact() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    for (int index = 0; index < 5; index++) {
+        account->name = QString("Bankia %1").arg(index);
+        book.store(account);
+    }
+    QVERIFY(!book.isError());
+
+    chancho::ChangeLog log;
+    auto last = log.lastSequence();
+    auto changes = log.changes();
+
+    // only the last entry of the account is kept
+    QVERIFY(log.compact() >= 5);
+    QVERIFY(!log.isError());
+    QCOMPARE(log.changes().count(), changes.count());
+    QCOMPARE(log.changes().last().sequence, last);
+    QCOMPARE(log.lastSequence(), last);
+
+    // the entries applied by the other copy are removed but the last one
+    QVERIFY(log.compact(last) >= 0);
+    QVERIFY(!log.isError());
+    QCOMPARE(log.lastSequence(), last);
+    QCOMPARE(log.changes().count(), 1);
+}
+
+QTEST_MAIN(TestChangeLog)
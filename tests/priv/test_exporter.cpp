@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_transaction.h"
+
+#include "test_exporter.h"
+
+void
+TestExporter::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestExporter::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestExporter::testFormatForFile() {
+    QCOMPARE(*chancho::Exporter::formatForFile("/tmp/book.csv"), chancho::Exporter::Format::CSV);
+    QCOMPARE(*chancho::Exporter::formatForFile("/tmp/book.JSON"), chancho::Exporter::Format::JSON);
+    QCOMPARE(*chancho::Exporter::formatForFile("/tmp/book.jsonl"), chancho::Exporter::Format::JSON);
+    QVERIFY(!chancho::Exporter::formatForFile("/tmp/book.pdf"));
+}
+
+void
+TestExporter::testExportCsv() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    book.store(salary);
+
+    // stored out of order and with separators and quotes in the contents
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 2000, salary, QDate(2015, 2, 1), "Payroll"));
+    trans.append(std::make_shared<PublicTransaction>(account, 20.5, food, QDate(2015, 1, 10), "Shop, \"fresh\"",
+        "Weekly"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QByteArray result;
+    QBuffer buffer(&result);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    chancho::Exporter exporter;
+    auto count = exporter.exportTo(&buffer, chancho::Exporter::Format::CSV);
+
+    QVERIFY(!exporter.isError());
+    QCOMPARE(count, 2LL);
+    QCOMPARE(QString::fromUtf8(result), QString("Date,Account,Category,Amount,Contents,Memo\n"
+        "2015-01-10,Bankia,Food,-20.5,\"Shop, \"\"fresh\"\"\",Weekly\n"
+        "2015-02-01,Bankia,Salary,2000,Payroll,\n"));
+}
+
+void
+TestExporter::testExportJson() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    auto tran = std::make_shared<PublicTransaction>(account, 20.5, food, QDate(2015, 1, 10), "Shop", "Weekly");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    QByteArray result;
+    QBuffer buffer(&result);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    chancho::Exporter exporter;
+    auto count = exporter.exportTo(&buffer, chancho::Exporter::Format::JSON);
+    QVERIFY(!exporter.isError());
+    QCOMPARE(count, 1LL);
+
+    // one object per line
+    auto lines = result.split('\n');
+    QCOMPARE(lines.count(), 2);
+    QVERIFY(lines.last().isEmpty());
+
+    auto object = QJsonDocument::fromJson(lines.first()).object();
+    QCOMPARE(object["date"].toString(), QString("2015-01-10"));
+    QCOMPARE(object["account"].toString(), QString("Bankia"));
+    QCOMPARE(object["category"].toString(), QString("Food"));
+    QCOMPARE(object["amount"].toDouble(), -20.5);
+    QCOMPARE(object["contents"].toString(), QString("Shop"));
+    QCOMPARE(object["memo"].toString(), QString("Weekly"));
+}
+
+void
+TestExporter::testExportInChunks() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    // enough rows to fill the buffer several times
+    QList<chancho::TransactionPtr> trans;
+    for (int index = 0; index < 3000; index++) {
+        trans.append(std::make_shared<PublicTransaction>(account, index, food, QDate(2015, 1, 1).addDays(index % 365),
+            QString("Transaction number %1").arg(index)));
+    }
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QByteArray result;
+    QBuffer buffer(&result);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    QList<qint64> progress;
+    chancho::Exporter exporter;
+    auto count = exporter.exportTo(&buffer, chancho::Exporter::Format::JSON, [&progress](qint64 done, qint64 total) {
+        QCOMPARE(total, 3000LL);
+        progress.append(done);
+    });
+
+    QVERIFY(!exporter.isError());
+    QCOMPARE(count, 3000LL);
+    QVERIFY(progress.count() > 1);
+    QCOMPARE(progress.last(), 3000LL);
+    QCOMPARE(result.count('\n'), 3000);
+}
+
+void
+TestExporter::testExportCancelled() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    // enough rows to report the progress before the end
+    QList<chancho::TransactionPtr> trans;
+    for (int index = 0; index < 3000; index++) {
+        trans.append(std::make_shared<PublicTransaction>(account, index, food, QDate(2015, 1, 1).addDays(index % 365),
+            QString("Transaction number %1").arg(index)));
+    }
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto path = QStandardPaths::writableLocation(QStandardPaths::TempLocation) + "/chancho_export.csv";
+    QFile::remove(path);
+
+    // an export cancelled while it runs does not write the file
+    chancho::Exporter exporter;
+    auto count = exporter.exportTo(path, [&exporter](qint64, qint64) {
+        exporter.cancel();
+    });
+
+    QVERIFY(exporter.wasCancelled());
+    QVERIFY(!exporter.isError());
+    QVERIFY(count < 3000LL);
+    QVERIFY(!QFile::exists(path));
+
+    // the following export is not cancelled
+    count = exporter.exportTo(path);
+    QVERIFY(!exporter.wasCancelled());
+    QVERIFY(!exporter.isError());
+    QCOMPARE(count, 3000LL);
+    QVERIFY(QFile::exists(path));
+    QFile::remove(path);
+}
+
+void
+TestExporter::testExportArchivedYears() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 10, food, QDate(2015, 2, 1), "Shop"));
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2014, 3, 1), "Shop"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    book.archive(2014);
+    QVERIFY(!book.isError());
+
+    QByteArray result;
+    QBuffer buffer(&result);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    // the transactions of the archived years are exported as well
+    QList<qint64> totals;
+    chancho::Exporter exporter;
+    auto count = exporter.exportTo(&buffer, chancho::Exporter::Format::CSV, [&totals](qint64, qint64 total) {
+        totals.append(total);
+    });
+
+    QVERIFY(!exporter.isError());
+    QCOMPARE(count, 2LL);
+    QCOMPARE(totals, QList<qint64>() << 2);
+    QCOMPARE(QString::fromUtf8(result), QString("Date,Account,Category,Amount,Contents,Memo\n"
+        "2014-03-01,Bankia,Food,-20,Shop,\n"
+        "2015-02-01,Bankia,Food,-10,Shop,\n"));
+}
+
+QTEST_MAIN(TestExporter)
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <com/chancho/forecast.h>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_transaction.h"
+#include "public_recurrence.h"
+#include "public_recurrent_transaction.h"
+
+#include "test_forecast.h"
+
+namespace chancho = com::chancho;
+
+namespace {
+
+    QList<QPair<QDate, double>>
+    balancesFor(QList<chancho::Forecast::AccountBalances> balances, chancho::AccountPtr account) {
+        foreach(const chancho::Forecast::AccountBalances& current, balances) {
+            if (current.account == account) {
+                return current.balances;
+            }
+        }
+        return QList<QPair<QDate, double>>();
+    }
+
+}
+
+void
+TestForecast::init() {
+    BaseTestCase::init();
+}
+
+void
+TestForecast::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestForecast::testBalancesMergeByDate() {
+    auto first = std::make_shared<PublicAccount>("Bankia", 100);
+    first->_dbId = QUuid::createUuid();
+    auto second = std::make_shared<PublicAccount>("BBVA", 50);
+    second->_dbId = QUuid::createUuid();
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+
+    auto weekly = std::make_shared<PublicRecurrence>(
+            chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY, QDate(2015, 1, 1));
+    weekly->lastGenerated = QDate(2015, 1, 1);
+    auto monthly = std::make_shared<PublicRecurrence>(
+            chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 5));
+    auto daily = std::make_shared<PublicRecurrence>(
+            chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, QDate(2015, 1, 1), boost::optional<int>(3));
+    daily->lastGenerated = QDate(2015, 1, 1);
+
+    QList<chancho::RecurrentTransactionPtr> recurrents;
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(first, 10, salary, QDate(2015, 1, 1)), weekly));
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(first, 30, rent, QDate(2015, 1, 5)), monthly));
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(second, 1, rent, QDate(2015, 1, 1)), daily));
+
+    QList<chancho::AccountPtr> accounts;
+    accounts.append(first);
+    accounts.append(second);
+
+    chancho::Forecast forecast(accounts, recurrents);
+    auto result = forecast.balances(QDate(2015, 1, 1), QDate(2015, 2, 10));
+    QCOMPARE(result.count(), 2);
+
+    // the weekly income and the monthly expense share the 5th of February
+    QList<QPair<QDate, double>> expected;
+    expected.append(qMakePair(QDate(2015, 1, 1), 100.0));
+    expected.append(qMakePair(QDate(2015, 1, 8), 110.0));
+    expected.append(qMakePair(QDate(2015, 1, 15), 120.0));
+    expected.append(qMakePair(QDate(2015, 1, 22), 130.0));
+    expected.append(qMakePair(QDate(2015, 1, 29), 140.0));
+    expected.append(qMakePair(QDate(2015, 2, 5), 120.0));
+    QCOMPARE(balancesFor(result, first), expected);
+
+    // the daily expense stops after three occurrences
+    expected.clear();
+    expected.append(qMakePair(QDate(2015, 1, 1), 50.0));
+    expected.append(qMakePair(QDate(2015, 1, 2), 49.0));
+    expected.append(qMakePair(QDate(2015, 1, 3), 48.0));
+    expected.append(qMakePair(QDate(2015, 1, 4), 47.0));
+    QCOMPARE(balancesFor(result, second), expected);
+}
+
+void
+TestForecast::testBalancesPendingOccurrences() {
+    // occurrences that were not generated before the start of the forecast are part of the initial balance
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    account->_dbId = QUuid::createUuid();
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+
+    QList<chancho::RecurrentTransactionPtr> recurrents;
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(account, 5, salary, QDate(2015, 1, 1)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, QDate(2015, 1, 1))));
+
+    QList<chancho::AccountPtr> accounts;
+    accounts.append(account);
+
+    chancho::Forecast forecast(accounts, recurrents);
+    auto result = forecast.balances(QDate(2015, 1, 4), QDate(2015, 1, 5));
+
+    QList<QPair<QDate, double>> expected;
+    expected.append(qMakePair(QDate(2015, 1, 4), 115.0));
+    expected.append(qMakePair(QDate(2015, 1, 5), 120.0));
+    QCOMPARE(balancesFor(result, account), expected);
+}
+
+void
+TestForecast::testBalancesEndedRecurrence() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    account->_dbId = QUuid::createUuid();
+    auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+
+    QList<chancho::RecurrentTransactionPtr> recurrents;
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(account, 30, rent, QDate(2015, 1, 1)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 1),
+                    QDate(2015, 2, 15))));
+
+    QList<chancho::AccountPtr> accounts;
+    accounts.append(account);
+
+    chancho::Forecast forecast(accounts, recurrents);
+    auto result = forecast.balances(QDate(2015, 1, 1), QDate(2015, 12, 31));
+
+    QList<QPair<QDate, double>> expected;
+    expected.append(qMakePair(QDate(2015, 1, 1), 100.0));
+    expected.append(qMakePair(QDate(2015, 2, 1), 70.0));
+    QCOMPARE(balancesFor(result, account), expected);
+}
+
+void
+TestForecast::testBalancesUnknownAccount() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    account->_dbId = QUuid::createUuid();
+    auto other = std::make_shared<PublicAccount>("BBVA", 100);
+    other->_dbId = QUuid::createUuid();
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+
+    QList<chancho::RecurrentTransactionPtr> recurrents;
+    recurrents.append(std::make_shared<PublicRecurrentTransaction>(
+            std::make_shared<PublicTransaction>(other, 5, salary, QDate(2015, 1, 1)),
+            std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, QDate(2015, 1, 1))));
+
+    QList<chancho::AccountPtr> accounts;
+    accounts.append(account);
+
+    chancho::Forecast forecast(accounts, recurrents);
+    auto result = forecast.balances(QDate(2015, 1, 1), QDate(2015, 1, 31));
+    QCOMPARE(result.count(), 1);
+
+    QList<QPair<QDate, double>> expected;
+    expected.append(qMakePair(QDate(2015, 1, 1), 100.0));
+    QCOMPARE(balancesFor(result, account), expected);
+}
+
+QTEST_MAIN(TestForecast)
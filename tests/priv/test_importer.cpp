@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QBuffer>
+#include <QFileInfo>
+
+#include "public_account.h"
+#include "public_category.h"
+
+#include "test_importer.h"
+
+namespace {
+
+    std::shared_ptr<PublicBook>
+    bookWith(PublicAccountPtr account, QList<PublicCategoryPtr> categories) {
+        auto book = std::make_shared<PublicBook>();
+        book->store(account);
+        foreach(const PublicCategoryPtr& category, categories) {
+            book->store(category);
+        }
+        return book;
+    }
+
+}
+
+void
+TestImporter::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestImporter::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestImporter::testFormatForFile() {
+    QCOMPARE(*chancho::Importer::formatForFile("/tmp/statement.csv"), chancho::Importer::Format::CSV);
+    QCOMPARE(*chancho::Importer::formatForFile("/tmp/statement.OFX"), chancho::Importer::Format::OFX);
+    QCOMPARE(*chancho::Importer::formatForFile("/tmp/statement.qif"), chancho::Importer::Format::QIF);
+    QVERIFY(!chancho::Importer::formatForFile("/tmp/statement.pdf"));
+}
+
+void
+TestImporter::testImportCsv() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food << rent);
+    QVERIFY(!book->isError());
+
+    // semicolon separated with decimal commas, a quoted description and a row that cannot be parsed
+    QByteArray statement("Date;Description;Amount;Category\n"
+        "2014-12-30;\"Shop; groceries\";-1.020,50;\n"
+        "2015-01-01;Flat;-500;Rent\n"
+        "not a date;Broken;-3;Food\n"
+        "01/02/2015;Payroll;2000;Salary\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    QList<qint64> progress;
+    chancho::Importer importer(book, account);
+    auto months = importer.import(&buffer, chancho::Importer::Format::CSV, [&progress](qint64 read, qint64) {
+        progress.append(read);
+    }, 2);
+
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 3);
+    QCOMPARE(importer.skipped(), 1);
+    // the progress counts the lines parsed, not what the stream read ahead
+    QCOMPARE(progress.count(), 2);
+    QCOMPARE(progress.at(0), static_cast<qint64>(statement.indexOf("not a date")));
+    QCOMPARE(progress.at(1), static_cast<qint64>(statement.size()));
+    QCOMPARE(months, QList<QDate>() << QDate(2014, 12, 1) << QDate(2015, 1, 1) << QDate(2015, 2, 1));
+
+    auto accounts = book->accounts();
+    QCOMPARE(accounts.count(), 1);
+    QCOMPARE(accounts.first()->amount, 100 - 1020.5 - 500 + 2000);
+
+    // the rows without a known category use the first one of the type
+    auto transactions = book->transactions(12, 2014);
+    QCOMPARE(transactions.count(), 1);
+    QCOMPARE(transactions.first()->contents, QString("Shop; groceries"));
+    QCOMPARE(transactions.first()->category->type, chancho::Category::Type::EXPENSE);
+
+    transactions = book->transactions(1, 2015);
+    QCOMPARE(transactions.count(), 1);
+    QCOMPARE(transactions.first()->category->name, rent->name);
+}
+
+void
+TestImporter::testImportCsvCategoryOfOtherType() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food);
+    QVERIFY(!book->isError());
+
+    // a refund in an expense category and a charge in an income one keep the sign of their amount
+    QByteArray statement("Date,Description,Amount,Category\n"
+        "2015-01-05,Refund,30,Food\n"
+        "2015-01-06,Fee,-20,Salary\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    importer.import(&buffer, chancho::Importer::Format::CSV);
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 2);
+    QCOMPARE(book->accounts().first()->amount, 100.0 + 30 - 20);
+
+    auto transactions = book->transactions(1, 2015);
+    QCOMPARE(transactions.count(), 2);
+    foreach(const chancho::TransactionPtr& tran, transactions) {
+        if (tran->contents == "Refund") {
+            QCOMPARE(tran->category->type, chancho::Category::Type::INCOME);
+        } else {
+            QCOMPARE(tran->category->type, chancho::Category::Type::EXPENSE);
+        }
+    }
+}
+
+void
+TestImporter::testImportCsvMissingColumns() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 100);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << food);
+
+    QByteArray statement("When,What\n2015-01-01,Flat\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    auto months = importer.import(&buffer, chancho::Importer::Format::CSV);
+    QVERIFY(months.isEmpty());
+    QCOMPARE(importer.imported(), 0);
+}
+
+void
+TestImporter::testImportCsvAmbiguousAmounts() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food);
+
+    // 1.500 does not tell the separator until the second row uses the comma for the decimals
+    QByteArray statement("Date;Description;Amount\n"
+        "2015-01-01;Bonus;1.500\n"
+        "2015-01-02;Coffee;-2,50\n"
+        "2015-01-03;Payroll;1.500\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    importer.import(&buffer, chancho::Importer::Format::CSV);
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 2);
+    QCOMPARE(importer.skipped(), 1);
+    QCOMPARE(book->accounts().first()->amount, 1500 - 2.5);
+}
+
+void
+TestImporter::testImportCsvDecimalSeparator() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary);
+
+    QByteArray statement("Date;Description;Amount\n"
+        "2015-01-01;Interests;1.500\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    importer.setDecimalSeparator('.');
+    importer.import(&buffer, chancho::Importer::Format::CSV);
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 1);
+    QCOMPARE(book->accounts().first()->amount, 1.5);
+}
+
+void
+TestImporter::testImportCsvWindowsLineEndings() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << food);
+
+    QByteArray statement("Date,Description,Amount\r\n"
+        "2015-01-01,Bread,-1.20\r\n"
+        "2015-01-02,Milk,-0.90\r\n"
+        "2015-01-03,Fruit,-3.10\r\n"
+        "not a date,Broken,-3\r\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    QList<qint64> progress;
+    chancho::Importer importer(book, account);
+    importer.import(&buffer, chancho::Importer::Format::CSV, [&progress](qint64 read, qint64) {
+        progress.append(read);
+    }, 2);
+
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 3);
+    QCOMPARE(progress.count(), 2);
+    QCOMPARE(progress.at(0), static_cast<qint64>(statement.indexOf("2015-01-03")));
+    QCOMPARE(progress.last(), static_cast<qint64>(statement.size()));
+}
+
+void
+TestImporter::testImportOfx() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food);
+
+    // SGML values end with the line, XML values with the closing tag
+    QByteArray statement("OFXHEADER:100\n"
+        "<OFX><BANKMSGSRSV1><STMTTRNRS><STMTRS><BANKTRANLIST>\n"
+        "<STMTTRN>\n"
+        "<TRNTYPE>DEBIT\n"
+        "<DTPOSTED>20150105120000[0:GMT]\n"
+        "<TRNAMT>-12.30\n"
+        "<NAME>Fish &amp; chips\n"
+        "<MEMO>Lunch\n"
+        "</STMTTRN>\n"
+        "<STMTTRN><TRNTYPE>CREDIT</TRNTYPE><DTPOSTED>20150201</DTPOSTED><TRNAMT>1500</TRNAMT>"
+        "<NAME>Payroll</NAME></STMTTRN>\n"
+        "</BANKTRANLIST></STMTRS></STMTTRNRS></BANKMSGSRSV1></OFX>\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    auto months = importer.import(&buffer, chancho::Importer::Format::OFX);
+
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 2);
+    QCOMPARE(months, QList<QDate>() << QDate(2015, 1, 1) << QDate(2015, 2, 1));
+
+    auto transactions = book->transactions(1, 2015);
+    QCOMPARE(transactions.count(), 1);
+    QCOMPARE(transactions.first()->contents, QString("Fish & chips"));
+    QCOMPARE(transactions.first()->memo, QString("Lunch"));
+    QCOMPARE(transactions.first()->amount, 12.3);
+
+    auto accounts = book->accounts();
+    QCOMPARE(accounts.first()->amount, 1500 - 12.3);
+}
+
+void
+TestImporter::testImportQif() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto rent = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food << rent);
+
+    QByteArray statement("!Type:Bank\n"
+        "D1/31'15\n"
+        "T-1,250.00\n"
+        "PLandlord\n"
+        "LHome:Rent\n"
+        "^\n"
+        "D02/15/2015\n"
+        "T30\n"
+        "PRefund\n"
+        "^\n");
+    QBuffer buffer(&statement);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account, salary, food);
+    auto months = importer.import(&buffer, chancho::Importer::Format::QIF);
+
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 2);
+    QCOMPARE(months, QList<QDate>() << QDate(2015, 1, 1) << QDate(2015, 2, 1));
+
+    auto transactions = book->transactions(1, 2015);
+    QCOMPARE(transactions.count(), 1);
+    QCOMPARE(transactions.first()->date, QDate(2015, 1, 31));
+    QCOMPARE(transactions.first()->category->name, rent->name);
+    QCOMPARE(transactions.first()->amount, 1250.0);
+
+    transactions = book->transactions(2, 2015);
+    QCOMPARE(transactions.count(), 1);
+    QCOMPARE(transactions.first()->category->name, salary->name);
+}
+
+void
+TestImporter::testImportOverlappingStatement() {
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    auto book = bookWith(account, QList<PublicCategoryPtr>() << salary << food);
+
+    QByteArray january("Date,Description,Amount\n"
+        "2015-01-10,Coffee,-2\n"
+        "2015-01-10,Coffee,-2\n"
+        "2015-01-31,Payroll,2000\n");
+    QBuffer januaryBuffer(&january);
+    QVERIFY(januaryBuffer.open(QIODevice::ReadOnly));
+
+    chancho::Importer importer(book, account);
+    importer.import(&januaryBuffer, chancho::Importer::Format::CSV);
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 3);
+    QCOMPARE(importer.duplicates(), 0);
+
+    // the second statement repeats the end of january, a third coffee was bought that day
+    QByteArray february("Date,Description,Amount\n"
+        "2015-01-10,Coffee,-2\n"
+        "2015-01-10,Coffee,-2\n"
+        "2015-01-10,Coffee,-2\n"
+        "2015-01-31,Payroll,2000\n"
+        "2015-02-03,Flat,-500\n");
+    QBuffer februaryBuffer(&february);
+    QVERIFY(februaryBuffer.open(QIODevice::ReadOnly));
+
+    auto months = importer.import(&februaryBuffer, chancho::Importer::Format::CSV, chancho::Importer::ImportProgress(),
+        2);
+    QVERIFY(!importer.isError());
+    QCOMPARE(importer.imported(), 2);
+    QCOMPARE(importer.duplicates(), 3);
+    QCOMPARE(months, QList<QDate>() << QDate(2015, 1, 1) << QDate(2015, 2, 1));
+
+    QCOMPARE(book->transactions(1, 2015).count(), 4);
+    QCOMPARE(book->transactions(2, 2015).count(), 1);
+    QCOMPARE(book->accounts().first()->amount, -2.0 * 3 + 2000 - 500);
+}
+
+QTEST_MAIN(TestImporter)
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QFileInfo>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_transaction.h"
+
+#include "test_payees.h"
+
+void
+TestPayees::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestPayees::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestPayees::testBuild() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    // the case and the white spaces do not make a different payee, transactions without contents are ignored
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2015, 1, 11), " MERCADONA "));
+    trans.append(std::make_shared<PublicTransaction>(account, 5, food, QDate(2015, 1, 12), "Bakery"));
+    trans.append(std::make_shared<PublicTransaction>(account, 5, food, QDate(2015, 1, 13), ""));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(!payees.isBuilt());
+    QVERIFY(payees.build());
+    QVERIFY(!payees.isError());
+    QVERIFY(payees.isBuilt());
+    QCOMPARE(payees.numberOfPayees(), 2);
+
+    auto suggestions = payees.suggestions("mer");
+    QCOMPARE(suggestions.count(), 1);
+    QCOMPARE(suggestions.at(0).count, 2);
+    // written as in the last transaction
+    QCOMPARE(suggestions.at(0).contents, QString("MERCADONA"));
+}
+
+void
+TestPayees::testSuggestionsPrefix() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Bakery"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2015, 1, 11), "Bank fees"));
+    trans.append(std::make_shared<PublicTransaction>(account, 5, food, QDate(2015, 1, 12), "Cinema"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    QCOMPARE(payees.suggestions("BA").count(), 2);
+    QCOMPARE(payees.suggestions("bak").count(), 1);
+    QCOMPARE(payees.suggestions("bank fees").count(), 1);
+    QCOMPARE(payees.suggestions("z").count(), 0);
+    QCOMPARE(payees.suggestions("  ").count(), 0);
+}
+
+void
+TestPayees::testSuggestionsRankRecentFirst() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    // two old transactions weight less than a recent one
+    auto today = QDate::currentDate();
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, today.addYears(-2), "Cafe Central"));
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, today.addYears(-2).addDays(1),
+        "Cafe Central"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, today, "Cafe Pepe"));
+    // among recent payees the most used one is first
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, today.addDays(-1), "Cinema"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, today.addDays(-2), "Cinema"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, today, "Circus"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    auto suggestions = payees.suggestions("cafe");
+    QCOMPARE(suggestions.count(), 2);
+    QCOMPARE(suggestions.at(0).contents, QString("Cafe Pepe"));
+    QCOMPARE(suggestions.at(1).contents, QString("Cafe Central"));
+
+    suggestions = payees.suggestions("ci");
+    QCOMPARE(suggestions.count(), 2);
+    QCOMPARE(suggestions.at(0).contents, QString("Cinema"));
+    QCOMPARE(suggestions.at(1).contents, QString("Circus"));
+}
+
+void
+TestPayees::testSuggestionsCount() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    QList<chancho::TransactionPtr> trans;
+    for (int index = 0; index < 10; index++) {
+        trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, index + 1),
+            QString("Shop %1").arg(index)));
+    }
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    QCOMPARE(payees.suggestions("shop").count(), chancho::Payees::PAYEE_SUGGESTIONS);
+    auto suggestions = payees.suggestions("shop", 3);
+    QCOMPARE(suggestions.count(), 3);
+    // same number of transactions, the newest ones first
+    QCOMPARE(suggestions.at(0).contents, QString("Shop 9"));
+    QCOMPARE(payees.suggestions("shop", 0).count(), 0);
+}
+
+void
+TestPayees::testSuggestionsUsualCategoryAndAmount() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto home = std::make_shared<PublicCategory>("Home", chancho::Category::Type::EXPENSE);
+    book.store(home);
+
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Supermarket"));
+    trans.append(std::make_shared<PublicTransaction>(account, 25, food, QDate(2015, 1, 17), "Supermarket"));
+    trans.append(std::make_shared<PublicTransaction>(account, 40, home, QDate(2015, 1, 24), "Supermarket"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    auto suggestions = payees.suggestions("super");
+    QCOMPARE(suggestions.count(), 1);
+    QVERIFY(suggestions.at(0).category != nullptr);
+    QCOMPARE(suggestions.at(0).category->name, QString("Food"));
+    QCOMPARE(suggestions.at(0).category->type, chancho::Category::Type::EXPENSE);
+    // expenses are stored as negative numbers yet the amount is suggested as the user typed it
+    QCOMPARE(suggestions.at(0).amount, 40.0);
+}
+
+void
+TestPayees::testAddNewPayee() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+    QCOMPARE(payees.numberOfPayees(), 0);
+
+    // added in the middle and at the ends of the sorted payees
+    QStringList names;
+    names << "Market" << "Zoo" << "Airport" << "Library";
+    foreach(const QString& name, names) {
+        auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), name);
+        book.store(tran);
+        QVERIFY(!book.isError());
+        payees.add(tran);
+    }
+
+    QCOMPARE(payees.numberOfPayees(), 4);
+    foreach(const QString& name, names) {
+        auto suggestions = payees.suggestions(name.left(2));
+        QCOMPARE(suggestions.count(), 1);
+        QCOMPARE(suggestions.at(0).contents, name);
+        QCOMPARE(suggestions.at(0).category->name, QString("Food"));
+    }
+}
+
+void
+TestPayees::testAddExistingPayee() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Market");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    auto newer = std::make_shared<PublicTransaction>(account, 35, food, QDate(2015, 1, 17), "market");
+    book.store(newer);
+    QVERIFY(!book.isError());
+    payees.add(newer);
+
+    QCOMPARE(payees.numberOfPayees(), 1);
+    auto suggestions = payees.suggestions("ma");
+    QCOMPARE(suggestions.count(), 1);
+    QCOMPARE(suggestions.at(0).count, 2);
+    QCOMPARE(suggestions.at(0).contents, QString("market"));
+    QCOMPARE(suggestions.at(0).amount, 35.0);
+}
+
+void
+TestPayees::testRemovePayee() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Market"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2015, 1, 11), "Market"));
+    trans.append(std::make_shared<PublicTransaction>(account, 5, food, QDate(2015, 1, 12), "Cinema"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+    QCOMPARE(payees.numberOfPayees(), 2);
+
+    payees.remove(trans.at(0));
+    auto suggestions = payees.suggestions("ma");
+    QCOMPARE(suggestions.count(), 1);
+    QCOMPARE(suggestions.at(0).count, 1);
+
+    // a payee without transactions is not suggested
+    payees.remove(trans.at(2));
+    QCOMPARE(payees.numberOfPayees(), 1);
+    QCOMPARE(payees.suggestions("ci").count(), 0);
+}
+
+void
+TestPayees::testRemoveEditedPayee() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    auto tran = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Mrket");
+    book.store(tran);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    // fixing a typo replaces the payee instead of keeping both
+    auto edited = std::make_shared<PublicTransaction>(account, 20, food, QDate(2015, 1, 10), "Market");
+    payees.remove(tran);
+    payees.add(edited);
+
+    QCOMPARE(payees.numberOfPayees(), 1);
+    auto suggestions = payees.suggestions("m");
+    QCOMPARE(suggestions.count(), 1);
+    QCOMPARE(suggestions.at(0).contents, QString("Market"));
+    QCOMPARE(suggestions.at(0).count, 1);
+}
+
+void
+TestPayees::testWeightDoesNotDependOnCurrentDate() {
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+
+    // a book whose last transaction is years old still ranks its most recent payees first
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2005, 1, 10), "Cafe Central"));
+    trans.append(std::make_shared<PublicTransaction>(account, 20, food, QDate(2005, 1, 11), "Cafe Central"));
+    trans.append(std::make_shared<PublicTransaction>(account, 30, food, QDate(2005, 9, 1), "Cafe Pepe"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Payees payees;
+    QVERIFY(payees.build());
+
+    auto suggestions = payees.suggestions("cafe");
+    QCOMPARE(suggestions.count(), 2);
+    QCOMPARE(suggestions.at(0).contents, QString("Cafe Pepe"));
+
+    // a new transaction is weighted against the same reference
+    auto newer = std::make_shared<PublicTransaction>(account, 20, food, QDate(2005, 9, 2), "Cafe Central");
+    book.store(newer);
+    payees.add(newer);
+    suggestions = payees.suggestions("cafe");
+    QCOMPARE(suggestions.at(0).contents, QString("Cafe Central"));
+}
+
+QTEST_MAIN(TestPayees)
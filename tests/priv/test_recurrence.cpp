@@ -20,11 +20,73 @@
  * THE SOFTWARE.
  */
 
+#include <algorithm>
+#include <random>
+
 #include <QDebug>
 #include "public_recurrence.h"
 #include "test_recurrence.h"
 
 namespace chancho = com::chancho;
+
+Q_DECLARE_METATYPE(std::shared_ptr<PublicRecurrence>)
+
+namespace {
+
+    // reference implementation that steps one period at a time, used to validate the closed form calculations
+    QList<QDate> steppingDates(chancho::RecurrentTransaction::Recurrence& recurrence, QDate from, QDate until) {
+        QList<QDate> result;
+        auto current = from;
+        while (current < until) {
+            if (recurrence.defaults()) {
+                switch (*recurrence.defaults()) {
+                    case chancho::RecurrentTransaction::Recurrence::Defaults::DAILY:
+                        current = current.addDays(1);
+                        break;
+                    case chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY:
+                        current = current.addDays(7);
+                        break;
+                    default:
+                        current = current.addMonths(1);
+                        break;
+                }
+            } else {
+                current = current.addDays(*recurrence.numberOfDays());
+            }
+            if (current <= until) {
+                result.append(current);
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<PublicRecurrence> randomRecurrence(std::default_random_engine& re, QDate start) {
+        std::uniform_int_distribution<int> kindUnif(0, 3);
+        std::uniform_int_distribution<int> daysUnif(1, 45);
+        switch (kindUnif(re)) {
+            case 0:
+                return std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, start);
+            case 1:
+                return std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY, start);
+            case 2:
+                return std::make_shared<PublicRecurrence>(
+                    chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, start);
+            default:
+                return std::make_shared<PublicRecurrence>(daysUnif(re), start);
+        }
+    }
+
+    // the stepping implementation drifts when the start day is not present in a month (31/01 -> 28/02 -> 28/03), the
+    // closed form does not, therefore the random start days are limited to days that all months have
+    QDate randomStart(std::default_random_engine& re) {
+        std::uniform_int_distribution<int> yearUnif(1995, 2020);
+        std::uniform_int_distribution<int> monthUnif(1, 12);
+        std::uniform_int_distribution<int> dayUnif(1, 28);
+        return QDate(yearUnif(re), monthUnif(re), dayUnif(re));
+    }
+}
 void
 TestRecurrence::init() {
     BaseTestCase::init();
@@ -164,4 +226,205 @@ TestRecurrence::testRecurrenceMonthlyNotFromStart() {
     QCOMPARE(result.first(), lastGenerated.addMonths(1));
 }
 
+void
+TestRecurrence::testOccurrencesMatchStepping_data() {
+    QTest::addColumn<std::shared_ptr<PublicRecurrence>>("recurrence");
+    QTest::addColumn<QDate>("until");
+
+    std::default_random_engine re;
+    std::uniform_int_distribution<int> lengthUnif(0, 3000);
+    for (int index = 0; index < 200; index++) {
+        auto start = randomStart(re);
+        auto recurrence = randomRecurrence(re, start);
+        auto until = start.addDays(lengthUnif(re));
+        QTest::newRow(QString("case-%1").arg(index).toStdString().c_str()) << recurrence << until;
+    }
+}
+
+void
+TestRecurrence::testOccurrencesMatchStepping() {
+    QFETCH(std::shared_ptr<PublicRecurrence>, recurrence);
+    QFETCH(QDate, until);
+
+    auto expected = steppingDates(*recurrence, recurrence->startDate, until);
+    QCOMPARE(recurrence->occurrencesUntil(until), expected.count());
+    for (int index = 0; index < expected.count(); index++) {
+        QCOMPARE(recurrence->occurrence(index + 1), expected.at(index));
+    }
+    if (expected.count() > 0) {
+        QCOMPARE(recurrence->nextOccurrence(expected.last()), recurrence->occurrence(expected.count() + 1));
+    }
+}
+
+void
+TestRecurrence::testOccurrencesPassedMatchStepping_data() {
+    QTest::addColumn<std::shared_ptr<PublicRecurrence>>("recurrence");
+    QTest::addColumn<int>("passed");
+
+    std::default_random_engine re;
+    std::uniform_int_distribution<int> passedUnif(0, 500);
+    for (int index = 0; index < 200; index++) {
+        auto start = randomStart(re);
+        auto recurrence = randomRecurrence(re, start);
+        auto passed = passedUnif(re);
+
+        // use the stepping implementation to calculate the last generated date, no period is longer than 45 days
+        if (passed > 0) {
+            auto dates = steppingDates(*recurrence, start, start.addDays(passed * 45));
+            recurrence->lastGenerated = dates.at(passed - 1);
+        }
+        QTest::newRow(QString("case-%1").arg(index).toStdString().c_str()) << recurrence << passed;
+    }
+}
+
+void
+TestRecurrence::testOccurrencesPassedMatchStepping() {
+    QFETCH(std::shared_ptr<PublicRecurrence>, recurrence);
+    QFETCH(int, passed);
+
+    QCOMPARE(recurrence->ocurrencesPassed(), passed);
+}
+
+void
+TestRecurrence::testMonthlyKeepsDayOfMonth() {
+    PublicRecurrence recurrence(chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 31));
+    QCOMPARE(recurrence.occurrence(1), QDate(2015, 2, 28));
+    QCOMPARE(recurrence.occurrence(2), QDate(2015, 3, 31));
+    QCOMPARE(recurrence.occurrence(13), QDate(2016, 2, 29));
+    QCOMPARE(recurrence.occurrencesUntil(QDate(2015, 3, 30)), 1);
+    QCOMPARE(recurrence.occurrencesUntil(QDate(2015, 3, 31)), 2);
+    QCOMPARE(recurrence.occurrencesUntil(QDate(2014, 12, 31)), 0);
+}
+
+void
+TestRecurrence::testDriftedLastGenerated_data() {
+    QTest::addColumn<int>("day");
+
+    QTest::newRow("29th") << 29;
+    QTest::newRow("30th") << 30;
+    QTest::newRow("31st") << 31;
+}
+
+void
+TestRecurrence::testDriftedLastGenerated() {
+    QFETCH(int, day);
+
+    // the end date keeps the test independent of the current date
+    auto start = QDate(2015, 1, day);
+    PublicRecurrence recurrence(chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, start,
+        QDate(2015, 12, 31));
+
+    // older versions stepped from the previous occurrence, the day drifted to the 28th after february
+    auto drifted = start.addMonths(1).addMonths(1);
+    QCOMPARE(drifted, QDate(2015, 3, 28));
+    recurrence.lastGenerated = drifted;
+
+    QCOMPARE(recurrence.generatedOccurrences(), 2);
+    QCOMPARE(recurrence.ocurrencesPassed(), 2);
+    QCOMPARE(recurrence.nextDue(), QDate(2015, 4, std::min(day, 30)));
+
+    // the occurrence of march is not generated a second time
+    auto result = recurrence.generateMissingDates();
+    QCOMPARE(result.count(), 9);
+    QCOMPARE(result.first(), QDate(2015, 4, std::min(day, 30)));
+    QCOMPARE(result.last(), QDate(2015, 12, day));
+
+    // the same dates are pending for the forecast
+    auto pending = recurrence.dates().from(recurrence.generatedOccurrences() + 1);
+    QCOMPARE(pending.size(), 9);
+    QCOMPARE(*pending.begin(), result.first());
+
+    // dates that did not drift are identified the same way
+    recurrence.lastGenerated = recurrence.occurrence(2);
+    QCOMPARE(recurrence.generatedOccurrences(), 2);
+    QCOMPARE(recurrence.generateMissingDates().count(), 9);
+}
+
+void
+TestRecurrence::testNextOccurrence() {
+    PublicRecurrence weekly(chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY, QDate(2015, 1, 1));
+    QCOMPARE(weekly.nextOccurrence(QDate(2014, 1, 1)), QDate(2015, 1, 8));
+    QCOMPARE(weekly.nextOccurrence(QDate(2015, 1, 8)), QDate(2015, 1, 15));
+    QCOMPARE(weekly.nextOccurrence(QDate(2015, 1, 9)), QDate(2015, 1, 15));
+
+    // limited by the number of occurrences
+    PublicRecurrence limited(3, QDate(2015, 1, 1), boost::optional<int>(2));
+    QCOMPARE(limited.nextOccurrence(QDate(2015, 1, 1)), QDate(2015, 1, 4));
+    QCOMPARE(limited.nextOccurrence(QDate(2015, 1, 4)), QDate(2015, 1, 7));
+    QVERIFY(!limited.nextOccurrence(QDate(2015, 1, 7)).isValid());
+
+    // limited by the end date
+    PublicRecurrence ended(chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 10),
+        QDate(2015, 3, 1));
+    QCOMPARE(ended.nextOccurrence(QDate(2015, 1, 10)), QDate(2015, 2, 10));
+    QVERIFY(!ended.nextOccurrence(QDate(2015, 2, 10)).isValid());
+}
+
+void
+TestRecurrence::testOccurrencesRange() {
+    PublicRecurrence weekly(chancho::RecurrentTransaction::Recurrence::Defaults::WEEKLY, QDate(2015, 1, 1));
+
+    // the range has no limit, take is needed to stop
+    auto first = weekly.dates().take(3);
+    QCOMPARE(first.size(), 3);
+    QList<QDate> result;
+    for (const auto& date : first) {
+        result.append(date);
+    }
+    QCOMPARE(result, QList<QDate>() << QDate(2015, 1, 1) << QDate(2015, 1, 8) << QDate(2015, 1, 15));
+
+    // the dates used by after and until do not have to be occurrences
+    auto range = weekly.dates().after(QDate(2015, 1, 9)).until(QDate(2015, 2, 4));
+    QCOMPARE(range.size(), 3);
+    auto it = range.begin();
+    QCOMPARE(*it, QDate(2015, 1, 15));
+    QCOMPARE(it.index(), 2);
+    it++;
+    QCOMPARE(*it, QDate(2015, 1, 22));
+    ++it;
+    QCOMPARE(*it, QDate(2015, 1, 29));
+    ++it;
+    QVERIFY(it == range.end());
+
+    // dates before the start date
+    QCOMPARE(weekly.dates().after(QDate(2014, 1, 1)).take(1).size(), 1);
+    QCOMPARE(*weekly.dates().after(QDate(2014, 1, 1)).begin(), QDate(2015, 1, 1));
+    QVERIFY(weekly.dates().until(QDate(2014, 12, 31)).isEmpty());
+    QVERIFY(weekly.dates().until(QDate()).isEmpty());
+    QVERIFY(weekly.dates().take(0).isEmpty());
+    QVERIFY(weekly.dates().take(0).begin() == weekly.dates().take(0).end());
+}
+
+void
+TestRecurrence::testOccurrencesRangeLimits() {
+    // limited by the number of occurrences, the start date is not counted
+    PublicRecurrence limited(3, QDate(2015, 1, 1), boost::optional<int>(2));
+    QCOMPARE(limited.dates().size(), 3);
+    QCOMPARE(limited.dates().take(10).size(), 3);
+    QVERIFY(limited.dates().after(QDate(2015, 1, 7)).isEmpty());
+
+    // limited by the end date
+    PublicRecurrence ended(chancho::RecurrentTransaction::Recurrence::Defaults::MONTHLY, QDate(2015, 1, 31),
+        QDate(2015, 4, 30));
+    QList<QDate> result;
+    for (const auto& date : ended.dates()) {
+        result.append(date);
+    }
+    QCOMPARE(result, QList<QDate>() << QDate(2015, 1, 31) << QDate(2015, 2, 28) << QDate(2015, 3, 31)
+        << QDate(2015, 4, 30));
+
+    // invalid recurrences do not have occurrences
+    PublicRecurrence invalid(0, QDate(2015, 1, 1));
+    QVERIFY(invalid.dates().isEmpty());
+
+    // the missing dates match the generated ones
+    auto startDate = QDate::currentDate().addDays(-10);
+    PublicRecurrence daily(chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate);
+    daily.lastGenerated = startDate.addDays(4);
+    auto missing = daily.missingDates();
+    QCOMPARE(missing.size(), 6);
+    QCOMPARE(*missing.begin(), startDate.addDays(5));
+    QCOMPARE(daily.generateMissingDates().count(), missing.size());
+}
+
 QTEST_MAIN(TestRecurrence)
@@ -51,4 +51,20 @@ class TestRecurrence : public BaseTestCase {
     void testRecurrenceMonthlyFromStart();
     void testRecurrenceMonthlyNotFromStart();
 
+    void testOccurrencesMatchStepping_data();
+    void testOccurrencesMatchStepping();
+
+    void testOccurrencesPassedMatchStepping_data();
+    void testOccurrencesPassedMatchStepping();
+
+    void testMonthlyKeepsDayOfMonth();
+
+    void testDriftedLastGenerated_data();
+    void testDriftedLastGenerated();
+
+    void testNextOccurrence();
+
+    void testOccurrencesRange();
+    void testOccurrencesRangeLimits();
+
 };
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <QFile>
+#include <QFileInfo>
+
+#include "public_account.h"
+#include "public_category.h"
+#include "public_transaction.h"
+
+#include "test_snapshot.h"
+
+void
+TestSnapshot::init() {
+    BaseTestCase::init();
+    PublicBook::initDatabse();
+}
+
+void
+TestSnapshot::cleanup() {
+    BaseTestCase::cleanup();
+
+    auto dbPath = PublicBook::databasePath();
+    QFileInfo fi(dbPath);
+    if (fi.exists())
+        removeDir(fi.absolutePath());
+}
+
+void
+TestSnapshot::testLoadMissing() {
+    QFile::remove(chancho::Snapshot::snapshotPath());
+
+    chancho::Snapshot snapshot;
+    QVERIFY(!snapshot.load());
+    QVERIFY(!snapshot.isLoaded());
+    QVERIFY(!snapshot.isCurrent());
+    QVERIFY(snapshot.isError());
+}
+
+void
+TestSnapshot::testWriteLoad() {
+    PublicBook book;
+    auto bankia = std::make_shared<PublicAccount>("Bankia", 20.5, "Savings", "#fff");
+    bankia->initialAmount = 10;
+    auto bbva = std::make_shared<PublicAccount>("BBVA", 3);
+    book.store(bankia);
+    book.store(bbva);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE, "#000");
+    book.store(food);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    chancho::Snapshot snapshot;
+    QVERIFY(snapshot.write());
+    QVERIFY(!snapshot.isError());
+    QVERIFY(QFile::exists(chancho::Snapshot::snapshotPath()));
+
+    QVERIFY(snapshot.load());
+    QVERIFY(snapshot.isLoaded());
+    QVERIFY(snapshot.isCurrent());
+
+    // same order and values as the queries of the book
+    auto expectedAccs = book.accounts();
+    auto accs = snapshot.accounts();
+    QCOMPARE(snapshot.numberOfAccounts(), expectedAccs.count());
+    QCOMPARE(accs.count(), expectedAccs.count());
+    for (int index = 0; index < accs.count(); index++) {
+        auto acc = std::static_pointer_cast<PublicAccount>(accs.at(index));
+        auto expected = std::static_pointer_cast<PublicAccount>(expectedAccs.at(index));
+        QCOMPARE(acc->name, expected->name);
+        QCOMPARE(acc->memo, expected->memo);
+        QCOMPARE(acc->color, expected->color);
+        QCOMPARE(acc->amount, expected->amount);
+        QCOMPARE(acc->initialAmount, expected->initialAmount);
+        QCOMPARE(acc->_dbId, expected->_dbId);
+    }
+
+    auto cats = snapshot.categories();
+    QCOMPARE(cats.count(), 2);
+    QCOMPARE(cats.at(0)->name, QString("Food"));
+    QCOMPARE(cats.at(0)->color, QString("#000"));
+    QCOMPARE(snapshot.numberOfCategories(chancho::Category::Type::INCOME), 1);
+    QCOMPARE(snapshot.categories(chancho::Category::Type::INCOME).at(0)->name, QString("Salary"));
+}
+
+void
+TestSnapshot::testCategoriesPage() {
+    PublicBook book;
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto bakery = std::make_shared<PublicCategory>("Bakery", chancho::Category::Type::EXPENSE, food);
+    book.store(bakery);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    chancho::Snapshot snapshot;
+    QVERIFY(snapshot.write());
+    QVERIFY(snapshot.load());
+
+    auto all = snapshot.categories(chancho::Category::Type::EXPENSE);
+    QCOMPARE(all.count(), 2);
+    QCOMPARE(all.at(0)->name, QString("Bakery"));
+    QVERIFY(all.at(0)->parent != nullptr);
+    QCOMPARE(all.at(0)->parent->name, QString("Food"));
+
+    // the parent is not in the page, as with the query it is not set
+    auto first = snapshot.categories(chancho::Category::Type::EXPENSE, 1, 0);
+    QCOMPARE(first.count(), 1);
+    QCOMPARE(first.at(0)->name, QString("Bakery"));
+    QVERIFY(first.at(0)->parent == nullptr);
+
+    auto second = snapshot.categories(boost::optional<chancho::Category::Type>(), 2, 1);
+    QCOMPARE(second.count(), 2);
+    QCOMPARE(second.at(0)->name, QString("Food"));
+    QCOMPARE(second.at(1)->name, QString("Salary"));
+}
+
+void
+TestSnapshot::testDays() {
+    auto today = QDate::currentDate();
+    auto first = QDate(today.year(), today.month(), 1);
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    auto salary = std::make_shared<PublicCategory>("Salary", chancho::Category::Type::INCOME);
+    book.store(salary);
+
+    QList<chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(account, 20.5, food, first, "Market"));
+    trans.append(std::make_shared<PublicTransaction>(account, 4, food, first, "Bakery"));
+    trans.append(std::make_shared<PublicTransaction>(account, 1000, salary, first, "Salary"));
+    trans.append(std::make_shared<PublicTransaction>(account, 7, food, today, "Cinema"));
+    // other months are not in the snapshot
+    trans.append(std::make_shared<PublicTransaction>(account, 9, food, first.addMonths(-1), "Cinema"));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    chancho::Snapshot snapshot;
+    QVERIFY(snapshot.write());
+    QVERIFY(snapshot.load());
+
+    QVERIFY(snapshot.covers(today.month(), today.year()));
+    QVERIFY(!snapshot.covers(first.addMonths(-1).month(), first.addMonths(-1).year()));
+
+    auto days = book.daysWithTransactions(today.month(), today.year());
+    QCOMPARE(snapshot.days(), days);
+    QCOMPARE(snapshot.numberOfDays(), days.count());
+    foreach(int day, days) {
+        QCOMPARE(snapshot.day(day).income, book.incomeForDay(day, today.month(), today.year()));
+        QCOMPARE(snapshot.day(day).expense, book.expenseForDay(day, today.month(), today.year()));
+    }
+    QCOMPARE(snapshot.days(1, days.count() - 1).count(), 1);
+    QCOMPARE(snapshot.days(1, days.count() - 1).at(0), 1);
+}
+
+void
+TestSnapshot::testStaleAfterChange() {
+    PublicBook book;
+    book.store(std::make_shared<PublicAccount>("Bankia", 0));
+
+    chancho::Snapshot snapshot;
+    QVERIFY(snapshot.write());
+    QVERIFY(snapshot.load());
+    QVERIFY(snapshot.isCurrent());
+
+    book.store(std::make_shared<PublicAccount>("BBVA", 0));
+    QVERIFY(!book.isError());
+
+    QVERIFY(!snapshot.isCurrent());
+    QVERIFY(!snapshot.load());
+
+    QVERIFY(snapshot.write());
+    QVERIFY(snapshot.load());
+    QCOMPARE(snapshot.numberOfAccounts(), 2);
+}
+
+void
+TestSnapshot::testBookUsesSnapshot() {
+    auto today = QDate::currentDate();
+
+    PublicBook book;
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(account);
+    auto food = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    book.store(food);
+    book.store(std::make_shared<PublicTransaction>(account, 20, food, today, "Market"));
+    QVERIFY(!book.isError());
+
+    auto accounts = book.numberOfAccounts();
+    auto categories = book.numberOfCategories();
+    auto days = book.numberOfDaysWithTransactions(today.month(), today.year());
+    auto expense = book.expenseForDay(today.day(), today.month(), today.year());
+
+    auto snapshot = std::make_shared<chancho::Snapshot>();
+    QVERIFY(snapshot->write());
+    QVERIFY(snapshot->load());
+    book.setSnapshot(snapshot);
+
+    QCOMPARE(book.numberOfAccounts(), accounts);
+    QCOMPARE(book.accounts().at(0)->name, QString("Bankia"));
+    QCOMPARE(book.numberOfCategories(), categories);
+    QCOMPARE(book.categories().at(0)->name, QString("Food"));
+    QCOMPARE(book.numberOfDaysWithTransactions(today.month(), today.year()), days);
+    QCOMPARE(book.daysWithTransactions(today.month(), today.year()).at(0), today.day());
+    QCOMPARE(book.expenseForDay(today.day(), today.month(), today.year()), expense);
+    QVERIFY(!book.isError());
+}
+
+void
+TestSnapshot::testBookDropsStaleSnapshot() {
+    PublicBook book;
+    book.store(std::make_shared<PublicAccount>("Bankia", 0));
+
+    auto snapshot = std::make_shared<chancho::Snapshot>();
+    QVERIFY(snapshot->write());
+    QVERIFY(snapshot->load());
+    book.setSnapshot(snapshot);
+    QCOMPARE(book.numberOfAccounts(), 1);
+
+    // the book queries the database once it changes
+    book.store(std::make_shared<PublicAccount>("BBVA", 0));
+    QCOMPARE(book.numberOfAccounts(), 2);
+    QCOMPARE(book.accounts().count(), 2);
+}
+
+void
+TestSnapshot::testBookIgnoresStaleSnapshot() {
+    PublicBook book;
+    book.store(std::make_shared<PublicAccount>("Bankia", 0));
+
+    auto snapshot = std::make_shared<chancho::Snapshot>();
+    QVERIFY(snapshot->write());
+    QVERIFY(snapshot->load());
+
+    // the database changes between the load and the moment the book receives the snapshot
+    book.store(std::make_shared<PublicAccount>("BBVA", 0));
+    book.setSnapshot(snapshot);
+    QCOMPARE(book.numberOfAccounts(), 2);
+    QVERIFY(!book.isError());
+}
+
+QTEST_MAIN(TestSnapshot)
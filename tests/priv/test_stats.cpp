@@ -722,5 +722,370 @@ TestStats::testCategoriesPercentage() {
     QCOMPARE(severalResults.second.count(), 3);
 }
 
+void
+TestStats::testCategoryTreePercentages() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto restaurants = std::make_shared<PublicCategory>("Restaurants", com::chancho::Category::Type::EXPENSE, food);
+    auto sushi = std::make_shared<PublicCategory>("Sushi", com::chancho::Category::Type::EXPENSE, restaurants);
+    auto salary = std::make_shared<PublicCategory>("Salary", com::chancho::Category::Type::INCOME);
+    book.store(sushi);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 10, food, QDate(2015, 2, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 20, restaurants, QDate(2015, 2, 2)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 30, sushi, QDate(2015, 2, 3)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 1000, salary, QDate(2015, 2, 4)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.categoryTreePercentages(2, 2015);
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.first.count, 2);
+    QCOMPARE(result.second.count(), 2);
+    foreach(const com::chancho::Stats::CategoryPercentage& percentage, result.second) {
+        if (percentage.category->name == "Food") {
+            QCOMPARE(percentage.count, 3);
+            QCOMPARE(percentage.amount, -60.0);
+        } else {
+            QCOMPARE(percentage.category->name, QString("Salary"));
+            QCOMPARE(percentage.count, 1);
+            QCOMPARE(percentage.amount, 1000.0);
+        }
+    }
+}
+
+void
+TestStats::testMonthsTotalForCategoryTree() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto restaurants = std::make_shared<PublicCategory>("Restaurants", com::chancho::Category::Type::EXPENSE, food);
+    auto sushi = std::make_shared<PublicCategory>("Sushi", com::chancho::Category::Type::EXPENSE, restaurants);
+    book.store(sushi);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 10, food, QDate(2015, 1, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 20, restaurants, QDate(2015, 1, 2)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 30, sushi, QDate(2015, 3, 3)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QList<double> expected {30, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    QCOMPARE(stats.monthsTotalForCategoryTree(food, 2015), expected);
+
+    QList<double> restaurantsExpected {20, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    QCOMPARE(stats.monthsTotalForCategoryTree(restaurants, 2015), restaurantsExpected);
+
+    // moving a subtree must move its amounts too
+    sushi->parent = food;
+    book.store(sushi);
+    QVERIFY(!book.isError());
+    QList<double> movedExpected {20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    QCOMPARE(stats.monthsTotalForCategoryTree(restaurants, 2015), movedExpected);
+}
+
+void
+TestStats::testLargestTransactions() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto salary = std::make_shared<PublicCategory>("Salary", com::chancho::Category::Type::INCOME);
+    book.store(food);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    QList<double> amounts {12, 450, 3.5, 89, 1200, 7, 300};
+    int day = 1;
+    foreach(double amount, amounts) {
+        trans.append(std::make_shared<PublicTransaction>(acc, amount, food, QDate(2015, 3, day++)));
+    }
+    // different type and different year must be ignored
+    trans.append(std::make_shared<PublicTransaction>(acc, 5000, salary, QDate(2015, 3, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 9000, food, QDate(2014, 3, 1)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.largestTransactions(com::chancho::Category::Type::EXPENSE, 3, 2015);
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 3);
+    // expenses are stored as negative amounts
+    QCOMPARE(result.at(0)->amount, -1200.0);
+    QCOMPARE(result.at(1)->amount, -450.0);
+    QCOMPARE(result.at(2)->amount, -300.0);
+    QCOMPARE(result.at(0)->category->name, food->name);
+    QCOMPARE(result.at(0)->date, QDate(2015, 3, 5));
+
+    auto monthResult = stats.largestTransactions(com::chancho::Category::Type::EXPENSE, 20, 2015, 4);
+    QCOMPARE(monthResult.count(), 0);
+
+    auto allResult = stats.largestTransactions(com::chancho::Category::Type::EXPENSE, 20, 2015, 3);
+    QCOMPARE(allResult.count(), amounts.count());
+}
+
+void
+TestStats::testTopCategories() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto drinks = std::make_shared<PublicCategory>("Drinks", com::chancho::Category::Type::EXPENSE);
+    auto rent = std::make_shared<PublicCategory>("Rent", com::chancho::Category::Type::EXPENSE);
+    QList<com::chancho::CategoryPtr> cats {food, drinks, rent};
+    book.store(cats);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 100, food, QDate(2015, 1, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 150, food, QDate(2015, 2, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 20, drinks, QDate(2015, 1, 3)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 700, rent, QDate(2015, 1, 1)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.topCategories(com::chancho::Category::Type::EXPENSE, 2, 2015);
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 2);
+    QCOMPARE(result.at(0).category->name, rent->name);
+    QCOMPARE(result.at(0).amount, -700.0);
+    QCOMPARE(result.at(1).category->name, food->name);
+    QCOMPARE(result.at(1).count, 2);
+    QCOMPARE(result.at(1).amount, -250.0);
+
+    auto monthResult = stats.topCategories(com::chancho::Category::Type::EXPENSE, 5, 2015, 2);
+    QCOMPARE(monthResult.count(), 1);
+    QCOMPARE(monthResult.at(0).category->name, food->name);
+}
+
+void
+TestStats::testTopContents() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    book.store(food);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 30, food, QDate(2015, 1, 1), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(acc, 45, food, QDate(2015, 1, 8), "Mercadona"));
+    trans.append(std::make_shared<PublicTransaction>(acc, 60, food, QDate(2015, 1, 9), "Carrefour"));
+    trans.append(std::make_shared<PublicTransaction>(acc, 5, food, QDate(2015, 1, 10), "Bakery"));
+    trans.append(std::make_shared<PublicTransaction>(acc, 500, food, QDate(2015, 1, 11)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.topContents(com::chancho::Category::Type::EXPENSE, 2, 2015);
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 2);
+    QCOMPARE(result.at(0).contents, QString("Mercadona"));
+    QCOMPARE(result.at(0).count, 2);
+    QCOMPARE(result.at(0).amount, -75.0);
+    QCOMPARE(result.at(1).contents, QString("Carrefour"));
+}
+
+void
+TestStats::testBudgets() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto drinks = std::make_shared<PublicCategory>("Drinks", com::chancho::Category::Type::EXPENSE);
+    auto rent = std::make_shared<PublicCategory>("Rent", com::chancho::Category::Type::EXPENSE);
+    QList<com::chancho::CategoryPtr> cats {food, drinks, rent};
+    book.store(cats);
+    QVERIFY(!book.isError());
+
+    book.setBudget(food, 300);
+    book.setBudget(drinks, 50);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 100, food, QDate(2015, 1, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 120, food, QDate(2015, 1, 20)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 80, food, QDate(2015, 2, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 700, rent, QDate(2015, 1, 1)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    // ordered by name
+    auto result = stats.budgets(1, 2015);
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 2);
+    QCOMPARE(result.at(0).category->name, drinks->name);
+    QCOMPARE(result.at(0).budget, 50.0);
+    QCOMPARE(result.at(0).spent, 0.0);
+    QCOMPARE(result.at(0).remaining, 50.0);
+    QCOMPARE(result.at(1).category->name, food->name);
+    QCOMPARE(result.at(1).budget, 300.0);
+    QCOMPARE(result.at(1).spent, 220.0);
+    QCOMPARE(result.at(1).remaining, 80.0);
+
+    // updates and removals of transactions are reflected
+    trans.at(0)->amount = 150;
+    book.store(trans.at(0));
+    book.remove(trans.at(1));
+    QVERIFY(!book.isError());
+
+    result = stats.budgets(1, 2015);
+    QCOMPARE(result.count(), 2);
+    QCOMPARE(result.at(1).spent, 150.0);
+    QCOMPARE(result.at(1).remaining, 150.0);
+
+    book.removeBudget(drinks);
+    QVERIFY(!book.isError());
+    result = stats.budgets(2, 2015);
+    QCOMPARE(result.count(), 1);
+    QCOMPARE(result.at(0).spent, 80.0);
+}
+
+void
+TestStats::testBalanceForDate() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto salary = std::make_shared<PublicCategory>("Salary", com::chancho::Category::Type::INCOME);
+    book.store(food);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 1000, salary, QDate(2015, 1, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 100, food, QDate(2015, 1, 15)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 50, food, QDate(2015, 2, 10)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 1000, salary, QDate(2015, 3, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 25, food, QDate(2015, 3, 20)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    QCOMPARE(stats.balanceForDate(acc, QDate(2014, 12, 31)), 0.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 1, 1)), 1000.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 1, 14)), 1000.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 1, 15)), 900.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 2, 28)), 850.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 3, 19)), 1850.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2016, 1, 1)), 1825.0);
+    QVERIFY(!stats.isError());
+
+    // checkpoints have to be kept up to date when transactions are removed
+    book.remove(trans.at(2));
+    QVERIFY(!book.isError());
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 2, 28)), 900.0);
+    QCOMPARE(stats.balanceForDate(acc, QDate(2015, 3, 31)), 1875.0);
+}
+
+void
+TestStats::testDailyBalances() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto salary = std::make_shared<PublicCategory>("Salary", com::chancho::Category::Type::INCOME);
+    book.store(food);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 1000, salary, QDate(2015, 1, 30)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 100, food, QDate(2015, 2, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 20, food, QDate(2015, 2, 1)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 30, food, QDate(2015, 2, 3)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 500, salary, QDate(2015, 2, 10)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.dailyBalances(acc, QDate(2015, 1, 31), QDate(2015, 2, 4));
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 5);
+    QCOMPARE(result.at(0).first, QDate(2015, 1, 31));
+    QCOMPARE(result.at(0).second, 1000.0);
+    QCOMPARE(result.at(1).first, QDate(2015, 2, 1));
+    QCOMPARE(result.at(1).second, 880.0);
+    QCOMPARE(result.at(2).first, QDate(2015, 2, 2));
+    QCOMPARE(result.at(2).second, 880.0);
+    QCOMPARE(result.at(3).first, QDate(2015, 2, 3));
+    QCOMPARE(result.at(3).second, 850.0);
+    QCOMPARE(result.at(4).first, QDate(2015, 2, 4));
+    QCOMPARE(result.at(4).second, 850.0);
+}
+
+void
+TestStats::testDailyBalancesAcrossYears() {
+    chancho::Book book;
+    chancho::Stats stats;
+
+    auto acc = std::make_shared<PublicAccount>("Bankia", 0);
+    book.store(acc);
+    QVERIFY(!book.isError());
+
+    auto food = std::make_shared<PublicCategory>("Food", com::chancho::Category::Type::EXPENSE);
+    auto salary = std::make_shared<PublicCategory>("Salary", com::chancho::Category::Type::INCOME);
+    book.store(food);
+    book.store(salary);
+    QVERIFY(!book.isError());
+
+    // the days of the edge months outside the range must not be counted twice or missed
+    QList<com::chancho::TransactionPtr> trans;
+    trans.append(std::make_shared<PublicTransaction>(acc, 100, salary, QDate(2014, 12, 29)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 10, food, QDate(2014, 12, 31)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 50, salary, QDate(2015, 6, 15)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 5, food, QDate(2016, 1, 2)));
+    trans.append(std::make_shared<PublicTransaction>(acc, 1000, salary, QDate(2016, 1, 3)));
+    book.store(trans);
+    QVERIFY(!book.isError());
+
+    auto result = stats.dailyBalances(acc, QDate(2014, 12, 30), QDate(2016, 1, 2));
+    QVERIFY(!stats.isError());
+    QCOMPARE(result.count(), 369);
+    QCOMPARE(result.at(0).first, QDate(2014, 12, 30));
+    QCOMPARE(result.at(0).second, 100.0);
+    QCOMPARE(result.at(1).second, 90.0);
+    QCOMPARE(result.at(167).first, QDate(2015, 6, 15));
+    QCOMPARE(result.at(167).second, 140.0);
+    QCOMPARE(result.last().first, QDate(2016, 1, 2));
+    QCOMPARE(result.last().second, 135.0);
+}
+
 QTEST_MAIN(TestStats)
 
@@ -51,5 +51,17 @@ class TestStats : public BaseTestCase {
     void testMonthTotalsForAccountScattered();
 
     void testCategoriesPercentage();
+    void testCategoryTreePercentages();
+    void testMonthsTotalForCategoryTree();
+
+    void testLargestTransactions();
+    void testTopCategories();
+    void testTopContents();
+
+    void testBudgets();
+
+    void testBalanceForDate();
+    void testDailyBalances();
+    void testDailyBalancesAcrossYears();
 };
 
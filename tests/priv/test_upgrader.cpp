@@ -23,14 +23,126 @@
 #include <QDebug>
 #include <QFileInfo>
 #include <QSqlDatabase>
+#include <QUuid>
 
+#include <com/chancho/change_log.h>
 #include <com/chancho/updater.h>
 #include <com/chancho/system/database.h>
 #include <com/chancho/system/database_factory.h>
+#include "public_account.h"
+#include "public_category.h"
+#include "public_recurrence.h"
+#include "public_recurrent_transaction.h"
+#include "public_transaction.h"
 #include "test_upgrader.h"
 
 namespace sys = com::chancho::system;
 
+namespace {
+
+    // migration that copies the numbers of a table, it can fail after a number of batches to simulate a crash
+    class CopyNumbersMigration : public chancho::Migration {
+     public:
+        int id() const override {
+            return 1000;
+        }
+
+        QString name() const override {
+            return "CopyNumbers";
+        }
+
+        int total(sys::DatabasePtr db) override {
+            auto query = db->createQuery();
+            if (query->exec("SELECT COUNT(*) FROM Numbers") && query->next()) {
+                return query->value(0).toInt();
+            }
+            return 0;
+        }
+
+        bool migrateBatch(sys::DatabasePtr db, int batchSize, QVariant& cursor, int& processed) override {
+            if (failAfter >= 0 && batches == failAfter) {
+                return false;
+            }
+            batches++;
+
+            auto query = db->createQuery();
+            query->prepare("SELECT MAX(value), COUNT(*) FROM (SELECT value FROM Numbers WHERE value > :cursor "
+                "ORDER BY value LIMIT :limit)");
+            query->bindValue(":cursor", cursor.isValid() ? cursor.toInt() : 0);
+            query->bindValue(":limit", batchSize);
+            if (!query->exec() || !query->next()) {
+                return false;
+            }
+            processed = query->value(1).toInt();
+            if (processed == 0) {
+                return true;
+            }
+            auto last = query->value(0).toInt();
+
+            query->prepare("INSERT INTO Copies(value) SELECT value FROM Numbers WHERE value > :first "
+                "AND value <= :last");
+            query->bindValue(":first", cursor.isValid() ? cursor.toInt() : 0);
+            query->bindValue(":last", last);
+            if (!query->exec()) {
+                return false;
+            }
+            cursor = last;
+            return true;
+        }
+
+        int failAfter = -1;
+        int batches = 0;
+    };
+
+    class TestMigrationsUpdater : public chancho::Updater {
+     public:
+        QList<chancho::MigrationPtr> migrations() override {
+            return QList<chancho::MigrationPtr>() << migration;
+        }
+
+        std::shared_ptr<CopyNumbersMigration> migration = std::make_shared<CopyNumbersMigration>();
+    };
+
+    const QString LEGACY_TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS Transactions("\
+        "uuid VARCHAR(40) PRIMARY KEY, "\
+        "amount TEXT,"\
+        "account VARCHAR(40) NOT NULL, "\
+        "category VARCHAR(40) NOT NULL, "\
+        "day INT, "\
+        "month INT, "\
+        "year INT, "\
+        "contents TEXT, "\
+        "memo TEXT, "\
+        "is_recurrent INT, "\
+        "FOREIGN KEY(account) REFERENCES Accounts(uuid), "\
+        "FOREIGN KEY(category) REFERENCES Categories(uuid))";
+    const QString LEGACY_ROWID_TRANSACTION_TABLE = "CREATE TABLE IF NOT EXISTS Transactions("\
+        "uuid VARCHAR(40) PRIMARY KEY, "\
+        "amount TEXT,"\
+        "account VARCHAR(40) NOT NULL, "\
+        "category VARCHAR(40) NOT NULL, "\
+        "day INT, "\
+        "month INT, "\
+        "year INT, "\
+        "contents TEXT, "\
+        "memo TEXT, "\
+        "is_recurrent INT, "\
+        "recurrent_id VARCHAR(40), "\
+        "fingerprint INTEGER, "\
+        "FOREIGN KEY(account) REFERENCES Accounts(uuid), "\
+        "FOREIGN KEY(category) REFERENCES Categories(uuid), "\
+        "FOREIGN KEY(recurrent_id) REFERENCES RecurrentTransactions(uuid))";
+    const QString LEGACY_ROWID_TRANSACTIONS_SEARCH_TABLE = "CREATE VIRTUAL TABLE TransactionsSearch "\
+        "USING fts5(contents, memo, content='Transactions', content_rowid='rowid', prefix='2 3')";
+    const QString LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE = "CREATE TABLE IF NOT EXISTS "\
+        "RecurrentTransactionRelations("\
+        "recurrent_transaction VARCHAR(40),"\
+        "generated_transaction VARCHAR(40),"\
+        "FOREIGN KEY(recurrent_transaction) REFERENCES RecurrentTransactions(uuid),"\
+        "FOREIGN KEY(generated_transaction) REFERENCES Transactions(uuid),"\
+        "PRIMARY KEY(recurrent_transaction, generated_transaction))";
+}
+
 void
 TestUpgrader::init() {
     BaseTestCase::init();
@@ -46,6 +158,60 @@ TestUpgrader::cleanup() {
         removeDir(fi.absolutePath());
 }
 
+void
+TestUpgrader::testNeedsUpgradeCurrentVersion() {
+    chancho::Updater updater;
+    PublicBook::initDatabse();
+    updater.setDatabaseVersion();
+    QVERIFY(!updater.needsUpgrade());
+}
+
+void
+TestUpgrader::testNeedsUpgradeOlderVersion() {
+    chancho::Updater updater;
+    PublicBook::initDatabse();
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DELETE FROM Versions"));
+    QVERIFY(query->exec("INSERT INTO Versions(major, minor, patch) VALUES (0, 0, 1)"));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+
+    // storing the current version makes the schema up to date again
+    updater.setDatabaseVersion();
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("DELETE FROM Versions WHERE major=0 AND minor=0 AND patch=1"));
+    db->close();
+    QVERIFY(!updater.needsUpgrade());
+}
+
+void
+TestUpgrader::testNeedsUpgradeNoVersion() {
+    chancho::Updater updater;
+    PublicBook::initDatabse();
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DELETE FROM Versions"));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+}
+
 void
 TestUpgrader::testUpgradeNoRecurrence() {
     // create a database with the basic tables (just the names, no need to add the exact fields)  and make sure it
@@ -82,13 +248,21 @@ TestUpgrader::testUpgradeNoRecurrence() {
 
     // once the db has been created we need to check that it has the correct version and the required tables
     auto tables = db->tables();
-    QCOMPARE(tables.count(), 6);
+    QCOMPARE(tables.count(), 18);  // the search index adds four tables and the transaction ids sqlite_sequence
     QVERIFY(tables.contains("Accounts", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Categories", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Transactions", Qt::CaseInsensitive));
     QVERIFY(tables.contains("RecurrentTransactions", Qt::CaseInsensitive));
-    QVERIFY(tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Versions", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryClosure", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryMonthTotals", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Budgets", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("TransactionsSearch", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("ArchivedYears", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Changes", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("BulkRecurrentTransactions", Qt::CaseInsensitive));
     db->close();
 }
 
@@ -133,13 +307,604 @@ TestUpgrader::testUpgradeNoRecurrenceRelations() {
     // once the db has been created we need to check that it has the correct version and the required tables
     auto tables = db->tables();
     qDebug() << tables;
-    QCOMPARE(tables.count(), 6);
+    QCOMPARE(tables.count(), 18);  // the search index adds four tables and the transaction ids sqlite_sequence
     QVERIFY(tables.contains("Accounts", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Categories", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Transactions", Qt::CaseInsensitive));
     QVERIFY(tables.contains("RecurrentTransactions", Qt::CaseInsensitive));
-    QVERIFY(tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
     QVERIFY(tables.contains("Versions", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("AccountBalanceCheckpoints", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryClosure", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("CategoryMonthTotals", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Budgets", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("TransactionsSearch", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("ArchivedYears", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("Changes", Qt::CaseInsensitive));
+    QVERIFY(tables.contains("BulkRecurrentTransactions", Qt::CaseInsensitive));
+    db->close();
+}
+
+void
+TestUpgrader::testUpgradeRecurrenceRelationsToColumn() {
+    // create a database that links the generated transactions using the relations table and make sure that the
+    // links are moved to the transactions
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+    auto accountId = QUuid::createUuid().toString();
+    auto categoryId = QUuid::createUuid().toString();
+    auto recurrentId = QUuid::createUuid().toString();
+    auto generatedId = QUuid::createUuid().toString();
+    auto singleId = QUuid::createUuid().toString();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec(chancho::Book::ACCOUNTS_TABLE));
+    QVERIFY(query->exec(chancho::Book::CATEGORIES_TABLE));
+    QVERIFY(query->exec(LEGACY_TRANSACTION_TABLE));
+    QVERIFY(query->exec(chancho::Book::RECURRENT_TRANSACTION_TABLE));
+    QVERIFY(query->exec(LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE));
+
+    QVERIFY(query->exec(QString("INSERT INTO Accounts(uuid, name, amount) VALUES ('%1', 'Bankia', '0')")
+            .arg(accountId)));
+    QVERIFY(query->exec(QString("INSERT INTO Categories(uuid, name, type) VALUES ('%1', 'Rent', 1)")
+            .arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO RecurrentTransactions(uuid, amount, account, category) "
+            "VALUES ('%1', '-3', '%2', '%3')").arg(recurrentId).arg(accountId).arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "is_recurrent) VALUES ('%1', '-3', '%2', '%3', 1, 1, 2015, 1)")
+            .arg(generatedId).arg(accountId).arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "is_recurrent) VALUES ('%1', '-5', '%2', '%3', 2, 1, 2015, 0)")
+            .arg(singleId).arg(accountId).arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO RecurrentTransactionRelations(recurrent_transaction, "
+            "generated_transaction) VALUES ('%1', '%2')").arg(recurrentId).arg(generatedId)));
+    db->close();
+
+    PublicBook::initDatabse();
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+
+    // the links are copied by a data migration that runs after the upgrade
+    QVERIFY(!updater.needsUpgrade());
+    QVERIFY(updater.needsMigration());
+    QVERIFY(updater.migrate());
+    QVERIFY(!updater.needsMigration());
+
+    opened = db->open();
+    QVERIFY(opened);
+
+    auto tables = db->tables();
+    QVERIFY(!tables.contains("RecurrentTransactionRelations", Qt::CaseInsensitive));
+
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT name FROM sqlite_master WHERE type='index' AND name='transaction_recurrent_index'"));
+    QVERIFY(query->next());
+
+    query->prepare("SELECT recurrent_id FROM Transactions WHERE uuid=:uuid");
+    query->bindValue(":uuid", generatedId);
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toString(), recurrentId);
+
+    query->prepare("SELECT recurrent_id FROM Transactions WHERE uuid=:uuid");
+    query->bindValue(":uuid", singleId);
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QVERIFY(query->value(0).isNull());
+
+    // the transactions stored before the fingerprint column was added get one from a data migration as well
+    QVERIFY(query->exec("SELECT name FROM sqlite_master WHERE type='index' AND name='transaction_fingerprint_index'"));
+    QVERIFY(query->next());
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Transactions WHERE fingerprint IS NULL"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 0);
+    db->close();
+}
+
+void
+TestUpgrader::testRecurrentTransactionsDuringMigration() {
+    // the generated transactions that are only linked by the relations table must be found by their recurrent
+    // transaction before the migration copies the links
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+    auto accountId = QUuid::createUuid().toString();
+    auto categoryId = QUuid::createUuid().toString();
+    auto recurrentId = QUuid::createUuid().toString();
+    auto singleId = QUuid::createUuid().toString();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec(chancho::Book::ACCOUNTS_TABLE));
+    QVERIFY(query->exec(chancho::Book::CATEGORIES_TABLE));
+    QVERIFY(query->exec(LEGACY_TRANSACTION_TABLE));
+    QVERIFY(query->exec(chancho::Book::RECURRENT_TRANSACTION_TABLE));
+    QVERIFY(query->exec(LEGACY_RECURRENT_TRANSACTIONS_RELATIONS_TABLE));
+
+    QVERIFY(query->exec(QString("INSERT INTO Accounts(uuid, name, amount) VALUES ('%1', 'Bankia', '-11')")
+            .arg(accountId)));
+    QVERIFY(query->exec(QString("INSERT INTO Categories(uuid, name, type) VALUES ('%1', 'Rent', 1)")
+            .arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO RecurrentTransactions(uuid, amount, account, category) "
+            "VALUES ('%1', '-3', '%2', '%3')").arg(recurrentId).arg(accountId).arg(categoryId)));
+    for (int day = 1; day < 3; day++) {
+        auto generatedId = QUuid::createUuid().toString();
+        QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+                "is_recurrent) VALUES ('%1', '-3', '%2', '%3', %4, 1, 2015, 1)")
+                .arg(generatedId).arg(accountId).arg(categoryId).arg(day)));
+        QVERIFY(query->exec(QString("INSERT INTO RecurrentTransactionRelations(recurrent_transaction, "
+                "generated_transaction) VALUES ('%1', '%2')").arg(recurrentId).arg(generatedId)));
+    }
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "is_recurrent) VALUES ('%1', '-5', '%2', '%3', 3, 1, 2015, 0)")
+            .arg(singleId).arg(accountId).arg(categoryId)));
+    db->close();
+
+    PublicBook::initDatabse();
+    updater.upgrade();
+    QVERIFY(updater.needsMigration());
+
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    auto category = std::make_shared<PublicCategory>("Rent", chancho::Category::Type::EXPENSE);
+    auto transaction = std::make_shared<PublicTransaction>(account, 3, category);
+    auto recurrence = std::make_shared<PublicRecurrence>(
+            chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, QDate(2015, 1, 1));
+    auto recurrent = std::make_shared<PublicRecurrentTransaction>(transaction, recurrence);
+    recurrent->_dbId = QUuid(recurrentId);
+
+    PublicBook book;
+    QCOMPARE(book.numberOfTransactions(recurrent), 2);
+    QCOMPARE(book.transactions(recurrent).count(), 2);
+
+    // removing the generated transactions must not leave those that were not migrated behind
+    book.remove(recurrent, true);
+    QVERIFY(!book.isError());
+    QCOMPARE(book.numberOfTransactions(), 1);
+
+    // the migration finishes with the links that are left
+    QVERIFY(updater.migrate());
+    QVERIFY(!updater.needsMigration());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    query->prepare("SELECT uuid FROM Transactions");
+    QVERIFY(query->exec());
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toString(), singleId);
+    QVERIFY(!query->next());
+    db->close();
+}
+
+void
+TestUpgrader::testUpgradeAddsTransactionsSearch() {
+    // create a database without the search index and make sure that the stored transactions are indexed
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+    auto accountId = QUuid::createUuid().toString();
+    auto categoryId = QUuid::createUuid().toString();
+
+    PublicBook::initDatabse();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TRIGGER UpdateSearchOnTransactionInsert"));
+    QVERIFY(query->exec("DROP TRIGGER UpdateSearchOnTransactionUpdate"));
+    QVERIFY(query->exec("DROP TRIGGER UpdateSearchOnTransactionDelete"));
+    QVERIFY(query->exec("DROP TABLE TransactionsSearch"));
+
+    QVERIFY(query->exec(QString("INSERT INTO Accounts(uuid, name, amount) VALUES ('%1', 'Bankia', '0')")
+            .arg(accountId)));
+    QVERIFY(query->exec(QString("INSERT INTO Categories(uuid, name, type) VALUES ('%1', 'Food', 1)")
+            .arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "contents, memo) VALUES ('%1', '-3', '%2', '%3', 1, 1, 2015, 'Groceries', 'Weekly')")
+            .arg(QUuid::createUuid().toString()).arg(accountId).arg(categoryId)));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+    QVERIFY(!updater.needsUpgrade());
+
+    PublicBook book;
+    auto page = book.search("weekly");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 1);
+    QCOMPARE(page.transactions.at(0)->contents, QString("Groceries"));
+}
+
+void
+TestUpgrader::testUpgradeAddsTransactionId() {
+    // create a database whose search index uses the implicit rowid of the transactions and make sure that the rows
+    // keep their position as id and are still found
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+    auto accountId = QUuid::createUuid().toString();
+    auto categoryId = QUuid::createUuid().toString();
+    auto removedId = QUuid::createUuid().toString();
+    auto storedId = QUuid::createUuid().toString();
+
+    PublicBook::initDatabse();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TABLE TransactionsSearch"));
+    QVERIFY(query->exec("DROP TABLE Transactions"));
+    QVERIFY(query->exec(LEGACY_ROWID_TRANSACTION_TABLE));
+    QVERIFY(query->exec(chancho::Book::TRANSACTION_RECURRENT_INDEX));
+    QVERIFY(query->exec(chancho::Book::TRANSACTION_FINGERPRINT_INDEX));
+    QVERIFY(query->exec(LEGACY_ROWID_TRANSACTIONS_SEARCH_TABLE));
+
+    QVERIFY(query->exec(QString("INSERT INTO Accounts(uuid, name, amount) VALUES ('%1', 'Bankia', '0')")
+            .arg(accountId)));
+    QVERIFY(query->exec(QString("INSERT INTO Categories(uuid, name, type) VALUES ('%1', 'Food', 1)")
+            .arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "contents, memo) VALUES ('%1', '-1', '%2', '%3', 1, 1, 2015, 'Bakery', 'Bread')")
+            .arg(removedId).arg(accountId).arg(categoryId)));
+    QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+            "contents, memo) VALUES ('%1', '-3', '%2', '%3', 2, 1, 2015, 'Groceries', 'Weekly')")
+            .arg(storedId).arg(accountId).arg(categoryId)));
+    QVERIFY(query->exec(QString("DELETE FROM Transactions WHERE uuid='%1'").arg(removedId)));
+    QVERIFY(query->exec("INSERT INTO TransactionsSearch(TransactionsSearch) VALUES('rebuild')"));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+    QVERIFY(!updater.needsUpgrade());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec(QString("SELECT id FROM Transactions WHERE uuid='%1'").arg(storedId)));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 2);
+    db->close();
+
+    PublicBook book;
+    auto page = book.search("weekly");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 1);
+    QCOMPARE(page.transactions.at(0)->_dbId, QUuid(storedId));
+
+    // new transactions get an id after the present ones and are indexed with it
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    account->_dbId = QUuid(accountId);
+    auto category = std::make_shared<PublicCategory>("Food", chancho::Category::Type::EXPENSE);
+    category->_dbId = QUuid(categoryId);
+    auto transaction = std::make_shared<PublicTransaction>(account, -4, category, QDate(2015, 1, 3), "Groceries",
+            "Monthly");
+    book.store(transaction);
+    QVERIFY(!book.isError());
+
+    page = book.search("monthly");
+    QVERIFY(!book.isError());
+    QCOMPARE(page.transactions.count(), 1);
+    QCOMPARE(page.transactions.at(0)->_dbId, transaction->_dbId);
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec(QString("SELECT id FROM Transactions WHERE uuid='%1'").arg(transaction->_dbId.toString())));
+    QVERIFY(query->next());
+    QVERIFY(query->value(0).toInt() > 2);
+    db->close();
+}
+
+void
+TestUpgrader::testUpgradeAddsArchivedYears() {
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+
+    PublicBook::initDatabse();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TABLE ArchivedYears"));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+    QVERIFY(!updater.needsUpgrade());
+
+    PublicBook book;
+    QCOMPARE(book.numberOfTransactions(), 0);
+    QVERIFY(!book.isError());
+}
+
+void
+TestUpgrader::testUpgradeAddsChanges() {
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+
+    PublicBook::initDatabse();
+    auto account = std::make_shared<PublicAccount>("Bankia", 0);
+    {
+        PublicBook book;
+        book.store(account);
+        QVERIFY(!book.isError());
+    }
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TABLE Changes"));
+    QStringList entities {"Account", "Category", "Transaction", "RecurrentTransaction"};
+    QStringList operations {"Insert", "Update", "Delete"};
+    foreach(const QString& entity, entities) {
+        foreach(const QString& operation, operations) {
+            QVERIFY(query->exec(QString("DROP TRIGGER LogChangeOn%1%2").arg(entity, operation)));
+        }
+    }
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+    QVERIFY(!updater.needsUpgrade());
+
+    // the present rows are logged so that the first export contains the whole book
+    chancho::ChangeLog log;
+    auto changes = log.changes();
+    QVERIFY(!log.isError());
+    auto found = false;
+    foreach(const chancho::ChangeLog::Change& change, changes) {
+        if (change.uuid == account->_dbId) {
+            found = true;
+            QCOMPARE(change.entity, chancho::ChangeLog::Entity::ACCOUNT);
+            QCOMPARE(change.operation, chancho::ChangeLog::Operation::INSERT);
+        }
+    }
+    QVERIFY(found);
+}
+
+void
+TestUpgrader::testUpgradeAddsBulkRecurrentTransactions() {
+    // create a database that flagged the generated transactions with is_recurrent 3 and make sure that they are
+    // reset to a boolean
+    chancho::Updater updater;
+    auto dbPath = PublicBook::databasePath();
+    auto accountId = QUuid::createUuid().toString();
+    auto categoryId = QUuid::createUuid().toString();
+
+    PublicBook::initDatabse();
+
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+
+    auto query = db->createQuery();
+    QVERIFY(query->exec(QString("INSERT INTO Accounts(uuid, name, amount) VALUES ('%1', 'Bankia', '0')")
+            .arg(accountId)));
+    QVERIFY(query->exec(QString("INSERT INTO Categories(uuid, name, type) VALUES ('%1', 'Rent', 1)")
+            .arg(categoryId)));
+    foreach(int flag, QList<int>() << 2 << 3) {
+        QVERIFY(query->exec(QString("INSERT INTO Transactions(uuid, amount, account, category, day, month, year, "
+                "is_recurrent) VALUES ('%1', '-5', '%2', '%3', 1, 1, 2015, %4)")
+                .arg(QUuid::createUuid().toString()).arg(accountId).arg(categoryId).arg(flag)));
+    }
+    // the triggers read the table, it is dropped once the rows are stored
+    QVERIFY(query->exec("DROP TABLE BulkRecurrentTransactions"));
+    db->close();
+
+    QVERIFY(updater.needsUpgrade());
+    updater.upgrade();
+    QVERIFY(!updater.needsUpgrade());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Transactions WHERE is_recurrent=1"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 2);
+    db->close();
+}
+
+void
+TestUpgrader::testPrepareDatabaseRefreshesTriggers() {
+    PublicBook::prepareDatabase();
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    // replace the trigger by one with the same name and an older body, the schema looks complete
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TRIGGER UpdateAccountAmountOnTransactionInsert"));
+    QVERIFY(query->exec("CREATE TRIGGER UpdateAccountAmountOnTransactionInsert AFTER INSERT ON Transactions "
+        "WHEN new.is_recurrent IS NOT 1 "
+        "BEGIN "
+        "UPDATE Accounts SET amount=AddStringNumbers(amount, new.amount) WHERE uuid=new.account; "
+        "END"));
+    QVERIFY(query->exec("PRAGMA user_version = 0"));
+    db->close();
+
+    chancho::Updater updater;
+    QVERIFY(!updater.needsUpgrade());
+
+    PublicBook::prepareDatabase();
+    QCOMPARE(updater.getSchemaFingerprint(), PublicBook::schemaFingerprint());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT sql FROM sqlite_master WHERE type='trigger' AND "
+        "name='UpdateAccountAmountOnTransactionInsert'"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toString(), chancho::Book::TRANSACTION_INSERT_TRIGGER);
+    QVERIFY(query->exec("SELECT COUNT(*) FROM sqlite_master WHERE type='trigger'"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), PublicBook::triggers().count());
+    db->close();
+}
+
+void
+TestUpgrader::testPrepareDatabaseStoresFingerprint() {
+    PublicBook::prepareDatabase();
+
+    chancho::Updater updater;
+    QVERIFY(PublicBook::schemaFingerprint() != 0);
+    QCOMPARE(updater.getSchemaFingerprint(), PublicBook::schemaFingerprint());
+    QVERIFY(!updater.needsUpgrade());
+}
+
+void
+TestUpgrader::testPrepareDatabaseSkipsMatchingFingerprint() {
+    PublicBook::prepareDatabase();
+
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    // remove a table, with a matching fingerprint the schema is not looked at
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("DROP TABLE Budgets"));
+    db->close();
+
+    PublicBook::prepareDatabase();
+
+    opened = db->open();
+    QVERIFY(opened);
+    QVERIFY(!db->tables().contains("Budgets", Qt::CaseInsensitive));
+
+    // a different fingerprint forces the upgrade
+    query = db->createQuery();
+    QVERIFY(query->exec("PRAGMA user_version = 0"));
+    db->close();
+
+    PublicBook::prepareDatabase();
+
+    opened = db->open();
+    QVERIFY(opened);
+    QVERIFY(db->tables().contains("Budgets", Qt::CaseInsensitive));
+    db->close();
+
+    chancho::Updater updater;
+    QCOMPARE(updater.getSchemaFingerprint(), PublicBook::schemaFingerprint());
+}
+
+void
+TestUpgrader::testMigrateInBatches() {
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("CREATE TABLE Numbers(value INT PRIMARY KEY)"));
+    QVERIFY(query->exec("CREATE TABLE Copies(value INT PRIMARY KEY)"));
+    for (int value = 1; value <= 25; value++) {
+        QVERIFY(query->exec(QString("INSERT INTO Numbers(value) VALUES (%1)").arg(value)));
+    }
+    db->close();
+
+    TestMigrationsUpdater updater;
+    QVERIFY(updater.needsMigration());
+
+    QList<int> progress;
+    auto migrated = updater.migrate([&progress](QString migration, int done, int total) {
+        QCOMPARE(migration, QString("CopyNumbers"));
+        QCOMPARE(total, 25);
+        progress.append(done);
+    }, 10);
+    QVERIFY(migrated);
+    QCOMPARE(progress, QList<int>() << 10 << 20 << 25);
+    QVERIFY(!updater.needsMigration());
+
+    // a finished migration is not executed again
+    QVERIFY(updater.migrate(TestMigrationsUpdater::MigrationProgress(), 10));
+    QCOMPARE(updater.migration->batches, 3);
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Copies"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 25);
+    db->close();
+}
+
+void
+TestUpgrader::testMigrateResumesAfterFailure() {
+    auto dbPath = PublicBook::databasePath();
+    auto db = sys::DatabaseFactory::instance()->addDatabase("QSQLITE", QTest::currentTestFunction());
+    db->setDatabaseName(dbPath);
+
+    auto opened = db->open();
+    QVERIFY(opened);
+    auto query = db->createQuery();
+    QVERIFY(query->exec("CREATE TABLE Numbers(value INT PRIMARY KEY)"));
+    QVERIFY(query->exec("CREATE TABLE Copies(value INT PRIMARY KEY)"));
+    for (int value = 1; value <= 25; value++) {
+        QVERIFY(query->exec(QString("INSERT INTO Numbers(value) VALUES (%1)").arg(value)));
+    }
+    db->close();
+
+    // fail in the second batch, the first one has been committed
+    TestMigrationsUpdater failing;
+    failing.migration->failAfter = 1;
+    QVERIFY(!failing.migrate(TestMigrationsUpdater::MigrationProgress(), 10));
+    QVERIFY(failing.needsMigration());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Copies"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 10);
+    db->close();
+
+    // a new run continues with the rows after the last committed batch, a copy would fail on the primary key
+    TestMigrationsUpdater updater;
+    QList<int> progress;
+    QVERIFY(updater.migrate([&progress](QString, int done, int) {
+        progress.append(done);
+    }, 10));
+    QCOMPARE(progress, QList<int>() << 20 << 25);
+    QCOMPARE(updater.migration->batches, 2);
+    QVERIFY(!updater.needsMigration());
+
+    opened = db->open();
+    QVERIFY(opened);
+    query = db->createQuery();
+    QVERIFY(query->exec("SELECT COUNT(*) FROM Copies"));
+    QVERIFY(query->next());
+    QCOMPARE(query->value(0).toInt(), 25);
     db->close();
 }
 
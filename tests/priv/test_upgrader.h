@@ -39,6 +39,21 @@ class TestUpgrader : public BaseTestCase {
     void init() override;
     void cleanup() override;
 
+    void testNeedsUpgradeCurrentVersion();
+    void testNeedsUpgradeOlderVersion();
+    void testNeedsUpgradeNoVersion();
     void testUpgradeNoRecurrence();
     void testUpgradeNoRecurrenceRelations();
+    void testUpgradeRecurrenceRelationsToColumn();
+    void testRecurrentTransactionsDuringMigration();
+    void testUpgradeAddsTransactionsSearch();
+    void testUpgradeAddsTransactionId();
+    void testUpgradeAddsArchivedYears();
+    void testUpgradeAddsChanges();
+    void testUpgradeAddsBulkRecurrentTransactions();
+    void testPrepareDatabaseRefreshesTriggers();
+    void testPrepareDatabaseStoresFingerprint();
+    void testPrepareDatabaseSkipsMatchingFingerprint();
+    void testMigrateInBatches();
+    void testMigrateResumesAfterFailure();
 };
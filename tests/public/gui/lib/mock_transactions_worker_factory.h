@@ -87,6 +87,12 @@ class WorkerFactory : public ta::WorkerFactory {
     MOCK_METHOD8(updateTransaction, w::WorkerThread<ta::SingleUpdate>*(qml::Book*, chancho::TransactionPtr, chancho::AccountPtr,
             chancho::CategoryPtr, QDate, QString, QString, double));
     MOCK_METHOD1(generateRecurrentTransactions, w::WorkerThread<ta::GenerateRecurrent>*(qml::Book*));
+    MOCK_METHOD1(migrateDatabase, w::WorkerThread<ta::MigrateDatabase>*(qml::Book*));
+    MOCK_METHOD3(importStatement, w::WorkerThread<ta::ImportStatement>*(qml::Book*, chancho::AccountPtr, QString));
+    MOCK_METHOD3(exportBook, w::WorkerThread<ta::ExportBook>*(qml::Book*, chancho::ExporterPtr, QString));
+    MOCK_METHOD2(backupBook, w::WorkerThread<ta::BackupBook>*(qml::Book*, int));
+    MOCK_METHOD2(restoreBook, w::WorkerThread<ta::RestoreBook>*(qml::Book*, QString));
+    MOCK_METHOD2(buildPayees, w::WorkerThread<ta::BuildPayees>*(qml::Book*, chancho::PayeesPtr));
 };
 
 }
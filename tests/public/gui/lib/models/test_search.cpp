@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test_search.h"
+
+using ::testing::_;
+using ::testing::Field;
+using ::testing::Mock;
+using ::testing::Return;
+
+namespace {
+
+    com::chancho::Book::SearchPage
+    searchPage(int count, qint64 nextRowid) {
+        com::chancho::Book::SearchPage page;
+        for (int index = 0; index < count; index++) {
+            page.transactions.append(std::make_shared<com::chancho::Transaction>());
+        }
+        page.next.rank = -1;
+        page.next.rowid = nextRowid;
+        return page;
+    }
+
+}
+
+void
+TestSearchModel::init() {
+    BaseTestCase::init();
+}
+
+void
+TestSearchModel::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestSearchModel::testEmptyQuery() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+    auto model = std::make_shared<com::chancho::tests::PublicSearchModel>(book);
+
+    EXPECT_CALL(*book.get(), search(_, _, _, _))
+            .Times(0);
+
+    model->setQuery("  ");
+    QVERIFY(!model->canFetchMore(QModelIndex()));
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->rowCount(QModelIndex()), 0);
+
+    QVERIFY(Mock::VerifyAndClearExpectations(book.get()));
+}
+
+void
+TestSearchModel::testFetchPages() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+    auto model = std::make_shared<com::chancho::tests::PublicSearchModel>(book);
+
+    // the first page starts without a cursor and the second one uses the cursor of the first
+    EXPECT_CALL(*book.get(), search(QString("coffee"), _, Field(&com::chancho::Book::SearchCursor::rowid, 0), _))
+            .Times(1)
+            .WillOnce(Return(searchPage(3, 7)));
+
+    EXPECT_CALL(*book.get(), search(QString("coffee"), _, Field(&com::chancho::Book::SearchCursor::rowid, 7), _))
+            .Times(1)
+            .WillOnce(Return(searchPage(2, 0)));
+
+    EXPECT_CALL(*book.get(), isError())
+            .Times(2)
+            .WillRepeatedly(Return(false));
+
+    model->setQuery("coffee");
+    QVERIFY(model->canFetchMore(QModelIndex()));
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->rowCount(QModelIndex()), 3);
+
+    QVERIFY(model->canFetchMore(QModelIndex()));
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->rowCount(QModelIndex()), 5);
+    QVERIFY(!model->canFetchMore(QModelIndex()));
+
+    auto result = model->data(4, Qt::DisplayRole);
+    QVERIFY(result.isValid());
+
+    QVERIFY(Mock::VerifyAndClearExpectations(book.get()));
+}
+
+void
+TestSearchModel::testFetchMoreError() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+    auto model = std::make_shared<com::chancho::tests::PublicSearchModel>(book);
+
+    EXPECT_CALL(*book.get(), search(QString("coffee"), _, _, _))
+            .Times(1)
+            .WillOnce(Return(searchPage(3, 7)));
+
+    EXPECT_CALL(*book.get(), isError())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    EXPECT_CALL(*book.get(), lastError())
+            .Times(1)
+            .WillOnce(Return(QString("Foo")));
+
+    model->setQuery("coffee");
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->rowCount(QModelIndex()), 0);
+    QVERIFY(!model->canFetchMore(QModelIndex()));
+
+    QVERIFY(Mock::VerifyAndClearExpectations(book.get()));
+}
+
+void
+TestSearchModel::testDataOutOfIndex() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+    auto model = std::make_shared<com::chancho::tests::PublicSearchModel>(book);
+
+    auto result = model->data(QModelIndex(), Qt::DisplayRole);
+    QVERIFY(!result.isValid());
+
+    result = model->data(1, Qt::DisplayRole);
+    QVERIFY(!result.isValid());
+
+    QVERIFY(Mock::VerifyAndClearExpectations(book.get()));
+}
+
+void
+TestSearchModel::testTransactionStoredResets() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+    auto model = std::make_shared<com::chancho::tests::PublicSearchModel>(book);
+
+    EXPECT_CALL(*book.get(), search(QString("coffee"), _, _, _))
+            .Times(1)
+            .WillOnce(Return(searchPage(3, 0)));
+
+    EXPECT_CALL(*book.get(), isError())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    model->setQuery("coffee");
+    model->fetchMore(QModelIndex());
+    QCOMPARE(model->rowCount(QModelIndex()), 3);
+    QVERIFY(!model->canFetchMore(QModelIndex()));
+
+    // a new transaction can be part of the results, the search is performed again
+    model->onTransactionStored(QDate(2015, 3, 2));
+    QCOMPARE(model->rowCount(QModelIndex()), 0);
+    QVERIFY(model->canFetchMore(QModelIndex()));
+
+    QVERIFY(Mock::VerifyAndClearExpectations(book.get()));
+}
+
+QTEST_MAIN(TestSearchModel)
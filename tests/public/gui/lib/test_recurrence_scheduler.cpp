@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+#include <gmock/gmock.h>
+
+#include <com/chancho/qml/book.h>
+#include <com/chancho/qml/recurrence_scheduler.h>
+
+#include "book.h"
+#include "mock_accounts_worker_factory.h"
+#include "mock_categories_worker_factory.h"
+#include "mock_transactions_worker_factory.h"
+#include "mock_worker_thread.h"
+#include "public_qml_book.h"
+
+#include "test_recurrence_scheduler.h"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace t = com::chancho::tests;
+
+void
+TestRecurrenceScheduler::init() {
+    BaseTestCase::init();
+}
+
+void
+TestRecurrenceScheduler::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestRecurrenceScheduler::testGenerate() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+    auto worker = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto implementation = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(qmlBook.get()))
+            .Times(1)
+            .WillOnce(Return(worker.get()));
+
+    EXPECT_CALL(*worker.get(), implementation())
+            .WillRepeatedly(Return(implementation.get()));
+
+    EXPECT_CALL(*worker.get(), start())
+            .Times(1);
+
+    com::chancho::qml::RecurrenceScheduler scheduler(qmlBook.get(), transactions);
+    QSignalSpy monthsSpy(&scheduler, SIGNAL(monthGenerated(QDate)));
+
+    scheduler.generate();
+    QVERIFY(scheduler.isRunning());
+
+    // just the months with new transactions are notified
+    QList<QDate> months;
+    months << QDate(2015, 3, 1) << QDate(2015, 4, 1);
+    auto nextDue = QDate::currentDate().addDays(3);
+    emit implementation->generated(months, nextDue);
+
+    QVERIFY(!scheduler.isRunning());
+    QCOMPARE(scheduler.nextDue(), nextDue);
+    QCOMPARE(monthsSpy.count(), 2);
+    QCOMPARE(monthsSpy.at(0).at(0).toDate(), months.at(0));
+    QCOMPARE(monthsSpy.at(1).at(0).toDate(), months.at(1));
+}
+
+void
+TestRecurrenceScheduler::testGenerateWhileRunning() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+    auto first = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto firstImpl = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+    auto second = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto secondImpl = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+
+    // a generation requested while running is executed once the running one is done
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(qmlBook.get()))
+            .Times(2)
+            .WillOnce(Return(first.get()))
+            .WillOnce(Return(second.get()));
+
+    EXPECT_CALL(*first.get(), implementation())
+            .WillRepeatedly(Return(firstImpl.get()));
+    EXPECT_CALL(*first.get(), start())
+            .Times(1);
+
+    EXPECT_CALL(*second.get(), implementation())
+            .WillRepeatedly(Return(secondImpl.get()));
+    EXPECT_CALL(*second.get(), start())
+            .Times(1);
+
+    com::chancho::qml::RecurrenceScheduler scheduler(qmlBook.get(), transactions);
+    scheduler.generate();
+    scheduler.generate();
+    QVERIFY(scheduler.isRunning());
+
+    emit firstImpl->generated(QList<QDate>(), QDate());
+    QVERIFY(scheduler.isRunning());
+
+    emit secondImpl->generated(QList<QDate>(), QDate());
+    QVERIFY(!scheduler.isRunning());
+    QVERIFY(!scheduler.nextDue().isValid());
+}
+
+void
+TestRecurrenceScheduler::testGenerateFailure() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+    auto worker = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto implementation = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(qmlBook.get()))
+            .Times(1)
+            .WillOnce(Return(worker.get()));
+
+    EXPECT_CALL(*worker.get(), implementation())
+            .WillRepeatedly(Return(implementation.get()));
+
+    EXPECT_CALL(*worker.get(), start())
+            .Times(1);
+
+    com::chancho::qml::RecurrenceScheduler scheduler(qmlBook.get(), transactions);
+    QSignalSpy monthsSpy(&scheduler, SIGNAL(monthGenerated(QDate)));
+
+    scheduler.generate();
+    emit implementation->failure();
+
+    // the generation is retried later on
+    QVERIFY(!scheduler.isRunning());
+    QCOMPARE(scheduler.nextDue(), QDate::currentDate());
+    QCOMPARE(monthsSpy.count(), 0);
+}
+
+void
+TestRecurrenceScheduler::testChangesIgnoredBeforeStart() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(_))
+            .Times(0);
+
+    com::chancho::qml::RecurrenceScheduler scheduler(qmlBook.get(), transactions);
+    scheduler.onRecurrentTransactionsChanged();
+    QVERIFY(!scheduler.isRunning());
+    QVERIFY(!scheduler.nextDue().isValid());
+}
+
+void
+TestRecurrenceScheduler::testTransactionStoredIgnored() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+
+    // the startup delay has not passed, only a change of the recurrent transactions would generate right away
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(_))
+            .Times(0);
+
+    qmlBook->scheduleRecurrentTransactions();
+    emit qmlBook->transactionStored(QDate::currentDate());
+    QTest::qWait(100);
+}
+
+void
+TestRecurrenceScheduler::testRecurrentTransactionStored() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+    auto worker = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto implementation = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(qmlBook.get()))
+            .Times(1)
+            .WillOnce(Return(worker.get()));
+
+    EXPECT_CALL(*worker.get(), implementation())
+            .WillRepeatedly(Return(implementation.get()));
+
+    EXPECT_CALL(*worker.get(), start())
+            .Times(1);
+
+    qmlBook->scheduleRecurrentTransactions();
+    emit qmlBook->recurrentTransactionStored();
+    QTest::qWait(100);
+}
+
+void
+TestRecurrenceScheduler::testRecurrentTransactionChangedWhileRunning() {
+    auto book = std::make_shared<t::MockBook>();
+    auto accounts = std::make_shared<t::accounts::WorkerFactory>();
+    auto categories = std::make_shared<t::categories::WorkerFactory>();
+    auto transactions = std::make_shared<t::transactions::WorkerFactory>();
+    auto qmlBook = std::make_shared<t::PublicBook>(book, accounts, categories, transactions);
+    auto first = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto firstImpl = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+    auto second = std::make_shared<t::MockWorkerThread<com::chancho::qml::workers::transactions::GenerateRecurrent>>();
+    auto secondImpl = std::make_shared<t::transactions::MockGenerateRecurrent>(book);
+
+    // a recurrent transaction changed while generating might not have been seen by the running pass
+    EXPECT_CALL(*transactions.get(), generateRecurrentTransactions(qmlBook.get()))
+            .Times(2)
+            .WillOnce(Return(first.get()))
+            .WillOnce(Return(second.get()));
+
+    EXPECT_CALL(*first.get(), implementation())
+            .WillRepeatedly(Return(firstImpl.get()));
+    EXPECT_CALL(*first.get(), start())
+            .Times(1);
+
+    EXPECT_CALL(*second.get(), implementation())
+            .WillRepeatedly(Return(secondImpl.get()));
+    EXPECT_CALL(*second.get(), start())
+            .Times(1);
+
+    com::chancho::qml::RecurrenceScheduler scheduler(qmlBook.get(), transactions);
+    scheduler.generate();
+    scheduler.onRecurrentTransactionsChanged();
+    QVERIFY(scheduler.isRunning());
+
+    emit firstImpl->generated(QList<QDate>(), QDate());
+    QVERIFY(scheduler.isRunning());
+
+    emit secondImpl->generated(QList<QDate>(), QDate());
+    QVERIFY(!scheduler.isRunning());
+}
+
+QTEST_MAIN(TestRecurrenceScheduler)
@@ -505,4 +505,25 @@ TestRecurrentTransaction::testGetRecurrenceType() {
     QCOMPARE(qmlTransaction->getRecurrenceType(), qmlType);
 }
 
+void
+TestRecurrentTransaction::testNextOccurrences() {
+    auto startDate = QDate::currentDate().addDays(-3);
+    auto account = std::make_shared<PublicAccount>("Test account", .0, "");
+    auto category = std::make_shared<com::chancho::Category>("Sushi", com::chancho::Category::Type::EXPENSE);
+    auto transactionPtr = std::make_shared<com::chancho::Transaction>(account, .45, category);
+    auto recurrentPtr = std::make_shared<com::chancho::RecurrentTransaction>(transactionPtr,
+        std::make_shared<com::chancho::RecurrentTransaction::Recurrence>(
+            com::chancho::RecurrentTransaction::Recurrence::Defaults::DAILY, startDate));
+
+    auto qmlTransaction = std::make_shared<com::chancho::tests::PublicRecurrentTransaction>(recurrentPtr);
+    auto result = qmlTransaction->nextOccurrences(3);
+    QCOMPARE(result.count(), 3);
+    QCOMPARE(result.at(0).toDate(), QDate::currentDate().addDays(1));
+    QCOMPARE(result.at(2).toDate(), QDate::currentDate().addDays(3));
+
+    // the end date stops the preview
+    recurrentPtr->recurrence->endDate = QDate::currentDate().addDays(1);
+    QCOMPARE(qmlTransaction->nextOccurrences(3).count(), 1);
+}
+
 QTEST_MAIN(TestRecurrentTransaction)
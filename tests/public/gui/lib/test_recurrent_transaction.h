@@ -80,4 +80,6 @@ class TestRecurrentTransaction : public BaseTestCase {
 
     void testGetRecurrenceType_data();
     void testGetRecurrenceType();
+
+    void testNextOccurrences();
 };
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+
+#include "backup.h"
+
+#include "test_backup_book.h"
+#include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/backup_book.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+namespace tests {
+
+void
+TestBackupBook::init() {
+    BaseTestCase::init();
+}
+
+void
+TestBackupBook::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestBackupBook::testRun() {
+    QString path("/tmp/backups/chancho-20150101-000000000.db");
+    auto backup = std::make_shared<com::chancho::tests::MockBackup>();
+
+    EXPECT_CALL(*backup.get(), isDue(7, _))
+            .Times(1)
+            .WillOnce(Return(true));
+
+    // the backup reports the progress after every step
+    EXPECT_CALL(*backup.get(), backup(_, _))
+            .Times(1)
+            .WillOnce(Invoke([path](com::chancho::Backup::BackupProgress progress, int) {
+                progress(64, 100);
+                progress(100, 100);
+                return path;
+            }));
+
+    EXPECT_CALL(*backup.get(), isError())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::BackupBook>(backup, 7);
+
+    QSignalSpy progressSpy(worker.get(), SIGNAL(progress(int, int)));
+    QSignalSpy backedUpSpy(worker.get(), SIGNAL(backedUp(QString)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(progressSpy.count(), 2);
+    QCOMPARE(backedUpSpy.count(), 1);
+    QCOMPARE(backedUpSpy.takeFirst().at(0).toString(), path);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+void
+TestBackupBook::testRunError() {
+    auto backup = std::make_shared<com::chancho::tests::MockBackup>();
+
+    EXPECT_CALL(*backup.get(), isDue(_, _))
+            .Times(0);
+
+    EXPECT_CALL(*backup.get(), backup(_, _))
+            .Times(1)
+            .WillOnce(Return(QString()));
+
+    EXPECT_CALL(*backup.get(), isError())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    // without an interval the backup is always done
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::BackupBook>(backup, 0);
+
+    QSignalSpy backedUpSpy(worker.get(), SIGNAL(backedUp(QString)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(backedUpSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+void
+TestBackupBook::testRunNotDue() {
+    auto backup = std::make_shared<com::chancho::tests::MockBackup>();
+
+    EXPECT_CALL(*backup.get(), isDue(7, _))
+            .Times(1)
+            .WillOnce(Return(false));
+
+    EXPECT_CALL(*backup.get(), backup(_, _))
+            .Times(0);
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::BackupBook>(backup, 7);
+
+    QSignalSpy backedUpSpy(worker.get(), SIGNAL(backedUp(QString)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(backedUpSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+}
+}
+}
+}
+}
+}
+
+QTEST_MAIN(com::chancho::qml::workers::transactions::tests::TestBackupBook)
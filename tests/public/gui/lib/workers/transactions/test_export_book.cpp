@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+
+#include "exporter.h"
+
+#include "test_export_book.h"
+#include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/export_book.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+namespace tests {
+
+void
+TestExportBook::init() {
+    BaseTestCase::init();
+}
+
+void
+TestExportBook::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestExportBook::testRun() {
+    QString path("/tmp/book.csv");
+    auto exporter = std::make_shared<com::chancho::tests::MockExporter>();
+
+    // the exporter reports the progress every time the buffer is written
+    EXPECT_CALL(*exporter.get(), exportTo(path, _))
+            .Times(1)
+            .WillOnce(Invoke([](QString, com::chancho::Exporter::ExportProgress progress) {
+                progress(1000, 1500);
+                progress(1500, 1500);
+                return 1500;
+            }));
+
+    EXPECT_CALL(*exporter.get(), isError())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    EXPECT_CALL(*exporter.get(), wasCancelled())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::ExportBook>(exporter, path);
+
+    QSignalSpy progressSpy(worker.get(), SIGNAL(progress(qint64, qint64)));
+    QSignalSpy exportedSpy(worker.get(), SIGNAL(exported(QString, qint64)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(progressSpy.count(), 2);
+    auto arguments = progressSpy.takeLast();
+    QCOMPARE(arguments.at(0).toLongLong(), 1500LL);
+    QCOMPARE(arguments.at(1).toLongLong(), 1500LL);
+    QCOMPARE(exportedSpy.count(), 1);
+    arguments = exportedSpy.takeFirst();
+    QCOMPARE(arguments.at(0).toString(), path);
+    QCOMPARE(arguments.at(1).toLongLong(), 1500LL);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+void
+TestExportBook::testRunError() {
+    QString path("/tmp/book.csv");
+    auto exporter = std::make_shared<com::chancho::tests::MockExporter>();
+
+    EXPECT_CALL(*exporter.get(), exportTo(path, _))
+            .Times(1)
+            .WillOnce(Return(0));
+
+    EXPECT_CALL(*exporter.get(), isError())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::ExportBook>(exporter, path);
+
+    QSignalSpy exportedSpy(worker.get(), SIGNAL(exported(QString, qint64)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(exportedSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+void
+TestExportBook::testRunCancelled() {
+    QString path("/tmp/book.csv");
+    auto exporter = std::make_shared<com::chancho::tests::MockExporter>();
+
+    EXPECT_CALL(*exporter.get(), exportTo(path, _))
+            .Times(1)
+            .WillOnce(Return(10));
+
+    EXPECT_CALL(*exporter.get(), isError())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    EXPECT_CALL(*exporter.get(), wasCancelled())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::ExportBook>(exporter, path);
+
+    QSignalSpy exportedSpy(worker.get(), SIGNAL(exported(QString, qint64)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(exportedSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+}
+}
+}
+}
+}
+}
+
+QTEST_MAIN(com::chancho::qml::workers::transactions::tests::TestExportBook)
@@ -30,6 +30,7 @@
 #include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/generate_recurrent.h"
 
 using ::testing::_;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::Matcher;
 using ::testing::Return;
@@ -60,24 +61,38 @@ void
 TestGenerateRecurrent::testRun() {
     auto book = std::make_shared<com::chancho::tests::MockBook>();
 
+    QList<QDate> months;
+    months << QDate(2015, 3, 1) << QDate(2015, 4, 1);
+    auto nextDue = QDate(2015, 4, 20);
+
     EXPECT_CALL(*book.get(),
-                generateRecurrentTransactions())
-            .Times(1);
+                generateRecurrentTransactions(_, _))
+            .Times(1)
+            .WillOnce(Return(months));
 
-    EXPECT_CALL(*book.get(), isError())
+    EXPECT_CALL(*book.get(), nextRecurrentDueDate())
             .Times(1)
-            .WillOnce(Return(false));
+            .WillOnce(Return(nextDue));
+
+    EXPECT_CALL(*book.get(), isError())
+            .Times(2)
+            .WillRepeatedly(Return(false));
 
     auto worker = std::make_shared<com::chancho::qml::workers::transactions::GenerateRecurrent>(book);
 
     // ensure that the signals are indeed fired
     QSignalSpy successSpy(worker.get(), SIGNAL(success()));
     QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+    QSignalSpy generatedSpy(worker.get(), SIGNAL(generated(QList<QDate>, QDate)));
 
     worker->run();
 
     QCOMPARE(successSpy.count(), 1);
     QCOMPARE(failureSpy.count(), 0);
+    QCOMPARE(generatedSpy.count(), 1);
+    auto arguments = generatedSpy.takeFirst();
+    QCOMPARE(arguments.at(0).value<QList<QDate>>(), months);
+    QCOMPARE(arguments.at(1).toDate(), nextDue);
 }
 
 void
@@ -85,13 +100,16 @@ TestGenerateRecurrent::testRunBookError() {
     auto book = std::make_shared<com::chancho::tests::MockBook>();
 
     EXPECT_CALL(*book.get(),
-                generateRecurrentTransactions())
+                generateRecurrentTransactions(_, _))
             .Times(1);
 
     EXPECT_CALL(*book.get(), isError())
             .Times(1)
             .WillOnce(Return(true));
 
+    EXPECT_CALL(*book.get(), nextRecurrentDueDate())
+            .Times(0);
+
     auto worker = std::make_shared<com::chancho::qml::workers::transactions::GenerateRecurrent>(book);
 
     // ensure that the signals are indeed fired
@@ -104,6 +122,43 @@ TestGenerateRecurrent::testRunBookError() {
     QCOMPARE(failureSpy.count(), 1);
 }
 
+void
+TestGenerateRecurrent::testRunProgress() {
+    auto book = std::make_shared<com::chancho::tests::MockBook>();
+
+    // the book reports the progress after every stored chunk
+    EXPECT_CALL(*book.get(),
+                generateRecurrentTransactions(_, _))
+            .Times(1)
+            .WillOnce(Invoke([](com::chancho::Book::GenerationProgress progress, int) {
+                progress(500, 1200);
+                progress(1000, 1200);
+                progress(1200, 1200);
+                return QList<QDate>();
+            }));
+
+    EXPECT_CALL(*book.get(), nextRecurrentDueDate())
+            .Times(1)
+            .WillOnce(Return(QDate()));
+
+    EXPECT_CALL(*book.get(), isError())
+            .Times(2)
+            .WillRepeatedly(Return(false));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::GenerateRecurrent>(book);
+
+    QSignalSpy progressSpy(worker.get(), SIGNAL(progress(int, int)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+
+    worker->run();
+
+    QCOMPARE(progressSpy.count(), 3);
+    auto arguments = progressSpy.takeLast();
+    QCOMPARE(arguments.at(0).toInt(), 1200);
+    QCOMPARE(arguments.at(1).toInt(), 1200);
+    QCOMPARE(successSpy.count(), 1);
+}
+
 }
 }
 }
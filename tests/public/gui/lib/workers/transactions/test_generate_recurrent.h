@@ -52,6 +52,7 @@ class TestGenerateRecurrent : public BaseTestCase {
 
     void testRun();
     void testRunBookError();
+    void testRunProgress();
 };
 
 }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+
+#include "importer.h"
+
+#include "test_import_statement.h"
+#include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/import_statement.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+namespace tests {
+
+void
+TestImportStatement::init() {
+    BaseTestCase::init();
+    qRegisterMetaType<QList<QDate>>("QList<QDate>");
+}
+
+void
+TestImportStatement::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestImportStatement::testRun() {
+    QString path("/tmp/statement.csv");
+    QList<QDate> months;
+    months << QDate(2015, 1, 1) << QDate(2015, 2, 1);
+    auto importer = std::make_shared<com::chancho::tests::MockImporter>();
+
+    // the importer reports the progress after every stored batch
+    EXPECT_CALL(*importer.get(), import(path, _, _))
+            .Times(1)
+            .WillOnce(Invoke([months](QString, com::chancho::Importer::ImportProgress progress, int) {
+                progress(512, 1024);
+                progress(1024, 1024);
+                return months;
+            }));
+
+    EXPECT_CALL(*importer.get(), isError())
+            .Times(1)
+            .WillOnce(Return(false));
+
+    EXPECT_CALL(*importer.get(), imported())
+            .Times(1)
+            .WillOnce(Return(30));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::ImportStatement>(importer, path);
+
+    QSignalSpy progressSpy(worker.get(), SIGNAL(progress(qint64, qint64)));
+    QSignalSpy importedSpy(worker.get(), SIGNAL(imported(QList<QDate>, int)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(progressSpy.count(), 2);
+    auto arguments = progressSpy.takeLast();
+    QCOMPARE(arguments.at(0).toLongLong(), 1024LL);
+    QCOMPARE(arguments.at(1).toLongLong(), 1024LL);
+    QCOMPARE(importedSpy.count(), 1);
+    arguments = importedSpy.takeFirst();
+    QCOMPARE(arguments.at(0).value<QList<QDate>>(), months);
+    QCOMPARE(arguments.at(1).toInt(), 30);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+void
+TestImportStatement::testRunError() {
+    QString path("/tmp/statement.csv");
+    auto importer = std::make_shared<com::chancho::tests::MockImporter>();
+
+    EXPECT_CALL(*importer.get(), import(path, _, _))
+            .Times(1)
+            .WillOnce(Return(QList<QDate>()));
+
+    EXPECT_CALL(*importer.get(), isError())
+            .Times(1)
+            .WillOnce(Return(true));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::ImportStatement>(importer, path);
+
+    QSignalSpy importedSpy(worker.get(), SIGNAL(imported(QList<QDate>, int)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(importedSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+}
+}
+}
+}
+}
+}
+
+QTEST_MAIN(com::chancho::qml::workers::transactions::tests::TestImportStatement)
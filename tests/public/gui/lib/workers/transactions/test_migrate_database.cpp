@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+
+#include "updater.h"
+
+#include "test_migrate_database.h"
+#include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/migrate_database.h"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+namespace tests {
+
+void
+TestMigrateDatabase::init() {
+    BaseTestCase::init();
+}
+
+void
+TestMigrateDatabase::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestMigrateDatabase::testRun() {
+    auto updater = std::make_shared<com::chancho::tests::MockUpdater>();
+
+    // the updater reports the progress after every committed batch
+    EXPECT_CALL(*updater.get(), migrate(_, _))
+            .Times(1)
+            .WillOnce(Invoke([](com::chancho::Updater::MigrationProgress progress, int) {
+                progress("Relations", 500, 700);
+                progress("Relations", 700, 700);
+                return true;
+            }));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::MigrateDatabase>(updater);
+
+    QSignalSpy progressSpy(worker.get(), SIGNAL(progress(QString, int, int)));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(progressSpy.count(), 2);
+    auto arguments = progressSpy.takeLast();
+    QCOMPARE(arguments.at(0).toString(), QString("Relations"));
+    QCOMPARE(arguments.at(1).toInt(), 700);
+    QCOMPARE(arguments.at(2).toInt(), 700);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+void
+TestMigrateDatabase::testRunError() {
+    auto updater = std::make_shared<com::chancho::tests::MockUpdater>();
+
+    EXPECT_CALL(*updater.get(), migrate(_, _))
+            .Times(1)
+            .WillOnce(Return(false));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::MigrateDatabase>(updater);
+
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+}
+}
+}
+}
+}
+}
+
+QTEST_MAIN(com::chancho::qml::workers::transactions::tests::TestMigrateDatabase)
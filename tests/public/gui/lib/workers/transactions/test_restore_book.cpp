@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015 Manuel de la Peña <mandel@themacaque.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <QSignalSpy>
+
+#include "backup.h"
+
+#include "test_restore_book.h"
+#include "../../../../../../src/public/gui/lib/com/chancho/qml/workers/transactions/restore_book.h"
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace com {
+
+namespace chancho {
+
+namespace qml {
+
+namespace workers {
+
+namespace transactions {
+
+namespace tests {
+
+void
+TestRestoreBook::init() {
+    BaseTestCase::init();
+}
+
+void
+TestRestoreBook::cleanup() {
+    BaseTestCase::cleanup();
+}
+
+void
+TestRestoreBook::testRun() {
+    QString path("/tmp/backups/chancho-20150101-000000000.db");
+    auto backup = std::make_shared<com::chancho::tests::MockBackup>();
+
+    EXPECT_CALL(*backup.get(), restore(path))
+            .Times(1)
+            .WillOnce(Return(true));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::RestoreBook>(backup, path);
+
+    QSignalSpy restoredSpy(worker.get(), SIGNAL(restored()));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(restoredSpy.count(), 1);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(failureSpy.count(), 0);
+}
+
+void
+TestRestoreBook::testRunError() {
+    QString path("/tmp/backups/chancho-20150101-000000000.db");
+    auto backup = std::make_shared<com::chancho::tests::MockBackup>();
+
+    EXPECT_CALL(*backup.get(), restore(path))
+            .Times(1)
+            .WillOnce(Return(false));
+
+    auto worker = std::make_shared<com::chancho::qml::workers::transactions::RestoreBook>(backup, path);
+
+    QSignalSpy restoredSpy(worker.get(), SIGNAL(restored()));
+    QSignalSpy successSpy(worker.get(), SIGNAL(success()));
+    QSignalSpy failureSpy(worker.get(), SIGNAL(failure()));
+
+    worker->run();
+
+    QCOMPARE(restoredSpy.count(), 0);
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(failureSpy.count(), 1);
+}
+
+}
+}
+}
+}
+}
+}
+
+QTEST_MAIN(com::chancho::qml::workers::transactions::tests::TestRestoreBook)